@@ -0,0 +1,9 @@
+@echo off
+rem Compare script VM modes on each level of each sample game,
+rem fails if any mode differs from the bytecode interpreter.
+set Failed=0
+for %%G in (Games\*.flg) do (
+	Flu.exe "%%G" Entry -scriptdiff "%%~nG.ScriptDiff.json"
+	if errorlevel 1 set Failed=1
+)
+exit /b %Failed%
\ No newline at end of file
@@ -14,6 +14,8 @@
 #include <tchar.h>
 #include <windows.h>
 #include <windowsx.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
    
 #pragma pack( push, 8 )
 #include <DbgHelp.h>
@@ -30,6 +32,7 @@
 #include "..\GUI\GUI.h"
 #include "..\Render\OpenGL\OpenGLRend.h"
 #include "..\Audio\OpenAL\OpenALAud.h"
+#include "..\Win32\FrWinJobs.h"
 
 
 // Partial classes tree.
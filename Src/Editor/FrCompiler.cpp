@@ -64,6 +64,97 @@ static const Char*	GEvents[_EVENT_MAX]	=
 static Word GTempWord	= 0xCAFE; 
 
 
+//
+// Size of the Integer or Float constant load:
+// opcode, value and register.
+//
+#define FOLD_CONST_SIZE		6
+
+
+//
+// Return true, if constants of this type could
+// be folded at compile time.
+//
+static Bool IsFoldable( const CTypeInfo& Type )
+{
+	return	Type.ArrayDim == 1 &&
+			(Type.Type == TYPE_Integer || Type.Type == TYPE_Float);
+}
+
+
+//
+// Evaluate an operator with both constant operands.
+// Return false, if the operator couldn't be folded, or
+// it would be an error at run time. Integer arithmetic
+// wraps around as in the VM, operands which are undefined
+// in C++ are left for the run time.
+//
+static Bool FoldConstants( Byte iOpCode, DWord A, DWord B, DWord& Result )
+{
+	Integer	iA = *(Integer*)&A,	iB = *(Integer*)&B,	iR;
+	Float	fA = *(Float*)&A,	fB = *(Float*)&B,	fR;
+	DWord	dR;
+
+	switch( iOpCode )
+	{
+		case BIN_Add_Integer:	dR = A + B;			goto DWordResult;
+		case BIN_Sub_Integer:	dR = A - B;			goto DWordResult;
+		case BIN_Mult_Integer:	dR = A * B;			goto DWordResult;
+		case BIN_And_Integer:	iR = iA & iB;		break;
+		case BIN_Or_Integer:	iR = iA | iB;		break;
+		case BIN_Xor_Integer:	iR = iA ^ iB;		break;
+
+		case BIN_Shl_Integer:
+			if( iB < 0 || iB > 31 )
+				return false;
+			dR = A << iB;
+			goto DWordResult;
+
+		case BIN_Shr_Integer:
+			if( iB < 0 || iB > 31 )
+				return false;
+			iR = iA >> iB;
+			break;
+
+		case BIN_Div_Integer:
+			if( iB == 0 || (A == 0x80000000 && iB == -1) )
+				return false;
+			iR = iA / iB;
+			break;
+
+		case BIN_Mod_Integer:
+			if( iB == 0 || (A == 0x80000000 && iB == -1) )
+				return false;
+			iR = iA % iB;
+			break;
+
+		case BIN_Add_Float:		fR = fA + fB;		goto FloatResult;
+		case BIN_Sub_Float:		fR = fA - fB;		goto FloatResult;
+		case BIN_Mult_Float:	fR = fA * fB;		goto FloatResult;
+
+		case BIN_Div_Float:
+			if( fB == 0.f )
+				return false;
+			fR = fA / fB;
+			goto FloatResult;
+
+		default:
+			return false;
+	}
+
+	Result = *(DWord*)&iR;
+	return true;
+
+DWordResult:
+	Result = dR;
+	return true;
+
+FloatResult:
+	Result = *(DWord*)&fR;
+	return true;
+}
+
+
 //
 // An current object context. It's should
 // be tracked to reduce bytecode length.
@@ -144,6 +235,26 @@ public:
 	TArray<CProperty*>			Properties;		// Old properties.
 	TArray<CEnum*>				Enums;			// Old enumeration, still referenced by properties above.
 	TArray<CInstanceBuffer*>	Buffers;		// All instance buffers of this script from the entities and script.
+	Double						Time;			// Compilation time, in seconds.
+};
+
+
+/*-----------------------------------------------------------------------------
+    TSourceScript.
+-----------------------------------------------------------------------------*/
+
+//
+// A script with the text. Only scripts changed since
+// the last compilation, and scripts depend on them are
+// recompiled, others keep their code.
+//
+struct TSourceScript
+{
+public:
+	FScript*					Script;			// Source script.
+	DWord						Hash;			// Hash of the current source.
+	Integer						OldFamily;		// Family before parsing headers.
+	Bool						bDirty;			// Whether script should be recompiled.
 };
 
 
@@ -162,11 +273,13 @@ public:
 	CTypeInfo	Type;
 	Bool		bLValue;
 	Byte		iReg;
+	Integer		iConst;		// Address of the constant load, or -1.
 
 	// Constructor.
 	TExprResult()
 		:	bLValue( false ),
-			iReg( 0xff )
+			iReg( 0xff ),
+			iConst( -1 )
 	{}
 };
 
@@ -175,6 +288,20 @@ public:
     CCodeEmitter.
 -----------------------------------------------------------------------------*/
 
+//
+// A reference to the script table from the code.
+// Code is compiled with own tables, since functions
+// are compiled in parallel, and indexes are patched
+// after merging tables to the script.
+//
+struct TTableRef
+{
+public:
+	Word				Addr;		// Location of index in code.
+	Bool				bString;	// String or resource index.
+};
+
+
 //
 // A bytecode emitter.
 //
@@ -183,10 +310,15 @@ class CCodeEmitter: public CSerializer
 public:
 	// Variables.
 	CBytecode*			Bytecode;
+	TArray<String>		Strings;
+	TArray<FResource*>	Resources;
+	TArray<TTableRef>	Refs;
 
 	// CCodeEmitter interface.
 	CCodeEmitter();
 	void SetBytecode( CBytecode* InBytecode );
+	void EmitString( const String& Str );
+	void EmitResource( FResource* Res );
 
 	// CSerializer interface.
 	void SerializeData( void* Mem, DWord Count );
@@ -200,7 +332,7 @@ public:
 // Emitter macro.
 //
 #define emit(v)			Serialize( Emitter, v );
-#define emit_const(v)	Serialize( Emitter, Script, v );
+#define emit_const(v)	Serialize( Emitter, v );
 
 
 /*-----------------------------------------------------------------------------
@@ -261,6 +393,34 @@ public:
 };
 
 
+/*-----------------------------------------------------------------------------
+    TCodeTask.
+-----------------------------------------------------------------------------*/
+
+//
+// A function or thread body to compile. Bodies are
+// independent, so they are compiled in parallel, each
+// with own compiler, and results are merged to scripts
+// in the serial order.
+//
+struct TCodeTask
+{
+public:
+	FScript*					Script;			// Owner script.
+	CBytecode*					Bytecode;		// Code to compile.
+	TArray<CProperty*>			Locals;			// Function locals, other tasks see only parameters.
+	DWord						FrameSize;		// Function frame size.
+	TArray<String>				Strings;		// Own string table.
+	TArray<FResource*>			Resources;		// Own resource table.
+	TArray<TTableRef>			Refs;			// Indexes to patch.
+	TArray<String>				Depends;		// Scripts code depends on.
+	TArray<String>				Warnings;		// Compilation warnings.
+	TCompilerError				Error;			// Error, if failed.
+	Bool						bFailed;		// Whether compilation failed.
+	Double						Time;			// Compilation time, in seconds.
+};
+
+
 /*-----------------------------------------------------------------------------
     CCompiler.
 -----------------------------------------------------------------------------*/
@@ -276,6 +436,9 @@ public:
 	~CCompiler();
 	Bool CompileAll( Bool bSilent );
 
+	// Whether compile bodies in parallel.
+	static Bool bParallel;
+
 private:
 	// Errors.
 	TArray<String>&						Warnings;		
@@ -288,12 +451,27 @@ private:
 	// General.
 	FScript*							Script;			
 	TArray<TStoredScript>				Storage;	
+	TArray<TSourceScript>				Sources;
 	TArray<FScript*>					AllScripts;
 	TArray<CFamily*>					Families;
+	String								Layout;
+
+	// Families layout after the last successful
+	// compilation, family number is hardcoded in
+	// the bytecode.
+	static String						LastLayout;
 
 	// First pass variables.
 	EAccessModifier						Access;
 	TArray<TToken>						Constants;		
+	TArray<FScript*>					ConstScripts;	// Script of each constant.
+
+	// Parallel compilation.
+	TArray<TCodeTask>					Tasks;
+	TArray<CCompiler*>					Workers;
+	TArray<TArray<String>>				WorkerWarnings;
+	TArray<TCompilerError>				WorkerErrors;
+	TCodeTask*							CodeTask;
 
 	// Second pass variables.
 	CCodeEmitter						Emitter;
@@ -305,17 +483,31 @@ private:
 	Bool								Regs[TRegister::NUM_REGS];
 	
 	// Top level functions.
-	void StoreAllScripts();
+	void CollectScripts();
+	Bool MarkDirtyScripts();
+	Bool IsDirty( String Name );
+	void StoreScript( FScript* InScript );
+	void RestoreFamilies();
 	void RestoreAfterFailure();
 	void RestoreAfterSuccess();
 	void ParseHeader( FScript* InScript );
 	void CompileFirstPass( FScript* InScript );
+	void CollectConstants( FScript* InScript );
 	void CompileSecondPass( FScript* InScript );
+	void AddTask( CBytecode* InCode );
+	void CompileTasks();
+	void CompileTask( TCodeTask& Task );
+	void MergeTask( TCodeTask& Task );
+	static void CompileTaskJob( void* Param, Integer iJob, Integer iWorker );
 
 	// Errors & warnings.
 	void Error( const Char* Fmt, ... );
 	void Warn( const Char* Fmt, ... );
 
+	// Dependencies.
+	void AddDependency( FScript* Other );
+	void AddDependency( CFamily* Family );
+
 	// Expression compilation.
 	TExprResult CompileExpr( const CTypeInfo& ReqType, Bool bForceR, Bool bAllowAssign = false, DWord InPri = 0 );
 	Bool CompileEntityExpr( EEntityContext InContext, CTypeInfo Entity, Byte iConReg, TExprResult& Result );
@@ -407,6 +599,39 @@ void CCodeEmitter::SetBytecode( CBytecode* InBytecode )
 {
 	assert(InBytecode);
 	Bytecode	= InBytecode;
+	Strings.Empty();
+	Resources.Empty();
+	Refs.Empty();
+}
+
+
+//
+// Emit an index of the string constant.
+//
+void CCodeEmitter::EmitString( const String& Str )
+{
+	TTableRef Ref;
+	Ref.Addr	= Tell();
+	Ref.bString	= true;
+	Refs.Push( Ref );
+
+	Word iStr	= Strings.AddUnique( Str );
+	Serialize( *this, iStr );
+}
+
+
+//
+// Emit an index of the resource.
+//
+void CCodeEmitter::EmitResource( FResource* Res )
+{
+	TTableRef Ref;
+	Ref.Addr	= Tell();
+	Ref.bString	= false;
+	Refs.Push( Ref );
+
+	Byte iRes	= Resources.AddUnique( Res );
+	Serialize( *this, iRes );
 }
 
 
@@ -474,7 +699,7 @@ static void Serialize( CSerializer& S, EPropType V )
 //
 // TToken's constant value serialization.
 //
-static void Serialize( CSerializer& S, FScript* Owner, TToken& Const )
+static void Serialize( CCodeEmitter& S, TToken& Const )
 {
 	assert(Const.Type == TOK_Const);
 
@@ -511,9 +736,11 @@ static void Serialize( CSerializer& S, FScript* Owner, TToken& Const )
 			break;	
 
 		case TYPE_String:
+		{
 			Serialize( S, CODE_ConstString );
-			Serialize( S, Const.cString );
+			S.EmitString( Const.cString );
 			break;	
+		}
 
 		case TYPE_Vector:
 			Serialize( S, CODE_ConstVector );
@@ -535,9 +762,7 @@ static void Serialize( CSerializer& S, FScript* Owner, TToken& Const )
 			if( Const.cResource )
 			{
 				// Add to list.
-				Byte iRes = Owner->ResTable.AddUnique( Const.cResource );
-				assert(Owner->ResTable.Num() < 256);
-				Serialize( S, iRes );
+				S.EmitResource( Const.cResource );
 			}
 			else
 			{
@@ -557,6 +782,27 @@ static void Serialize( CSerializer& S, FScript* Owner, TToken& Const )
     CCompiler implementation.
 -----------------------------------------------------------------------------*/
 
+//
+// Families layout after the last successful compilation.
+//
+String CCompiler::LastLayout	= L"";
+
+
+//
+// Whether compile bodies in parallel.
+//
+Bool CCompiler::bParallel		= true;
+
+
+//
+// Whether script A compiled slower than B.
+//
+static Bool SlowerScript( TStoredScript* const& A, TStoredScript* const& B )
+{
+	return A->Time > B->Time;
+}
+
+
 //
 // Compiler constructor.
 //
@@ -566,7 +812,8 @@ CCompiler::CCompiler( TArray<String>& OutWarnings, TCompilerError& OutFatalError
 		Storage(),
 		Emitter(),
 		Families(),
-		Bytecode( nullptr )
+		Bytecode( nullptr ),
+		CodeTask( nullptr )
 {
 }
 
@@ -601,44 +848,96 @@ Bool CCompiler::CompileAll( Bool bSilent )
 		FatalError.Script		= nullptr;
 
 		log( L"** COMPILATION BEGAN **" );
+		Double StartTime	= GPlat->TimeStamp();
 
-		// Perform compilation step by step.
+		// Perform compilation step by step. Headers of all
+		// scripts are parsed, since families are temporal.
 		if( !bSilent ) GEditor->TaskDialog->UpdateSubtask(L"Collecting");
-		StoreAllScripts();
+		CollectScripts();
 
-		for( Integer i=0; i<Storage.Num(); i++ )
-			ParseHeader( Storage[i].Script );
+		for( Integer i=0; i<Sources.Num(); i++ )
+			ParseHeader( Sources[i].Script );
+
+		// Figure out what should be recompiled.
+		Bool bComplete	= MarkDirtyScripts();
+
+		for( Integer i=0; i<Sources.Num(); i++ )
+			if( Sources[i].bDirty )
+				StoreScript( Sources[i].Script );
+
+		RestoreFamilies();
 
+		// Constants are shared between scripts, so collect them
+		// from unchanged scripts, in the same order.
 		if( !bSilent ) GEditor->TaskDialog->UpdateSubtask(L"First-Pass Compiling");
-		for( Integer i=0; i<Storage.Num(); i++ )
+		for( Integer i=0, iSlot=0; i<Sources.Num(); i++ )
 		{
-			if( !bSilent && !(i & 3) ) GEditor->TaskDialog->UpdateProgress( i, Storage.Num() );
-			CompileFirstPass( Storage[i].Script );
+			if( !bSilent && !(i & 3) ) GEditor->TaskDialog->UpdateProgress( i, Sources.Num() );
+			if( Sources[i].bDirty )
+			{
+				assert(Storage[iSlot].Script == Sources[i].Script);
+				Double Time	= GPlat->TimeStamp();
+				CompileFirstPass( Storage[iSlot].Script );
+				Storage[iSlot++].Time	+= GPlat->TimeStamp() - Time;
+			}
+			else
+				CollectConstants( Sources[i].Script );
 		}
 
 		if( !bSilent ) GEditor->TaskDialog->UpdateSubtask(L"Second-Pass Compiling");
 		for( Integer i=0; i<Storage.Num(); i++ )
 		{
+			Double Time	= GPlat->TimeStamp();
 			CompileSecondPass( Storage[i].Script );
+			Storage[i].Time	+= GPlat->TimeStamp() - Time;
 			if( !bSilent && !(i & 3) ) GEditor->TaskDialog->UpdateProgress( i, Storage.Num() );
 		}
 
+		CompileTasks();
+
+		// Tasks are in order of scripts.
+		for( Integer i=0, iSlot=0; i<Tasks.Num(); i++ )
+		{
+			while( Storage[iSlot].Script != Tasks[i].Script )
+				iSlot++;
+			Storage[iSlot].Time	+= Tasks[i].Time;
+		}
+
 		RestoreAfterSuccess();
 
+		// Now compiled code matches the source.
+		for( Integer i=0; i<Sources.Num(); i++ )
+			if( Sources[i].bDirty )
+				Sources[i].Script->SourceHash	= Sources[i].Hash;
+		LastLayout	= Layout;
+
 		// Count lines.
 		Integer  NumLines = 0;
 		for( Integer i=0; i<Storage.Num(); i++ )
 			NumLines += Storage[i].Script->Text.Num();
 
+		// Sort compiled scripts, slowest first.
+		TArray<TStoredScript*> Slowest;
+		for( Integer i=0; i<Storage.Num(); i++ )
+			Slowest.Push( &Storage[i] );
+		Slowest.Sort( SlowerScript );
+
 		// Everything ok, so notify and return.
 		log( L"Compiler: COMPILATION SUCCESSFULLY" );
-		log( L"Compiler: %d scripts compiled", Storage.Num() );
+		log( L"Compiler: %d scripts compiled, %d up to date", Storage.Num(), Sources.Num()-Storage.Num() );
 		log( L"Compiler: %d lines compiled", NumLines );
+		for( Integer i=0; i<Slowest.Num(); i++ )
+			log( L"Compiler: '%s' compiled in %.2f ms", *Slowest[i]->Script->GetName(), Slowest[i]->Time*1000.0 );
+		log( L"Compiler: Total time %.2f ms", (GPlat->TimeStamp()-StartTime)*1000.0 );
 
 		// Add to compilation log.
 		Warnings.Push( L"---" );
-		Warnings.Push(String::Format( L"%d scripts compiled", Storage.Num() ));
+		if( bComplete )
+			Warnings.Push( L"Complete compilation" );
+		Warnings.Push(String::Format( L"%d scripts compiled, %d up to date", Storage.Num(), Sources.Num()-Storage.Num() ));
 		Warnings.Push(String::Format( L"%d lines compiled", NumLines ));
+		for( Integer i=0; i<Min( Slowest.Num(), 5 ); i++ )
+			Warnings.Push(String::Format( L"'%s' compiled in %.2f ms", *Slowest[i]->Script->GetName(), Slowest[i]->Time*1000.0 ));
 
 		return true;
 	}
@@ -756,6 +1055,59 @@ void CCompiler::CompileFirstPass( FScript* InScript )
 }
 
 
+//
+// Collect constants of the unchanged script, other 
+// declarations are skipped, since script keeps them.
+//
+void CCompiler::CollectConstants( FScript* InScript )
+{
+	// Prepare compiler.
+	Script				= InScript;
+	TextLine			= 0;
+	TextPos				= 0;
+	PrevLine			= 0;
+	PrevPos				= 0;	
+
+	// Skip header.
+	RequireIdentifier( KW_script, L"script header" );
+	RequireIdentifier( *Script->GetName(), L"script header" );
+
+	if( MatchSymbol(L":") )
+	{
+		RequireIdentifier( KW_family, L"script header" );
+		GetIdentifier(L"script family");
+	}
+
+	RequireSymbol( L"{", L"script body" );
+
+	// Walk through the script body, constants are
+	// declared only on the top level.
+	Integer Level = 1;
+	do 
+	{
+		TToken T;
+		GetToken( T, false, false );
+
+		if( T.Type == TOK_Symbol && T.Text == L"{" )
+		{
+			// Push nest level.
+			Level++;
+		}
+		else if( T.Type == TOK_Symbol && T.Text == L"}" )
+		{
+			// Pop nest level.
+			Level--;
+		}
+		else if( Level == 1 && T.Type == TOK_Identifier && T.Text == KW_const )
+		{
+			// Constant declaration.
+			GotoToken( T );
+			CompileConstDecl();
+		}
+	} while( Level != 0 );
+}
+
+
 //
 // Compile script second pass.
 //
@@ -789,14 +1141,219 @@ void CCompiler::CompileSecondPass( FScript* InScript )
 			Script->Events[iEvent]	= Func;
 		}
 
-	// Compile actor thread if it specified. It's important to compile the thread
-	// before functions.
+	// Add actor thread if it specified. It's important to compile the thread
+	// before functions, tasks are merged in this order.
 	if( Script->Thread )
-		CompileCode( Script->Thread );
+		AddTask( Script->Thread );
 
-	// Compile all functions.
+	// Add all functions.
 	for( Integer i=0; i<Script->Functions.Num(); i++ )
-		CompileCode( Script->Functions[i] );
+		AddTask( Script->Functions[i] );
+}
+
+
+//
+// Add a function or thread body to compile.
+//
+void CCompiler::AddTask( CBytecode* InCode )
+{
+	TCodeTask Task;
+	Task.Script				= Script;
+	Task.Bytecode			= InCode;
+	Task.FrameSize			= 0;
+	Task.bFailed			= false;
+	Task.Time				= 0.0;
+	Task.Error.Script		= nullptr;
+	Task.Error.ErrorLine	= -1;
+	Task.Error.ErrorPos		= -1;
+
+	// Now function has only parameters.
+	if( InCode != Script->Thread )
+	{
+		CFunction* Function	= (CFunction*)InCode;
+		Task.Locals			= Function->Locals;
+		Task.FrameSize		= Function->FrameSize;
+	}
+
+	Tasks.Push( Task );
+}
+
+
+//
+// Compile all bodies, in parallel if allowed. Each
+// worker has own compiler, with copy of the shared
+// lists. Results are merged in the serial order, so 
+// code doesn't depend on the number of workers.
+//
+void CCompiler::CompileTasks()
+{
+	Integer NumWorkers	= bParallel && Tasks.Num() > 1 ? GPlat->NumWorkers() : 1;
+	Double	StartTime	= GPlat->TimeStamp();
+
+	// Create workers.
+	WorkerWarnings.SetNum( NumWorkers );
+	WorkerErrors.SetNum( NumWorkers );
+	for( Integer i=0; i<NumWorkers; i++ )
+	{
+		CCompiler* Worker		= new CCompiler( WorkerWarnings[i], WorkerErrors[i] );
+		Worker->AllScripts		= AllScripts;
+		Worker->Families		= Families;
+		Worker->Constants		= Constants;
+		Worker->ConstScripts	= ConstScripts;
+		Worker->Access			= Access;
+		Workers.Push( Worker );
+	}
+
+	// Compile, strings are shared between threads
+	// meanwhile.
+	if( NumWorkers > 1 )
+	{
+		String::bThreadSafe	= true;
+		GPlat->ParallelFor( CompileTaskJob, this, Tasks.Num() );
+		String::bThreadSafe	= false;
+	}
+	else
+	{
+		for( Integer i=0; i<Tasks.Num(); i++ )
+			Workers[0]->CompileTask( Tasks[i] );
+	}
+
+	// Destroy workers, families are owned by this compiler.
+	for( Integer i=0; i<Workers.Num(); i++ )
+	{
+		Workers[i]->Families.Empty();
+		delete Workers[i];
+	}
+	Workers.Empty();
+
+	log
+	( 
+		L"Compiler: %d bodies compiled in %.2f ms, %d workers", 
+		Tasks.Num(), 
+		(GPlat->TimeStamp()-StartTime)*1000.0, 
+		NumWorkers 
+	);
+
+	// Functions own their locals, even if failed.
+	for( Integer i=0; i<Tasks.Num(); i++ )
+		if( Tasks[i].Bytecode != Tasks[i].Script->Thread )
+		{
+			CFunction* Function		= (CFunction*)Tasks[i].Bytecode;
+			Function->Locals		= Tasks[i].Locals;
+			Function->FrameSize		= Tasks[i].FrameSize;
+		}
+
+	// Merge until first failure, as serial compiler does.
+	for( Integer i=0; i<Tasks.Num(); i++ )
+	{
+		TCodeTask& Task = Tasks[i];
+
+		for( Integer w=0; w<Task.Warnings.Num(); w++ )
+			Warnings.Push( Task.Warnings[w] );
+
+		if( Task.bFailed )
+		{
+			FatalError	= Task.Error;
+			throw nullptr;
+		}
+
+		MergeTask( Task );
+	}
+}
+
+
+//
+// Parallel job to compile a task.
+//
+void CCompiler::CompileTaskJob( void* Param, Integer iJob, Integer iWorker )
+{
+	CCompiler* Compiler = (CCompiler*)Param;
+	Compiler->Workers[iWorker]->CompileTask( Compiler->Tasks[iJob] );
+}
+
+
+//
+// Compile a task on this worker compiler.
+//
+void CCompiler::CompileTask( TCodeTask& Task )
+{
+	Double StartTime	= GPlat->TimeStamp();
+
+	Script		= Task.Script;
+	CodeTask	= &Task;
+
+	try
+	{
+		CompileCode( Task.Bytecode );
+	}
+	catch( ... )
+	{
+		Task.bFailed	= true;
+		Task.Error		= FatalError;
+	}
+
+	// Take results.
+	Exchange( Task.Strings, Emitter.Strings );
+	Exchange( Task.Resources, Emitter.Resources );
+	Exchange( Task.Refs, Emitter.Refs );
+	Exchange( Task.Warnings, Warnings );
+
+	CodeTask	= nullptr;
+	Task.Time	= GPlat->TimeStamp() - StartTime;
+}
+
+
+//
+// Merge compiled body to the script: add strings 
+// and resources to tables, patch their indexes in
+// the code, and add dependencies.
+//
+void CCompiler::MergeTask( TCodeTask& Task )
+{
+	FScript*	S		= Task.Script;
+	CBytecode*	Code	= Task.Bytecode;
+
+	// Tables are addressed by the code with fixed size
+	// operands, so overflow is reported at the body.
+	Script		= S;
+	TextLine	= Code->iLine;
+	TextPos		= Code->iPos;
+
+	TArray<Word> StrMap( Task.Strings.Num() );
+	for( Integer i=0; i<Task.Strings.Num(); i++ )
+	{
+		Integer iStr = S->AddString( Task.Strings[i] );
+		if( iStr == -1 )
+			Error( L"Too many string constants in script" );
+		StrMap[i]	= iStr;
+	}
+
+	TArray<Byte> ResMap( Task.Resources.Num() );
+	for( Integer i=0; i<Task.Resources.Num(); i++ )
+	{
+		ResMap[i]	= S->ResTable.AddUnique( Task.Resources[i] );
+		if( S->ResTable.Num() > 256 )
+			Error( L"Too many resource constants in script" );
+	}
+
+	// Patch indexes.
+	for( Integer i=0; i<Task.Refs.Num(); i++ )
+	{
+		TTableRef& Ref = Task.Refs[i];
+
+		if( Ref.bString )
+		{
+			Word iStr;
+			MemCopy( &iStr, &Code->Code[Ref.Addr], sizeof(Word) );
+			MemCopy( &Code->Code[Ref.Addr], &StrMap[iStr], sizeof(Word) );
+		}
+		else
+			Code->Code[Ref.Addr]	= ResMap[Code->Code[Ref.Addr]];
+	}
+
+	// Dependencies.
+	for( Integer i=0; i<Task.Depends.Num(); i++ )
+		S->Depends.AddUnique( Task.Depends[i] );
 }
 
 
@@ -942,6 +1499,7 @@ TExprResult CCompiler::CompileExpr( const CTypeInfo& ReqType, Bool bForceR, Bool
 		ExprRes.bLValue		= false;
 		ExprRes.iReg		= GetReg();
 		ExprRes.Type		= T.TypeInfo;
+		ExprRes.iConst		= IsFoldable(ExprRes.Type) ? Emitter.Tell() : -1;
 
 		emit_const( T );
 		emit( ExprRes.iReg );
@@ -1045,7 +1603,7 @@ TExprResult CCompiler::CompileExpr( const CTypeInfo& ReqType, Bool bForceR, Bool
 		RequireSymbol( L")", L"log" );
 
 		emit( CODE_Log );
-		emit( Fmt );
+		Emitter.EmitString( Fmt );
 		for( Integer i=0; i<Args.Num(); i++ )
 		{
 			emit( Args[i].Type.Type );
@@ -1107,9 +1665,7 @@ TExprResult CCompiler::CompileExpr( const CTypeInfo& ReqType, Bool bForceR, Bool
 			ScriptExpr.Type.iFamily	= Known->iFamily;
 
 			emit( CODE_ConstResource );
-			Byte iRes = Script->ResTable.AddUnique( Known );
-			assert(Script->ResTable.Num() < 256);
-			emit( iRes );
+			Emitter.EmitResource( Known );
 			emit( ScriptExpr.iReg );
 
 			ExprRes.bLValue			= false;
@@ -1209,7 +1765,7 @@ TExprResult CCompiler::CompileExpr( const CTypeInfo& ReqType, Bool bForceR, Bool
 	}
 	else if	( 
 				Bytecode != Script->Thread && 
-				(Prop = FindProperty( ((CFunction*)Bytecode)->Locals, T.Text) ) 
+				(Prop = FindProperty( CodeTask->Locals, T.Text) ) 
 			)
 	{
 		// A local variable.
@@ -1346,6 +1902,7 @@ TExprResult CCompiler::CompileExpr( const CTypeInfo& ReqType, Bool bForceR, Bool
 	else if( CastFamily = FindFamily( T.Text ) )
 	{
 		// Entity family cast.
+		AddDependency( CastFamily );
 		RequireSymbol( L"(", L"explicit cast" );
 		TExprResult Ent	= CompileExpr( TYPE_Entity, true, false, 0 );
 		RequireSymbol( L")", L"explicit cast" );
@@ -1366,6 +1923,7 @@ TExprResult CCompiler::CompileExpr( const CTypeInfo& ReqType, Bool bForceR, Bool
 		ExprRes.bLValue		= false;
 		ExprRes.Type.Type	= Const->TypeInfo.Type;
 		ExprRes.iReg		= GetReg();
+		ExprRes.iConst		= IsFoldable(ExprRes.Type) ? Emitter.Tell() : -1;
 
 		emit_const( *Const );
 		emit( ExprRes.iReg );
@@ -1617,6 +2175,7 @@ OperLoop:
 		if( !Family )
 			Error( L"Family '%s' not found", *FamilyName );
 		assert(Family->Scripts.Num()>0);
+		AddDependency( Family );
 
 		emit_ltor( ExprRes );
 		emit( CODE_In );
@@ -1778,6 +2337,10 @@ OperLoop:
 			if( !Oper )
 				Error( L"Operator '%s' not applicable to '%s' and '%s'", *T.Text, *ExprRes.Type.TypeName(), *Second.Type.TypeName() );
 
+			// Folded constant, local since bodies are compiled
+			// in parallel.
+			DWord Folded;
+
 			if( Oper->Flags & NFUN_AssignOp )
 			{
 				// It's an assignment operator, such as += or <<=.
@@ -1806,6 +2369,30 @@ OperLoop:
 
 				bValidExpr	= true;
 			}
+			else if	(	ExprRes.iConst != -1 && 
+						Second.iConst == ExprRes.iConst + FOLD_CONST_SIZE && 
+						Emitter.Tell() == Second.iConst + FOLD_CONST_SIZE &&
+						ExprRes.Type.Type == Oper->ParamsType[0].Type &&
+						Second.Type.Type == Oper->ParamsType[1].Type &&
+						FoldConstants
+						( 
+							Oper->iOpCode, 
+							*(DWord*)&Bytecode->Code[ExprRes.iConst+1], 
+							*(DWord*)&Bytecode->Code[Second.iConst+1], 
+							Folded 
+						) )
+			{
+				// Both operands are constants, so replace
+				// them with the result.
+				Bytecode->Code.SetNum( ExprRes.iConst );
+				emit( Oper->ResultType.Type == TYPE_Integer ? CODE_ConstInteger : CODE_ConstFloat );
+				emit( Folded );
+				emit( ExprRes.iReg );
+				FreeReg( Second.iReg );
+
+				ExprRes.Type	= Oper->ResultType;
+				ExprRes.bLValue	= false;
+			}
 			else
 			{
 				// It's a regular operator.
@@ -1834,6 +2421,7 @@ OperLoop:
 				// Store result.
 				ExprRes.Type	= Oper->ResultType;
 				ExprRes.bLValue	= false;
+				ExprRes.iConst	= -1;
 			}
 
 			goto OperLoop;
@@ -2644,8 +3232,8 @@ void CCompiler::CompileStatement()
 					Bytecode != Script->Thread && 
 					CompileVarDecl
 								( 
-									((CFunction*)Bytecode)->Locals, 
-									((CFunction*)Bytecode)->FrameSize, 
+									CodeTask->Locals, 
+									CodeTask->FrameSize, 
 									false 
 								) 
 				)
@@ -2881,6 +3469,26 @@ void CCompiler::CompileFor()
 }
 
 
+//
+// A switch label and address of its code.
+//
+struct TSwitchLabel
+{
+public:
+	Integer		Value;
+	Word		Addr;
+};
+
+
+//
+// Switch labels comparison.
+//
+static Bool SwitchLabelCmp( const TSwitchLabel& A, const TSwitchLabel& B )
+{
+	return A.Value < B.Value;
+}
+
+
 //
 // Compile 'switch' statement.
 //
@@ -2890,7 +3498,7 @@ void CCompiler::CompileSwitch()
 	PushNest(NEST_Switch);
 
 	TExprResult Expr;
-	Word DstJmpTab, DstDefaultAddr, DstOut;
+	Word DstOpCode, DstJmpTab, DstDefaultAddr, DstOut;
 	TArray<Integer>	Labels;
 	TArray<Word>	Addrs;
 	Byte			Size;
@@ -2909,7 +3517,8 @@ void CCompiler::CompileSwitch()
 			)
 				Error( L"Integral expression type in 'switch'" );
 
-		// Emit header.
+		// Emit header, opcode will be chosen later.
+		DstOpCode		= Emitter.Tell();
 		emit( CODE_Switch );
 		emit( Size );
 		emit( Expr.iReg );
@@ -2992,25 +3601,87 @@ void CCompiler::CompileSwitch()
 	DstOut	= Emitter.Tell();
 	emit( GTempWord );
 
-	// Emit jump table.
+	// Emit jump table. Compact labels range uses table of
+	// addresses, many sparse labels are sorted for binary 
+	// search, and a few labels are just tested one by one.
 	*(Word*)&Bytecode->Code[DstJmpTab]	= Emitter.Tell();
 	assert(Labels.Num() == Addrs.Num());
-	Byte NumLabs = Labels.Num();
-	emit( NumLabs );
-	for( Integer i=0; i<Labels.Num(); i++ )
+	Integer	NumLabs	= Labels.Num();
+	Integer MinLab	= NumLabs > 0 ? Labels[0] : 0, 
+			MaxLab	= MinLab;
+	for( Integer i=1; i<NumLabs; i++ )
 	{
-		if( Expr.Type.Type == TYPE_Byte )
-			emit( *(Byte*)&Labels[i] )
-		else
-			emit( *(Integer*)&Labels[i] );
-	
-		emit( Addrs[i] );
+		MinLab	= Min( MinLab, Labels[i] );
+		MaxLab	= Max( MaxLab, Labels[i] );
 	}
 
-	// Set out address.
-	*(Word*)&Bytecode->Code[DstOut]	= Emitter.Tell();
-
-	if( !bDefaultFound )
+	// Labels span is unsigned, since MaxLab-MinLab may
+	// overflow Integer, and table range should fit Word.
+	DWord Span	= (DWord)MaxLab - (DWord)MinLab;
+
+	if( NumLabs >= SWITCH_MIN_TABLE && Span < 0xffff && Span < (DWord)NumLabs*SWITCH_MAX_DENSITY )
+	{
+		// Dense jump table, missing labels go to default, which
+		// is out address, just after table, if not specified.
+		Word Range		= Span + 1;
+		Word OutAddr	= Emitter.Tell() + sizeof(Integer) + sizeof(Word) + Range*sizeof(Word);
+		Word DefAddr	= bDefaultFound ? *(Word*)&Bytecode->Code[DstDefaultAddr] : OutAddr;
+
+		TArray<Word> Table;
+		Table.SetNum( Range );
+		for( Integer i=0; i<Range; i++ )
+			Table[i]	= DefAddr;
+		for( Integer i=0; i<NumLabs; i++ )
+			Table[Labels[i]-MinLab]	= Addrs[i];
+
+		Bytecode->Code[DstOpCode]	= CODE_SwitchTable;
+		emit( MinLab );
+		emit( Range );
+		for( Integer i=0; i<Range; i++ )
+			emit( Table[i] );
+	}
+	else if( NumLabs >= SWITCH_MIN_SEARCH )
+	{
+		// Sorted labels.
+		TArray<TSwitchLabel> Sorted;
+		for( Integer i=0; i<NumLabs; i++ )
+		{
+			TSwitchLabel Lab;
+			Lab.Value	= Labels[i];
+			Lab.Addr	= Addrs[i];
+			Sorted.Push( Lab );
+		}
+		Sorted.Sort( SwitchLabelCmp );
+
+		Bytecode->Code[DstOpCode]	= CODE_SwitchSearch;
+		Word Num	= NumLabs;
+		emit( Num );
+		for( Integer i=0; i<NumLabs; i++ )
+		{
+			emit( Sorted[i].Value );
+			emit( Sorted[i].Addr );
+		}
+	}
+	else
+	{
+		// Linear search.
+		Byte Num = NumLabs;
+		emit( Num );
+		for( Integer i=0; i<NumLabs; i++ )
+		{
+			if( Expr.Type.Type == TYPE_Byte )
+				emit( *(Byte*)&Labels[i] )
+			else
+				emit( *(Integer*)&Labels[i] );
+	
+			emit( Addrs[i] );
+		}
+	}
+
+	// Set out address.
+	*(Word*)&Bytecode->Code[DstOut]	= Emitter.Tell();
+
+	if( !bDefaultFound )
 		*(Word*)&Bytecode->Code[DstDefaultAddr]	= Emitter.Tell();
 
 	// Fix & pop nest.
@@ -3173,11 +3844,6 @@ void CCompiler::CompileForeach()
 {
 	assert(MatchIdentifier(KW_foreach));
 
-	// Doesn't allowed nested foreach loops.
-	for( Integer i=0; i<NestTop; i++ )
-		if( Nest[i].Type == NEST_Foreach )
-			Error( L"Nested 'foreach' is not allowed" );
-
 	// Don't use foreach in threads. To predic some really
 	// uncatchy gpf errors.
 	if( Bytecode == Script->Thread )
@@ -3186,14 +3852,19 @@ void CCompiler::CompileForeach()
 	PushNest(NEST_Foreach);
 	
 	Word AddrStart, DstEnd;
-	Word PropAddr;
+	Word PropAddr, IterAddr;
+
+	// Allocate the iterator in the frame, each loop
+	// has own iterator, so loops could be nested.
+	IterAddr			= CodeTask->FrameSize;
+	CodeTask->FrameSize	= align( CodeTask->FrameSize + sizeof(TIterator), SCRIPT_PROP_ALIGN );
 
 	// Foreach header.
 	RequireSymbol( L"(", L"foreach" );
 	{
 		// Get loop control variable.
 		String PropName = GetIdentifier(L"'foreach' loop control");
-		CProperty* Control = FindProperty( ((CFunction*)Bytecode)->Locals, PropName );
+		CProperty* Control = FindProperty( CodeTask->Locals, PropName );
 		if( !Control )
 			Error( L"Loop control variable '%s' is not found", *PropName );
 		if( Control->ArrayDim != 1 || Control->Type != TYPE_Entity )
@@ -3231,12 +3902,14 @@ void CCompiler::CompileForeach()
 				emit( ArgRegs[i] );
 				FreeReg( ArgRegs[i] );
 			}
+			emit( IterAddr );
 			assert(Iter->ResultType.Type == TYPE_None);
 		}
 
 		// Emit foreach header.
 		AddrStart		= Emitter.Tell();
 		emit(CODE_Foreach);
+		emit(IterAddr);
 		emit(PropAddr);
 		DstEnd			= Emitter.Tell();
 		emit(GTempWord);
@@ -3389,6 +4062,7 @@ CTypeInfo CCompiler::CompileVarType( Bool bNoArray )
 		// Family entity.
 		TypeInfo.Type	= TYPE_Entity;
 		TypeInfo.Script	= nullptr;
+		AddDependency( Families[TypeInfo.iFamily] );
 	}
 	else
 	{
@@ -3487,6 +4161,7 @@ void CCompiler::CompileConstDecl()
 	// Complete constant and store.
 	Const.Text	= Name;
 	Constants.Push(Const);		
+	ConstScripts.Push(Script);
 
 	// Close the line.
 	RequireSymbol( L";", L"constant" );
@@ -3541,7 +4216,7 @@ Bool CCompiler::CompileVarDecl( TArray<CProperty*>& Vars, DWord& VarsSize, Bool
 
 		// Not really good place for it, but its works well.
 		// Compile variable initialization, but for locals only.
-		if( Bytecode && (&(((CFunction*)Bytecode)->Locals) == &Vars) )
+		if( CodeTask && &CodeTask->Locals == &Vars )
 		{
 			if( MatchSymbol( L"=" ) )
 			{
@@ -3743,6 +4418,7 @@ void CCompiler::CompileFunctionDecl()
 
 		CFamily* Family = Families[Script->iFamily];
 		Integer iProto = Family->VFNames.FindItem(Function->Name);
+		Function->Flags	|= FUNC_Unified;
 		if( iProto == -1 )
 		{
 			// Add a new function and it signature.
@@ -3944,13 +4620,17 @@ CEnum* CCompiler::FindEnum( FScript* Script, String Name, Bool bOwnOnly )
 
 
 //
-// Find a script by name.
+// Find a script by name. Found script becomes
+// a dependency of the compiling one.
 //
 FScript* CCompiler::FindScript( String Name )
 {
 	for( Integer i=0; i<AllScripts.Num(); i++ )
 		if( Name == AllScripts[i]->GetName() )
+		{
+			AddDependency( AllScripts[i] );
 			return AllScripts[i];
+		}
 
 	return nullptr;
 }
@@ -3978,7 +4658,10 @@ TToken* CCompiler::FindConstant( String Name )
 {
 	for( Integer i=0; i<Constants.Num(); i++ )
 		if( Constants[i].Text == Name )
+		{
+			AddDependency( ConstScripts[i] );
 			return &Constants[i];
+		}
 
 	return nullptr;
 }
@@ -4554,8 +5237,9 @@ void CCompiler::GetToken( TToken& T, Bool bAllowNeg, Bool bAllowVect )
 		}
 		else if( T.Text == L"\"" )
 		{
-			// Literal string constant.
-			MemZero( Buffer, sizeof(Buffer) );
+			// Literal string constant. It's collected by buffer
+			// sized chunks, so literal length is not limited.
+			String Literal;
 			Walk = Buffer;
 
 			do 
@@ -4565,11 +5249,21 @@ void CCompiler::GetToken( TToken& T, Bool bAllowNeg, Bool bAllowVect )
 					break;
 				*Walk	= C;
 				Walk++;
+
+				if( Walk == &Buffer[array_length(Buffer)-1] )
+				{
+					*Walk	= '\0';
+					Literal	+= Buffer;
+					Walk	= Buffer;
+				}
 			} while( true );
 
+			*Walk	= '\0';
+			Literal	+= Buffer;
+
 			// String constant.
-			T.Text					= String::Format( L"\"%s\"", Buffer );
-			T.cString				= Buffer;
+			T.Text					= String(L"\"") + Literal + L"\"";
+			T.cString				= Literal;
 			T.Type					= TOK_Const;
 			T.TypeInfo.Type			= TYPE_String;				
 		}
@@ -4753,13 +5447,58 @@ void CCompiler::Warn( const Char* Fmt, ... )
 -----------------------------------------------------------------------------*/
 
 //
-// Collect all script, store their values,
-// and entities of course, and prepare for
-// the script compilation.
+// Add a bytes to the FNV-1a hash.
+//
+static inline DWord HashBytes( DWord Hash, const void* Data, Integer Size )
+{
+	const Byte* Walk = (const Byte*)Data;
+	for( Integer i=0; i<Size; i++ )
+		Hash	= (Hash ^ Walk[i]) * 16777619;
+
+	return Hash;
+}
+
+
+//
+// Hash the script source: text and components, since
+// the code refers components by index. Zero hash is
+// reserved for never compiled script.
 //
-void CCompiler::StoreAllScripts()
+static DWord HashSource( FScript* Script )
+{
+	DWord Hash	= 2166136261;
+
+	for( Integer i=0; i<Script->Text.Num(); i++ )
+	{
+		const String& Line = Script->Text[i];
+		Hash	= HashBytes( Hash, *Line, Line.Len()*sizeof(Char) );
+		Hash	= HashBytes( Hash, L"\n", sizeof(Char) );
+	}
+
+	if( Script->Base )
+	{
+		const String& Class = Script->Base->GetClass()->Name;
+		Hash	= HashBytes( Hash, *Class, Class.Len()*sizeof(Char) );
+	}
+
+	for( Integer i=0; i<Script->Components.Num(); i++ )
+	{
+		String Name		= Script->Components[i]->GetName();
+		String Class	= Script->Components[i]->GetClass()->Name;
+		Hash	= HashBytes( Hash, *Name, Name.Len()*sizeof(Char) );
+		Hash	= HashBytes( Hash, *Class, Class.Len()*sizeof(Char) );
+	}
+
+	return Hash ? Hash : 1;
+}
+
+
+//
+// Collect all scripts, and hash sources of
+// the scripts with text.
+//
+void CCompiler::CollectScripts()
 {
-	// Walk through all scripts.
 	for( Integer i=0; i<GObjectDatabase->GObjects.Num(); i++ )
 		if( GObjectDatabase->GObjects[i] && GObjectDatabase->GObjects[i]->IsA(FScript::MetaClass) )
 		{
@@ -4768,50 +5507,209 @@ void CCompiler::StoreAllScripts()
 			// Add any script to list, for searching.
 			AllScripts.Push(S);
 
-			// Add only script with the text.
+			// Compile only script with the text.
 			if( S->bHasText )
 			{
 				// Script should have an instance buffer.
 				assert(S->InstanceBuffer);
 
-				// Add to the storage.
-				TStoredScript Stored;
-				Stored.Script		= S;
-				Stored.Properties	= S->Properties;
-				Stored.Enums		= S->Enums;
-				Stored.InstanceSize	= S->InstanceSize;
-				Stored.Buffers.Push( S->InstanceBuffer );
-
-				// Collect instance buffers from the entities.
-				for( Integer i=0; i<GObjectDatabase->GObjects.Num(); i++ )
-					if( GObjectDatabase->GObjects[i] && GObjectDatabase->GObjects[i]->IsA(FEntity::MetaClass) )
-					{
-						FEntity* Entity = (FEntity*)GObjectDatabase->GObjects[i];
-
-						if( Entity->Script == S )
-						{
-							// Same as S.
-							assert(Entity->InstanceBuffer);
-							Stored.Buffers.Push( Entity->InstanceBuffer );
-						}
-					}
+				TSourceScript Source;
+				Source.Script		= S;
+				Source.Hash			= HashSource( S );
+				Source.OldFamily	= S->iFamily;
+				Source.bDirty		= false;
+				Sources.Push(Source);
+			}
+		}
+}
 
-				// Add to list.
-				Storage.Push(Stored);
-
-				// Cleanup all script's objects.
-				freeandnil(S->Thread);
-				for( Integer f=0; f<S->Functions.Num(); f++ )
-					freeandnil(S->Functions[f]);
-				S->Enums.Empty();
-				S->Properties.Empty();
-				S->Functions.Empty();
-				S->Events.Empty();
-				S->VFTable.Empty();
-				S->InstanceSize	= 0;
-				S->ResTable.Empty();
+
+//
+// Whether script with the given name should be
+// recompiled. Deleted script is treated as changed.
+//
+Bool CCompiler::IsDirty( String Name )
+{
+	for( Integer i=0; i<Sources.Num(); i++ )
+		if( Name == Sources[i].Script->GetName() )
+			return Sources[i].bDirty;
+
+	for( Integer i=0; i<AllScripts.Num(); i++ )
+		if( Name == AllScripts[i]->GetName() )
+			return false;
+
+	return true;
+}
+
+
+//
+// Mark scripts to recompile: changed scripts and
+// scripts depend on them, directly or not. Return
+// true, if all scripts should be recompiled.
+//
+Bool CCompiler::MarkDirtyScripts()
+{
+	// Make a families layout. If it changed, family
+	// numbers in the code are wrong, so recompile all.
+	Layout	= L"";
+	for( Integer i=0; i<Families.Num(); i++ )
+	{
+		Layout	+= Families[i]->Name + L":";
+		for( Integer j=0; j<Families[i]->Scripts.Num(); j++ )
+			Layout	+= Families[i]->Scripts[j]->GetName() + L",";
+		Layout	+= L";";
+	}
+
+	Bool bComplete	= Layout != LastLayout;
+	for( Integer i=0; i<Sources.Num(); i++ )
+		Sources[i].bDirty	= bComplete || Sources[i].Hash != Sources[i].Script->SourceHash;
+
+	// Propagate to dependents, until nothing changed.
+	Bool bChanged	= !bComplete;
+	while( bChanged )
+	{
+		bChanged	= false;
+		for( Integer i=0; i<Sources.Num(); i++ )
+		{
+			TSourceScript& Source = Sources[i];
+			if( Source.bDirty )
+				continue;
+
+			// Scripts referenced from the code.
+			for( Integer d=0; d<Source.Script->Depends.Num() && !Source.bDirty; d++ )
+				Source.bDirty	= IsDirty( Source.Script->Depends[d] );
+
+			// Family members share virtual functions.
+			if( Source.Script->iFamily != -1 )
+			{
+				CFamily* Family = Families[Source.Script->iFamily];
+				for( Integer m=0; m<Family->Scripts.Num() && !Source.bDirty; m++ )
+					Source.bDirty	= IsDirty( Family->Scripts[m]->GetName() );
+			}
+
+			bChanged	|= Source.bDirty;
+		}
+	}
+
+	// Notify.
+	Integer NumDirty = 0;
+	for( Integer i=0; i<Sources.Num(); i++ )
+		NumDirty += Sources[i].bDirty ? 1 : 0;
+
+	log( L"Compiler: %d of %d scripts to compile%s", NumDirty, Sources.Num(), bComplete ? L" (complete)" : L"" );
+	return bComplete;
+}
+
+
+//
+// Store script values, and entities of course,
+// and prepare script for the compilation.
+//
+void CCompiler::StoreScript( FScript* S )
+{
+	// Add to the storage.
+	TStoredScript Stored;
+	Stored.Script		= S;
+	Stored.Properties	= S->Properties;
+	Stored.Enums		= S->Enums;
+	Stored.InstanceSize	= S->InstanceSize;
+	Stored.Time			= 0.0;
+	Stored.Buffers.Push( S->InstanceBuffer );
+
+	// Collect instance buffers from the entities.
+	for( Integer i=0; i<GObjectDatabase->GObjects.Num(); i++ )
+		if( GObjectDatabase->GObjects[i] && GObjectDatabase->GObjects[i]->IsA(FEntity::MetaClass) )
+		{
+			FEntity* Entity = (FEntity*)GObjectDatabase->GObjects[i];
+
+			if( Entity->Script == S )
+			{
+				// Same as S.
+				assert(Entity->InstanceBuffer);
+				Stored.Buffers.Push( Entity->InstanceBuffer );
+			}
+		}
+
+	// Add to list.
+	Storage.Push(Stored);
+
+	// Cleanup all script's objects.
+	freeandnil(S->Thread);
+	for( Integer f=0; f<S->Functions.Num(); f++ )
+		freeandnil(S->Functions[f]);
+	S->Enums.Empty();
+	S->Properties.Empty();
+	S->Functions.Empty();
+	S->Events.Empty();
+	S->VFTable.Empty();
+	S->InstanceSize	= 0;
+	S->ResTable.Empty();
+	S->StrTable.Empty();
+
+	// Script has no code now, dependencies will be
+	// collected again.
+	S->SourceHash	= 0;
+	S->Depends.Empty();
+}
+
+
+//
+// Restore virtual functions of the families
+// without changed scripts, since changed scripts
+// may call them. Order is the same as in the 
+// first pass.
+//
+void CCompiler::RestoreFamilies()
+{
+	for( Integer i=0; i<Families.Num(); i++ )
+	{
+		CFamily* Family = Families[i];
+
+		Bool bDirty = false;
+		for( Integer m=0; m<Family->Scripts.Num(); m++ )
+			bDirty	|= IsDirty( Family->Scripts[m]->GetName() );
+
+		if( bDirty )
+			continue;
+
+		for( Integer m=0; m<Family->Scripts.Num(); m++ )
+		{
+			FScript* Member = Family->Scripts[m];
+
+			for( Integer f=0; f<Member->Functions.Num(); f++ )
+			{
+				CFunction* Function = Member->Functions[f];
+
+				if( (Function->Flags & FUNC_Unified) && Family->VFNames.FindItem(Function->Name) == -1 )
+				{
+					Family->VFNames.Push(Function->Name);
+					Family->Proto.Push(Function);
+				}
 			}
 		}
+	}
+}
+
+
+//
+// Add a script to the dependencies of the compiling
+// script, so it will be recompiled after other changed.
+//
+void CCompiler::AddDependency( FScript* Other )
+{
+	if( Other != Script )
+		(CodeTask ? CodeTask->Depends : Script->Depends).AddUnique( Other->GetName() );
+}
+
+
+//
+// Add all family members to the dependencies of
+// the compiling script.
+//
+void CCompiler::AddDependency( CFamily* Family )
+{
+	for( Integer i=0; i<Family->Scripts.Num(); i++ )
+		AddDependency( Family->Scripts[i] );
 }
 
 
@@ -4845,6 +5743,7 @@ void CCompiler::RestoreAfterFailure()
 		S->InstanceSize		= 0;
 		S->iFamily			= -1;
 		S->ResTable.Empty();
+		S->StrTable.Empty();
 
 		// Copy old properties and enumerations
 		// from the storage.
@@ -4855,6 +5754,12 @@ void CCompiler::RestoreAfterFailure()
 		// The information in all CInstanceBuffer are
 		// still valid and well.
 	}
+
+	// Unchanged scripts keep their code, so
+	// restore their families.
+	for( Integer i=0; i<Sources.Num(); i++ )
+		if( !Sources[i].bDirty )
+			Sources[i].Script->iFamily	= Sources[i].OldFamily;
 }
 
 
@@ -4993,6 +5898,7 @@ Bool CEditor::CompileAllScripts( Bool bSilent )
 	TArray<String> Warns;
 	TCompilerError Err;
 	CCompiler Compiler( Warns, Err );
+	CCompiler::bParallel	= Config->ReadBool( L"Compiler", L"Parallel", true );
 
 	if( Result = Compiler.CompileAll( bSilent ) )		
 	{
@@ -5102,6 +6008,11 @@ Bool CEditor::DropAllScripts()
 			Script->Events.Empty();
 			Script->VFTable.Empty();
 			Script->ResTable.Empty();
+			Script->StrTable.Empty();
+
+			// Force to recompile.
+			Script->SourceHash	= 0;
+			Script->Depends.Empty();
 		}
 
 	// Notify.
@@ -5110,6 +6021,426 @@ Bool CEditor::DropAllScripts()
 }
 
 
+/*-----------------------------------------------------------------------------
+    Script benchmark suite.
+-----------------------------------------------------------------------------*/
+
+//
+// Suite magic numbers.
+//
+#define SUITE_WARMUP		30		// Frames before measure, threads start and code becomes hot.
+#define SUITE_FRAMES		300		// Measured frames per benchmark script.
+
+
+//
+// Load all scripts from the directory to the new project,
+// compile them, and play each 'Bench' script, other scripts
+// are its helpers. Results are written to the file as JSON,
+// so VM changes can be compared commit to commit.
+//
+Bool CEditor::BenchScripts( String Directory, String FileName )
+{
+	if( !NewProject() )
+		return false;
+
+	// Load the scripts.
+	TArray<FScript*>	Benches;
+	WIN32_FIND_DATA		FindData;
+	HANDLE				hFind	= FindFirstFile( *(Directory+L"\\*.flu"), &FindData );
+
+	if( hFind == INVALID_HANDLE_VALUE )
+	{
+		log( L"Ed: No scripts found in '%s'", *Directory );
+		CloseProject( false );
+		return false;
+	}
+
+	do
+	{
+		String	ScriptFile	= FindData.cFileName;
+		String	Name		= String::Copy( ScriptFile, 0, ScriptFile.Len()-4 );
+
+		FScript* Script			= NewObject<FScript>( Name );
+		Script->bHasText		= true;
+		Script->InstanceBuffer	= new CInstanceBuffer(Script);
+		Script->FileName		= ScriptFile;
+
+		FBaseComponent* Base = NewObject<FBaseComponent>( FRectComponent::MetaClass, L"Base", Script );
+		Base->InitForScript( Script );
+
+		CTextReader TextReader( Directory+L"\\"+ScriptFile );
+		while( !TextReader.IsEOF() )
+			Script->Text.Push( TextReader.ReadLine() );
+
+		while( Script->Text.Num() && !Script->Text.Last() )
+			Script->Text.Remove(Script->Text.Num()-1);
+
+		if( String::Pos( L"Bench", Name ) == 0 )
+			Benches.Push( Script );
+	} 
+	while( FindNextFile( hFind, &FindData ) );
+	FindClose( hFind );
+
+	// Compile them all.
+	TArray<String>	Warns;
+	TCompilerError	Err;
+	CCompiler		Compiler( Warns, Err );
+	CCompiler::bParallel	= Config->ReadBool( L"Compiler", L"Parallel", true );
+
+	Bool bCompiled = Compiler.CompileAll( true );
+	for( Integer i=0; i<Warns.Num(); i++ )
+		log( L"Ed: %s", *Warns[i] );
+
+	if( !bCompiled )
+	{
+		log( L"Ed: Script '%s' line %d: %s", Err.Script ? *Err.Script->GetName() : L"", Err.ErrorLine, *Err.Message );
+		CloseProject( false );
+		return false;
+	}
+
+	// Play each benchmark script.
+	TArray<String> Lines;
+	for( Integer i=0; i<Benches.Num(); i++ )
+	{
+		TScriptSuiteResult Result;
+		{
+			CScriptSuite Suite( Benches[i] );
+			Suite.Run( SUITE_WARMUP, SUITE_FRAMES, 1.f/60.f, Result );
+		}
+		log
+		( 
+			L"ScriptSuite: %s %.2f ns/op, %.3f allocs/op, %.1f instrs/op, %.3f ms/frame%s", 
+			*Result.Name,
+			Result.NsPerOp,
+			Result.AllocsPerOp,
+			Result.InstrsPerOp,
+			Result.FrameTime,
+			Result.bFailed ? L" (FAILED)" : L""
+		);
+		Lines.Push( CScriptSuite::ToJSON( Result ) );
+	}
+
+	// Write the report.
+	if( FileName )
+	{
+		FileName	= String::Pos( L":\\", FileName ) != -1 ? FileName : GDirectory+L"\\"+FileName;
+		CTextWriter Writer( FileName );
+
+		Writer.WriteString( L"{" );
+		Writer.WriteString( String::Format( L"  \"engine\": \"%s %s\",", FLU_NAME, FLU_VER ) );
+		Writer.WriteString( String::Format( L"  \"threaded\": %s,", FLU_THREADED_VM ? L"true" : L"false" ) );
+		Writer.WriteString( String::Format( L"  \"linked\": %s,", CFrame::bLinkedCode ? L"true" : L"false" ) );
+		Writer.WriteString( String::Format( L"  \"lean\": %s,", CFrame::bLeanCode ? L"true" : L"false" ) );
+		Writer.WriteString( String::Format( L"  \"jit\": %s,", FLU_JIT && CJit::bEnabled ? L"true" : L"false" ) );
+		Writer.WriteString( String::Format( L"  \"allocs\": %s,", FLU_COUNT_ALLOCS ? L"true" : L"false" ) );
+		Writer.WriteString( L"  \"scripts\":" );
+		Writer.WriteString( L"  [" );
+		for( Integer i=0; i<Lines.Num(); i++ )
+			Writer.WriteString( String::Format( L"    %s%s", *Lines[i], i < Lines.Num()-1 ? L"," : L"" ) );
+		Writer.WriteString( L"  ]" );
+		Writer.WriteString( L"}" );
+
+		log( L"Ed: Script benchmark saved to '%s'", *FileName );
+	}
+
+	CloseProject( false );
+	return true;
+}
+
+
+//
+// Number of complete recompilations per compiler mode.
+//
+#define COMPILE_RUNS		5
+
+
+//
+// Compiled code writer, it stores scripts as they are
+// saved to the project file, so output of serial and 
+// parallel compilers can be compared byte by byte.
+//
+class CCodeImageWriter: public CSerializer
+{
+public:
+	// Variables.
+	TArray<Byte>	Buffer;
+	TArray<Integer>	Offsets;
+
+	// CCodeImageWriter interface.
+	CCodeImageWriter()
+		:	Buffer(),
+			Offsets()
+	{
+		Mode	= SM_Save;
+	}
+	void Capture()
+	{
+		Buffer.Empty();
+		Offsets.Empty();
+		for( Integer i=0; i<GObjectDatabase->GObjects.Num(); i++ )
+			if( GObjectDatabase->GObjects[i] && GObjectDatabase->GObjects[i]->IsA(FScript::MetaClass) )
+			{
+				FScript* Script	= As<FScript>(GObjectDatabase->GObjects[i]);
+				if( Script->bHasText )
+				{
+					Offsets.Push( Buffer.Num() );
+					Script->SerializeThis( *this );
+				}
+			}
+	}
+
+	// CSerializer interface.
+	void SerializeData( void* Mem, DWord Count )
+	{
+		if( Count == 0 )
+			return;
+
+		Integer OldNum = Buffer.Num();
+		Buffer.SetNum( OldNum+Count );
+		MemCopy( &Buffer[OldNum], Mem, Count );
+	}
+	void SerializeRef( FObject*& Obj )
+	{
+		String ObjName = Obj ? Obj->GetName() : L"null";
+		Serialize( *this, ObjName );
+	}
+	DWord Tell()
+	{
+		return Buffer.Num();
+	}
+};
+
+
+//
+// Return the index of the first script, which compiled
+// code differs, or -1 if both images are identical.
+//
+static Integer CompareCodeImages( CCodeImageWriter& A, CCodeImageWriter& B )
+{
+	if( A.Offsets.Num() != B.Offsets.Num() )
+		return 0;
+
+	for( Integer i=0; i<A.Offsets.Num(); i++ )
+	{
+		Integer	StartA	= A.Offsets[i],
+				StartB	= B.Offsets[i],
+				SizeA	= (i < A.Offsets.Num()-1 ? A.Offsets[i+1] : A.Buffer.Num()) - StartA,
+				SizeB	= (i < B.Offsets.Num()-1 ? B.Offsets[i+1] : B.Buffer.Num()) - StartB;
+
+		if( SizeA != SizeB || (SizeA > 0 && !MemCmp( &A.Buffer[StartA], &B.Buffer[StartB], SizeA )) )
+			return i;
+	}
+
+	return -1;
+}
+
+
+//
+// Scale the opened project up, by adding NumCopies-1 
+// renamed copies of each script with text. Copies 
+// refer to the original scripts, so the project 
+// still compiles.
+//
+static void CloneScripts( Integer NumCopies )
+{
+	TArray<FScript*> Sources;
+	for( Integer i=0; i<GObjectDatabase->GObjects.Num(); i++ )
+		if( GObjectDatabase->GObjects[i] && GObjectDatabase->GObjects[i]->IsA(FScript::MetaClass) )
+		{
+			FScript* Script	= As<FScript>(GObjectDatabase->GObjects[i]);
+			if( Script->bHasText && Script->Base )
+				Sources.Push( Script );
+		}
+
+	for( Integer iCopy=1; iCopy<NumCopies; iCopy++ )
+		for( Integer i=0; i<Sources.Num(); i++ )
+		{
+			FScript*	Source	= Sources[i];
+			String		Name	= String::Format( L"%s_%d", *Source->GetName(), iCopy );
+
+			FScript* Script			= NewObject<FScript>( Name );
+			Script->bHasText		= true;
+			Script->InstanceBuffer	= new CInstanceBuffer(Script);
+			Script->FileName		= String::Format( L"%s.flu", *Name );
+			Script->Group			= Source->Group;
+			Script->Text			= Source->Text;
+
+			// Components.
+			FBaseComponent* Base = NewObject<FBaseComponent>( Source->Base->GetClass(), L"Base", Script );
+			Base->InitForScript( Script );
+
+			for( Integer e=0; e<Source->Components.Num(); e++ )
+			{
+				FExtraComponent* Extra = NewObject<FExtraComponent>
+				( 
+					Source->Components[e]->GetClass(), 
+					Source->Components[e]->GetName(), 
+					Script 
+				);
+				Extra->InitForScript( Script );
+			}
+
+			// Rename the script header.
+			String Header = String(L"script ") + Source->GetName();
+			for( Integer iLine=0; iLine<Script->Text.Num(); iLine++ )
+			{
+				String&	Line	= Script->Text[iLine];
+				Integer	iPos	= String::Pos( Header, Line );
+				Integer	iEnd	= iPos + Header.Len();
+
+				if	( 
+						iPos != -1 && 
+						(iPos == 0 || Line[iPos-1] == ' ' || Line[iPos-1] == '\t') &&
+						(iEnd == Line.Len() || !(IsLetter(Line[iEnd]) || IsDigit(Line[iEnd])))
+					)
+				{
+					Line	= String::Copy( Line, 0, iPos ) + L"script " + Name + 
+							  String::Copy( Line, iEnd, Line.Len()-iEnd );
+					break;
+				}
+			}
+		}
+}
+
+
+//
+// Open the project, and recompile all its scripts from
+// scratch, serially and in parallel, to see how compile
+// time scales with the workers. Project could be scaled 
+// up by NumCopies, to get a large one. Compiled code of
+// every parallel run is compared to serial one, they 
+// should be byte-identical. Results are written to the
+// file as JSON.
+//
+Bool CEditor::BenchCompiler( String ProjectFile, String FileName, Integer NumCopies )
+{
+	if( !OpenProjectFrom( ProjectFile ) )
+		return false;
+
+	if( NumCopies > 1 )
+		CloneScripts( NumCopies );
+
+	// Count scripts.
+	Integer	NumScripts = 0, NumLines = 0;
+	for( Integer i=0; i<GObjectDatabase->GObjects.Num(); i++ )
+		if( GObjectDatabase->GObjects[i] && GObjectDatabase->GObjects[i]->IsA(FScript::MetaClass) )
+		{
+			FScript* Script	= As<FScript>(GObjectDatabase->GObjects[i]);
+			if( Script->bHasText )
+			{
+				NumScripts++;
+				NumLines	+= Script->Text.Num();
+			}
+		}
+
+	// Serial first, then parallel.
+	Bool				bOldParallel	= CCompiler::bParallel;
+	Double				Best[2], Average[2];
+	CCodeImageWriter	SerialImage, ParallelImage;
+	Integer				iMismatch		= -1;
+	for( Integer iMode=0; iMode<2; iMode++ )
+	{
+		CCompiler::bParallel	= iMode == 1;
+		Best[iMode]				= 0.0;
+		Average[iMode]			= 0.0;
+
+		for( Integer iRun=0; iRun<COMPILE_RUNS; iRun++ )
+		{
+			DropAllScripts();
+
+			TArray<String>	Warns;
+			TCompilerError	Err;
+			CCompiler		Compiler( Warns, Err );
+
+			Double	Time	= GPlat->TimeStamp();
+			Bool	bCompiled	= Compiler.CompileAll( true );
+			Time	= (GPlat->TimeStamp() - Time) * 1000.0;
+
+			if( !bCompiled )
+			{
+				log( L"Ed: Script '%s' line %d: %s", Err.Script ? *Err.Script->GetName() : L"", Err.ErrorLine, *Err.Message );
+				CCompiler::bParallel	= bOldParallel;
+				CloseProject( false );
+				return false;
+			}
+
+			Best[iMode]		= iRun == 0 ? Time : Min( Best[iMode], Time );
+			Average[iMode]	+= Time / COMPILE_RUNS;
+
+			// Compare the code, outside of timing.
+			if( iMode == 0 )
+			{
+				if( iRun == 0 )
+					SerialImage.Capture();
+			}
+			else if( iMismatch == -1 )
+			{
+				ParallelImage.Capture();
+				iMismatch	= CompareCodeImages( SerialImage, ParallelImage );
+			}
+		}
+	}
+	CCompiler::bParallel	= bOldParallel;
+
+	// Report the first mismatched script.
+	String MismatchName;
+	if( iMismatch != -1 )
+	{
+		for( Integer i=0, iScript=0; i<GObjectDatabase->GObjects.Num(); i++ )
+			if( GObjectDatabase->GObjects[i] && GObjectDatabase->GObjects[i]->IsA(FScript::MetaClass) )
+			{
+				FScript* Script	= As<FScript>(GObjectDatabase->GObjects[i]);
+				if( Script->bHasText && iScript++ == iMismatch )
+				{
+					MismatchName	= Script->GetName();
+					break;
+				}
+			}
+		log( L"CompilerBench: Parallel code differs from serial in script '%s'", *MismatchName );
+	}
+
+	log
+	( 
+		L"CompilerBench: %d scripts, %d lines, serial %.2f ms, parallel %.2f ms, %d workers, x%.2f, %s", 
+		NumScripts,
+		NumLines,
+		Best[0],
+		Best[1],
+		GPlat->NumWorkers(),
+		Best[1] > 0.0 ? Best[0] / Best[1] : 0.0,
+		iMismatch == -1 ? L"identical" : L"MISMATCHED"
+	);
+
+	// Write the report.
+	if( FileName )
+	{
+		FileName	= String::Pos( L":\\", FileName ) != -1 ? FileName : GDirectory+L"\\"+FileName;
+		CTextWriter Writer( FileName );
+
+		Writer.WriteString( L"{" );
+		Writer.WriteString( String::Format( L"  \"engine\": \"%s %s\",", FLU_NAME, FLU_VER ) );
+		Writer.WriteString( String::Format( L"  \"project\": \"%s\",", *GetFileName( ProjectFile ) ) );
+		Writer.WriteString( String::Format( L"  \"copies\": %d,", Max( NumCopies, 1 ) ) );
+		Writer.WriteString( String::Format( L"  \"scripts\": %d,", NumScripts ) );
+		Writer.WriteString( String::Format( L"  \"lines\": %d,", NumLines ) );
+		Writer.WriteString( String::Format( L"  \"workers\": %d,", GPlat->NumWorkers() ) );
+		Writer.WriteString( String::Format( L"  \"runs\": %d,", COMPILE_RUNS ) );
+		Writer.WriteString( String::Format( L"  \"code_bytes\": %d,", SerialImage.Buffer.Num() ) );
+		Writer.WriteString( String::Format( L"  \"identical\": %s,", iMismatch == -1 ? L"true" : L"false" ) );
+		if( iMismatch != -1 )
+			Writer.WriteString( String::Format( L"  \"mismatched\": \"%s\",", *MismatchName ) );
+		Writer.WriteString( String::Format( L"  \"serial_ms\": { \"best\": %.2f, \"avg\": %.2f },", Best[0], Average[0] ) );
+		Writer.WriteString( String::Format( L"  \"parallel_ms\": { \"best\": %.2f, \"avg\": %.2f }", Best[1], Average[1] ) );
+		Writer.WriteString( L"}" );
+
+		log( L"Ed: Compiler benchmark saved to '%s'", *FileName );
+	}
+
+	CloseProject( false );
+	return true;
+}
+
+
 /*-----------------------------------------------------------------------------
     The End.
 -----------------------------------------------------------------------------*/
\ No newline at end of file
@@ -213,6 +213,26 @@ void CEditor::Init( HINSTANCE InhInstance )
 
 	// Notify.
 	log( L"Ed: Editor initialized" );
+
+	// Headless script benchmark suite.
+	if( GCmdLine[1] == L"-scriptbench" )
+	{
+		BenchScripts
+		( 
+			GCmdLine[2] ? GCmdLine[2] : GDirectory+L"\\Bench", 
+			GCmdLine[3] ? GCmdLine[3] : String(L"ScriptSuite.json") 
+		);
+		PostMessage( hWnd, WM_CLOSE, 0, 0 );
+	}
+
+	// Headless compiler benchmark on the project.
+	if( GCmdLine[1] == L"-compilebench" && GCmdLine[2] )
+	{
+		Integer NumCopies = 1;
+		GCmdLine[4].ToInteger( NumCopies, 1 );
+		BenchCompiler( GCmdLine[2], GCmdLine[3] ? GCmdLine[3] : String(L"CompilerBench.json"), NumCopies );
+		PostMessage( hWnd, WM_CLOSE, 0, 0 );
+	}
 }
 
 
@@ -798,6 +818,15 @@ public:
 		if( !QueryPerformanceFrequency(&LInt) )
 			error( L"'QueryPerformanceFrequency' failed." );
 		SecsPerCycle = 1.0 / (Double)LInt.QuadPart;
+
+		// Multithreading.
+		InitializeCriticalSection( &CriticalSection );
+	}
+
+	// Shutdown platform.
+	~CWinPlatform()
+	{
+		DeleteCriticalSection( &CriticalSection );
 	}
 
 	// Return current time.
@@ -887,9 +916,68 @@ public:
 		ShellExecute( nullptr, L"open", Target, Parms?Parms:L"", L"", SW_SHOWNORMAL );
 	}
 
+	// Return peak process memory usage in kilobytes.
+	DWord PeakMemory()
+	{
+		PROCESS_MEMORY_COUNTERS Counters;
+		if( !GetProcessMemoryInfo( GetCurrentProcess(), &Counters, sizeof(Counters) ) )
+			return 0;
+		return (DWord)(Counters.PeakWorkingSetSize / 1024);
+	}
+
+	// Return number of job workers, including
+	// the main thread.
+	Integer NumWorkers()
+	{
+		return Jobs.NumWorkers();
+	}
+
+	// Execute all jobs on the worker threads.
+	void ParallelFor( TJobFunction Func, void* Param, Integer NumJobs )
+	{
+		Jobs.ParallelFor( Func, Param, NumJobs );
+	}
+
+	// Enter the global critical section.
+	void EnterCritical()
+	{
+		EnterCriticalSection( &CriticalSection );
+	}
+
+	// Leave the global critical section.
+	void LeaveCritical()
+	{
+		LeaveCriticalSection( &CriticalSection );
+	}
+
+	// Allocate a writable memory for the generated code.
+	void* AllocExecutable( DWord Size )
+	{
+		return VirtualAlloc( nullptr, Size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+	}
+
+	// Make the written code executable, but read only.
+	Bool ProtectExecutable( void* Mem, DWord Size )
+	{
+		DWORD OldProtect;
+		return	VirtualProtect( Mem, Size, PAGE_EXECUTE_READ, &OldProtect ) &&
+				FlushInstructionCache( GetCurrentProcess(), Mem, Size );
+	}
+
+	// Release a generated code memory.
+	void FreeExecutable( void* Mem, DWord Size )
+	{
+		if( Mem )
+			VirtualFree( Mem, 0, MEM_RELEASE );
+	}
+
 private:
 	// Internal variables.
 	Double		SecsPerCycle;
+
+	// Multithreading.
+	CRITICAL_SECTION	CriticalSection;
+	CWinJobPool			Jobs;
 };
 
 
@@ -60,6 +60,8 @@ public:
 	// Script functions.
 	Bool CompileAllScripts( Bool bSilent );	
 	Bool DropAllScripts();
+	Bool BenchScripts( String Directory, String FileName );
+	Bool BenchCompiler( String ProjectFile, String FileName, Integer NumCopies );
 
 	// Level functions.
 	void BuildPaths( FLevel* Level );
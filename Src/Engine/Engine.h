@@ -8,10 +8,12 @@
 // C++ includes.
 #include <math.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <tchar.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <intrin.h>
    
 // Partial classes tree.
 class String;
@@ -38,10 +40,23 @@ class CCanvas;
 class CBlockManager;
 class CInstanceBuffer;
 class CFrame;
+class CFunction;
 class CEntityThread;
+class CThreadScheduler;
+class CLinkedCode;
+struct TInstr;
+class CJit;
+class CJitCode;
+class CScriptBench;
+class CScriptSuite;
+class CScriptDiff;
 class CCollisionHash;
 class CNavigator;
 class CPhysics;
+class CPhysicsScene;
+class CPhysicsReplay;
+class CPhysicsBench;
+struct TPhysPoly;
 enum EPathType;
 enum EEventName;
 template<class T> class TArray;
@@ -74,6 +89,8 @@ template<class K, class V> class TMap;
 #include "FrOpCode.h"
 #include "FrScript.h"
 #include "FrCode.h"
+#include "FrLinker.h"
+#include "FrJit.h"
 #include "FrBitmap.h"
 #include "FrAnim.h"
 #include "FrFont.h"
@@ -87,6 +104,11 @@ template<class K, class V> class TMap;
 #include "FrApp.h"
 #include "FrDemoEff.h"
 #include "FrPhysEng.h"
+#include "FrReplay.h"
+#include "FrPhysBench.h"
+#include "FrScriptBench.h"
+#include "FrScriptSuite.h"
+#include "FrScriptDiff.h"
 #include "FrPath.h"
 
 
@@ -55,7 +55,7 @@ void FPuppetComponent::InitForEntity( FEntity* InEntity )
 {
 	FExtraComponent::InitForEntity(InEntity);
 
-	com_add(TickObjects);
+	com_add_tick();
 	com_add(Puppets);
 }
 
@@ -377,9 +377,9 @@ Float FPuppetComponent::SpeedForJump( TVector From, TVector To, Float XSpeed, Fl
 //
 // Emit a noise, from the puppet.
 //
-void FPuppetComponent::nativeMakeNoise( CFrame& Frame )
+void FPuppetComponent::nativeMakeNoise( CFrame& Frame, Float Radius )
 {
-	Float Radius2 = Sqr(POP_FLOAT);
+	Float Radius2 = Sqr(Radius);
 	for( Integer i=0; i<Level->Puppets.Num(); i++ )
 	{
 		FPuppetComponent* Other = Level->Puppets[i];
@@ -398,10 +398,9 @@ void FPuppetComponent::nativeMakeNoise( CFrame& Frame )
 //
 // Suggest a jump height using initial jump speed.
 //
-void FPuppetComponent::nativeSuggestJumpHeight( CFrame& Frame )
+Float FPuppetComponent::nativeSuggestJumpHeight( CFrame& Frame, Float Speed )
 {
-	Float Speed = POP_FLOAT;
-	*POPA_FLOAT	= FPuppetComponent::SuggestJumpHeight
+	return FPuppetComponent::SuggestJumpHeight
 	(
 		Speed,
 		GravityScale
@@ -412,10 +411,9 @@ void FPuppetComponent::nativeSuggestJumpHeight( CFrame& Frame )
 //
 // Suggest a jump speed to reach height.
 //
-void FPuppetComponent::nativeSuggestJumpSpeed( CFrame& Frame )
+Float FPuppetComponent::nativeSuggestJumpSpeed( CFrame& Frame, Float Height )
 {
-	Float Height = POP_FLOAT;
-	*POPA_FLOAT	= FPuppetComponent::SuggestJumpSpeed
+	return FPuppetComponent::SuggestJumpSpeed
 	(
 		Height,
 		GravityScale
@@ -426,11 +424,10 @@ void FPuppetComponent::nativeSuggestJumpSpeed( CFrame& Frame )
 //
 // Send an order to puppet's teammates in radius.
 //
-void FPuppetComponent::nativeSendOrder( CFrame& Frame )
+Integer FPuppetComponent::nativeSendOrder( CFrame& Frame, String Order, Float Radius )
 {
 	Integer	NumRecipients	= 0;
-	String	Order			= POP_STRING;
-	Float	Radius2			= Sqr(POP_FLOAT);
+	Float	Radius2			= Sqr(Radius);
 
 	for( Integer p=0; p<Level->Puppets.Num(); p++ )
 	{
@@ -447,55 +444,48 @@ void FPuppetComponent::nativeSendOrder( CFrame& Frame )
 		}
 	}
 
-	*POPA_INTEGER	= NumRecipients;
+	return NumRecipients;
 }
 
 
 //
 // Return true, if other is visible.
 //
-void FPuppetComponent::nativeIsVisible( CFrame& Frame )
+Bool FPuppetComponent::nativeIsVisible( CFrame& Frame, FEntity* Other )
 {
-	FEntity* Other	= POP_ENTITY;
 	if( !Other )
-	{
-		*POPA_BOOL	= false;
-		return;
-	}
+		return false;
 
 	for( Integer i=0; i<MAX_WATCHED && LookList[i]; i++ )
 		if( LookList[i]->Entity == Other )
-		{
-			*POPA_BOOL	= true;
-			return;
-		}
+			return true;
 
-	*POPA_BOOL	= false;
+	return false;
 }
 
 
 //
 // Move puppet to the goal.
 //
-void FPuppetComponent::nativeMoveToGoal( CFrame& Frame )
+Bool FPuppetComponent::nativeMoveToGoal( CFrame& Frame )
 {
-	*POPA_BOOL	= MoveToGoal();
+	return MoveToGoal();
 }
 
 
 //
 // Tries to create a random path.
 //
-void FPuppetComponent::nativeCreateRandomPath( CFrame& Frame )
+Bool FPuppetComponent::nativeCreateRandomPath( CFrame& Frame )
 {
 	if( Level->Navigator )
 	{
-		*POPA_BOOL	= Level->Navigator->MakeRandomPath( this );
+		return Level->Navigator->MakeRandomPath( this );
 	}
 	else
 	{
 		log( L"AI: Level has no navigator" );
-		*POPA_BOOL	= false;
+		return false;
 	}
 }
 
@@ -504,17 +494,16 @@ void FPuppetComponent::nativeCreateRandomPath( CFrame& Frame )
 // Tries to create a path to specified location, returns true
 // if path was successfully created, otherwise returns false.
 //
-void FPuppetComponent::nativeCreatePathTo( CFrame& Frame )
+Bool FPuppetComponent::nativeCreatePathTo( CFrame& Frame, const TVector& Dest )
 {
-	TVector	Dest	= POP_VECTOR;
 	if( Level->Navigator )
 	{
-		*POPA_BOOL	= Level->Navigator->MakePathTo( this, Dest );
+		return Level->Navigator->MakePathTo( this, Dest );
 	}
 	else
 	{
 		log( L"AI: Level has no navigator" );
-		*POPA_BOOL	= false;
+		return false;
 	}
 }
 
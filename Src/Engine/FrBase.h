@@ -66,16 +66,31 @@ typedef unsigned long long	QWord;
     Memory functions.
 -----------------------------------------------------------------------------*/
 
+//
+// Number of heap allocations, made through the memory
+// functions. It's never reset, so use a difference.
+//
+extern volatile long	GNumAllocs;
+
+#if FLU_COUNT_ALLOCS
+#define COUNT_ALLOC		_InterlockedIncrement( &GNumAllocs );
+#else
+#define COUNT_ALLOC
+#endif
+
 inline void* MemAlloc( DWord Count )
 {
+	COUNT_ALLOC
 	return calloc( Count, 1 );
 }
 inline void* MemMalloc( DWord Count )
 {
+	COUNT_ALLOC
 	return malloc( Count );
 }
 inline void* MemRealloc( void* Addr, DWord NewCount )
 {
+	COUNT_ALLOC
 	return realloc( Addr, NewCount );
 }
 inline void MemFree( void* Addr )
@@ -104,6 +119,14 @@ inline void MemCopy( void* Dst, const void* Src, DWord Count )
     CPlatformBase.
 -----------------------------------------------------------------------------*/
 
+//
+// A parallel job function. iJob is in range [0..NumJobs-1],
+// iWorker is in range [0..NumWorkers-1], worker 0 is
+// always the calling thread.
+//
+typedef void (*TJobFunction)( void* Param, Integer iJob, Integer iWorker );
+
+
 //
 // Platform global functions.
 //
@@ -118,6 +141,21 @@ public:
 	virtual void ClipboardCopy( Char* Str ) = 0;
 	virtual String ClipboardPaste() = 0;
 	virtual void Launch( const Char* Target, const Char* Parms ) = 0;
+	virtual DWord PeakMemory() = 0;
+
+	// Multithreading.
+	virtual Integer NumWorkers() = 0;
+	virtual void ParallelFor( TJobFunction Func, void* Param, Integer NumJobs ) = 0;
+	virtual void EnterCritical() = 0;
+	virtual void LeaveCritical() = 0;
+
+	// Executable memory, for the script JIT. Memory is
+	// allocated writable, and protected to be executable,
+	// once the code is written, it's never both. Platform
+	// maps it with VirtualAlloc, or mmap and mprotect.
+	virtual void* AllocExecutable( DWord Size ) = 0;
+	virtual Bool ProtectExecutable( void* Mem, DWord Size ) = 0;
+	virtual void FreeExecutable( void* Mem, DWord Size ) = 0;
 };
 
 
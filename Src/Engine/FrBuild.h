@@ -6,6 +6,40 @@
 // Whether use assembler instead C++ code?
 #define FLU_ASM			1
 
+// Whether use SSE2 intrinsics instead C++ code?
+#define FLU_SSE			1
+
+// Whether use threaded dispatch in script VM? It requires
+// computed goto, which is not supported by MSVC.
+#if defined(__GNUC__)
+#define FLU_THREADED_VM	1
+#else
+#define FLU_THREADED_VM	0
+#endif
+
+// Whether compile hot script functions to the machine
+// code? Code generator emits x86 or x64 code.
+#if defined(_M_IX86) || defined(__i386__) || defined(_M_X64) || defined(__x86_64__)
+#define FLU_JIT			1
+#else
+#define FLU_JIT			0
+#endif
+
+// Whether JIT emits x64 code.
+#if defined(_M_X64) || defined(__x86_64__)
+#define FLU_JIT_X64		1
+#else
+#define FLU_JIT_X64		0
+#endif
+
+// Whether count heap allocations of the engine memory
+// functions? Script benchmarks report them per operation.
+// It costs an interlocked op per allocation, so it's only
+// defined by the editor's build, which runs benchmarks.
+#ifndef FLU_COUNT_ALLOCS
+#define FLU_COUNT_ALLOCS	0
+#endif
+
 // Whether allow to use cheats console?
 #define FLU_CONSOLE		1
 
@@ -196,7 +196,8 @@ CNativeFunction::CNativeFunction( const Char* InName, DWord InFlags, Integer Ini
 		Flags( InFlags ),
 		iOpCode( IniOpCode ),
 		Class( nullptr ),
-		Priority( 0 )
+		Priority( 0 ),
+		NumRegs( 0 )
 {
 	// Test for duplicates.
 	if( !(Flags & (NFUN_UnaryOp | NFUN_BinaryOp)) )
@@ -213,9 +214,10 @@ CNativeFunction::CNativeFunction( const Char* InName, DWord InFlags, Integer Ini
 //
 // Native method constructor.
 //
-CNativeFunction::CNativeFunction( const Char* InName, CClass* InClass, TNativeMethod InMethod )
+CNativeFunction::CNativeFunction( const Char* InName, CClass* InClass, TNativeMethod InMethod, Integer InNumRegs )
 	:	Flags( NFUN_Method ),
 		Class( InClass ),
+		NumRegs( InNumRegs ),
 		ptrMethod( InMethod )
 {
 	// Make a friendly name.
@@ -185,9 +185,11 @@ public:
 
 
 //
-// Pointer to the native method.
+// A native method thunk, generated from the typed method
+// by the DECLARE_METHOD, see TMethodBind. Regs are the method
+// operands registers, arguments are followed by the result.
 //
-typedef void (FComponent::*TNativeMethod)( CFrame& Frame );
+typedef void (*TNativeMethod)( FComponent* Self, CFrame& Frame, const Byte* Regs );
 
 
 //
@@ -203,6 +205,7 @@ public:
 	CTypeInfo		ResultType;
 	CTypeInfo		ParamsType[8];
 	DWord			Priority;
+	Integer			NumRegs;	// Number of the method operands.
 
 	union
 	{
@@ -212,7 +215,7 @@ public:
 
 	// CNativeFunction interface.
 	CNativeFunction( const Char* InName, DWord InFlags, Integer IniOpCode );
-	CNativeFunction( const Char* InName, CClass* InClass, TNativeMethod InMethod );
+	CNativeFunction( const Char* InName, CClass* InClass, TNativeMethod InMethod, Integer InNumRegs );
 	String GetSignature() const; 
 };
 
@@ -422,7 +425,8 @@ Byte cls::cls##_Initializator()	\
 // Declare a native method.
 #define DECLARE_METHOD( name, resulttype, arg1type, arg2type, arg3type, arg4type )\
 {	\
-	CNativeFunction* Func	= new CNativeFunction( L#name, ClassType::MetaClass, (TNativeMethod)(&ClassType::name) );	\
+	typedef TMethodBind<decltype(&ClassType::name), &ClassType::name> TBind;	\
+	CNativeFunction* Func	= new CNativeFunction( L#name, ClassType::MetaClass, &TBind::Thunk, TBind::NumRegs );	\
 	Func->ParamsType[0]		= arg1type;	\
 	Func->ParamsType[1]		= arg2type;	\
 	Func->ParamsType[2]		= arg3type;	\
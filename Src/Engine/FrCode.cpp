@@ -10,10 +10,35 @@
 -----------------------------------------------------------------------------*/
 
 //
-// Static memory for script calling stack.
-// 512 kB should be enough.
+// Frames stack of the thread. Each thread has its own,
+// so frames never share it across threads.
 //
-CMemPool CFrame::GLocalsMem( L"Locals", 512 * 1024 );
+thread_local CFrameStack CFrameStack::GStack;
+
+
+//
+// Whether execute linked code.
+//
+Bool CFrame::bLinkedCode = true;
+
+
+//
+// Total number of executed instructions, for profiling.
+//
+QWord CFrame::NumExecuted = 0;
+
+
+//
+// Whether execute verified code in lean mode.
+//
+Bool CFrame::bLeanCode = true;
+
+
+//
+// Watchdog of the lean code.
+//
+Double CFrame::WatchdogBudget	= 1.0;
+Double CFrame::WatchdogDeadline	= 0.0;
 
 
 //
@@ -26,14 +51,19 @@ CFrame::CFrame( FEntity* InThis, CFunction* InFunction, Integer InDepth, CFrame*
 		PrevFrame( InPrevFrame ),
 		Depth( InDepth ),
 		Code( &InFunction->Code[0] ),
-		Locals( nullptr )
+		Regs( nullptr ),
+		Locals( nullptr ),
+		Stack( InPrevFrame ? InPrevFrame->Stack : &CFrameStack::GStack ),
+		Window( nullptr ),
+		StrRegs( nullptr ),
+		bGoto( false )
 {
 	// Test recursion depth.
 	if( InDepth > MAX_RECURSION_DEPTH )
 		ScriptError( L"Stack overflow" );
 
 	// Allocate locals.
-	Locals	= (Byte*)GLocalsMem.Push0( InFunction->FrameSize );
+	Locals	= (Byte*)Stack->LocalsMem.Push0( InFunction->FrameSize );
 }
 
 
@@ -47,9 +77,13 @@ CFrame::CFrame( FEntity* InThis, CThreadCode* InThread )
 		PrevFrame( nullptr ),
 		Script( InThis->Script ),
 		This( InThis ),
+		Regs( nullptr ),
 		Locals( nullptr ),
-		Code( &InThread->Code[0] )
-		
+		Stack( &CFrameStack::GStack ),
+		Window( nullptr ),
+		StrRegs( nullptr ),
+		Code( &InThread->Code[0] ),
+		bGoto( false )
 {
 }
 
@@ -107,6 +141,48 @@ void CFrame::ScriptError( Char* Fmt, ... )
 }
 
 
+//
+// Start the watchdog for the level tick, or for the
+// script entered out of the tick. It's started for each
+// event out of the tick, so clock isn't read here, the
+// budget starts with the first poll instead.
+//
+void CFrame::StartWatchdog()
+{
+	WatchdogDeadline	= WatchdogBudget > 0.0 ? WATCHDOG_PENDING : 0.0;
+}
+
+
+//
+// Stop the watchdog after the level tick.
+//
+void CFrame::StopWatchdog()
+{
+	WatchdogDeadline	= 0.0;
+}
+
+
+//
+// Stop the lean code, if scripts exceed time budget
+// of the tick. Watchdog is polled once per WATCHDOG_MASK+1
+// backward jumps.
+//
+void CFrame::CheckWatchdog()
+{
+	if( WatchdogDeadline == WATCHDOG_PENDING )
+	{
+		// First poll, script is looping, start counting.
+		WatchdogDeadline	= GPlat->TimeStamp() + WatchdogBudget;
+	}
+	else if( WatchdogDeadline != 0.0 && GPlat->TimeStamp() > WatchdogDeadline )
+	{
+		// Rest of scripts get a fresh budget.
+		StartWatchdog();
+		ScriptError( L"Infinity loop, time budget %.2f ms is exceeded", WatchdogBudget * 1000.0 );
+	}
+}
+
+
 //
 // Frame destructor.
 //
@@ -116,82 +192,127 @@ CFrame::~CFrame()
 	{
 		CFunction* Func = (CFunction*)Bytecode;
 
-		for( Integer i=0; i<Func->Locals.Num(); i++ )
-		{
-			CProperty* L = Func->Locals[i];
-			L->DestroyValues( Locals + L->Offset );
-		}
+		// Plain values don't require destruction.
+		if( !Func->Linked || !Func->Linked->bPlainLocals )
+			for( Integer i=0; i<Func->Locals.Num(); i++ )
+			{
+				CProperty* L = Func->Locals[i];
+				L->DestroyValues( Locals + L->Offset );
+			}
 
-		GLocalsMem.Pop(Locals);
+		Stack->LocalsMem.Pop(Locals);
 	}  
 }
 
 
+//
+// Return the registers window to the stack, after
+// execution. String registers are cleared, so window
+// doesn't hold strings alive.
+//
+void CFrame::ReleaseWindow()
+{
+	if( StrRegs )
+	{
+		for( Integer i=0; i<TRegister::NUM_REGS; i++ )
+			StrRegs[i]	= String();
+
+		StrRegs	= nullptr;
+	}
+
+	Stack->PopWindow();
+	Window	= nullptr;
+	Regs	= nullptr;
+}
+
+
+/*-----------------------------------------------------------------------------
+    CFrameStack implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Frames stack constructor. 512 kB of locals should be
+// enough, windows are preallocated for the recursion
+// depth, and grow only if events are nested deeper.
+//
+CFrameStack::CFrameStack()
+	:	LocalsMem( L"Locals", 512 * 1024 ),
+		Windows(),
+		Top( 0 )
+{
+	for( Integer i=0; i<NUM_FRAME_WINDOWS; i++ )
+		Windows.Push( new TFrameWindow() );
+}
+
+
+//
+// Frames stack destructor.
+//
+CFrameStack::~CFrameStack()
+{
+	assert(Top == 0);
+	for( Integer i=0; i<Windows.Num(); i++ )
+		delete Windows[i];
+
+	Windows.Empty();
+}
+
+
 /*-----------------------------------------------------------------------------
     FEntity implementation.
 -----------------------------------------------------------------------------*/
 
 //
-// Call a script event.
+// Execute a script event. Arguments are typed by the
+// caller, so only the signature is matched, and values
+// are written straight to the frame locals. Extra 
+// arguments are ignored.
 //
-void FEntity::CallEvent( EEventName EventName, CVariant A1, CVariant A2, CVariant A3, CVariant A4 )
+void FEntity::ExecuteEvent( CFunction* Event, DWord Signature, Integer NumArgs, const void** Args )
 {
-	// Don't call if no text.
-	if( !Script->bHasText || Script->Events.Num()==0 )
-		return;
+	CLinkedCode* Linked	= CLinkedCode::Link( Script, Event );
+	NumArgs				= Min( NumArgs, Event->ParmsCount );
 
-	// Try to find event.
-	CFunction* Event = Script->Events[EventName];
-	if( !Event )
+	// Match signatures.
+	DWord Mask = NumArgs < 4 ? (1u << (NumArgs * 8)) - 1 : 0xffffffff;
+	if( (Signature ^ Linked->Signature) & Mask )
+	{
+		if( Linked->BadSignature != Signature )
+		{
+			Integer iArg = 0;
+			while( !(((Signature ^ Linked->Signature) >> (iArg * 8)) & 0xff) )
+				iArg++;
+
+			GOutput->ScriptErrorf
+			(
+				L"Event call %s(%s::%s) from C++ failed. Argument %d types mismatched '%s' and '%s'",
+				*GetFullName(),
+				*Script->GetName(),
+				*Event->Name,
+				iArg+1,
+				*Event->Locals[iArg]->TypeName(),
+				*CTypeInfo((EPropType)((Signature >> (iArg * 8)) & 0xff)).TypeName()
+			);
+			Linked->BadSignature	= Signature;
+		}
 		return;
+	}
 
-	// Execute code!
-	try
+	// Create new frame and copy arguments.
+	CFrame Frame( this, Event, 1, nullptr );
+	for( Integer iArg=0; iArg<NumArgs; iArg++ )
 	{
-		// Create new frame frame.
-		CFrame Frame( this, Event, 1, nullptr );
-
-		// Parse parameters.
-		CVariant* Args[4] = { &A1, &A2, &A3, &A4 };
-		for( Integer iArg=0; iArg<4 && iArg<Event->ParmsCount; iArg++ )
-		{
-			// Everything parsed.
-			if( Args[iArg]->Type == TYPE_None )
-				break;
-
-			CProperty* Parm = Event->Locals[iArg];
-
-			// Match types.
-			if( Parm->Type != Args[iArg]->Type )
-			{
-				// Mismatched.
-				log
-				( 
-					L"Script: Exception in FEntity::CallEvent(\"%s\"), types are mismatched in %d argument", 
-					EventName, 
-					iArg 
-				);
-				GOutput->ScriptErrorf
-				(
-					L"Event call %s(%s::%s) from C++ failed. Argument %d types mismatched '%s' and '%s'",
-					*GetFullName(),
-					*Script->GetName(),
-					EventName,
-					iArg+1,
-					*Parm->TypeName(),
-					*CTypeInfo(Args[iArg]->Type).TypeName()
-				);
-				throw nullptr;
-			}
-
-			// Copy arguments.
-			if( Parm->Type != TYPE_String )
-				Parm->CopyValues( &Frame.Locals[Parm->Offset], Args[iArg]->Value );
-			else
-				*(String*)&Frame.Locals[Parm->Offset] = Args[iArg]->StringValue;
-		}
+		const TCallArg& Arg = Linked->Args[iArg];
+
+		if( ((Signature >> (iArg * 8)) & 0xff) != TYPE_String )
+			MemCopy( &Frame.Locals[Arg.Offset], Args[iArg], Arg.Size );
+		else
+			*(String*)&Frame.Locals[Arg.Offset] = *(const String*)Args[iArg];
+	}
 
-		// Execute the code!
+	// Execute the code!
+	try
+	{
 		Frame.ProcessCode( nullptr );
 	}
 	catch( ... )
@@ -203,6 +324,129 @@ void FEntity::CallEvent( EEventName EventName, CVariant A1, CVariant A2, CVarian
 }
 
 
+/*-----------------------------------------------------------------------------
+    TIterator implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Return the next entity of the foreach loop, or 
+// nullptr if no more entities. Entities are filtered
+// while iterating, so entities, destroyed by the loop
+// body are skipped. Rect iterator walks the hash until
+// the loop body changes it, then the rest of objects is
+// walked from a snapshot, so moved objects are neither
+// skipped nor repeated.
+//
+FEntity* TIterator::Next()
+{
+	switch( Type )
+	{
+		case IT_AllEntities:
+		{
+			while( i < Level->Entities.Num() )
+			{
+				FEntity* Entity = Level->Entities[i++];
+				if( (!Script || Entity->Script == Script) && !Entity->Base->bDestroyed )
+					return Entity;
+			}
+			break;
+		}
+		case IT_RectEntities:
+		{
+			// Cursor isn't valid, once hash is changed.
+			if( !Snapshot && ModCount != Level->CollHash->ModCount )
+				TakeSnapshot();
+
+			if( Snapshot )
+			{
+				while( i < NumSnapshot )
+				{
+					FBaseComponent* Base = Snapshot[i++];
+					if( !Base->bDestroyed )
+						return Base->Entity;
+				}
+			}
+			else
+			{
+				FBaseComponent* Base = Level->CollHash->NextOverlapped( Bounds, Script, X, Y, i );
+				if( Base )
+				{
+					// Remember reported object, for the snapshot.
+					TWalked* Record	= (TWalked*)Push( sizeof(TWalked) );
+					Record->Object	= Base;
+					Record->Prev	= Walked;
+					Walked			= Record;
+					return Base->Entity;
+				}
+			}
+
+			// Release records and snapshot. Loops, nested into
+			// this one, are done, so their memory goes too.
+			if( MemBase )
+				Mem->Pop( MemBase );
+			break;
+		}
+		case IT_TouchedEntities:
+		{
+			while( i < array_length(Phys->Touched) )
+			{
+				FEntity* Entity = Phys->Touched[i++];
+				if( Entity )
+					return Entity;
+			}
+			break;
+		}
+	}
+
+	// No more entities.
+	Type	= 0;
+	return nullptr;
+}
+
+
+//
+// Push memory for the rect iterator records.
+//
+void* TIterator::Push( Integer Size )
+{
+	void* Result = Mem->Push( Size );
+	if( !MemBase )
+		MemBase	= (Byte*)Result;
+	return Result;
+}
+
+
+//
+// Collect the rest of objects inside the bounds, when
+// the loop body changed the hash. Already reported
+// objects are excluded, it's rare, so just look them up.
+//
+void TIterator::TakeSnapshot()
+{
+	static TArray<FBaseComponent*> List;
+	Integer NumObjs;
+	Level->CollHash->GetOverlapped( Bounds, NumObjs, List );
+
+	Snapshot	= (FBaseComponent**)Push( Max( NumObjs, 1 ) * sizeof(FBaseComponent*) );
+	NumSnapshot	= 0;
+	i			= 0;
+
+	for( Integer iObj=0; iObj<NumObjs; iObj++ )
+	{
+		FBaseComponent* Object = List[iObj];
+		if( Script && Object->Entity->Script != Script )
+			continue;
+
+		TWalked* Walk = Walked;
+		while( Walk && Walk->Object != Object )
+			Walk = Walk->Prev;
+
+		if( !Walk )
+			Snapshot[NumSnapshot++]	= Object;
+	}
+}
+
+
 /*-----------------------------------------------------------------------------
     Script execution.
 -----------------------------------------------------------------------------*/
@@ -210,7 +454,182 @@ void FEntity::CallEvent( EEventName EventName, CVariant A1, CVariant A2, CVarian
 //
 // Execute script function code.
 //
-void CFrame::ProcessCode( TRegister* Result )
+void CFrame::ProcessCode( Byte* Result )
+{
+	// Script, entered out of the level tick, has own time
+	// budget, since lean code doesn't count loop iterations.
+	if( !PrevFrame && WatchdogDeadline == 0.0 && WatchdogBudget > 0.0 )
+	{
+		StartWatchdog();
+		try
+		{
+			ProcessCode( Result );
+		}
+		catch( ... )
+		{
+			StopWatchdog();
+			throw;
+		}
+		StopWatchdog();
+		return;
+	}
+
+	// Take a registers window for the time of execution.
+	Window	= Stack->PushWindow();
+	Regs	= Window->Regs;
+
+	// Execute it!
+	try
+	{
+		if( bLinkedCode )
+			ExecuteLinked();
+		else
+			ExecuteBytecode();
+	}
+	catch( ... )
+	{
+		ReleaseWindow();
+		throw;
+	}
+	ReleaseWindow();
+
+	// Copy result if required.
+	if( Result && (Bytecode != Script->Thread) && ((CFunction*)Bytecode)->ResultVar )
+	{
+		CProperty* ResProp = ((CFunction*)Bytecode)->ResultVar;
+		ResProp->CopyValues( Result, Locals + ResProp->Offset );
+	}
+}
+
+
+//
+// Call a script function in the given context, with
+// arguments passed through the registers.
+//
+void CFrame::CallFunction( FEntity* Context, CFunction* Func, Byte* Args )
+{
+	CLinkedCode* Callee	= CLinkedCode::Link( Context->Script, Func );
+
+	if( Callee->bPlainArgs )
+	{
+		// Fast call, just copy values.
+		CFrame NewFrame( Context, Func, Depth+1, this );
+		for( Integer i=0; i<Func->ParmsCount; i++ )
+			MemCopy( NewFrame.Locals + Callee->Args[i].Offset, Regs[Args[i]].Value, Callee->Args[i].Size );
+
+		NewFrame.ProcessCode( Func->ResultVar ? RegValue( Args[Func->ParmsCount], Func->ResultVar->Type ) : nullptr );
+	}
+	else
+	{
+		void* OutParms[16];
+		assert(Func->ParmsCount<=array_length(OutParms));
+		CFrame NewFrame( Context, Func, Depth+1, this );
+
+		for( Integer i=0; i<Func->ParmsCount; i++ )
+		{
+			CProperty* Arg = Func->Locals[i];
+			Byte iReg = Args[i];
+			if( Arg->Flags & PROP_OutParm )
+			{
+				// Out param.
+				OutParms[i]	= Regs[iReg].Addr;
+				Arg->CopyValues( NewFrame.Locals + Arg->Offset, OutParms[i] );
+			}
+			else
+			{
+				// Regular param.
+				Arg->CopyValues( NewFrame.Locals + Arg->Offset, RegValue( iReg, Arg->Type ) );
+			}
+		}
+
+		NewFrame.ProcessCode( Func->ResultVar ? RegValue( Args[Func->ParmsCount], Func->ResultVar->Type ) : nullptr );
+
+		// Copy out parameters back.
+		for( Integer i=0; i<Func->ParmsCount; i++ )
+		{
+			CProperty* Arg = Func->Locals[i];
+			if( Arg->Flags & PROP_OutParm )
+				Arg->CopyValues( OutParms[i], NewFrame.Locals + Arg->Offset );
+		}
+	}
+}
+
+
+//
+// Print a message of the 'log' instruction.
+//
+void CFrame::LogMessage()
+{
+	// C-style output function, its really SLOW!!
+	const String& Fmt = ReadString();
+	String Out;
+	Integer iText = 0;
+
+	for( Integer i=0; i<Fmt.Len(); i++ )
+	{
+		if( Fmt[i] == L'%' )
+		{
+			CTypeInfo Info = CTypeInfo( ReadPropType() );
+			Byte iReg = ReadByte();
+			String Value = Info.Type == TYPE_String ? StrReg(iReg) : Info.ToString( Regs[iReg].Value );
+
+			Out		+= String::Copy( Fmt, iText, i-iText );
+			Out		+= Value;
+			iText	= i+2;
+			i++;
+		}
+	}
+
+	Out	+= String::Copy( Fmt, iText, Fmt.Len()-iText );
+	log( L"Script: %s", *Out );
+}
+
+
+//
+// Return the case address of the switch with dense
+// jump table, or -1 if label is out of range.
+//
+static inline Integer SwitchTable( const Byte* Table, Integer Expr )
+{
+	DWord	iLab	= (DWord)(Expr - *(Integer*)Table);
+	DWord	Num		= *(Word*)(Table + sizeof(Integer));
+
+	return iLab < Num ? ((Word*)(Table + sizeof(Integer) + sizeof(Word)))[iLab] : -1;
+}
+
+
+//
+// Return the case address of the switch with sorted
+// labels, or -1 if label not found.
+//
+static inline Integer SwitchSearch( const Byte* Table, Integer Expr )
+{
+	const Integer	Stride	= sizeof(Integer) + sizeof(Word);
+	Integer			Lo		= 0,
+					Hi		= *(Word*)Table - 1;
+
+	Table	+= sizeof(Word);
+	while( Lo <= Hi )
+	{
+		Integer	iMid	= (Lo + Hi) >> 1;
+		Integer	Label	= *(Integer*)(Table + iMid * Stride);
+
+		if( Label < Expr )
+			Lo	= iMid + 1;
+		else if( Label > Expr )
+			Hi	= iMid - 1;
+		else
+			return *(Word*)(Table + iMid * Stride + sizeof(Integer));
+	}
+	return -1;
+}
+
+
+//
+// Interpret the bytecode, instruction by instruction. It's
+// slower than linked code, but doesn't require linking.
+//
+void CFrame::ExecuteBytecode()
 {
 	// Infinity loop detection variables.
 	Integer LoopCounter = 0;
@@ -218,10 +637,17 @@ void CFrame::ProcessCode( TRegister* Result )
 	// Current execution context.
 	FEntity* Context = This;
 
+	// Executed instructions counter.
+	Integer Executed = 0;
+
+	// Registers of the bound window.
+	TRegister* Regs	= this->Regs;
+
 	// Execute it!
 	while( *Code != CODE_EOC )
 	{
 		EOpCode Op = (EOpCode)*Code++;
+		Executed++;
 
 		switch( Op )
 		{
@@ -262,7 +688,7 @@ void CFrame::ProcessCode( TRegister* Result )
 			{
 				// String l to r.
 				Byte iReg = ReadByte();
-				Regs[iReg].StrValue = *(String*)Regs[iReg].Addr;
+				StrReg(iReg) = *(String*)Regs[iReg].Addr;
 				break;
 			}
 			case CODE_Assign:
@@ -284,7 +710,7 @@ void CFrame::ProcessCode( TRegister* Result )
 			{
 				// String assignment.
 				Byte iDst = ReadByte();
-				*((String*)Regs[iDst].Addr) = Regs[ReadByte()].StrValue;
+				*((String*)Regs[iDst].Addr) = StrReg(ReadByte());
 				break;
 			}
 			case CODE_LocalVar:
@@ -417,8 +843,8 @@ void CFrame::ProcessCode( TRegister* Result )
 			case CODE_ConstString:
 			{
 				// String constant.
-				String Value = ReadString();
-				Regs[ReadByte()].StrValue = Value;
+				const String& Value = ReadString();
+				StrReg(ReadByte()) = Value;
 				break;
 			}
 			case CODE_ConstVector:
@@ -459,30 +885,8 @@ void CFrame::ProcessCode( TRegister* Result )
 			}
 			case CODE_Log:
 			{
-				// C-style output function, its really SLOW!!
-				String Fmt = ReadString();
-				Char Out[256], *Str = Out;
-
-				for( Integer i=0; i<Fmt.Len(); i++ )
-				{
-					if( Fmt[i] != L'%' )
-					{
-						*Str++ = Fmt[i];
-					}
-					else
-					{
-						CTypeInfo Info = CTypeInfo( ReadPropType() );
-						Byte iReg = ReadByte();
-						String Value = Info.Type == TYPE_String ? Regs[iReg].StrValue : Info.ToString( Regs[iReg].Value );
-
-						for( Integer j=0; j<Value.Len(); j++ )
-							*Str++ = Value[j];
-						i++;
-					}
-				}
-
-				*Str = 0;
-				log( L"Script: %s", Out );
+				// Output message.
+				LogMessage();
 				break;
 			}
 			case CODE_EntityCast:
@@ -520,7 +924,7 @@ void CFrame::ProcessCode( TRegister* Result )
 			{
 				// String length.
 				Byte iStr = ReadByte();
-				*(Integer*)(Regs[ReadByte()].Value) = Regs[iStr].StrValue.Len();
+				*(Integer*)(Regs[ReadByte()].Value) = StrReg(iStr).Len();
 				break;
 			}
 			case CODE_New:
@@ -586,7 +990,7 @@ void CFrame::ProcessCode( TRegister* Result )
 				Byte i1	= ReadByte();
 				Byte i2 = ReadByte();	
 				Byte Size = ReadByte();
-				*(Bool*)(Regs[i1].Value) = Size != 0 ? MemCmp( Regs[i1].Value, Regs[i2].Value, Size ) : Regs[i1].StrValue == Regs[i2].StrValue;
+				*(Bool*)(Regs[i1].Value) = Size != 0 ? MemCmp( Regs[i1].Value, Regs[i2].Value, Size ) : StrReg(i1) == StrReg(i2);
 				break;
 			}
 			case CODE_NotEqual:
@@ -595,7 +999,7 @@ void CFrame::ProcessCode( TRegister* Result )
 				Byte i1	= ReadByte();
 				Byte i2 = ReadByte();	
 				Byte Size = ReadByte();
-				*(Bool*)(Regs[i1].Value) = Size != 0 ? !MemCmp( Regs[i1].Value, Regs[i2].Value, Size ) : Regs[i1].StrValue != Regs[i2].StrValue;
+				*(Bool*)(Regs[i1].Value) = Size != 0 ? !MemCmp( Regs[i1].Value, Regs[i2].Value, Size ) : StrReg(i1) != StrReg(i2);
 				break;
 			}
 			case CODE_ConditionalOp:
@@ -604,7 +1008,10 @@ void CFrame::ProcessCode( TRegister* Result )
 				Byte iRes		= ReadByte();
 				Byte iFirst		= ReadByte();
 				Byte iSecond	= ReadByte();
-				Regs[iRes]		= Regs[*(Bool*)(Regs[ReadByte()].Value) ? iFirst : iSecond];
+				Byte iSrc		= *(Bool*)(Regs[ReadByte()].Value) ? iFirst : iSecond;
+				Regs[iRes]		= Regs[iSrc];
+				if( StrRegs )
+					StrRegs[iRes]	= StrRegs[iSrc];
 				break;
 			}
 			case CAST_ByteToInteger:
@@ -694,24 +1101,31 @@ void CFrame::ProcessCode( TRegister* Result )
 				LabFound:
 				break;
 			}
+			case CODE_SwitchTable:
+			case CODE_SwitchSearch:
+			{
+				// Perform switch statement, with jump table
+				// or binary search.
+				Byte	Size	= ReadByte();
+				Byte*	Value	= Regs[ReadByte()].Value;
+				Integer	Expr	= Size == 1 ? *(Byte*)Value : *(Integer*)Value;
+				Word	AddrDef	= ReadWord();
+				Byte*	Table	= &Bytecode->Code[ReadWord()];
+				Integer	Addr	= Op == CODE_SwitchTable ? SwitchTable( Table, Expr ) : SwitchSearch( Table, Expr );
+
+				Code	= &Bytecode->Code[Addr != -1 ? Addr : AddrDef];
+				break;
+			}
 			case CODE_Foreach:
 			{
 				// Perform foreach statement.
+				TIterator*	Iter	= (TIterator*)&Locals[ReadWord()];
 				FEntity**	Value	= (FEntity**)&Locals[ReadWord()];	
 				Word		EndAddr	= ReadWord();
 
-				if( Foreach.i < Foreach.Collection.Num() )
-				{
-					*Value		= Foreach.Collection[Foreach.i];
-					Foreach.i++;
-				}
-				else
-				{
-					*Value		= nullptr;
-					Code		= &Bytecode->Code[EndAddr];
-					Foreach.i	= 0;
-					Foreach.Collection.Empty();
-				}
+				*Value	= Iter->Next();
+				if( !*Value )
+					Code	= &Bytecode->Code[EndAddr];
 				break;
 			}
 			case CODE_CallFunction:
@@ -739,11 +1153,7 @@ void CFrame::ProcessCode( TRegister* Result )
 					else
 					{
 						// Regular param.
-						Arg->CopyValues
-									(	
-										NewFrame.Locals + Arg->Offset,
-										Arg->Type == TYPE_String ? (Byte*)&Regs[iReg].StrValue : (Byte*)Regs[iReg].Value
-									);
+						Arg->CopyValues( NewFrame.Locals + Arg->Offset, RegValue( iReg, Arg->Type ) );
 					}
 				}
 
@@ -751,7 +1161,7 @@ void CFrame::ProcessCode( TRegister* Result )
 				{
 					// With result.
 					Byte iRes = ReadByte();
-					NewFrame.ProcessCode( &Regs[iRes] );
+					NewFrame.ProcessCode( RegValue( iRes, Func->ResultVar->Type ) );
 				}
 				else
 				{
@@ -782,18 +1192,14 @@ void CFrame::ProcessCode( TRegister* Result )
 				{
 					CProperty* Arg = Func->Locals[i];
 					Byte iReg = ReadByte();
-					Arg->CopyValues
-								(	
-									NewFrame.Locals + Arg->Offset,
-									Arg->Type == TYPE_String ? (Byte*)&Regs[iReg].StrValue : (Byte*)Regs[iReg].Value
-								);
+					Arg->CopyValues( NewFrame.Locals + Arg->Offset, RegValue( iReg, Arg->Type ) );
 				}
 
 				if( Func->ResultVar )
 				{
 					// With result.
 					Byte iRes = ReadByte();
-					NewFrame.ProcessCode( &Regs[iRes] );
+					NewFrame.ProcessCode( RegValue( iRes, Func->ResultVar->Type ) );
 				}
 				else
 				{
@@ -805,15 +1211,20 @@ void CFrame::ProcessCode( TRegister* Result )
 			case CODE_BaseMethod:
 			{
 				// Base method call.
-				CNativeFunction* Native = CClassDatabase::GFuncs[ReadWord()];
-				((Context->Base)->*(Native->ptrMethod))( *this );
+				CNativeFunction*	Native		= CClassDatabase::GFuncs[ReadWord()];
+				Byte*				Operands	= Code;
+				Code	+= Native->NumRegs;
+				Native->ptrMethod( Context->Base, *this, Operands );
 				break;
 			}
 			case CODE_ComponentMethod:
 			{
 				// Component method call.
-				CNativeFunction* Native = CClassDatabase::GFuncs[ReadWord()];
-				((Context->Components[ReadByte()])->*(Native->ptrMethod))( *this );
+				CNativeFunction*	Native		= CClassDatabase::GFuncs[ReadWord()];
+				FComponent*			Component	= Context->Components[ReadByte()];
+				Byte*				Operands	= Code;
+				Code	+= Native->NumRegs;
+				Native->ptrMethod( Component, *this, Operands );
 				break;
 			}
 			case CODE_Stop:
@@ -859,6 +1270,9 @@ void CFrame::ProcessCode( TRegister* Result )
 					This->Thread->Frame.Code	= &Script->Thread->Code[LabAddr];
 					This->Thread->Status		= THR_Run;
 					This->Thread->LabelId		= iLabel;
+
+					if( This->Thread->Scheduler )
+						This->Thread->Scheduler->Wake( This->Thread );
 				}
 				else
 					ScriptError( L"Bad label %d in 'goto'", iLabel );
@@ -884,37 +1298,926 @@ void CFrame::ProcessCode( TRegister* Result )
 		}
 	}
 
-LeaveCode:;
-
-	// Copy result if required.
-	if( Result && (Bytecode != Script->Thread) && ((CFunction*)Bytecode)->ResultVar )
-	{
-		CProperty* ResProp = ((CFunction*)Bytecode)->ResultVar;
-		ResProp->CopyValues
-						( 
-							ResProp->Type == TYPE_String ? (Byte*)&Result->StrValue : Result->Value,
-							Locals + ResProp->Offset
-						);
-	}
+LeaveCode:
+	NumExecuted	+= Executed;
 }
 
 
 /*-----------------------------------------------------------------------------
-    CEntityThread implementation.
+    Linked code execution.
 -----------------------------------------------------------------------------*/
 
 //
-// Thread constructor. Creates frame for execution.
-// Warning: Use only while playing, since cause
-// problems with GC and Undo/Redo.
+// List of instructions, executed by the linked code
+// VM itself, all others are natives.
 //
-CEntityThread::CEntityThread( FEntity* InEntity, CThreadCode* InThread )
-	:	Frame( InEntity, InThread ),
-		Status( THR_Run ),
-		Entity( InEntity ),
+#define LINKED_OPS( X )\
+	X( CODE_EOC )				X( CODE_Jump )				X( CODE_JumpZero )\
+	X( CODE_Switch )			X( CODE_SwitchTable )		X( CODE_SwitchSearch )\
+	X( CODE_Foreach )			X( CODE_ConstByte )\
+	X( CODE_ConstBool )			X( CODE_ConstInteger )		X( CODE_ConstFloat )\
+	X( CODE_ConstAngle )		X( CODE_ConstColor )		X( CODE_ConstString )\
+	X( CODE_ConstVector )		X( CODE_ConstAABB )			X( CODE_ConstResource )\
+	X( CODE_ConstEntity )		X( CODE_This )				X( CODE_EntityCast )\
+	X( CODE_FamilyCast )		X( CODE_Context )			X( CODE_Is )\
+	X( CODE_In )				X( CODE_New )				X( CODE_Delete )\
+	X( CODE_Log )				X( CODE_Assert )			X( CODE_Length )\
+	X( CODE_Assign )			X( CODE_AssignDWord )		X( CODE_AssignString )\
+	X( CODE_LocalVar )			X( CODE_EntityProperty )	X( CODE_BaseProperty )\
+	X( CODE_ComponentProperty )	X( CODE_ResourceProperty )	X( CODE_ProtoProperty )\
+	X( CODE_LToR )				X( CODE_LToRDWord )			X( CODE_LToRString )\
+	X( CODE_ArrayElem )			X( CODE_RMember )			X( CODE_LMember )\
+	X( CODE_BaseMethod )		X( CODE_ComponentMethod )	X( CODE_CallFunction )\
+	X( CODE_CallVF )			X( CODE_Stop )				X( CODE_Sleep )\
+	X( CODE_Goto )				X( CODE_Wait )				X( CODE_Interrupt )\
+	X( CODE_Label )				X( CODE_Equal )				X( CODE_NotEqual )\
+	X( CODE_VectorCnstr )		X( CODE_ConditionalOp )		X( CAST_ByteToInteger )\
+	X( CAST_ByteToFloat )		X( CAST_ByteToAngle )		X( CAST_IntegerToFloat )\
+	X( CAST_IntegerToByte )		X( CAST_IntegerToAngle )	X( CAST_AngleToInteger )\
+	X( UN_Inc_Integer )			X( UN_Inc_Float )			X( UN_Dec_Integer )\
+	X( UN_Dec_Float )			X( UN_Minus_Integer )		X( UN_Minus_Float )\
+	X( UN_Not_Bool )			X( BIN_Mult_Integer )		X( BIN_Mult_Float )\
+	X( BIN_Mult_Vector )		X( BIN_Div_Float )			X( BIN_Add_Integer )\
+	X( BIN_Add_Float )			X( BIN_Add_Vector )			X( BIN_Sub_Integer )\
+	X( BIN_Sub_Float )			X( BIN_Sub_Vector )			X( BIN_Less_Integer )\
+	X( BIN_Less_Float )			X( BIN_LessEq_Integer )		X( BIN_LessEq_Float )\
+	X( BIN_Greater_Integer )	X( BIN_Greater_Float )		X( BIN_GreaterEq_Integer )\
+	X( BIN_GreaterEq_Float )	X( BIN_And_Integer )		X( BIN_Or_Integer )\
+	X( BIN_AddEqual_Integer )	X( BIN_AddEqual_Float )		X( BIN_SubEqual_Integer )\
+	X( BIN_SubEqual_Float )		X( BIN_MulEqual_Float )		X( XOP_Continue )\
+	X( XOP_LocalDWord )			X( XOP_EntityDWord )		X( XOP_BaseDWord )\
+	X( XOP_JumpNotLess_Integer )		X( XOP_JumpNotLessEq_Integer )\
+	X( XOP_JumpNotGreater_Integer )		X( XOP_JumpNotGreaterEq_Integer )\
+	X( XOP_JumpNotLess_Float )			X( XOP_JumpNotLessEq_Float )\
+	X( XOP_JumpNotGreater_Float )		X( XOP_JumpNotGreaterEq_Float )\
+	X( XOP_JumpNotEqualDWord )			X( XOP_JumpEqualDWord )\
+	X( XOP_Native )				X( OP_Abs )					X( OP_Cos )\
+	X( OP_Sin )					X( OP_Sqrt )				X( OP_Distance )\
+	X( OP_Frac )				X( OP_Round )				X( OP_Normalize )\
+	X( OP_VectorSize )			X( BIN_Dot_Vector )			X( BIN_Cross_Vector )\
+
+
+//
+// Dispatch macro. Use computed goto if possible, since
+// each handler has own indirect jump, which is much better 
+// predicted than the single jump of the switch.
+//
+#if FLU_THREADED_VM
+	#define OPCODE( op )		L_##op:
+	#define DISPATCH			{ Executed++; goto *Handlers[I->Op]; }
+#else
+	#define OPCODE( op )		case op:
+	#define DISPATCH			{ Executed++; continue; }
+#endif
+
+#define NEXT					{ I++; DISPATCH }
+#define JUMP( iInstr )			{ I = Base + (iInstr); DISPATCH }
+
+
+//
+// Count loop iteration. Both modes share the counter, and
+// look at it once per WATCHDOG_MASK+1 jumps, lean code polls
+// the watchdog, if it's running, other code just limits
+// the iterations.
+//
+#define LOOP_CHECK\
+	if( !(++LoopCounter & WATCHDOG_MASK) )\
+	{\
+		if( bLean && bWatchdog )\
+			CheckWatchdog();\
+		else if( LoopCounter > MAX_ITERATIONS )\
+			ScriptError( L"Infinity loop" );\
+	}
+
+
+//
+// Verifier might reject just linked code, so continue
+// it with all runtime checks.
+//
+#define VERIFY_FALLBACK\
+	if( bLean && !Linked->bVerified )\
+	{\
+		NumExecuted	+= Executed;\
+		ExecuteInstrs<false>( Linked, I - Base, Context );\
+		return;\
+	}
+
+
+//
+// Restore instruction pointer after call to the outer code,
+// since it might link more code or goto to label. Label is
+// entered in 'this' context, as thread starts.
+//
+#define RESUME( iInstr )\
+{\
+	Base	= &Linked->Instrs[0];\
+	I		= Base + (iInstr);\
+	if( bGoto )\
+	{\
+		bGoto	= false;\
+		Integer iLabel = Linked->Resolve( Code - &Bytecode->Code[0] );\
+		Base	= &Linked->Instrs[0];\
+		I		= Base + iLabel;\
+		Context	= This;\
+		VERIFY_FALLBACK\
+	}\
+	DISPATCH\
+}
+
+
+//
+// Continue after script function call. Next instruction is
+// linked on the first return, since the arguments list
+// length depends on the callee.
+//
+#define RESUME_CALL( iInstr, NextAddr )\
+{\
+	Base	= &Linked->Instrs[0];\
+	if( Base[iInstr].Target == -1 )\
+	{\
+		Linked->ResolveCall( iInstr, NextAddr );\
+		Base	= &Linked->Instrs[0];\
+		I		= Base + Base[iInstr].Target;\
+		VERIFY_FALLBACK\
+	}\
+	RESUME( Base[iInstr].Target )\
+}
+
+
+//
+// Leave the code, and store the address to continue from.
+//
+#define LEAVE( NextAddr )\
+{\
+	Code	= &Bytecode->Code[NextAddr];\
+	goto LeaveCode;\
+}
+
+
+//
+// Execute linked code, see FrLinker.h.
+//
+void CFrame::ExecuteLinked()
+{
+	// Link the code, if it's not linked yet.
+	CLinkedCode* Linked = CLinkedCode::Link( Script, Bytecode );
+	Integer iEntry = Linked->Resolve( Code - &Bytecode->Code[0] );
+
+#if FLU_JIT
+	// Run the machine code, if function is hot.
+	if( iEntry == 0 && Bytecode != Script->Thread && CJit::Execute( *this, Linked ) )
+		return;
+#endif
+
+	// Verified code runs in lean mode, if watchdog guards it.
+	bGoto	= false;
+	if( IsLean() && Linked->bVerified )
+		ExecuteInstrs<true>( Linked, iEntry, This );
+	else
+		ExecuteInstrs<false>( Linked, iEntry, This );
+}
+
+
+//
+// Execute linked instructions from the entry in the
+// given context. Lean mode skips checks, which verifier
+// made redundant.
+//
+template<Bool bLean> void CFrame::ExecuteInstrs( CLinkedCode* Linked, Integer iEntry, FEntity* Context )
+{
+	// Infinity loop detection variables.
+	DWord	LoopCounter	= 0;
+	Bool	bWatchdog	= WatchdogDeadline != 0.0;
+
+	// Executed instructions counter.
+	Integer Executed = 0;
+
+	// Window is bound for the whole execution, keep it
+	// in a local, so stores to registers don't reload it.
+	TRegister* Regs	= this->Regs;
+
+	TInstr* Base	= &Linked->Instrs[0];
+	TInstr* I		= Base + iEntry;
+
+#if FLU_THREADED_VM
+	// Prepare table of handlers.
+	static void* Handlers[XOP_MAX] = {};
+	if( !Handlers[0] )
+	{
+		for( Integer i=0; i<XOP_MAX; i++ )
+			Handlers[i]	= &&L_Native;
+
+		#define HANDLER( op ) Handlers[op] = &&L_##op;
+		LINKED_OPS( HANDLER )
+		#undef HANDLER
+	}
+
+	// Execute it!
+	DISPATCH
+#else
+	// Execute it!
+	for( ; ; )
+	switch( I->Op )
+	{
+#endif
+		OPCODE( CODE_EOC )
+		{
+			// End of code.
+			LEAVE( I->Addr );
+		}
+		OPCODE( CODE_Jump )
+		{
+			// Immediately jump.
+			LOOP_CHECK
+			JUMP( I->Target );
+		}
+		OPCODE( XOP_Continue )
+		{
+			// Continue in other block.
+			JUMP( I->Target );
+		}
+		OPCODE( CODE_JumpZero )
+		{
+			// Conditional jump.
+			LOOP_CHECK
+			if( !*(Bool*)(Regs[I->A].Value) )
+				JUMP( I->Target );
+			NEXT;
+		}
+		OPCODE( CODE_LToR )
+		{
+			// General purpose l to r.
+			MemCopy( Regs[I->A].Value, Regs[I->A].Addr, I->C );
+			NEXT;
+		}
+		OPCODE( CODE_LToRDWord )
+		{
+			// DWord l to r.
+			*((DWord*)Regs[I->A].Value) = *(DWord*)Regs[I->A].Addr;
+			NEXT;
+		}
+		OPCODE( CODE_LToRString )
+		{
+			// String l to r.
+			StrReg(I->A) = *(String*)Regs[I->A].Addr;
+			NEXT;
+		}
+		OPCODE( CODE_Assign )
+		{
+			// General purpose assignment.
+			MemCopy( Regs[I->A].Addr, Regs[I->B].Value, I->C );
+			NEXT;
+		}
+		OPCODE( CODE_AssignDWord )
+		{
+			// Assign DWord sized value.
+			*((DWord*)Regs[I->A].Addr) = *((DWord*)Regs[I->B].Value);
+			NEXT;
+		}
+		OPCODE( CODE_AssignString )
+		{
+			// String assignment.
+			*((String*)Regs[I->A].Addr) = StrReg(I->B);
+			NEXT;
+		}
+		OPCODE( CODE_LocalVar )
+		{
+			// Local variable.
+			Regs[I->A].Addr	= Locals + I->W;
+			NEXT;
+		}
+		OPCODE( CODE_EntityProperty )
+		{
+			// Get an entity property.
+			Regs[I->A].Addr = &Context->InstanceBuffer->Data[I->W];
+			NEXT;
+		}
+		OPCODE( CODE_BaseProperty )
+		{
+			// Get an base component property.
+			Regs[I->A].Addr = (Byte*)Context->Base + I->W;
+			NEXT;
+		}
+		OPCODE( CODE_ComponentProperty )
+		{
+			// Get an extra component property.
+			Regs[I->A].Addr = (Byte*)Context->Components[I->B] + I->W;
+			NEXT;
+		}
+		OPCODE( CODE_ResourceProperty )
+		{
+			// Get an resource property.
+			FResource* Res = *(FResource**)Regs[I->A].Value;
+			if( !Res )
+				ScriptError( L"Access to null resource" );
+			Regs[I->A].Addr	= (Byte*)Res + I->W;
+			NEXT;
+		}
+		OPCODE( CODE_ProtoProperty )
+		{
+			// Get a prototype property.
+			FScript*	Prototype	= I->Script;
+			Byte*		BaseAddr	=	I->B == 0xff ? (Byte*)&Prototype->InstanceBuffer->Data[0] :
+										I->B == 0xfe ? (Byte*)Prototype->Base : (Byte*)Prototype->Components[I->B];
+			Regs[I->A].Addr	= BaseAddr + I->W;
+			NEXT;
+		}
+		OPCODE( CODE_ArrayElem )
+		{
+			// Get an array element.
+			Integer Index = *(Integer*)Regs[I->B].Value;
+			if( Index < 0 || Index >= I->D )
+				ScriptError( L"Array violates bounds %i/%i", Index, I->D );
+
+			Regs[I->A].Addr = (Byte*)Regs[I->A].Addr + Index * I->C;
+			NEXT;
+		}
+		OPCODE( CODE_LMember )
+		{
+			// Get an l-value member.
+			Regs[I->A].Addr = (Byte*)Regs[I->A].Addr + I->C;
+			NEXT;
+		}
+		OPCODE( CODE_RMember )
+		{
+			// Get an r-value member.
+			MemCopy( &Regs[I->A].Value[0], &Regs[I->A].Value[I->C], 16-I->C );
+			NEXT;
+		}
+		OPCODE( CODE_This )
+		{
+			// This reference.
+			*(FEntity**)(Regs[I->A].Value) = This;
+			NEXT;
+		}
+		OPCODE( CODE_ConstByte )
+		OPCODE( CODE_ConstBool )
+		{
+			// Byte or bool constant.
+			*(Byte*)(Regs[I->A].Value) = I->dValue;
+			NEXT;
+		}
+		OPCODE( CODE_ConstInteger )
+		OPCODE( CODE_ConstFloat )
+		OPCODE( CODE_ConstAngle )
+		OPCODE( CODE_ConstColor )
+		{
+			// DWord sized constant.
+			*(DWord*)(Regs[I->A].Value) = I->dValue;
+			NEXT;
+		}
+		OPCODE( CODE_ConstString )
+		{
+			// String constant.
+			StrReg(I->A) = Script->StrTable[I->W];
+			NEXT;
+		}
+		OPCODE( CODE_ConstVector )
+		{
+			// Vector constant.
+			*(TVector*)(Regs[I->A].Value) = *(TVector*)I->Operands;
+			NEXT;
+		}
+		OPCODE( CODE_ConstAABB )
+		{
+			// TRect constant.
+			*(TRect*)(Regs[I->A].Value) = *(TRect*)I->Operands;
+			NEXT;
+		}
+		OPCODE( CODE_ConstResource )
+		{
+			// FResource constant.
+			*(FResource**)(Regs[I->A].Value) = I->Resource;
+			NEXT;
+		}
+		OPCODE( CODE_ConstEntity )
+		{
+			// FEntity constant.
+			*(FEntity**)(Regs[I->A].Value) = I->iValue != -1 ? (FEntity*)GObjectDatabase->GObjects[I->iValue] : nullptr;
+			NEXT;
+		}
+		OPCODE( CODE_Assert )
+		{
+			// Assertion.
+			if( !*(Bool*)(Regs[I->A].Value) )
+				ScriptError( L"Assertion failed! Line: %d", I->W );
+			NEXT;
+		}
+		OPCODE( CODE_Log )
+		{
+			// Output message.
+			Code	= I->Operands;
+			LogMessage();
+			NEXT;
+		}
+		OPCODE( CODE_EntityCast )
+		{
+			// Entity explicit cast.
+			FEntity* Value = *(FEntity**)Regs[I->A].Value;
+			if( Value && Value->Script != I->Script )
+				ScriptError
+						( 
+							L"Invalid script typecast '%s' to '%s'", 
+							*Value->Script->GetName(), 
+							*I->Script->GetName() 
+						);
+			NEXT;
+		}
+		OPCODE( CODE_FamilyCast )
+		{
+			// Entity explicit family cast.
+			FEntity* Value = *(FEntity**)Regs[I->A].Value;
+			if( Value && Value->Script->iFamily != I->iValue )
+				ScriptError
+						( 
+							L"Invalid family typecast '%d' to '%d'", 
+							Value->Script->iFamily, 
+							I->iValue
+						);
+			NEXT;
+		}
+		OPCODE( CODE_Length )
+		{
+			// String length.
+			*(Integer*)(Regs[I->B].Value) = StrReg(I->A).Len();
+			NEXT;
+		}
+		OPCODE( CODE_New )
+		{
+			// Create a new entity.
+			static String TempName = L"Temp";
+			FScript* NewScript = As<FScript>(*(FObject**)Regs[I->A].Value);
+			if( !NewScript )
+				ScriptError( L"Failed create entity, meta-script is not specified" );
+
+			Integer iThis = I - Base;
+			*(FEntity**)(Regs[I->B].Value) = This->Level->CreateEntity( NewScript, TempName, This->Base->Location );
+			RESUME( iThis + 1 );
+		}
+		OPCODE( CODE_Delete )
+		{
+			// Delete an entity.
+			FEntity* Poor = *(FEntity**)(Regs[I->A].Value);
+			if( Poor )
+				Poor->Base->bDestroyed	= true;
+			else
+				ScriptError( L"An attempt to delete undefined entity" );
+			NEXT;
+		}
+		OPCODE( CODE_VectorCnstr )
+		{
+			// Vector constructor.
+			TVector* VectorPtr = (TVector*)Regs[I->A].Value;
+			VectorPtr->X = *(Float*)Regs[I->B].Value;	
+			VectorPtr->Y = *(Float*)Regs[I->C].Value;	
+			NEXT;
+		}
+		OPCODE( CODE_Label )
+		{
+			// Current label id.
+			*(Integer*)Regs[I->A].Value = This->Thread->LabelId;
+			NEXT;
+		}
+		OPCODE( CODE_Is )
+		{
+			// Test entity script.
+			FEntity* Entity = *(FEntity**)(Regs[I->A].Value);
+			FScript* Test	= *(FScript**)(Regs[I->B].Value);
+			if( !Test )
+				ScriptError( L"'is' failure, meta-script is null" );
+
+			*(Bool*)(Regs[I->A].Value) = Entity ? Entity->Script == Test : false;
+			NEXT;
+		}
+		OPCODE( CODE_In )
+		{
+			// Test entity family.
+			FEntity* Entity = *(FEntity**)(Regs[I->A].Value);
+			*(Bool*)(Regs[I->A].Value) = Entity ? Entity->Script->iFamily == I->iValue : false;
+			NEXT;
+		}
+		OPCODE( CODE_Equal )
+		{
+			// Comparison operator "==".
+			*(Bool*)(Regs[I->A].Value) = I->C != 0 ? MemCmp( Regs[I->A].Value, Regs[I->B].Value, I->C ) : StrReg(I->A) == StrReg(I->B);
+			NEXT;
+		}
+		OPCODE( CODE_NotEqual )
+		{
+			// Comparison operator "!=".
+			*(Bool*)(Regs[I->A].Value) = I->C != 0 ? !MemCmp( Regs[I->A].Value, Regs[I->B].Value, I->C ) : StrReg(I->A) != StrReg(I->B);
+			NEXT;
+		}
+		OPCODE( CODE_ConditionalOp )
+		{
+			// Ternary if.
+			Byte iSrc	= *(Bool*)(Regs[I->D].Value) ? I->B : I->C;
+			Regs[I->A]	= Regs[iSrc];
+			if( StrRegs )
+				StrRegs[I->A]	= StrRegs[iSrc];
+			NEXT;
+		}
+		OPCODE( CAST_ByteToInteger )
+		{
+			// Byte to integer cast.
+			*(Integer*)Regs[I->A].Value = *(Byte*)Regs[I->A].Value;
+			NEXT;
+		}
+		OPCODE( CAST_ByteToFloat )
+		{
+			// Byte to float cast.
+			*(Float*)Regs[I->A].Value = *(Byte*)Regs[I->A].Value;
+			NEXT;
+		}
+		OPCODE( CAST_ByteToAngle )
+		{
+			// Byte to angle cast.
+			*(TAngle*)Regs[I->A].Value = *(Byte*)Regs[I->A].Value;
+			NEXT;
+		}
+		OPCODE( CAST_IntegerToFloat )
+		{
+			// Integer to float cast.
+			*(Float*)Regs[I->A].Value = *(Integer*)Regs[I->A].Value;
+			NEXT;
+		}
+		OPCODE( CAST_IntegerToByte )
+		{
+			// Integer to byte cast.
+			*(Byte*)Regs[I->A].Value = *(Integer*)Regs[I->A].Value;
+			NEXT;
+		}
+		OPCODE( CAST_IntegerToAngle )
+		{
+			// Integer to angle cast.
+			*(TAngle*)Regs[I->A].Value = *(Integer*)Regs[I->A].Value;
+			NEXT;
+		}
+		OPCODE( CAST_AngleToInteger )
+		{
+			// Angle to integer cast.
+			*(Integer*)Regs[I->A].Value = *(TAngle*)Regs[I->A].Value;
+			NEXT;
+		}
+		OPCODE( CODE_Context )
+		{
+			// Change current context. Verifier proves
+			// "this; context" pair, 'this' is never null.
+			if( bLean && (I->Flags & IF_ThisResult) )
+			{
+				Context	= This;
+				NEXT;
+			}
+			FEntity* NewContext = *(FEntity**)Regs[I->A].Value;
+			if( !NewContext )
+				ScriptError( L"Access to undefined entity" );
+			Context	= NewContext;
+			NEXT;
+		}
+		OPCODE( CODE_Switch )
+		{
+			// Perform switch statement.
+			Integer Expr	= 0;
+			Integer	iDest	= I->Target;
+			Byte*	Table	= I->Operands;
+			Integer	NumLabs	= *Table++;
+			MemCopy( &Expr, Regs[I->A].Value, I->C );
+
+			for( Integer i=0; i<NumLabs; i++ )
+			{
+				Integer Label	= 0;
+				MemCopy( &Label, Table, I->C );
+				Table	+= I->C;
+				Word Addr	= *(Word*)Table;
+				Table	+= sizeof(Word);
+
+				if( Label == Expr )
+				{
+					iDest	= Linked->Map[Addr];
+					break;
+				}
+			}
+
+			// Goto label or default.
+			JUMP( iDest );
+		}
+		OPCODE( CODE_SwitchTable )
+		{
+			// Perform switch statement, with jump table.
+			Integer Expr	= I->C == 1 ? *(Byte*)Regs[I->A].Value : *(Integer*)Regs[I->A].Value;
+			Integer Addr	= SwitchTable( I->Operands, Expr );
+			JUMP( Addr != -1 ? Linked->Map[Addr] : I->Target );
+		}
+		OPCODE( CODE_SwitchSearch )
+		{
+			// Perform switch statement, with binary search.
+			Integer Expr	= I->C == 1 ? *(Byte*)Regs[I->A].Value : *(Integer*)Regs[I->A].Value;
+			Integer Addr	= SwitchSearch( I->Operands, Expr );
+			JUMP( Addr != -1 ? Linked->Map[Addr] : I->Target );
+		}
+		OPCODE( CODE_Foreach )
+		{
+			// Perform foreach statement.
+			TIterator*	Iter	= (TIterator*)&Locals[I->iValue];
+			FEntity**	Value	= (FEntity**)&Locals[I->W];	
+
+			*Value	= Iter->Next();
+			if( !*Value )
+				JUMP( I->Target );
+			NEXT;
+		}
+		OPCODE( CODE_CallFunction )
+		{
+			// Call script function.
+			CFunction*	Func	= Context->Script->Functions[I->A];
+			Byte*		Args	= I->Operands;
+			Integer		iThis	= I - Base;
+			Integer		NextAddr= Args - &Bytecode->Code[0] + Func->ParmsCount + (Func->ResultVar ? 1 : 0);
+			CallFunction( Context, Func, Args );
+			RESUME_CALL( iThis, NextAddr );
+		}
+		OPCODE( CODE_CallVF )
+		{
+			// Call virtual function.
+			// Verifier rejects abstract method call in 'this' context.
+			CFunction* Func = Context->Script->VFTable[I->A];
+			if( !(bLean && (I->Flags & IF_ThisContext)) && !Func )
+				ScriptError( L"Attempt call abstract method from '%s'", *Context->Script->GetName() );		
+
+			Byte*		Args	= I->Operands;
+			Integer		iThis	= I - Base;
+			Integer		NextAddr= Args - &Bytecode->Code[0] + Func->ParmsCount + (Func->ResultVar ? 1 : 0);
+			CallFunction( Context, Func, Args );
+			RESUME_CALL( iThis, NextAddr );
+		}
+		OPCODE( CODE_BaseMethod )
+		{
+			// Base method call.
+			CNativeFunction* Native = CClassDatabase::GFuncs[I->W];
+			Integer iThis = I - Base;
+			Native->ptrMethod( Context->Base, *this, I->Operands );
+			RESUME( iThis + 1 );
+		}
+		OPCODE( CODE_ComponentMethod )
+		{
+			// Component method call.
+			CNativeFunction* Native = CClassDatabase::GFuncs[I->W];
+			Integer iThis = I - Base;
+			Native->ptrMethod( Context->Components[I->B], *this, I->Operands );
+			RESUME( iThis + 1 );
+		}
+		OPCODE( CODE_Stop )
+		{
+			// Stop thread execution.
+			This->Thread->Status	= THR_Stopped;
+			LEAVE( I->iValue );
+		}
+		OPCODE( CODE_Sleep )
+		{
+			// Make thread sleep.
+			This->Thread->SleepTime	= *(Float*)(Regs[I->A].Value);
+			This->Thread->Status	= THR_Sleep;
+			LEAVE( I->iValue );
+		}
+		OPCODE( CODE_Wait )
+		{
+			// Force the thread to wait.
+			This->Thread->WaitExpr	= &Bytecode->Code[I->W];
+
+			if( *(Bool*)(Regs[I->A].Value) )
+			{
+				// AWake.
+				This->Thread->Status	= THR_Run;
+				This->Thread->WaitExpr	= nullptr;
+			}
+			else
+			{
+				// Still wait.
+				This->Thread->Status	= THR_Wait;
+			}
+			LEAVE( I->iValue );
+		}
+		OPCODE( CODE_Goto )
+		{
+			// Goto label in thread.
+			Integer iLabel = *(Integer*)(Regs[I->A].Value);
+
+			if( iLabel >= 0 && iLabel < Script->Thread->Labels.Num() )
+			{
+				// Goto label and restart execution.
+				Word LabAddr				= Script->Thread->Labels[iLabel].Address;
+				This->Thread->Frame.Code	= &Script->Thread->Code[LabAddr];
+				This->Thread->Frame.bGoto	= true;
+				This->Thread->Status		= THR_Run;
+				This->Thread->LabelId		= iLabel;
+
+				if( This->Thread->Scheduler )
+					This->Thread->Scheduler->Wake( This->Thread );
+			}
+			else
+				ScriptError( L"Bad label %d in 'goto'", iLabel );
+
+			// Interrupt thread, if in running in thread.
+			if( Bytecode == Script->Thread )
+			{
+				bGoto	= false;
+				goto LeaveCode;
+			}
+			NEXT;
+		}
+		OPCODE( CODE_Interrupt )
+		{
+			// Interrupt thread execution.
+			LEAVE( I->iValue );
+		}
+
+		//
+		// Frequently used operators, to avoid native call.
+		//
+		#define OPCODE_BINARY( icode, op, a1, a2, r ) OPCODE( icode ){ *(r*)(Regs[I->A].Value) = *(a1*)(Regs[I->A].Value) op *(a2*)(Regs[I->B].Value); NEXT; }
+		OPCODE_BINARY( BIN_Mult_Integer,		*,	Integer,	Integer,	Integer		)
+		OPCODE_BINARY( BIN_Mult_Float,			*,	Float,		Float,		Float		)
+		OPCODE_BINARY( BIN_Mult_Vector,			*,	TVector,	Float,		TVector		)
+		OPCODE_BINARY( BIN_Div_Float,			/,	Float,		Float,		Float		)
+		OPCODE_BINARY( BIN_Add_Integer,			+,	Integer,	Integer,	Integer		)
+		OPCODE_BINARY( BIN_Add_Float,			+,	Float,		Float,		Float		)
+		OPCODE_BINARY( BIN_Add_Vector,			+,	TVector,	TVector,	TVector		)
+		OPCODE_BINARY( BIN_Sub_Integer,			-,	Integer,	Integer,	Integer		)
+		OPCODE_BINARY( BIN_Sub_Float,			-,	Float,		Float,		Float		)
+		OPCODE_BINARY( BIN_Sub_Vector,			-,	TVector,	TVector,	TVector		)
+		OPCODE_BINARY( BIN_Less_Integer,		<,	Integer,	Integer,	Bool		)
+		OPCODE_BINARY( BIN_Less_Float,			<,	Float,		Float,		Bool		)
+		OPCODE_BINARY( BIN_LessEq_Integer,		<=,	Integer,	Integer,	Bool		)
+		OPCODE_BINARY( BIN_LessEq_Float,		<=,	Float,		Float,		Bool		)
+		OPCODE_BINARY( BIN_Greater_Integer,		>,	Integer,	Integer,	Bool		)
+		OPCODE_BINARY( BIN_Greater_Float,		>,	Float,		Float,		Bool		)
+		OPCODE_BINARY( BIN_GreaterEq_Integer,	>=,	Integer,	Integer,	Bool		)
+		OPCODE_BINARY( BIN_GreaterEq_Float,		>=,	Float,		Float,		Bool		)
+		OPCODE_BINARY( BIN_And_Integer,			&,	Integer,	Integer,	Integer		)
+		OPCODE_BINARY( BIN_Or_Integer,			|,	Integer,	Integer,	Integer		)
+		OPCODE_BINARY( BIN_Dot_Vector,			*,	TVector,	TVector,	Float		)
+		OPCODE_BINARY( BIN_Cross_Vector,		/,	TVector,	TVector,	Float		)
+		#undef OPCODE_BINARY
+
+		#define OPCODE_ASSIGN( icode, op, type ) OPCODE( icode ){ *(type*)Regs[I->A].Addr op *(type*)Regs[I->B].Value; NEXT; }
+		OPCODE_ASSIGN( BIN_AddEqual_Integer,	+=,		Integer )
+		OPCODE_ASSIGN( BIN_AddEqual_Float,		+=,		Float )
+		OPCODE_ASSIGN( BIN_SubEqual_Integer,	-=,		Integer )
+		OPCODE_ASSIGN( BIN_SubEqual_Float,		-=,		Float )
+		OPCODE_ASSIGN( BIN_MulEqual_Float,		*=,		Float )
+		#undef OPCODE_ASSIGN
+
+		#define OPCODE_UNARY( icode, op, type ) OPCODE( icode ){ *(type*)(Regs[I->A].Value) = op *(type*)(Regs[I->A].Value); NEXT; }
+		OPCODE_UNARY( UN_Minus_Integer,		-,		Integer )
+		OPCODE_UNARY( UN_Minus_Float,		-,		Float )
+		OPCODE_UNARY( UN_Not_Bool,			!,		Bool )
+		#undef OPCODE_UNARY
+
+		//
+		// Superinstructions, see CLinkedCode::Optimize.
+		//
+		OPCODE( XOP_LocalDWord )
+		{
+			// Load local variable.
+			*(DWord*)Regs[I->A].Value = *(DWord*)(Locals + I->W);
+			JUMP( I - Base + 2 );
+		}
+		OPCODE( XOP_EntityDWord )
+		{
+			// Load entity property.
+			*(DWord*)Regs[I->A].Value = *(DWord*)&Context->InstanceBuffer->Data[I->W];
+			JUMP( I - Base + 2 );
+		}
+		OPCODE( XOP_BaseDWord )
+		{
+			// Load base component property.
+			*(DWord*)Regs[I->A].Value = *(DWord*)((Byte*)Context->Base + I->W);
+			JUMP( I - Base + 2 );
+		}
+
+		#define OPCODE_JUMPNOT( icode, op, type ) OPCODE( icode )\
+		{\
+			LOOP_CHECK\
+			if( !(*(type*)(Regs[I->A].Value) op *(type*)(Regs[I->B].Value)) )\
+				JUMP( I->Target );\
+			JUMP( I - Base + 2 );\
+		}
+		OPCODE_JUMPNOT( XOP_JumpNotLess_Integer,		<,	Integer )
+		OPCODE_JUMPNOT( XOP_JumpNotLessEq_Integer,		<=,	Integer )
+		OPCODE_JUMPNOT( XOP_JumpNotGreater_Integer,		>,	Integer )
+		OPCODE_JUMPNOT( XOP_JumpNotGreaterEq_Integer,	>=,	Integer )
+		OPCODE_JUMPNOT( XOP_JumpNotLess_Float,			<,	Float )
+		OPCODE_JUMPNOT( XOP_JumpNotLessEq_Float,		<=,	Float )
+		OPCODE_JUMPNOT( XOP_JumpNotGreater_Float,		>,	Float )
+		OPCODE_JUMPNOT( XOP_JumpNotGreaterEq_Float,		>=,	Float )
+		OPCODE_JUMPNOT( XOP_JumpNotEqualDWord,			==,	DWord )
+		OPCODE_JUMPNOT( XOP_JumpEqualDWord,				!=,	DWord )
+		#undef OPCODE_JUMPNOT
+
+		//
+		// Trivial natives, see IsInlineNative in FrLinker.cpp.
+		//
+		#define OPCODE_MATH( icode, a, r, expr ) OPCODE( icode ){ const a& X = *(a*)(Regs[I->A].Value); *(r*)(Regs[I->B].Value) = expr; NEXT; }
+		OPCODE_MATH( OP_Abs,			Float,		Float,		Abs( X ) )
+		OPCODE_MATH( OP_Cos,			Float,		Float,		Cos( X ) )
+		OPCODE_MATH( OP_Sin,			Float,		Float,		Sin( X ) )
+		OPCODE_MATH( OP_Frac,			Float,		Float,		Frac( X ) )
+		OPCODE_MATH( OP_Round,			Float,		Integer,	Round( X ) )
+		OPCODE_MATH( OP_VectorSize,		TVector,	Float,		X.Size() )
+		#undef OPCODE_MATH
+
+		OPCODE( OP_Sqrt )
+		{
+			Float X = *(Float*)(Regs[I->A].Value);
+			if( X < 0.f )
+				ScriptError( L"Negative X in 'sqrt'" );
+			*(Float*)(Regs[I->B].Value) = Sqrt( X );
+			NEXT;
+		}
+		OPCODE( OP_Normalize )
+		{
+			TVector V = *(TVector*)(Regs[I->A].Value);
+			V.Normalize();
+			*(TVector*)(Regs[I->B].Value) = V;
+			NEXT;
+		}
+		OPCODE( OP_Distance )
+		{
+			*(Float*)(Regs[I->C].Value) = Distance( *(TVector*)(Regs[I->A].Value), *(TVector*)(Regs[I->B].Value) );
+			NEXT;
+		}
+		OPCODE( XOP_Native )
+		{
+			// Typed native, bound by linker. Native might
+			// execute other scripts, so resume as after call.
+			Integer iThis = I - Base;
+			I->Native( *this, &I->A );
+			RESUME( iThis + 1 );
+		}
+
+		#define OPCODE_PREFIX( icode, op, type ) OPCODE( icode ){ (*(type*)(Regs[I->A].Addr))op; NEXT; }
+		OPCODE_PREFIX( UN_Inc_Integer,		++,		Integer )
+		OPCODE_PREFIX( UN_Inc_Float,		++,		Float )
+		OPCODE_PREFIX( UN_Dec_Integer,		--,		Integer )
+		OPCODE_PREFIX( UN_Dec_Float,		--,		Float )
+		#undef OPCODE_PREFIX
+
+#if FLU_THREADED_VM
+	L_Native:
+#else
+		default:
+#endif
+		{
+			// Delegate execution to native functions.
+			Integer iThis = I - Base;
+			Code	= I->Operands;
+			ExecuteNative( Context, (EOpCode)I->Op );
+			RESUME( iThis + 1 );
+		}
+#if !FLU_THREADED_VM
+	}
+#endif
+
+LeaveCode:
+	NumExecuted	+= Executed;
+}
+
+
+#undef OPCODE
+#undef DISPATCH
+#undef NEXT
+#undef JUMP
+#undef RESUME
+#undef RESUME_CALL
+#undef LEAVE
+#undef LOOP_CHECK
+#undef VERIFY_FALLBACK
+#undef LINKED_OPS
+
+
+/*-----------------------------------------------------------------------------
+    CEntityThread implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Thread constructor. Creates frame for execution.
+// Warning: Use only while playing, since cause
+// problems with GC and Undo/Redo.
+//
+CEntityThread::CEntityThread( FEntity* InEntity, CThreadCode* InThread )
+	:	Frame( InEntity, InThread ),
+		Status( THR_Run ),
+		Entity( InEntity ),
 		SleepTime( 0.f ),
 		WaitExpr( nullptr ),
-		LabelId( -1 )
+		LabelId( -1 ),
+		Scheduler( nullptr ),
+		Parked( PARK_None ),
+		iActive( -1 ),
+		WakeTick( 0 ),
+		ParkNext( nullptr ),
+		ParkLink( nullptr ),
+		NumWaitDeps( 0 )
 {
 }
 
@@ -984,6 +2287,547 @@ void CEntityThread::Tick( Float Delta )
 }
 
 
+/*-----------------------------------------------------------------------------
+    CThreadScheduler implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Whether park waits on properties change.
+//
+Bool CThreadScheduler::bWatchWaits = true;
+
+
+//
+// Scheduler constructor.
+//
+CThreadScheduler::CThreadScheduler( FLevel* InLevel )
+	:	Level( InLevel ),
+		Time( 0.0 ),
+		Now( 0 ),
+		Watched( nullptr ),
+		StatActive( 0 ),
+		StatPolled( 0 ),
+		StatSleeping( 0 ),
+		StatWatched( 0 ),
+		StatStopped( 0 ),
+		StatWoken( 0 ),
+		StatTime( 0.0 )
+{
+	MemZero( Wheel, sizeof(Wheel) );
+}
+
+
+//
+// Scheduler destructor. All threads should
+// be removed already.
+//
+CThreadScheduler::~CThreadScheduler()
+{
+	assert(Watched == nullptr);
+	assert(StatSleeping == 0);
+}
+
+
+//
+// Add a new thread to scheduler, it's
+// active until parked.
+//
+void CThreadScheduler::AddThread( CEntityThread* Thread )
+{
+	assert(Thread->Scheduler == nullptr);
+
+	Thread->Scheduler	= this;
+	Thread->Parked		= PARK_None;
+	Thread->iActive		= Active.Push( Thread );
+}
+
+
+//
+// Remove thread from the scheduler, before
+// thread destruction.
+//
+void CThreadScheduler::RemoveThread( CEntityThread* Thread )
+{
+	assert(Thread->Scheduler == this);
+
+	if( Thread->Parked == PARK_None )
+	{
+		// Just clear slot, it will be compacted
+		// in the next tick.
+		assert(Active[Thread->iActive] == Thread);
+		Active[Thread->iActive]	= nullptr;
+	}
+	else
+		Unpark( Thread );
+
+	Thread->Scheduler	= nullptr;
+	Thread->iActive		= -1;
+}
+
+
+//
+// Make parked thread active again, since it was
+// explicitly awaked, for example by goto.
+//
+void CThreadScheduler::Wake( CEntityThread* Thread )
+{
+	assert(Thread->Scheduler == this);
+
+	if( Thread->Parked != PARK_None )
+	{
+		Unpark( Thread );
+		Thread->iActive	= Active.Push( Thread );
+	}
+}
+
+
+//
+// Insert thread to the list.
+//
+void CThreadScheduler::Link( CEntityThread* Thread, CEntityThread** Head )
+{
+	Thread->ParkNext	= *Head;
+	Thread->ParkLink	= Head;
+	if( *Head )
+		(*Head)->ParkLink	= &Thread->ParkNext;
+	*Head	= Thread;
+}
+
+
+//
+// Remove thread from its list.
+//
+void CThreadScheduler::Unlink( CEntityThread* Thread )
+{
+	assert(Thread->ParkLink);
+
+	*Thread->ParkLink	= Thread->ParkNext;
+	if( Thread->ParkNext )
+		Thread->ParkNext->ParkLink	= Thread->ParkLink;
+
+	Thread->ParkNext	= nullptr;
+	Thread->ParkLink	= nullptr;
+}
+
+
+//
+// Insert sleeping thread to the timer wheel. Thread
+// goes to the lowest level, which covers its wake tick,
+// and cascades down, when time comes.
+//
+void CThreadScheduler::Schedule( CEntityThread* Thread )
+{
+	QWord	Tick	= Max( Thread->WakeTick, Now );
+	Integer	iLevel	= 0;
+
+	while( iLevel < WHEEL_LEVELS-1 && Tick - Now >= (1ull << (WHEEL_BITS * (iLevel+1))) )
+		iLevel++;
+
+	// Too far, park in the last level and
+	// reschedule on cascade.
+	Tick	= Min( Tick, Now + (1ull << (WHEEL_BITS * WHEEL_LEVELS)) - 1 );
+
+	Integer iSlot = (Tick >> (WHEEL_BITS * iLevel)) & (WHEEL_SLOTS-1);
+	Link( Thread, &Wheel[iLevel][iSlot] );
+}
+
+
+//
+// Advance timer wheel and wake all due threads.
+//
+void CThreadScheduler::Advance( QWord Target )
+{
+	while( Now < Target )
+	{
+		Now++;
+
+		// Cascade upper levels, when lower level wraps.
+		for( Integer iLevel=1; iLevel<WHEEL_LEVELS; iLevel++ )
+		{
+			if( Now & ((1ull << (WHEEL_BITS * iLevel)) - 1) )
+				break;
+
+			Integer iSlot = (Now >> (WHEEL_BITS * iLevel)) & (WHEEL_SLOTS-1);
+			CEntityThread* Thread = Wheel[iLevel][iSlot];
+			Wheel[iLevel][iSlot] = nullptr;
+
+			while( Thread )
+			{
+				CEntityThread* Next = Thread->ParkNext;
+				Schedule( Thread );
+				Thread	= Next;
+			}
+		}
+
+		// Wake all threads in the current slot.
+		CEntityThread** Head = &Wheel[0][Now & (WHEEL_SLOTS-1)];
+		CEntityThread* Thread = *Head;
+		*Head	= nullptr;
+
+		while( Thread )
+		{
+			CEntityThread* Next = Thread->ParkNext;
+			if( Thread->WakeTick <= Now )
+			{
+				// Awake. Thread is still sleeping, so its tick
+				// makes it running, and code resumes in the
+				// next tick, as it was before parking.
+				Thread->ParkNext	= nullptr;
+				Thread->ParkLink	= nullptr;
+				Thread->Parked		= PARK_None;
+				Thread->SleepTime	= 0.f;
+				Thread->iActive		= Active.Push( Thread );
+				StatSleeping--;
+				StatWoken++;
+			}
+			else
+				Schedule( Thread );
+
+			Thread	= Next;
+		}
+	}
+}
+
+
+//
+// Return an info about thread's wait expression. The
+// expression is watchable if it reads only own entity
+// properties and has no side effects.
+//
+const CThreadScheduler::TWaitInfo* CThreadScheduler::GetWaitInfo( CEntityThread* Thread )
+{
+	Integer* iInfo = WaitIndex.Get( Thread->WaitExpr );
+	if( iInfo )
+		return &WaitInfos[*iInfo];
+
+	TWaitInfo Info;
+	Info.Expr		= Thread->WaitExpr;
+	Info.bWatchable	= true;
+	Info.NumDeps	= 0;
+
+	// Walk all paths of the linked expression, until wait.
+	CBytecode*		Bytecode	= Thread->Frame.Bytecode;
+	CLinkedCode*	Linked		= CLinkedCode::Link( Thread->Frame.Script, Bytecode );
+	TArray<Integer>	Pending;
+	TArray<Integer>	Visited;
+	Integer			Snapshot	= 0;
+
+	Pending.Push( Linked->Resolve( Thread->WaitExpr - &Bytecode->Code[0] ) );
+
+	while( Pending.Num() && Info.bWatchable )
+	{
+		Integer iInstr = Pending.Pop();
+
+		for( ; ; )
+		{
+			if( Visited.FindItem( iInstr ) != -1 )
+				break;
+
+			if( Visited.Num() >= 64 || iInstr >= Linked->Instrs.Num() )
+			{
+				// Too complex expression.
+				Info.bWatchable	= false;
+				break;
+			}
+
+			Visited.Push( iInstr );
+			TInstr& I = Linked->Instrs[iInstr];
+			Integer Op = I.Op == XOP_Native ? I.W : I.Op;
+
+			if( Op == CODE_Wait )
+			{
+				// End of expression.
+				break;
+			}
+			else if( Op == CODE_Jump || Op == XOP_Continue )
+			{
+				iInstr	= I.Target;
+			}
+			else if( Op == CODE_JumpZero )
+			{
+				Pending.Push( I.Target );
+				iInstr++;
+			}
+			else if( Op >= XOP_JumpNotLess_Integer && Op <= XOP_JumpEqualDWord )
+			{
+				// Fused pair.
+				Pending.Push( I.Target );
+				iInstr += 2;
+			}
+			else if	( 
+						Op == CODE_EntityProperty || Op == CODE_BaseProperty || Op == CODE_ComponentProperty || 
+						Op == XOP_EntityDWord || Op == XOP_BaseDWord 
+					)
+			{
+				// Property load. L-value should be loaded to the
+				// r-value just after address evaluation.
+				Integer Kind	= Op == XOP_EntityDWord ? CODE_EntityProperty : Op == XOP_BaseDWord ? CODE_BaseProperty : Op;
+				Integer Offset	= I.W;
+				Integer Size	= -1;
+
+				if( Op == XOP_EntityDWord || Op == XOP_BaseDWord )
+				{
+					Size	= sizeof(DWord);
+					iInstr	+= 2;
+				}
+				else
+				{
+					for( iInstr++; iInstr < Linked->Instrs.Num(); iInstr++ )
+					{
+						TInstr& J = Linked->Instrs[iInstr];
+						if( J.A != I.A )
+							break;
+
+						if( J.Op == CODE_LMember )
+							Offset	+= J.C;
+						else if( J.Op == CODE_LToR )
+							Size	= J.C;
+						else if( J.Op == CODE_LToRDWord )
+							Size	= sizeof(DWord);
+						else
+							break;
+
+						if( Size != -1 )
+						{
+							iInstr++;
+							break;
+						}
+					}
+				}
+
+				if( Size <= 0 || Info.NumDeps >= MAX_WAIT_DEPS || Snapshot + Size > MAX_WAIT_SNAPSHOT )
+				{
+					Info.bWatchable	= false;
+					break;
+				}
+
+				Info.Deps[Info.NumDeps].Kind		= Kind;
+				Info.Deps[Info.NumDeps].iComponent	= Kind == CODE_ComponentProperty ? I.B : 0;
+				Info.Deps[Info.NumDeps].Offset		= Offset;
+				Info.Deps[Info.NumDeps].Size		= Size;
+				Info.NumDeps++;
+				Snapshot	+= Size;
+			}
+			else if	(
+						( Op >= CODE_ConstByte && Op <= CODE_ConstEntity && Op != CODE_ConstString ) ||
+						( Op >= CAST_ByteToInteger && Op <= CAST_AngleToInteger ) ||
+						( Op >= UN_Plus_Integer && Op <= BIN_Dot_Vector && Op != BIN_Add_String ) ||
+						( Op >= OP_Abs && Op <= OP_Normalize ) ||
+						( Op >= OP_VectorSize && Op <= OP_RGBA ) ||
+						Op == CODE_This || Op == CODE_RMember || Op == CODE_ConditionalOp ||
+						( (Op == CODE_Equal || Op == CODE_NotEqual) && I.C != 0 )
+					)
+			{
+				// Pure operation.
+				iInstr++;
+			}
+			else
+			{
+				// Expression has side effects, or reads
+				// something else.
+				Info.bWatchable	= false;
+				break;
+			}
+		}
+	}
+
+	Info.bWatchable	&= Info.NumDeps > 0;
+	WaitIndex.Put( Info.Expr, WaitInfos.Push( Info ) );
+	return &WaitInfos[WaitInfos.Num()-1];
+}
+
+
+//
+// Try to park waiting thread until its dependencies
+// are changed. Return false, if wait should be polled.
+//
+Bool CThreadScheduler::Watch( CEntityThread* Thread )
+{
+	if( !bWatchWaits )
+		return false;
+
+	const TWaitInfo* Info = GetWaitInfo( Thread );
+	if( !Info->bWatchable )
+		return false;
+
+	// Resolve properties addresses.
+	FEntity*	Entity		= Thread->Entity;
+	Byte*		Snapshot	= Thread->WaitSnapshot;
+
+	for( Integer i=0; i<Info->NumDeps; i++ )
+	{
+		TWaitDep& Dep = Thread->WaitDeps[i];
+
+		switch( Info->Deps[i].Kind )
+		{
+			case CODE_EntityProperty:
+				Dep.Addr	= &Entity->InstanceBuffer->Data[Info->Deps[i].Offset];
+				break;
+
+			case CODE_BaseProperty:
+				Dep.Addr	= (Byte*)Entity->Base + Info->Deps[i].Offset;
+				break;
+
+			default:
+				Dep.Addr	= (Byte*)Entity->Components[Info->Deps[i].iComponent] + Info->Deps[i].Offset;
+				break;
+		}
+
+		Dep.Size	= Info->Deps[i].Size;
+		MemCopy( Snapshot, Dep.Addr, Dep.Size );
+		Snapshot	+= Dep.Size;
+	}
+
+	Thread->NumWaitDeps	= Info->NumDeps;
+	return true;
+}
+
+
+//
+// Park thread according to its status.
+//
+void CThreadScheduler::Park( CEntityThread* Thread )
+{
+	switch( Thread->Status )
+	{
+		case THR_Sleep:
+		{
+			// Sleep in the timer wheel.
+			Thread->WakeTick	= Max( (QWord)ceil( (Time + Thread->SleepTime) * WHEEL_RATE ), Now + 1 );
+			Thread->Parked		= PARK_Wheel;
+			Schedule( Thread );
+			StatSleeping++;
+			break;
+		}
+		case THR_Wait:
+		{
+			// Wait for properties change.
+			Thread->Parked		= PARK_Watch;
+			Link( Thread, &Watched );
+			StatWatched++;
+			break;
+		}
+		case THR_Stopped:
+		{
+			// Stopped until goto.
+			Thread->Parked		= PARK_Stopped;
+			StatStopped++;
+			break;
+		}
+		default:
+			error( L"Bad thread '%s' status '%d'", *Thread->Entity->GetFullName(), (Byte)Thread->Status );
+	}
+
+	Thread->iActive		= -1;
+}
+
+
+//
+// Remove thread from its park.
+//
+void CThreadScheduler::Unpark( CEntityThread* Thread )
+{
+	switch( Thread->Parked )
+	{
+		case PARK_Wheel:
+			Unlink( Thread );
+			StatSleeping--;
+			break;
+
+		case PARK_Watch:
+			Unlink( Thread );
+			StatWatched--;
+			break;
+
+		case PARK_Stopped:
+			StatStopped--;
+			break;
+	}
+
+	Thread->Parked	= PARK_None;
+}
+
+
+//
+// Tick all active threads and wake parked threads.
+//
+void CThreadScheduler::Tick( Float Delta )
+{
+	Double StartTime	= GPlat->TimeStamp();
+
+	// Wake due threads.
+	Time	+= Delta;
+	Advance( (QWord)(Time * WHEEL_RATE) );
+
+	// Wake waiting threads with changed dependencies, expression
+	// will be reevaluated in the thread tick.
+	for( CEntityThread* Thread = Watched; Thread; )
+	{
+		CEntityThread*	Next		= Thread->ParkNext;
+		Byte*			Snapshot	= Thread->WaitSnapshot;
+
+		for( Integer i=0; i<Thread->NumWaitDeps; i++ )
+		{
+			if( !MemCmp( Snapshot, Thread->WaitDeps[i].Addr, Thread->WaitDeps[i].Size ) )
+			{
+				Unpark( Thread );
+				Thread->iActive	= Active.Push( Thread );
+				StatWoken++;
+				break;
+			}
+			Snapshot	+= Thread->WaitDeps[i].Size;
+		}
+		Thread	= Next;
+	}
+
+	// Tick active threads. Threads may be added while
+	// ticking, so array is compacted in place.
+	Integer iActive = 0;
+	StatPolled	= 0;
+
+	for( Integer i=0; i<Active.Num(); i++ )
+	{
+		CEntityThread* Thread = Active[i];
+		if( !Thread )
+			continue;
+
+		Thread->Tick( Delta );
+
+		if( Thread->Scheduler != this )
+		{
+			// Thread was removed while ticking.
+			continue;
+		}
+		else if( Thread->Status == THR_Run || (Thread->Status == THR_Wait && !Watch(Thread)) )
+		{
+			// Keep active.
+			StatPolled	+= Thread->Status == THR_Wait;
+			Thread->iActive	= iActive;
+			Active[iActive++]	= Thread;
+		}
+		else
+			Park( Thread );
+	}
+
+	Active.SetNum( iActive );
+	StatActive	= iActive;
+	StatTime	= GPlat->TimeStamp() - StartTime;
+}
+
+
+//
+// Log scheduler info.
+//
+void CThreadScheduler::DebugScheduler()
+{
+	log( L"** Thread scheduler \"%s\" info", *Level->GetFullName() );
+	log( L"Threads: %d active, %d polled waits", StatActive, StatPolled );
+	log( L"Threads: %d parked (%d sleeping, %d watched waits, %d stopped)", StatSleeping + StatWatched + StatStopped, StatSleeping, StatWatched, StatStopped );
+	log( L"Threads: %d woken, %d wait expressions, watch %s", StatWoken, WaitInfos.Num(), bWatchWaits ? L"on" : L"off" );
+	log( L"Threads: tick %.3f ms", StatTime*1000.0 );
+}
+
+
 /*-----------------------------------------------------------------------------
     The End.
 -----------------------------------------------------------------------------*/
\ No newline at end of file
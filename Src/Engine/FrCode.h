@@ -8,7 +8,9 @@
 -----------------------------------------------------------------------------*/
 
 //
-// A virtual machine register.
+// A virtual machine register. It's a plain data, so
+// frame doesn't pay for registers construction. String
+// values are held by the frame, see CFrame::StrReg.
 //
 class TRegister
 {
@@ -17,39 +19,63 @@ public:
 	enum{ NUM_REGS = 24 };
 
 	// Variables.
-	struct
+	union 
 	{
-		union 
-		{
-			Byte	Value[16];
-			void*	Addr;
-		};
-		String	StrValue;
+		Byte	Value[16];
+		void*	Addr;
 	};
-
-	// Constructor.
-	TRegister()
-		:	Addr( nullptr ),
-			StrValue()
-	{}
 };
 
 
 //
-// An information about foreach loop.
+// A foreach loop iterator. It's stored in the frame
+// locals, so loops could be nested, and it walks the
+// collection lazily, without copying. Rect iterator
+// falls back to a snapshot, once the loop body changes
+// the collision hash, see TIterator::Next.
 //
-class TForeach
+struct TIterator
 {
 public:
+	// A reported object of the rect iterator.
+	struct TWalked
+	{
+	public:
+		FBaseComponent*		Object;
+		TWalked*			Prev;
+	};
+
 	// Variables.
-	TArray<FEntity*>	Collection;
-	Integer				i;
-
-	// Constructor.
-	TForeach()
-		:	Collection(),
-			i( 0 )
-	{}
+	Byte					Type;		// Iterator opcode, or 0 if done.
+	FLevel*					Level;
+	union
+	{
+		FScript*			Script;		// Filter, or nullptr.
+		FPhysicComponent*	Phys;		// IT_TouchedEntities.
+	};
+	TRect					Bounds;		// IT_RectEntities.
+	Integer					X;			// Cursor.
+	Integer					Y;
+	Integer					i;
+
+	// IT_RectEntities hash changes tracking. Records and
+	// snapshot are pushed to the frames stack memory, so
+	// they are released with the frame, even if the loop
+	// is broken.
+	CMemPool*				Mem;
+	Byte*					MemBase;	// First pushed record, or nullptr.
+	DWord					ModCount;	// Hash modifications counter, seen by the last step.
+	TWalked*				Walked;		// Reported objects, latest first.
+	FBaseComponent**		Snapshot;	// Rest of objects, or nullptr if hash isn't changed.
+	Integer					NumSnapshot;
+
+	// TIterator interface.
+	FEntity* Next();
+
+private:
+	// Internal.
+	void* Push( Integer Size );
+	void TakeSnapshot();
 };
 
 
@@ -61,11 +87,66 @@ public:
 // Constants.
 //
 #define MAX_RECURSION_DEPTH		32
+#define NUM_FRAME_WINDOWS		(MAX_RECURSION_DEPTH * 2)	// Preallocated registers windows per thread.
 #define MAX_ITERATIONS			1000000
+#define WATCHDOG_MASK			0x3ff		// Backward jumps between watchdog polls, minus one.
+#define WATCHDOG_PENDING		-1.0		// Watchdog is started, but deadline is set by the first poll.
+
+
+//
+// A native function, bound to the operands registers.
+// Regs are decoded by the linker into the instruction, or
+// are read straight from the bytecode, see FrNative.cpp.
+//
+typedef void (*TNativeThunk)( CFrame& Frame, const Byte* Regs );
+
+
+//
+// A registers window of the frame. String registers are
+// kept constructed in the window, so taking a window
+// costs nothing.
+//
+struct TFrameWindow
+{
+public:
+	// Variables.
+	TRegister		Regs[TRegister::NUM_REGS];
+	String			StrRegs[TRegister::NUM_REGS];
+};
 
 
 //
-// A code execution local frame.
+// A per thread stack of the script frames. It holds the
+// locals memory and the registers windows, allocated
+// once, so a call just pushes its locals and takes the
+// next window, without heap or thread local storage
+// access. Only a root frame looks up the stack of the 
+// thread, nested frames share the caller's one.
+//
+class CFrameStack
+{
+public:
+	// Variables.
+	CMemPool				LocalsMem;
+	TArray<TFrameWindow*>	Windows;
+	Integer					Top;
+
+	// Stack of the current thread.
+	static thread_local CFrameStack GStack;
+
+	// CFrameStack interface.
+	CFrameStack();
+	~CFrameStack();
+	inline TFrameWindow* PushWindow();
+	inline void PopWindow();
+};
+
+
+//
+// A code execution local frame. Frame itself lives on 
+// the native stack, locals and registers window are taken
+// from the thread's CFrameStack, for the time of the
+// execution, so a call doesn't touch heap.
 //
 class CFrame
 {
@@ -74,20 +155,50 @@ public:
 	FEntity*		This;
 	FScript*		Script;
 	CBytecode*		Bytecode;
-	TRegister		Regs[TRegister::NUM_REGS];	
+	TRegister*		Regs;		// Window registers, while executed.
 
 	// Friends.
 	friend CEntityThread;
 	friend FEntity;
-
-	// Shared stack memory.
-	static CMemPool GLocalsMem;
+	friend CScriptBench;
+	friend CJit;
+
+	// Whether execute linked code, instead of
+	// interpreting the bytecode.
+	static Bool bLinkedCode;
+
+	// Total number of executed instructions.
+	static QWord NumExecuted;
+
+	// Whether execute verified code in lean mode, without
+	// loop iterations counting, see CLinkedCode::Verify.
+	static Bool bLeanCode;
+
+	// Watchdog of the lean code, time budget for scripts
+	// per level tick, in seconds, or 0 if disabled.
+	static Double WatchdogBudget;
+	static Double WatchdogDeadline;
+	static void StartWatchdog();
+	static void StopWatchdog();
+
+	// Whether verified code may run lean, only watchdog
+	// guards it from infinity loops.
+	static Bool IsLean()
+	{
+		return bLeanCode && WatchdogBudget > 0.0;
+	}
 
 	// CFrame interface.
 	CFrame( FEntity* InThis, CFunction* InFunction, Integer InDepth = 1, CFrame* InPrevFrame = nullptr );
 	CFrame( FEntity* InThis, CThreadCode* InThread );
 	~CFrame();
 	void ScriptError( Char* Fmt, ... );
+	inline String& StrReg( Byte iReg );
+	inline Byte* RegValue( Byte iReg, EPropType Type );
+
+	// Typed native function of the opcode, or nullptr
+	// if it's not bound.
+	static TNativeThunk FindNative( Integer iOpCode, Integer& NumRegs );
 
 private:
 	// Frame internal.
@@ -95,14 +206,24 @@ private:
 	Integer			Depth;	
 	Byte*			Code;
 	Byte*			Locals;
-	TForeach		Foreach;
+	CFrameStack*	Stack;
+	TFrameWindow*	Window;
+	String*			StrRegs;	// Window string registers, once touched.
+	Bool			bGoto;
 
 	// Opcodes execution.
-	void ProcessCode( TRegister* Result );
+	void ProcessCode( Byte* Result );
+	void ExecuteBytecode();
+	void ExecuteLinked();
+	template<Bool bLean> void ExecuteInstrs( CLinkedCode* Linked, Integer iEntry, FEntity* Context );
+	void CheckWatchdog();
 	void ExecuteNative( FEntity* Context, EOpCode Code );
+	void CallFunction( FEntity* Context, CFunction* Func, Byte* Args );
+	void LogMessage();
 
 	// Misc.
 	String StackTrace();
+	void ReleaseWindow();
 
 public:
 	// Constants readers.
@@ -112,7 +233,7 @@ public:
 	inline Float ReadFloat();
 	inline TAngle ReadAngle();
 	inline TColor ReadColor();
-	inline String ReadString();
+	inline const String& ReadString();
 	inline TVector ReadVector();
 	inline TRect ReadAABB();
 	inline FResource* ReadResource();
@@ -139,6 +260,40 @@ enum EThreadStatus
 };
 
 
+//
+// Thread scheduler constants.
+//
+#define WHEEL_BITS			6						// Bits per wheel level.
+#define WHEEL_SLOTS			(1 << WHEEL_BITS)		// Slots per wheel level.
+#define WHEEL_LEVELS		3						// Number of wheel levels.
+#define WHEEL_RATE			100						// Wheel ticks per second.
+#define MAX_WAIT_DEPS		8						// Properties per watched wait.
+#define MAX_WAIT_SNAPSHOT	64						// Snapshot size per watched wait.
+
+
+//
+// Where a thread is parked by the scheduler.
+//
+enum EThreadPark
+{
+	PARK_None,		// Thread is active, ticked every frame.
+	PARK_Wheel,		// Thread sleeps in the timer wheel.
+	PARK_Watch,		// Thread waits for properties change.
+	PARK_Stopped	// Thread is stopped until goto.
+};
+
+
+//
+// A property, read by the watched wait expression.
+//
+struct TWaitDep
+{
+public:
+	Byte*		Addr;
+	Integer		Size;
+};
+
+
 //
 // An entity thread to process scenario.
 //
@@ -156,6 +311,20 @@ public:
 		Byte*			WaitExpr;	// THR_Wait.
 	};
 
+	// Scheduler info.
+	CThreadScheduler*	Scheduler;
+	EThreadPark			Parked;
+	Integer				iActive;
+	QWord				WakeTick;
+	CEntityThread*		ParkNext;
+	CEntityThread**		ParkLink;
+
+	// Watched wait expression dependencies and
+	// their values, when thread was parked.
+	Integer				NumWaitDeps;
+	TWaitDep			WaitDeps[MAX_WAIT_DEPS];
+	Byte				WaitSnapshot[MAX_WAIT_SNAPSHOT];
+
 	// CEntityThread interface.
 	CEntityThread( FEntity* InEntity, CThreadCode* InThread );
 	~CEntityThread();
@@ -163,10 +332,118 @@ public:
 };
 
 
+//
+// A level threads scheduler. Only running threads are
+// ticked every frame. Sleeping threads are parked in the
+// hierarchical timer wheel and cost nothing until they
+// are due. Waiting threads, whose expression reads only
+// own entity properties, are parked until any of these
+// properties is changed. Other waits are polled.
+// Woken sleeping thread resumes in the next tick, as if
+// it was ticked all the time. Watched wait is checked at
+// the start of tick, so a change, made by thread ticked
+// later, is seen in the next tick, rather than the same.
+//
+class CThreadScheduler
+{
+public:
+	// Whether park waits on properties change.
+	static Bool		bWatchWaits;
+
+	// CThreadScheduler interface.
+	CThreadScheduler( FLevel* InLevel );
+	~CThreadScheduler();
+	void AddThread( CEntityThread* Thread );
+	void RemoveThread( CEntityThread* Thread );
+	void Wake( CEntityThread* Thread );
+	void Tick( Float Delta );
+	void DebugScheduler();
+
+private:
+	// A wait expression info, shared by all
+	// threads of the script.
+	struct TWaitInfo
+	{
+	public:
+		Byte*		Expr;
+		Bool		bWatchable;
+		Integer		NumDeps;
+		struct
+		{
+			Byte	Kind;		// CODE_EntityProperty, CODE_BaseProperty or CODE_ComponentProperty.
+			Byte	iComponent;
+			Word	Offset;
+			Word	Size;
+		} Deps[MAX_WAIT_DEPS];
+	};
+
+	// Variables.
+	FLevel*						Level;
+	Double						Time;
+	QWord						Now;
+	TArray<CEntityThread*>		Active;
+	CEntityThread*				Wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+	CEntityThread*				Watched;
+	TArray<TWaitInfo>			WaitInfos;
+	TMap<Byte*, Integer>		WaitIndex;		// Expression to its wait info.
+
+	// Stats.
+	Integer		StatActive;
+	Integer		StatPolled;
+	Integer		StatSleeping;
+	Integer		StatWatched;
+	Integer		StatStopped;
+	Integer		StatWoken;
+	Double		StatTime;
+
+	// Internal.
+	void Park( CEntityThread* Thread );
+	void Unpark( CEntityThread* Thread );
+	void Link( CEntityThread* Thread, CEntityThread** Head );
+	void Unlink( CEntityThread* Thread );
+	void Schedule( CEntityThread* Thread );
+	void Advance( QWord Target );
+	Bool Watch( CEntityThread* Thread );
+	const TWaitInfo* GetWaitInfo( CEntityThread* Thread );
+};
+
+
+/*-----------------------------------------------------------------------------
+    CFrameStack implementation.
+-----------------------------------------------------------------------------*/
+
+inline TFrameWindow* CFrameStack::PushWindow()
+{
+	// Events, raised from natives, may nest deeper
+	// than preallocated windows.
+	if( Top == Windows.Num() )
+		Windows.Push( new TFrameWindow() );
+	return Windows[Top++];
+}
+
+inline void CFrameStack::PopWindow()
+{
+	assert(Top > 0);
+	Top--;
+}
+
+
 /*-----------------------------------------------------------------------------
     CFrame implementation.
 -----------------------------------------------------------------------------*/
 
+inline String& CFrame::StrReg( Byte iReg )
+{
+	if( !StrRegs )
+		StrRegs	= Window->StrRegs;
+	return StrRegs[iReg];
+}
+
+inline Byte* CFrame::RegValue( Byte iReg, EPropType Type )
+{
+	return Type == TYPE_String ? (Byte*)&StrReg(iReg) : Regs[iReg].Value;
+}
+
 inline Byte CFrame::ReadByte()
 {
 	Byte R = *Code;
@@ -209,14 +486,9 @@ inline TColor CFrame::ReadColor()
 	return R;
 }
 
-inline String CFrame::ReadString()
+inline const String& CFrame::ReadString()
 {
-	Integer Len = Clamp( ReadInteger(), 0, 127 );
-	Char Str[128];
-	MemCopy( Str, Code, Len*sizeof(Char) );
-	Code += Len * sizeof(Char);
-	Str[Len] = '\0';
-	return Str;
+	return Script->StrTable[ReadWord()];
 }
 
 inline TVector CFrame::ReadVector()
@@ -268,33 +540,210 @@ inline EPropType CFrame::ReadPropType()
 
 
 /*-----------------------------------------------------------------------------
-    Stack macro.
+    Typed bindings.
 -----------------------------------------------------------------------------*/
 
-// Parameters grabbers.
-#define POP_BYTE			(*(Byte*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POP_BOOL			(*(Bool*)(Frame.Regs[Frame.ReadByte()].Value))		
-#define POP_INTEGER			(*(Integer*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POP_FLOAT			(*(Float*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POP_ANGLE			(*(TAngle*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POP_COLOR			(*(TColor*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POP_STRING			(Frame.Regs[Frame.ReadByte()].StrValue)
-#define POP_VECTOR			(*(TVector*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POP_AABB			(*(TRect*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POP_RESOURCE		(*(FResource**)(Frame.Regs[Frame.ReadByte()].Value))
-#define POP_ENTITY			(*(FEntity**)(Frame.Regs[Frame.ReadByte()].Value))
-
-#define POPA_BYTE			((Byte*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POPA_BOOL			((Bool*)(Frame.Regs[Frame.ReadByte()].Value))		
-#define POPA_INTEGER		((Integer*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POPA_FLOAT			((Float*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POPA_ANGLE			((TAngle*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POPA_COLOR			((TColor*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POPA_STRING			(&Frame.Regs[Frame.ReadByte()].StrValue)
-#define POPA_VECTOR			((TVector*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POPA_AABB			((TRect*)(Frame.Regs[Frame.ReadByte()].Value))
-#define POPA_RESOURCE		((FResource**)(Frame.Regs[Frame.ReadByte()].Value))
-#define POPA_ENTITY			((FEntity**)(Frame.Regs[Frame.ReadByte()].Value))
+//
+// A native function operand, in the register. String
+// values are held by the frame, all others are stored in
+// the register itself.
+//
+template<class T> struct TNativeArg
+{
+	static T& Get( CFrame& Frame, Byte iReg )
+	{
+		return *(T*)(Frame.Regs[iReg].Value);
+	}
+};
+template<class T> struct TNativeArg<const T&> : TNativeArg<T>
+{
+};
+template<> struct TNativeArg<String>
+{
+	static String& Get( CFrame& Frame, Byte iReg )
+	{
+		return Frame.StrReg( iReg );
+	}
+};
+
+
+//
+// A native method thunk generator. Operands types are
+// deduced from the method signature, as for the natives
+// functions, see TNativeBind in FrNative.cpp.
+//
+template<class F, F Fn> struct TMethodBind;
+
+#define ARG( T, i )	TNativeArg<T>::Get( Frame, Regs[i] )
+#define SELF		(((C*)Self)->*Fn)
+
+template<class C, class R, R(C::*Fn)( CFrame& )> 
+struct TMethodBind<R(C::*)( CFrame& ), Fn>
+{
+	enum{ NumRegs = 1 };
+	static void Thunk( FComponent* Self, CFrame& Frame, const Byte* Regs )
+	{
+		ARG( R, 0 ) = SELF( Frame );
+	}
+};
+
+template<class C, class R, class A1, R(C::*Fn)( CFrame&, A1 )> 
+struct TMethodBind<R(C::*)( CFrame&, A1 ), Fn>
+{
+	enum{ NumRegs = 2 };
+	static void Thunk( FComponent* Self, CFrame& Frame, const Byte* Regs )
+	{
+		ARG( R, 1 ) = SELF( Frame, ARG( A1, 0 ) );
+	}
+};
+
+template<class C, class R, class A1, class A2, R(C::*Fn)( CFrame&, A1, A2 )> 
+struct TMethodBind<R(C::*)( CFrame&, A1, A2 ), Fn>
+{
+	enum{ NumRegs = 3 };
+	static void Thunk( FComponent* Self, CFrame& Frame, const Byte* Regs )
+	{
+		ARG( R, 2 ) = SELF( Frame, ARG( A1, 0 ), ARG( A2, 1 ) );
+	}
+};
+
+template<class C, void(C::*Fn)( CFrame& )> 
+struct TMethodBind<void(C::*)( CFrame& ), Fn>
+{
+	enum{ NumRegs = 0 };
+	static void Thunk( FComponent* Self, CFrame& Frame, const Byte* Regs )
+	{
+		SELF( Frame );
+	}
+};
+
+template<class C, class A1, void(C::*Fn)( CFrame&, A1 )> 
+struct TMethodBind<void(C::*)( CFrame&, A1 ), Fn>
+{
+	enum{ NumRegs = 1 };
+	static void Thunk( FComponent* Self, CFrame& Frame, const Byte* Regs )
+	{
+		SELF( Frame, ARG( A1, 0 ) );
+	}
+};
+
+template<class C, class A1, class A2, void(C::*Fn)( CFrame&, A1, A2 )> 
+struct TMethodBind<void(C::*)( CFrame&, A1, A2 ), Fn>
+{
+	enum{ NumRegs = 2 };
+	static void Thunk( FComponent* Self, CFrame& Frame, const Byte* Regs )
+	{
+		SELF( Frame, ARG( A1, 0 ), ARG( A2, 1 ) );
+	}
+};
+
+template<class C, class A1, class A2, class A3, void(C::*Fn)( CFrame&, A1, A2, A3 )> 
+struct TMethodBind<void(C::*)( CFrame&, A1, A2, A3 ), Fn>
+{
+	enum{ NumRegs = 3 };
+	static void Thunk( FComponent* Self, CFrame& Frame, const Byte* Regs )
+	{
+		SELF( Frame, ARG( A1, 0 ), ARG( A2, 1 ), ARG( A3, 2 ) );
+	}
+};
+
+template<class C, class A1, class A2, class A3, class A4, void(C::*Fn)( CFrame&, A1, A2, A3, A4 )> 
+struct TMethodBind<void(C::*)( CFrame&, A1, A2, A3, A4 ), Fn>
+{
+	enum{ NumRegs = 4 };
+	static void Thunk( FComponent* Self, CFrame& Frame, const Byte* Regs )
+	{
+		SELF( Frame, ARG( A1, 0 ), ARG( A2, 1 ), ARG( A3, 2 ), ARG( A4, 3 ) );
+	}
+};
+
+#undef SELF
+#undef ARG
+
+
+/*-----------------------------------------------------------------------------
+    FEntity events implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// A script type of the C++ event argument. Events
+// could be called only with these types.
+//
+template<class T> struct TEventArg;
+template<> struct TEventArg<Byte>		{ enum{ Type = TYPE_Byte };		};
+template<> struct TEventArg<Bool>		{ enum{ Type = TYPE_Bool };		};
+template<> struct TEventArg<Integer>	{ enum{ Type = TYPE_Integer };	};
+template<> struct TEventArg<Float>		{ enum{ Type = TYPE_Float };	};
+template<> struct TEventArg<TAngle>		{ enum{ Type = TYPE_Angle };	};
+template<> struct TEventArg<TColor>		{ enum{ Type = TYPE_Color };	};
+template<> struct TEventArg<String>		{ enum{ Type = TYPE_String };	};
+template<> struct TEventArg<TVector>	{ enum{ Type = TYPE_Vector };	};
+template<> struct TEventArg<TRect>		{ enum{ Type = TYPE_AABB };		};
+template<> struct TEventArg<FResource*>	{ enum{ Type = TYPE_Resource };	};
+template<> struct TEventArg<FEntity*>	{ enum{ Type = TYPE_Entity };	};
+
+#define EVENT_ARG( T, i )	((DWord)TEventArg<T>::Type << ((i) * 8))
+
+
+//
+// Return the event function, or nullptr if entity's 
+// script has no such event.
+//
+inline CFunction* FEntity::FindEvent( EEventName EventName )
+{
+	return Script->bHasText && Script->Events.Num() > 0 ? Script->Events[EventName] : nullptr;
+}
+
+
+//
+// Call a script event.
+//
+inline void FEntity::CallEvent( EEventName EventName )
+{
+	CFunction* Event = FindEvent( EventName );
+	if( Event )
+		ExecuteEvent( Event, 0, 0, nullptr );
+}
+
+template<class T1> inline void FEntity::CallEvent( EEventName EventName, const T1& A1 )
+{
+	CFunction* Event = FindEvent( EventName );
+	if( Event )
+	{
+		const void* Args[1] = { &A1 };
+		ExecuteEvent( Event, EVENT_ARG(T1, 0), 1, Args );
+	}
+}
+
+template<class T1, class T2> inline void FEntity::CallEvent( EEventName EventName, const T1& A1, const T2& A2 )
+{
+	CFunction* Event = FindEvent( EventName );
+	if( Event )
+	{
+		const void* Args[2] = { &A1, &A2 };
+		ExecuteEvent( Event, EVENT_ARG(T1, 0) | EVENT_ARG(T2, 1), 2, Args );
+	}
+}
+
+template<class T1, class T2, class T3> inline void FEntity::CallEvent( EEventName EventName, const T1& A1, const T2& A2, const T3& A3 )
+{
+	CFunction* Event = FindEvent( EventName );
+	if( Event )
+	{
+		const void* Args[3] = { &A1, &A2, &A3 };
+		ExecuteEvent( Event, EVENT_ARG(T1, 0) | EVENT_ARG(T2, 1) | EVENT_ARG(T3, 2), 3, Args );
+	}
+}
+
+template<class T1, class T2, class T3, class T4> inline void FEntity::CallEvent( EEventName EventName, const T1& A1, const T2& A2, const T3& A3, const T4& A4 )
+{
+	CFunction* Event = FindEvent( EventName );
+	if( Event )
+	{
+		const void* Args[4] = { &A1, &A2, &A3, &A4 };
+		ExecuteEvent( Event, EVENT_ARG(T1, 0) | EVENT_ARG(T2, 1) | EVENT_ARG(T3, 2) | EVENT_ARG(T4, 3), 4, Args );
+	}
+}
 
 
 /*-----------------------------------------------------------------------------
@@ -31,14 +31,20 @@
 class CCollisionHash
 {
 public:
+	// Number of hash modifications, to detect changes
+	// during the lazy query.
+	DWord				ModCount;
+
 	// CCollisionHash interface.
 	CCollisionHash( FLevel* InLevel );
 	~CCollisionHash();
 	void AddToHash( FBaseComponent* Object );
 	void RemoveFromHash( FBaseComponent* Object );
 	void GetOverlapped( TRect Bounds, Integer& OutNumObjs, FBaseComponent** OutList );
+	void GetOverlapped( TRect Bounds, Integer& OutNumObjs, TArray<FBaseComponent*>& OutList );
 	void GetOverlappedByClass( TRect Bounds, CClass* Class, Integer& OutNumObjs, FBaseComponent** OutList );
 	void GetOverlappedByScript( TRect Bounds, FScript* Script, Integer& OutNumObjs, FBaseComponent** OutList );
+	FBaseComponent* NextOverlapped( TRect Bounds, FScript* Script, Integer& X, Integer& Y, Integer& iItem );
 	void DebugHash();
 
 private:
@@ -48,7 +48,8 @@ void CCollisionHash::GetHashIndex( TVector V, Integer& iX, Integer& iY )
 // Collision hash constructor.
 //
 CCollisionHash::CCollisionHash( FLevel* InLevel )
-	:	Level( InLevel ),
+	:	ModCount( 0 ),
+		Level( InLevel ),
 		Pool( L"CollisionHash", 16384 * sizeof(THashItem) ),
 		FirstAvail( nullptr ),
 		Mark( Random(777) ),
@@ -108,6 +109,7 @@ void CCollisionHash::AddToHash( FBaseComponent* Object )
 		return;
 	}
 	Object->bHashed	= true;
+	ModCount++;
 
 	// Get bounds.
 	Integer X1, X2, Y1, Y2;
@@ -161,6 +163,7 @@ void CCollisionHash::RemoveFromHash( FBaseComponent* Object )
 		return;
 	}
 	Object->bHashed	= false;
+	ModCount++;
 
 	// Get bounds.
 	Integer X1, X2, Y1, Y2;
@@ -253,6 +256,52 @@ Enough:;
 }
 
 
+//
+// Return all objects inside the bounds. The list grows
+// when it's full and never shrinks, so it may be reused
+// without reallocations.
+//
+void CCollisionHash::GetOverlapped( TRect Bounds, Integer& OutNumObjs, TArray<FBaseComponent*>& OutList )
+{
+	// Get bounds.
+	Integer X1, X2, Y1, Y2;
+	GetHashIndex( Bounds.Min, X1, Y1 );
+	GetHashIndex( Bounds.Max, X2, Y2 );
+
+	// Prepare.
+	OutNumObjs	= 0;
+	Mark++;
+
+	for( Integer Y=Y1; Y<=Y2; Y++ )
+	for( Integer X=X1; X<=X2; X++ )
+	{
+		Integer iSlot = HashXTab[X] ^ HashYTab[Y];
+		THashItem* Item = Hash[iSlot];
+
+		while( Item )
+		{
+			FBaseComponent* Object = Item->Object;		
+
+			if	(
+					Object->HashMark != Mark &&
+					!Object->bDestroyed &&
+					Bounds.IsOverlap(Object->HashAABB)
+				)
+			{
+				// Add to list.
+				Object->HashMark	= Mark;
+				if( OutNumObjs == OutList.Num() )
+					OutList.SetNum( Max( OutNumObjs*2, MAX_COLL_LIST_OBJS ) );
+
+				OutList[OutNumObjs++]	= Object;
+			}
+
+			Item = Item->Next;
+		}
+	}
+}
+
+
 //
 // Return any object inside the bounds of class 'Class' only.
 // Return first MAX_COLL_LIST_OBJS objects.
@@ -351,6 +400,83 @@ Enough:;
 }
 
 
+//
+// Lazy overlap query. Return next object inside the bounds,
+// of script 'Script' if specified, or nullptr if no more 
+// objects. Cursor X, Y, iItem should be -1 before the first
+// call. Each object is reported only in the first cell it
+// overlaps, so marks are not used and queries could be 
+// nested. Cursor is valid only while ModCount isn't changed.
+//
+FBaseComponent* CCollisionHash::NextOverlapped( TRect Bounds, FScript* Script, Integer& X, Integer& Y, Integer& iItem )
+{
+	// Get bounds.
+	Integer X1, X2, Y1, Y2;
+	GetHashIndex( Bounds.Min, X1, Y1 );
+	GetHashIndex( Bounds.Max, X2, Y2 );
+
+	// Start query.
+	if( iItem == -1 )
+	{
+		X		= X1;
+		Y		= Y1;
+		iItem	= 0;
+	}
+
+	while( Y <= Y2 )
+	{
+		while( X <= X2 )
+		{
+			// Skip already walked items of the cell. Items are counted
+			// instead of storing pointer, since hash might be changed
+			// between calls.
+			Integer iSlot = HashXTab[X] ^ HashYTab[Y];
+			THashItem* Item = Hash[iSlot];
+			for( Integer i=0; i<iItem && Item; i++ )
+				Item = Item->Next;
+
+			while( Item )
+			{
+				FBaseComponent* Object = Item->Object;
+				Item = Item->Next;
+				iItem++;
+
+				if	(
+						!Object->bDestroyed &&
+						(!Script || Object->Entity->Script == Script) &&
+						Bounds.IsOverlap(Object->HashAABB)
+					)
+				{
+					// Is it a first overlapped cell?
+					Integer OX, OY;
+					GetHashIndex( Object->HashAABB.Min, OX, OY );
+					if( Max( OX, X1 ) != X || Max( OY, Y1 ) != Y )
+						continue;
+
+					// Different cells might share slot, so test
+					// whether object already reported.
+					THashItem* Prev = Hash[iSlot];
+					for( Integer i=0; i<iItem-1 && Prev->Object != Object; i++ )
+						Prev = Prev->Next;
+					if( Prev->Object == Object && Prev->Next != Item )
+						continue;
+
+					return Object;
+				}
+			}
+
+			X++;
+			iItem	= 0;
+		}
+
+		Y++;
+		X	= X1;
+	}
+
+	return nullptr;
+}
+
+
 //
 // Output debug information into console.
 //
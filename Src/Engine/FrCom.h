@@ -94,6 +94,7 @@ public:
 
 	// FBaseComponent interface.
 	FBaseComponent();
+	~FBaseComponent();
 	virtual TRect GetAABB();
 
 	// FComponent interface.
@@ -131,15 +132,22 @@ private:
 	DWord		HashMark;
 	TRect		HashAABB;
 
+	// Physics scene internal.
+	friend CPhysics;
+	friend CPhysicsScene;
+	DWord		PhysMark;
+	Integer		iPhysNode;
+	TPhysPoly*	PhysPoly;
+
 	// Natives.
-	void nativeSetLocation( CFrame& Frame );
-	void nativeSetSize( CFrame& Frame );
-	void nativeSetRotation( CFrame& Frame );
-	void nativeMove( CFrame& Frame );
-	void nativePlayAmbient( CFrame& Frame );
+	void nativeSetLocation( CFrame& Frame, const TVector& NewLocation );
+	void nativeSetSize( CFrame& Frame, const TVector& NewSize );
+	void nativeSetRotation( CFrame& Frame, TAngle NewRotation );
+	void nativeMove( CFrame& Frame, const TVector& DeltaMove );
+	void nativePlayAmbient( CFrame& Frame, FResource* Res, Float Gain, Float Pitch, Float Radius );
 	void nativeStopAmbient( CFrame& Frame );
-	void nativeIsBasedOn( CFrame& Frame );
-	void nativeGetAABB( CFrame& Frame );
+	Bool nativeIsBasedOn( CFrame& Frame, const String& TestAlt );
+	TRect nativeGetAABB( CFrame& Frame );
 };
 
 
@@ -160,9 +168,15 @@ public:
 
 	// CTickAddon interface.
 	CTickAddon( FComponent* InOwner )
-		:	AddonOwner( InOwner )
+		:	AddonOwner( InOwner ),
+			TickOrder( 0 )
 	{}
 	virtual ~CTickAddon();
+
+	// Order of addition to the level's tick list, the
+	// list is always sorted by it.
+	DWord				TickOrder;
+	static DWord		NumAdded;
 private:
 	// Internal.
 	FComponent*			AddonOwner;
@@ -317,6 +331,9 @@ public:
 // Add component to list of components.
 #define com_add( arr )	{ Level->arr.Push(this); }
 
+// Add component to the level's tick list, in order of addition.
+#define com_add_tick()	{ TickOrder = CTickAddon::NumAdded++; Level->TickObjects.Push(this); }
+
 // Remove component from the level's list.
 #define com_remove( arr ){ if(Level){ Integer i=Level->arr.FindItem(this); if(i != -1) Level->arr.Remove(i); }}
 
@@ -86,10 +86,22 @@ FBaseComponent::FBaseComponent()
 		Layer( 0.5f ),
 		bHashed( false ),
 		HashMark( -1 ),
-		HashAABB( TVector( 0.f, 0.f ), 1.f )
+		HashAABB( TVector( 0.f, 0.f ), 1.f ),
+		PhysMark( -1 ),
+		iPhysNode( -1 ),
+		PhysPoly( nullptr )
 {}
 
 
+//
+// Base component destructor.
+//
+FBaseComponent::~FBaseComponent()
+{
+	freeandnil(PhysPoly);
+}
+
+
 //
 // Return component bounding rect.
 //
@@ -225,10 +237,8 @@ void FBaseComponent::EndPlay()
 //
 // Set a new object location.
 //
-void FBaseComponent::nativeSetLocation( CFrame& Frame )
+void FBaseComponent::nativeSetLocation( CFrame& Frame, const TVector& NewLocation )
 {
-	TVector NewLocation = POP_VECTOR;
-		
 	if( bHashable && bHashed )
 	{
 		// Deal with a hash.
@@ -246,10 +256,8 @@ void FBaseComponent::nativeSetLocation( CFrame& Frame )
 //
 // Move object by delta.
 //
-void FBaseComponent::nativeMove( CFrame& Frame )
+void FBaseComponent::nativeMove( CFrame& Frame, const TVector& DeltaMove )
 {
-	TVector DeltaMove = POP_VECTOR;
-		
 	if( bHashable && bHashed )
 	{
 		// Deal with a hash.
@@ -267,10 +275,8 @@ void FBaseComponent::nativeMove( CFrame& Frame )
 //
 // Set a new object size.
 //
-void FBaseComponent::nativeSetSize( CFrame& Frame )
+void FBaseComponent::nativeSetSize( CFrame& Frame, const TVector& NewSize )
 {
-	TVector NewSize = POP_VECTOR;
-
 	if( bHashable && bHashed )
 	{
 		// Deal with a hash.
@@ -288,10 +294,8 @@ void FBaseComponent::nativeSetSize( CFrame& Frame )
 //
 // Set a new object rotation.
 //
-void FBaseComponent::nativeSetRotation( CFrame& Frame )
+void FBaseComponent::nativeSetRotation( CFrame& Frame, TAngle NewRotation )
 {
-	TAngle NewRotation = POP_ANGLE;
-
 	if( bHashable && bHashed )
 	{
 		// Deal with a hash.
@@ -309,12 +313,9 @@ void FBaseComponent::nativeSetRotation( CFrame& Frame )
 //
 // Play an ambient sound.
 //
-void FBaseComponent::nativePlayAmbient( CFrame& Frame )
+void FBaseComponent::nativePlayAmbient( CFrame& Frame, FResource* Res, Float Gain, Float Pitch, Float Radius )
 {
-	FSound*	Sound	= As<FSound>(POP_RESOURCE);
-	Float	Gain	= POP_FLOAT;
-	Float	Pitch	= POP_FLOAT;
-	Float	Radius	= POP_FLOAT;
+	FSound* Sound = As<FSound>(Res);
 
 	if( Sound )
 		GApp->GAudio->PlayAmbient
@@ -341,25 +342,22 @@ void FBaseComponent::nativeStopAmbient( CFrame& Frame )
 //
 // Test base component class.
 //
-void FBaseComponent::nativeIsBasedOn( CFrame& Frame )
+Bool FBaseComponent::nativeIsBasedOn( CFrame& Frame, const String& TestAlt )
 {
-	String TestAlt	= POP_STRING;
 	for( CClass* C = GetClass(); C; C=C->Super )
 		if( C->Alt == TestAlt )
-		{
-			*POPA_BOOL	= true;
-			return;
-		}
-	*POPA_BOOL	= false;
+			return true;
+
+	return false;
 }
 
 
 //
 // Return entity's bounding rect.
 //
-void FBaseComponent::nativeGetAABB( CFrame& Frame )
+TRect FBaseComponent::nativeGetAABB( CFrame& Frame )
 {
-	*POPA_AABB	= GetAABB();
+	return GetAABB();
 }
 
 
@@ -492,6 +490,9 @@ void FComponent::Export( CExporterBase& Ex )
     Addons implementation.
 -----------------------------------------------------------------------------*/
 
+DWord	CTickAddon::NumAdded	= 0;
+
+
 CTickAddon::~CTickAddon()
 {
 	FLevel* Level = AddonOwner->Level;
@@ -70,9 +70,9 @@ private:
 	TVector				StartLocation;
 
 	// Native.
-	void nativeStart( CFrame& Frame );
+	void nativeStart( CFrame& Frame, Float InSpeed, Bool bLoop );
 	void nativeStop( CFrame& Frame );
-	void nativeMoveTo( CFrame& Frame );
+	void nativeMoveTo( CFrame& Frame, Float InSpeed, Integer iKey );
 };
 
 
@@ -140,7 +140,7 @@ public:
 
 private:
 	// Logic natives.
-	void nativeInduceSignal( CFrame& Frame );
+	void nativeInduceSignal( CFrame& Frame, FEntity* Creator, String PlugName );
 };
 
 
@@ -194,9 +194,9 @@ private:
 	Float				Frame;
 
 	// Natives.
-	void nativePlayAnim( CFrame& Frame );
+	void nativePlayAnim( CFrame& Frame, const String& ASeqName, Float ARate, Byte AType );
 	void nativePauseAnim( CFrame& Frame );
-	void nativeGetAnimName( CFrame& Frame );
+	String nativeGetAnimName( CFrame& Frame );
 };
 
 
@@ -309,8 +309,8 @@ public:
 
 private:
 	// Natives.
-	void nativeMirrorPoint( CFrame& Frame );
-	void nativeMirrorVector( CFrame& Frame );
+	TVector nativeMirrorPoint( CFrame& Frame, const TVector& P );
+	TVector nativeMirrorVector( CFrame& Frame, const TVector& V );
 };
 
 
@@ -347,8 +347,8 @@ public:
 
 private:
 	// Natives.
-	void nativeWarpPoint( CFrame& Frame );
-	void nativeWarpVector( CFrame& Frame );
+	TVector nativeWarpPoint( CFrame& Frame, const TVector& P );
+	TVector nativeWarpVector( CFrame& Frame, const TVector& V );
 };
 
 
@@ -405,9 +405,9 @@ public:
 
 private:
 	// Natives.
-	void nativeGetTile( CFrame& Frame );
-	void nativeSetTile( CFrame& Frame );
-	void nativeWorldToMap( CFrame& Frame );
+	Integer nativeGetTile( CFrame& Frame, Integer X, Integer Y );
+	void nativeSetTile( CFrame& Frame, Integer X, Integer Y, Integer iTile );
+	Integer nativeWorldToMap( CFrame& Frame, const TVector& V );
 };
 
 
@@ -579,7 +579,7 @@ private:
 	Bool		bShown;
 
 	// Natives.
-	void nativeIsShown( CFrame& Frame );
+	Bool nativeIsShown( CFrame& Frame );
 };
 
 
@@ -621,6 +621,7 @@ public:
 
 	// FJointComponent interface.
 	FJointComponent();
+	~FJointComponent();
 
 	// FComponent interface.
 	void InitForEntity( FEntity* InEntity );
@@ -632,6 +633,11 @@ public:
 
 	// CRenderAddon interface.
 	void Render( CCanvas* Canvas );
+
+private:
+	// Physics scene internal.
+	friend CPhysicsScene;
+	TVector			Impulse;
 };
 
 
@@ -1095,9 +1101,9 @@ public:
 
 private:
 	// Physic natives.
-	void nativeSolveSolid( CFrame& Frame );
-	void nativeSolveOneway( CFrame& Frame );
-	void nativeIsTouching( CFrame& Frame );
+	void nativeSolveSolid( CFrame& Frame, Bool bBrake );
+	void nativeSolveOneway( CFrame& Frame, Bool bBrake );
+	Bool nativeIsTouching( CFrame& Frame, FEntity* Other );
 };
 
 
@@ -1172,9 +1178,14 @@ public:
 	// Variables.
 	Bool			bCanSleep;
 	Bool			bSleeping;
+	Bool			bBullet;
 
 	// FRigidBodyComponent interface.
 	FRigidBodyComponent();
+	~FRigidBodyComponent();
+
+	// FComponent interface.
+	void InitForEntity( FEntity* InEntity );
 
 	// FObject interface.
 	void SerializeThis( CSerializer& S );
@@ -1185,6 +1196,14 @@ public:
 	// FPhysicComponent interface.
 	void PreTick( Float Delta );
 	void Tick( Float Delta );
+
+private:
+	// Physics scene internal.
+	friend CPhysicsScene;
+	Float			SleepTime;
+	DWord			iSleepIsland;
+	Integer			iSceneBody;
+	Bool			bOffTick;
 };
 
 
@@ -1223,15 +1242,15 @@ private:
 	TViewInfo		ViewInfo;
 
 	// Natives.
-	void nativePoint( CFrame& Frame );
-	void nativeLine( CFrame& Frame );
-	void nativeTile( CFrame& Frame );
-	void nativeTextSize( CFrame& Frame );
-	void nativeTextOut( CFrame& Frame );
-	void nativePopEffect( CFrame& Frame );
-	void nativePushEffect( CFrame& Frame );
-	void nativeProject( CFrame& Frame );
-	void nativeDeproject( CFrame& Frame );
+	void nativePoint( CFrame& Frame, const TVector& P, Float S );
+	void nativeLine( CFrame& Frame, const TVector& A, const TVector& B );
+	void nativeTile( CFrame& Frame, const TVector& P, const TVector& PL, const TVector& T, const TVector& TL );
+	Float nativeTextSize( CFrame& Frame, const String& S );
+	void nativeTextOut( CFrame& Frame, const TVector& P, const String& T, Float S );
+	void nativePopEffect( CFrame& Frame, Float FadeTime );
+	void nativePushEffect( CFrame& Frame, Float FadeTime );
+	TVector nativeProject( CFrame& Frame, const TVector& V );
+	TVector nativeDeproject( CFrame& Frame, const TVector& V );
 };
 
 
@@ -1318,14 +1337,14 @@ private:
 	Bool MoveToGoal();
 
 	// Natives.
-	void nativeSendOrder( CFrame& Frame );
-	void nativeSuggestJumpHeight( CFrame& Frame );
-	void nativeSuggestJumpSpeed( CFrame& Frame );
-	void nativeMakeNoise( CFrame& Frame );
-	void nativeIsVisible( CFrame& Frame );
-	void nativeCreatePathTo( CFrame& Frame );
-	void nativeCreateRandomPath( CFrame& Frame );
-	void nativeMoveToGoal( CFrame& Frame );
+	Integer nativeSendOrder( CFrame& Frame, String Order, Float Radius );
+	Float nativeSuggestJumpHeight( CFrame& Frame, Float Speed );
+	Float nativeSuggestJumpSpeed( CFrame& Frame, Float Height );
+	void nativeMakeNoise( CFrame& Frame, Float Radius );
+	Bool nativeIsVisible( CFrame& Frame, FEntity* Other );
+	Bool nativeCreatePathTo( CFrame& Frame, const TVector& Dest );
+	Bool nativeCreateRandomPath( CFrame& Frame );
+	Bool nativeMoveToGoal( CFrame& Frame );
 };
 
 
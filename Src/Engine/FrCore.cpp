@@ -14,6 +14,7 @@ CPlatformBase*		GPlat		= nullptr;
 String				GDirectory	= L"";
 DWord				GFrameStamp = 0;
 String				GCmdLine[8]	= {};
+volatile long		GNumAllocs	= 0;
 
 
 /*-----------------------------------------------------------------------------
@@ -225,12 +226,18 @@ String String::LowerCase( String Str )
 }
 
 
+//
+// Whether reference counters are changed atomically.
+//
+Bool String::bThreadSafe	= false;
+
+
 //
 // Format string.
 //
 String String::Format( String Fmt, ... )
 {
-	static Char Dest[2048] = {};
+	Char Dest[2048] = {};
 	va_list ArgPtr;
 	va_start( ArgPtr, Fmt );
 	_vsnwprintf( Dest, 2048, *Fmt, ArgPtr );
@@ -60,7 +60,7 @@ void FEmitterComponent::InitForEntity( FEntity* InEntity )
 {
 	FExtraComponent::InitForEntity( InEntity );
 	com_add(RenderObjects);
-	com_add(TickObjects);
+	com_add_tick();
 }
 
 
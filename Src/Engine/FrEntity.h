@@ -38,14 +38,16 @@ public:
 	void Export( CExporterBase& Ex );
 
 	// FluScript functions.
-	void CallEvent
-				( 
-					EEventName EventName, 
-					VARIANT_PARM(A1), 
-					VARIANT_PARM(A2), 
-					VARIANT_PARM(A3), 
-					VARIANT_PARM(A4) 
-				);
+	void CallEvent( EEventName EventName );
+	template<class T1> void CallEvent( EEventName EventName, const T1& A1 );
+	template<class T1, class T2> void CallEvent( EEventName EventName, const T1& A1, const T2& A2 );
+	template<class T1, class T2, class T3> void CallEvent( EEventName EventName, const T1& A1, const T2& A2, const T3& A3 );
+	template<class T1, class T2, class T3, class T4> void CallEvent( EEventName EventName, const T1& A1, const T2& A2, const T3& A3, const T4& A4 );
+
+private:
+	// Events internal.
+	CFunction* FindEvent( EEventName EventName );
+	void ExecuteEvent( CFunction* Event, DWord Signature, Integer NumArgs, const void** Args );
 };
 
 
@@ -95,11 +95,8 @@ void FPainterComponent::RenderHUD( CCanvas* InCanvas )
 //
 // Draw a colored point on HUD.
 //
-void FPainterComponent::nativePoint( CFrame& Frame )
+void FPainterComponent::nativePoint( CFrame& Frame, const TVector& P, Float S )
 {
-	TVector P	= POP_VECTOR;
-	Float	S	= POP_FLOAT;
-
 	if( Canvas )
 		Canvas->DrawPoint( P, S, Color );
 }
@@ -108,11 +105,8 @@ void FPainterComponent::nativePoint( CFrame& Frame )
 //
 // Draw a colored line on HUD.
 //
-void FPainterComponent::nativeLine( CFrame& Frame )
+void FPainterComponent::nativeLine( CFrame& Frame, const TVector& A, const TVector& B )
 {
-	TVector	A	= POP_VECTOR,
-			B	= POP_VECTOR;
-
 	if( Canvas )
 		Canvas->DrawLine( A, B, Color, false );
 }
@@ -121,13 +115,8 @@ void FPainterComponent::nativeLine( CFrame& Frame )
 //
 // Draw a textured tile.
 //
-void FPainterComponent::nativeTile( CFrame& Frame )
+void FPainterComponent::nativeTile( CFrame& Frame, const TVector& P, const TVector& PL, const TVector& T, const TVector& TL )
 {
-	TVector	P	= POP_VECTOR,
-			PL	= POP_VECTOR,
-			T	= POP_VECTOR,
-			TL	= POP_VECTOR;
-
 	if( Canvas )
 	{
 		TRenderRect	R;
@@ -181,12 +170,8 @@ void FPainterComponent::nativeTile( CFrame& Frame )
 //
 // Draw text.
 //
-void FPainterComponent::nativeTextOut( CFrame& Frame )
+void FPainterComponent::nativeTextOut( CFrame& Frame, const TVector& P, const String& T, Float S )
 {
-	TVector P	= POP_VECTOR;
-	String	T	= POP_STRING;
-	Float	S	= POP_FLOAT;
-
 	if( Canvas && Font )
 		Canvas->DrawText( *T, T.Len(), Font, Color, P, TVector( S, S ) );
 }
@@ -195,28 +180,27 @@ void FPainterComponent::nativeTextOut( CFrame& Frame )
 //
 // Return text width.
 //
-void FPainterComponent::nativeTextSize( CFrame& Frame )
+Float FPainterComponent::nativeTextSize( CFrame& Frame, const String& S )
 {
-	String	S	= POP_STRING;
-	*POPA_FLOAT	= Font ? Font->TextWidth(*S) : 0.f;
+	return Font ? Font->TextWidth(*S) : 0.f;
 }
 
 
 //
 // Restore level's global effect.
 //
-void FPainterComponent::nativePopEffect( CFrame& Frame )
+void FPainterComponent::nativePopEffect( CFrame& Frame, Float FadeTime )
 {
-	Level->GFXManager->PopEffect(POP_FLOAT);
+	Level->GFXManager->PopEffect( FadeTime );
 }
 
 
 //
 // Set current effect.
 //
-void FPainterComponent::nativePushEffect( CFrame& Frame )
+void FPainterComponent::nativePushEffect( CFrame& Frame, Float FadeTime )
 {
-	Level->GFXManager->PushEffect( Effect, POP_FLOAT );
+	Level->GFXManager->PushEffect( Effect, FadeTime );
 }
 
 
@@ -224,11 +208,11 @@ void FPainterComponent::nativePushEffect( CFrame& Frame )
 // Transform a point in the world's coords to the screen
 // coords system.
 //
-void FPainterComponent::nativeProject( CFrame& Frame )
+TVector FPainterComponent::nativeProject( CFrame& Frame, const TVector& V )
 {
 	Float	X, Y;
-	ViewInfo.Project( POP_VECTOR, X, Y );
-	*POPA_VECTOR	= TVector( X, Y );
+	ViewInfo.Project( V, X, Y );
+	return TVector( X, Y );
 }
 
 
@@ -236,10 +220,9 @@ void FPainterComponent::nativeProject( CFrame& Frame )
 // Transform a point in the screen's coords to the world
 // coords system.
 //
-void FPainterComponent::nativeDeproject( CFrame& Frame )
+TVector FPainterComponent::nativeDeproject( CFrame& Frame, const TVector& V )
 {
-	TVector V		= POP_VECTOR;
-	*POPA_VECTOR	= ViewInfo.Deproject( V.X, V.Y );
+	return ViewInfo.Deproject( V.X, V.Y );
 }
 
 
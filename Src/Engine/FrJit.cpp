@@ -0,0 +1,1597 @@
+/*=============================================================================
+    FrJit.cpp: Script baseline JIT compiler.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+#include "Engine.h"
+
+/*-----------------------------------------------------------------------------
+    CJitCode implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Machine code constructor.
+//
+CJitCode::CJitCode()
+	:	Entry( nullptr ),
+		Size( 0 ),
+		bLean( false ),
+		Instrs()
+{
+}
+
+
+//
+// Machine code destructor.
+//
+CJitCode::~CJitCode()
+{
+	if( Entry )
+		GPlat->FreeExecutable( Entry, Size );
+}
+
+
+/*-----------------------------------------------------------------------------
+    CJitEmitter.
+-----------------------------------------------------------------------------*/
+
+#if FLU_JIT
+
+//
+// x86 general purpose registers, x64 has eight more,
+// and names them with 'r' prefix.
+//
+enum EJitReg
+{
+	JR_EAX,
+	JR_ECX,
+	JR_EDX,
+	JR_EBX,
+	JR_ESP,
+	JR_EBP,
+	JR_ESI,
+	JR_EDI,
+	JR_R8,
+	JR_R9,
+	JR_R10,
+	JR_R11,
+	JR_R12
+};
+
+
+//
+// Registers, reserved by the machine code. They are
+// callee saved, so helpers keep them.
+//
+#if FLU_JIT_X64
+#define JR_State	JR_EBX		// rbx
+#define JR_Regs		JR_EBP		// rbp
+#define JR_Loop		JR_R12		// r12d
+#else
+#define JR_State	JR_EBX
+#define JR_Regs		JR_ESI
+#define JR_Loop		JR_EDI
+#endif
+
+
+//
+// Registers of the helpers arguments.
+//
+#if FLU_JIT_X64 && defined(_WIN32)
+#define JR_Arg0		JR_ECX		// Microsoft x64 convention.
+#define JR_Arg1		JR_EDX
+#define JR_Arg2		JR_R8
+#elif FLU_JIT_X64
+#define JR_Arg0		JR_EDI		// System V AMD64 convention.
+#define JR_Arg1		JR_ESI
+#define JR_Arg2		JR_EDX
+#endif
+
+
+//
+// x86 condition codes, inverted condition is
+// always Cond ^ 1.
+//
+enum EJitCond
+{
+	JC_B		= 0x2,
+	JC_AE		= 0x3,
+	JC_E		= 0x4,
+	JC_NE		= 0x5,
+	JC_BE		= 0x6,
+	JC_A		= 0x7,
+	JC_L		= 0xc,
+	JC_GE		= 0xd,
+	JC_LE		= 0xe,
+	JC_G		= 0xf
+};
+
+
+//
+// A helper, called from the machine code. Return false,
+// if script error happened, then machine code bails out.
+//
+typedef Bool (*TJitHelper)( TJitState* State, TInstr* I );
+
+
+//
+// Machine code emitter. Registers usage:
+//	EBX - TJitState*.
+//	ESI - Script registers, RBP on x64.
+//	EDI - Loop counter, to detect infinity loop or poll watchdog,
+//		  R12D on x64.
+//	EAX, ECX, EDX, XMM0, XMM1 - scratch.
+// All memory operands are addressed with 32-bit
+// displacement, to keep encoding simple. Pointers are
+// loaded and stored with OpW, which is 64-bit on x64.
+//
+class CJitEmitter
+{
+public:
+	// Variables.
+	CJitCode*			Jit;
+	TArray<Byte>		Code;
+	Bool				bRetry;
+	Bool				bLean;
+
+	// CJitEmitter interface.
+	CJitEmitter( CJitCode* InJit, Bool bInLean );
+	Bool EmitFunction();
+
+private:
+	// A jump to fix after emitting.
+	struct TFixup
+	{
+	public:
+		Integer		Pos;
+		Integer		iLabel;
+	};
+
+	// Internal variables.
+	TArray<Integer>		Labels;
+	TArray<Bool>		IsTarget;
+	TArray<TFixup>		Fixups;
+	Integer				LabelExit;
+	Integer				LabelLoop;
+	Integer				LabelBail;
+	Integer				LabelReturn;
+
+	// Code generation.
+	Bool EmitInstr( Integer iInstr );
+	void EmitLoopCheck( TInstr* I );
+	void EmitHelper( TJitHelper Func, TInstr* I );
+	void EmitNative( TNativeThunk Thunk, TInstr* I );
+	void EmitCall( void* Func, TInstr* I, void* Extra );
+	void EmitCopy( Byte DstBase, Integer DstDisp, Byte SrcBase, Integer SrcDisp, Integer Size );
+	void EmitPointer( Byte iReg, Integer StateField, Integer Offset );
+
+	// Instructions encoding.
+	void Byte1( Byte B );
+	void DWord4( DWord D );
+	void Rex( Bool bWide, Byte Reg, Byte Base );
+	void ModRM( Byte Reg, Byte Base, Integer Disp );
+	void ModRR( Byte Reg, Byte RM );
+	void Op( Byte Opc, Byte Reg, Byte Base, Integer Disp );
+	void OpW( Byte Opc, Byte Reg, Byte Base, Integer Disp );
+	void OpRR( Byte Opc, Byte Reg, Byte RM, Bool bWide = false );
+	void Op2( Byte Opc, Byte Reg, Byte Base, Integer Disp );
+	void Sse( Byte Prefix, Byte Opc, Byte Xmm, Byte Base, Integer Disp );
+	void SseRR( Byte Prefix, Byte Opc, Byte Xmm, Byte RM );
+	void ImmOp( Byte Ext, Byte Base, Integer Disp, DWord Imm, Bool bWide = false );
+	void MovImm( Byte Reg, const void* Imm );
+	void Push( Byte Reg );
+	void Pop( Byte Reg );
+	void SetCond( Byte Cond );
+	void Jump( Integer iLabel );
+	void JumpCond( Byte Cond, Integer iLabel );
+	Integer JumpShort( Byte Cond );
+	void LandShort( Integer Pos );
+};
+
+
+//
+// Offset of the script register in the frame.
+//
+inline Integer RegOfs( Byte iReg, Integer Offset = 0 )
+{
+	return iReg * sizeof(TRegister) + Offset;
+}
+
+
+//
+// Whether instruction is a fused pair, which skips
+// the next one.
+//
+inline Bool IsFused( Integer Op )
+{
+	return	Op == XOP_LocalDWord || Op == XOP_EntityDWord || Op == XOP_BaseDWord ||
+			(Op >= XOP_JumpNotLess_Integer && Op <= XOP_JumpEqualDWord);
+}
+
+
+//
+// Whether instruction jumps to the Target.
+//
+inline Bool HasTarget( Integer Op )
+{
+	return	Op == CODE_Jump || Op == CODE_JumpZero || Op == XOP_Continue ||
+			Op == CODE_CallFunction || (Op >= XOP_JumpNotLess_Integer && Op <= XOP_JumpEqualDWord);
+}
+
+
+//
+// Emitter constructor.
+//
+CJitEmitter::CJitEmitter( CJitCode* InJit, Bool bInLean )
+	:	Jit( InJit ),
+		Code(),
+		bRetry( false ),
+		bLean( bInLean ),
+		Labels(),
+		IsTarget(),
+		Fixups()
+{
+	LabelExit	= Jit->Instrs.Num();
+	LabelLoop	= Jit->Instrs.Num() + 1;
+	LabelBail	= Jit->Instrs.Num() + 2;
+	LabelReturn	= Jit->Instrs.Num() + 3;
+}
+
+
+//
+// Emit the entire function. Return false, if
+// function can't be compiled.
+//
+Bool CJitEmitter::EmitFunction()
+{
+	Integer NumInstrs = Jit->Instrs.Num();
+
+	// Find all instructions, where control comes not
+	// only from the previous one.
+	IsTarget.SetNum( NumInstrs + 2 );
+	for( Integer i=0; i<IsTarget.Num(); i++ )
+		IsTarget[i]	= false;
+	IsTarget[0]	= true;
+
+	for( Integer i=0; i<NumInstrs; i++ )
+	{
+		TInstr& I = Jit->Instrs[i];
+		if( HasTarget(I.Op) )
+		{
+			if( I.Target == -1 )
+			{
+				// Continuation of the call is not linked yet.
+				bRetry	= true;
+				return false;
+			}
+			IsTarget[I.Target]	= true;
+		}
+		if( IsFused(I.Op) )
+			IsTarget[i+2]	= true;
+	}
+
+	Labels.SetNum( NumInstrs + 4 );
+	for( Integer i=0; i<Labels.Num(); i++ )
+		Labels[i]	= -1;
+
+	// Prologue.
+#if FLU_JIT_X64
+	Push( JR_EBX );
+	Push( JR_EBP );
+	Push( JR_R12 );
+	OpRR( 0x83, 5, JR_ESP, true ); Byte1( 32 );			// sub rsp, 32, keeps rsp aligned
+	OpRR( 0x8b, JR_State, JR_Arg0, true );				// mov rbx, State
+#else
+	Push( JR_EBP );
+	OpRR( 0x8b, JR_EBP, JR_ESP );						// mov ebp, esp
+	Push( JR_EBX );
+	Push( JR_ESI );
+	Push( JR_EDI );
+	Op( 0x8b, JR_State, JR_EBP, 8 );					// mov ebx, [ebp+8]
+#endif
+	OpW( 0x8b, JR_Regs, JR_State, offsetof(TJitState, Regs) );
+	OpRR( 0x33, JR_Loop, JR_Loop );						// xor edi, edi
+
+	// Function body.
+	for( Integer i=0; i<NumInstrs; i++ )
+	{
+		Labels[i]	= Code.Num();
+		if( !EmitInstr( i ) )
+			return false;
+
+		if( IsFused(Jit->Instrs[i].Op) )
+		{
+			// Skip the second instruction of the pair, if
+			// nobody jumps to it.
+			if( IsTarget[i+1] )
+				Jump( i+2 );
+			else
+				i++;
+		}
+	}
+
+	// Epilogue, return true.
+	Labels[LabelExit]	= Code.Num();
+	Byte1( 0xb8 ); DWord4( 1 );							// mov eax, 1
+	Labels[LabelReturn]	= Code.Num();
+#if FLU_JIT_X64
+	OpRR( 0x83, 0, JR_ESP, true ); Byte1( 32 );			// add rsp, 32
+	Pop( JR_R12 );
+	Pop( JR_EBP );
+	Pop( JR_EBX );
+#else
+	Pop( JR_EDI );
+	Pop( JR_ESI );
+	Pop( JR_EBX );
+	Pop( JR_EBP );
+#endif
+	Byte1( 0xc3 );										// ret
+
+	// Infinity loop handler, it reports and bails out.
+	Labels[LabelLoop]	= Code.Num();
+	EmitCall( (void*)&CJit::LoopError, nullptr, nullptr );
+
+	// Script error happened, error is already reported,
+	// return false, so CJit::Execute interrupts the VM.
+	Labels[LabelBail]	= Code.Num();
+	OpRR( 0x33, JR_EAX, JR_EAX );						// xor eax, eax
+	Jump( LabelReturn );
+
+	// Fix jumps.
+	for( Integer i=0; i<Fixups.Num(); i++ )
+	{
+		TFixup& Fixup = Fixups[i];
+		assert(Labels[Fixup.iLabel] != -1);
+		*(Integer*)&Code[Fixup.Pos]	= Labels[Fixup.iLabel] - (Fixup.Pos + 4);
+	}
+
+	return true;
+}
+
+
+//
+// Emit a single instruction. Return false, if
+// it's not supported.
+//
+Bool CJitEmitter::EmitInstr( Integer iInstr )
+{
+	TInstr* I = &Jit->Instrs[iInstr];
+
+	switch( I->Op )
+	{
+		case CODE_EOC:
+		{
+			// End of code.
+			Jump( LabelExit );
+			break;
+		}
+		case CODE_Jump:
+		{
+			// Immediately jump.
+			EmitLoopCheck( I );
+			Jump( I->Target );
+			break;
+		}
+		case XOP_Continue:
+		{
+			// Continue in other block.
+			if( I->Target != iInstr+1 )
+				Jump( I->Target );
+			break;
+		}
+		case CODE_JumpZero:
+		{
+			// Conditional jump.
+			EmitLoopCheck( I );
+			Op( 0x80, 7, JR_Regs, RegOfs(I->A) ); Byte1( 0 );		// cmp byte [A], 0
+			JumpCond( JC_E, I->Target );
+			break;
+		}
+		case CODE_LToR:
+		{
+			// General purpose l to r.
+			OpW( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+			EmitCopy( JR_Regs, RegOfs(I->A), JR_EAX, 0, I->C );
+			break;
+		}
+		case CODE_LToRDWord:
+		{
+			// DWord l to r.
+			OpW( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+			Op( 0x8b, JR_EAX, JR_EAX, 0 );
+			Op( 0x89, JR_EAX, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case CODE_Assign:
+		{
+			// General purpose assignment.
+			OpW( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+			EmitCopy( JR_EAX, 0, JR_Regs, RegOfs(I->B), I->C );
+			break;
+		}
+		case CODE_AssignDWord:
+		{
+			// Assign DWord sized value.
+			OpW( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+			Op( 0x8b, JR_ECX, JR_Regs, RegOfs(I->B) );
+			Op( 0x89, JR_ECX, JR_EAX, 0 );
+			break;
+		}
+		case CODE_LocalVar:
+		{
+			// Local variable.
+			EmitPointer( I->A, offsetof(TJitState, Locals), I->W );
+			break;
+		}
+		case CODE_EntityProperty:
+		{
+			// Get an entity property.
+			EmitPointer( I->A, offsetof(TJitState, Instance), I->W );
+			break;
+		}
+		case CODE_BaseProperty:
+		{
+			// Get an base component property.
+			EmitPointer( I->A, offsetof(TJitState, Base), I->W );
+			break;
+		}
+		case CODE_ComponentProperty:
+		{
+			// Get an extra component property.
+			OpW( 0x8b, JR_EAX, JR_State, offsetof(TJitState, Components) );
+			OpW( 0x8b, JR_EAX, JR_EAX, I->B * sizeof(FExtraComponent*) );
+			OpW( 0x8d, JR_EAX, JR_EAX, I->W );
+			OpW( 0x89, JR_EAX, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case CODE_ResourceProperty:
+		{
+			// Get an resource property.
+			OpW( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+			OpRR( 0x85, JR_EAX, JR_EAX, true );						// test eax, eax
+			Integer Pos = JumpShort( JC_NE );
+			EmitHelper( &CJit::ResourceError, I );
+			LandShort( Pos );
+			OpW( 0x8d, JR_EAX, JR_EAX, I->W );
+			OpW( 0x89, JR_EAX, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case CODE_ArrayElem:
+		{
+			// Get an array element, unsigned compare
+			// rejects negative index too.
+			Op( 0x8b, JR_EAX, JR_Regs, RegOfs(I->B) );
+			OpRR( 0x81, 7, JR_EAX ); DWord4( I->D );				// cmp eax, D
+			Integer Pos = JumpShort( JC_B );
+			EmitHelper( &CJit::ArrayError, I );
+			LandShort( Pos );
+			OpRR( 0x69, JR_EAX, JR_EAX ); DWord4( I->C );			// imul eax, eax, C
+			OpW( 0x01, JR_EAX, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case CODE_LMember:
+		{
+			// Get an l-value member.
+			ImmOp( 0, JR_Regs, RegOfs(I->A), I->C, true );
+			break;
+		}
+		case CODE_RMember:
+		{
+			// Get an r-value member.
+			EmitCopy( JR_Regs, RegOfs(I->A), JR_Regs, RegOfs(I->A, I->C), 16-I->C );
+			break;
+		}
+		case CODE_This:
+		{
+			// This reference.
+			OpW( 0x8b, JR_EAX, JR_State, offsetof(TJitState, This) );
+			OpW( 0x89, JR_EAX, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case CODE_Context:
+		{
+			// Change current context. Lean code skips proven
+			// switch from 'this' to 'this'.
+			if( !bLean || !(I->Flags & IF_ThisContext) || !(I->Flags & IF_ThisResult) )
+				EmitHelper( &CJit::ChangeContext, I );
+			break;
+		}
+		case CODE_ConstByte:
+		case CODE_ConstBool:
+		{
+			// Byte or bool constant.
+			Op( 0xc6, 0, JR_Regs, RegOfs(I->A) ); Byte1( I->dValue );
+			break;
+		}
+		case CODE_ConstInteger:
+		case CODE_ConstFloat:
+		case CODE_ConstAngle:
+		case CODE_ConstColor:
+		{
+			// DWord sized constant.
+			Op( 0xc7, 0, JR_Regs, RegOfs(I->A) ); DWord4( I->dValue );
+			break;
+		}
+		case CODE_ConstResource:
+		{
+			// Resource constant.
+			MovImm( JR_EAX, I->Resource );
+			OpW( 0x89, JR_EAX, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case CODE_ConstVector:
+		case CODE_ConstAABB:
+		{
+			// Vector or TRect constant.
+			Integer Size = I->Op == CODE_ConstVector ? sizeof(TVector) : sizeof(TRect);
+			for( Integer i=0; i<Size; i+=sizeof(DWord) )
+			{
+				Op( 0xc7, 0, JR_Regs, RegOfs(I->A, i) );
+				DWord4( *(DWord*)(I->Operands + i) );
+			}
+			break;
+		}
+		case CODE_Assert:
+		{
+			// Assertion.
+			Op( 0x80, 7, JR_Regs, RegOfs(I->A) ); Byte1( 0 );		// cmp byte [A], 0
+			Integer Pos = JumpShort( JC_NE );
+			EmitHelper( &CJit::AssertError, I );
+			LandShort( Pos );
+			break;
+		}
+		case CODE_ConstString:
+		case CODE_AssignString:
+		case CODE_LToRString:
+		case CODE_Length:
+		{
+			// String operations.
+			EmitHelper( &CJit::StringOp, I );
+			break;
+		}
+		case CODE_Equal:
+		case CODE_NotEqual:
+		{
+			// Comparison operators.
+			if( I->C == 0 )
+			{
+				EmitHelper( &CJit::StringOp, I );
+			}
+			else if( I->C == 1 )
+			{
+				Op2( 0xb6, JR_EAX, JR_Regs, RegOfs(I->A) );			// movzx eax, byte [A]
+				Op2( 0xb6, JR_ECX, JR_Regs, RegOfs(I->B) );			// movzx ecx, byte [B]
+				OpRR( 0x3b, JR_EAX, JR_ECX );						// cmp eax, ecx
+				SetCond( I->Op == CODE_Equal ? JC_E : JC_NE );
+			}
+			else if( I->C % sizeof(DWord) == 0 && I->C <= 16 )
+			{
+				Op( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+				Op( 0x33, JR_EAX, JR_Regs, RegOfs(I->B) );			// xor eax, [B]
+				for( Integer i=sizeof(DWord); i<I->C; i+=sizeof(DWord) )
+				{
+					Op( 0x8b, JR_ECX, JR_Regs, RegOfs(I->A, i) );
+					Op( 0x33, JR_ECX, JR_Regs, RegOfs(I->B, i) );
+					OpRR( 0x0b, JR_EAX, JR_ECX );					// or eax, ecx
+				}
+				OpRR( 0x85, JR_EAX, JR_EAX );						// test eax, eax
+				SetCond( I->Op == CODE_Equal ? JC_E : JC_NE );
+			}
+			else
+				return false;
+			Op( 0x88, JR_EAX, JR_Regs, RegOfs(I->A) );				// mov [A], al
+			break;
+		}
+		case CODE_VectorCnstr:
+		{
+			// Vector constructor.
+			Op( 0x8b, JR_EAX, JR_Regs, RegOfs(I->B) );
+			Op( 0x89, JR_EAX, JR_Regs, RegOfs(I->A, 0) );
+			Op( 0x8b, JR_EAX, JR_Regs, RegOfs(I->C) );
+			Op( 0x89, JR_EAX, JR_Regs, RegOfs(I->A, 4) );
+			break;
+		}
+		case CAST_ByteToInteger:
+		case CAST_ByteToAngle:
+		{
+			// Byte to integer or angle cast.
+			Op2( 0xb6, JR_EAX, JR_Regs, RegOfs(I->A) );
+			Op( 0x89, JR_EAX, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case CAST_ByteToFloat:
+		{
+			// Byte to float cast.
+			Op2( 0xb6, JR_EAX, JR_Regs, RegOfs(I->A) );
+			SseRR( 0xf3, 0x2a, 0, JR_EAX );							// cvtsi2ss xmm0, eax
+			Sse( 0xf3, 0x11, 0, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case CAST_IntegerToFloat:
+		{
+			// Integer to float cast.
+			Sse( 0xf3, 0x2a, 0, JR_Regs, RegOfs(I->A) );
+			Sse( 0xf3, 0x11, 0, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case CAST_IntegerToByte:
+		case CAST_IntegerToAngle:
+		{
+			// Lower bits are already in place.
+			break;
+		}
+		case CAST_AngleToInteger:
+		{
+			// Angle to integer cast.
+			ImmOp( 4, JR_Regs, RegOfs(I->A), 0xffff );
+			break;
+		}
+		case UN_Inc_Integer:
+		case UN_Dec_Integer:
+		{
+			// Integer increment or decrement.
+			OpW( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+			Op( 0xff, I->Op == UN_Inc_Integer ? 0 : 1, JR_EAX, 0 );
+			break;
+		}
+		case UN_Inc_Float:
+		case UN_Dec_Float:
+		{
+			// Float increment or decrement.
+			OpW( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+			Sse( 0xf3, 0x10, 0, JR_EAX, 0 );
+			Byte1( 0xb9 ); DWord4( 0x3f800000 );					// mov ecx, 1.0
+			SseRR( 0x66, 0x6e, 1, JR_ECX );							// movd xmm1, ecx
+			SseRR( 0xf3, I->Op == UN_Inc_Float ? 0x58 : 0x5c, 0, 1 );
+			Sse( 0xf3, 0x11, 0, JR_EAX, 0 );
+			break;
+		}
+		case UN_Minus_Integer:
+		{
+			// Integer negation.
+			Op( 0xf7, 3, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case UN_Minus_Float:
+		{
+			// Float negation, just flip the sign.
+			ImmOp( 6, JR_Regs, RegOfs(I->A), 0x80000000 );
+			break;
+		}
+		case UN_Not_Bool:
+		{
+			// Logical not.
+			Op( 0x80, 7, JR_Regs, RegOfs(I->A) ); Byte1( 0 );
+			SetCond( JC_E );
+			Op( 0x88, JR_EAX, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case BIN_Mult_Integer:
+		case BIN_Add_Integer:
+		case BIN_Sub_Integer:
+		case BIN_And_Integer:
+		case BIN_Or_Integer:
+		{
+			// Integer arithmetic.
+			Op( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+			switch( I->Op )
+			{
+				case BIN_Mult_Integer:	Op2( 0xaf, JR_EAX, JR_Regs, RegOfs(I->B) );	break;
+				case BIN_Add_Integer:	Op( 0x03, JR_EAX, JR_Regs, RegOfs(I->B) );	break;
+				case BIN_Sub_Integer:	Op( 0x2b, JR_EAX, JR_Regs, RegOfs(I->B) );	break;
+				case BIN_And_Integer:	Op( 0x23, JR_EAX, JR_Regs, RegOfs(I->B) );	break;
+				case BIN_Or_Integer:	Op( 0x0b, JR_EAX, JR_Regs, RegOfs(I->B) );	break;
+			}
+			Op( 0x89, JR_EAX, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case BIN_Mult_Float:
+		case BIN_Div_Float:
+		case BIN_Add_Float:
+		case BIN_Sub_Float:
+		{
+			// Float arithmetic.
+			Byte Opc =	I->Op == BIN_Mult_Float ? 0x59 : I->Op == BIN_Div_Float ? 0x5e :
+						I->Op == BIN_Add_Float ? 0x58 : 0x5c;
+			Sse( 0xf3, 0x10, 0, JR_Regs, RegOfs(I->A) );
+			Sse( 0xf3, Opc, 0, JR_Regs, RegOfs(I->B) );
+			Sse( 0xf3, 0x11, 0, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case BIN_Add_Vector:
+		case BIN_Sub_Vector:
+		case BIN_Mult_Vector:
+		{
+			// Vector arithmetic, both components at once.
+			Sse( 0xf3, 0x7e, 0, JR_Regs, RegOfs(I->A) );				// movq xmm0, [A]
+			if( I->Op == BIN_Mult_Vector )
+			{
+				Sse( 0xf3, 0x10, 1, JR_Regs, RegOfs(I->B) );			// movss xmm1, [B]
+				SseRR( 0, 0xc6, 1, 1 ); Byte1( 0 );					// shufps xmm1, xmm1, 0
+			}
+			else
+				Sse( 0xf3, 0x7e, 1, JR_Regs, RegOfs(I->B) );			// movq xmm1, [B]
+
+			SseRR( 0, I->Op == BIN_Add_Vector ? 0x58 : I->Op == BIN_Sub_Vector ? 0x5c : 0x59, 0, 1 );
+			Sse( 0x66, 0xd6, 0, JR_Regs, RegOfs(I->A) );				// movq [A], xmm0
+			break;
+		}
+		case BIN_Less_Integer:
+		case BIN_LessEq_Integer:
+		case BIN_Greater_Integer:
+		case BIN_GreaterEq_Integer:
+		case XOP_JumpNotLess_Integer:
+		case XOP_JumpNotLessEq_Integer:
+		case XOP_JumpNotGreater_Integer:
+		case XOP_JumpNotGreaterEq_Integer:
+		case XOP_JumpNotEqualDWord:
+		case XOP_JumpEqualDWord:
+		{
+			// Integer comparison.
+			Byte Cond;
+			switch( I->Op )
+			{
+				case BIN_Less_Integer:
+				case XOP_JumpNotLess_Integer:		Cond = JC_L;	break;
+				case BIN_LessEq_Integer:
+				case XOP_JumpNotLessEq_Integer:		Cond = JC_LE;	break;
+				case BIN_Greater_Integer:
+				case XOP_JumpNotGreater_Integer:	Cond = JC_G;	break;
+				case BIN_GreaterEq_Integer:
+				case XOP_JumpNotGreaterEq_Integer:	Cond = JC_GE;	break;
+				case XOP_JumpNotEqualDWord:			Cond = JC_E;	break;
+				default:							Cond = JC_NE;	break;
+			}
+
+			if( I->Op >= XOP_JumpNotLess_Integer )
+				EmitLoopCheck( I );
+
+			Op( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+			Op( 0x3b, JR_EAX, JR_Regs, RegOfs(I->B) );				// cmp eax, [B]
+			if( I->Op >= XOP_JumpNotLess_Integer )
+			{
+				JumpCond( Cond ^ 1, I->Target );
+			}
+			else
+			{
+				SetCond( Cond );
+				Op( 0x88, JR_EAX, JR_Regs, RegOfs(I->A) );
+			}
+			break;
+		}
+		case BIN_Less_Float:
+		case BIN_LessEq_Float:
+		case BIN_Greater_Float:
+		case BIN_GreaterEq_Float:
+		case XOP_JumpNotLess_Float:
+		case XOP_JumpNotLessEq_Float:
+		case XOP_JumpNotGreater_Float:
+		case XOP_JumpNotGreaterEq_Float:
+		{
+			// Float comparison. Operands are ordered to test
+			// 'above', which is false for NaN, as C++ does.
+			Bool bLess	= I->Op == BIN_Less_Float || I->Op == BIN_LessEq_Float ||
+							I->Op == XOP_JumpNotLess_Float || I->Op == XOP_JumpNotLessEq_Float;
+			Bool bEq	= I->Op == BIN_LessEq_Float || I->Op == BIN_GreaterEq_Float ||
+							I->Op == XOP_JumpNotLessEq_Float || I->Op == XOP_JumpNotGreaterEq_Float;
+			Byte Cond	= bEq ? JC_AE : JC_A;
+
+			if( I->Op >= XOP_JumpNotLess_Float )
+				EmitLoopCheck( I );
+
+			Sse( 0xf3, 0x10, 0, JR_Regs, RegOfs(bLess ? I->B : I->A) );
+			Sse( 0, 0x2f, 0, JR_Regs, RegOfs(bLess ? I->A : I->B) );	// comiss xmm0, [X]
+			if( I->Op >= XOP_JumpNotLess_Float )
+			{
+				JumpCond( Cond ^ 1, I->Target );
+			}
+			else
+			{
+				SetCond( Cond );
+				Op( 0x88, JR_EAX, JR_Regs, RegOfs(I->A) );
+			}
+			break;
+		}
+		case BIN_AddEqual_Integer:
+		case BIN_SubEqual_Integer:
+		{
+			// Integer assignment operators.
+			OpW( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+			Op( 0x8b, JR_ECX, JR_Regs, RegOfs(I->B) );
+			Op( I->Op == BIN_AddEqual_Integer ? 0x01 : 0x29, JR_ECX, JR_EAX, 0 );
+			break;
+		}
+		case BIN_AddEqual_Float:
+		case BIN_SubEqual_Float:
+		case BIN_MulEqual_Float:
+		{
+			// Float assignment operators.
+			Byte Opc =	I->Op == BIN_AddEqual_Float ? 0x58 : I->Op == BIN_SubEqual_Float ? 0x5c : 0x59;
+			OpW( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+			Sse( 0xf3, 0x10, 0, JR_EAX, 0 );
+			Sse( 0xf3, Opc, 0, JR_Regs, RegOfs(I->B) );
+			Sse( 0xf3, 0x11, 0, JR_EAX, 0 );
+			break;
+		}
+		case XOP_LocalDWord:
+		case XOP_EntityDWord:
+		case XOP_BaseDWord:
+		{
+			// Load variable, second instruction is skipped.
+			Integer Field = I->Op == XOP_LocalDWord ? offsetof(TJitState, Locals) :
+							I->Op == XOP_EntityDWord ? offsetof(TJitState, Instance) : offsetof(TJitState, Base);
+			OpW( 0x8b, JR_EAX, JR_State, Field );
+			Op( 0x8b, JR_EAX, JR_EAX, I->W );
+			Op( 0x89, JR_EAX, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case CODE_BaseMethod:
+		{
+			// Base method call.
+			EmitHelper( &CJit::BaseMethod, I );
+			break;
+		}
+		case CODE_ComponentMethod:
+		{
+			// Component method call.
+			EmitHelper( &CJit::ComponentMethod, I );
+			break;
+		}
+		case CODE_CallFunction:
+		{
+			// Call script function, and continue where
+			// the linker placed the next instruction.
+			EmitHelper( &CJit::CallFunction, I );
+			if( I->Target != iInstr+1 )
+				Jump( I->Target );
+			break;
+		}
+		case CODE_Switch:
+		case CODE_SwitchTable:
+		case CODE_SwitchSearch:
+		case CODE_Foreach:
+		case CODE_ConstEntity:
+		case CODE_EntityCast:
+		case CODE_FamilyCast:
+		case CODE_Is:
+		case CODE_In:
+		case CODE_New:
+		case CODE_Delete:
+		case CODE_Log:
+		case CODE_ProtoProperty:
+		case CODE_CallVF:
+		case CODE_Stop:
+		case CODE_Sleep:
+		case CODE_Goto:
+		case CODE_Wait:
+		case CODE_Interrupt:
+		case CODE_Label:
+		case CODE_ConditionalOp:
+		{
+			// Left to VM.
+			return false;
+		}
+		case OP_Abs:
+		{
+			// Float absolute value, just clear the sign.
+			Op( 0x8b, JR_EAX, JR_Regs, RegOfs(I->A) );
+			Byte1( 0x25 ); DWord4( 0x7fffffff );					// and eax, 0x7fffffff
+			Op( 0x89, JR_EAX, JR_Regs, RegOfs(I->B) );
+			break;
+		}
+		case BIN_Dot_Vector:
+		case BIN_Cross_Vector:
+		{
+			// Vector dot or cross product.
+			Integer Other = I->Op == BIN_Dot_Vector ? 0 : 4;
+			Sse( 0xf3, 0x10, 0, JR_Regs, RegOfs(I->A, 0) );			// movss xmm0, [A.X]
+			Sse( 0xf3, 0x59, 0, JR_Regs, RegOfs(I->B, Other) );		// mulss xmm0, [B]
+			Sse( 0xf3, 0x10, 1, JR_Regs, RegOfs(I->A, 4) );			// movss xmm1, [A.Y]
+			Sse( 0xf3, 0x59, 1, JR_Regs, RegOfs(I->B, 4 - Other) );	// mulss xmm1, [B]
+			SseRR( 0xf3, I->Op == BIN_Dot_Vector ? 0x58 : 0x5c, 0, 1 );
+			Sse( 0xf3, 0x11, 0, JR_Regs, RegOfs(I->A) );
+			break;
+		}
+		case XOP_Native:
+		{
+			// Typed native function.
+			EmitNative( I->Native, I );
+			break;
+		}
+		default:
+		{
+			// Native function, call it directly, if it's bound and
+			// its operands fit the instruction.
+			if( I->Op >= XOP_Continue )
+				return false;
+
+			Integer			NumRegs;
+			TNativeThunk	Thunk	= CFrame::FindNative( I->Op, NumRegs );
+			if( Thunk && NumRegs <= MAX_INSTR_REGS )
+				EmitNative( Thunk, I );
+			else
+				EmitHelper( &CJit::ExecuteNative, I );
+			break;
+		}
+	}
+
+	return true;
+}
+
+
+//
+// Count loop iteration, and stop an infinity loop. Lean
+// code only polls the watchdog on backward jumps.
+//
+void CJitEmitter::EmitLoopCheck( TInstr* I )
+{
+	if( bLean )
+	{
+		if( I->Flags & IF_BackEdge )
+		{
+			OpRR( 0xff, 0, JR_Loop );								// inc edi
+			OpRR( 0xf7, 0, JR_Loop ); DWord4( WATCHDOG_MASK );		// test edi, MASK
+			Integer Pos = JumpShort( JC_NE );
+			EmitHelper( &CJit::Watchdog, I );
+			LandShort( Pos );
+		}
+		return;
+	}
+
+	OpRR( 0xff, 0, JR_Loop );									// inc edi
+	OpRR( 0x81, 7, JR_Loop ); DWord4( MAX_ITERATIONS+1 );		// cmp edi, MAX
+	JumpCond( JC_G, LabelLoop );
+}
+
+
+//
+// Call a helper with the state and the instruction, and
+// bail out, if it fails.
+//
+void CJitEmitter::EmitHelper( TJitHelper Func, TInstr* I )
+{
+	EmitCall( (void*)Func, I, nullptr );
+	OpRR( 0x84, JR_EAX, JR_EAX );								// test al, al
+	JumpCond( JC_E, LabelBail );
+}
+
+
+//
+// Call a typed native through the CJit::CallNative, since
+// native might raise script error, and exceptions should
+// never unwind the machine code.
+//
+void CJitEmitter::EmitNative( TNativeThunk Thunk, TInstr* I )
+{
+	EmitCall( (void*)&CJit::CallNative, I, (void*)Thunk );
+	OpRR( 0x84, JR_EAX, JR_EAX );								// test al, al
+	JumpCond( JC_E, LabelBail );
+}
+
+
+//
+// Call a function with the state, the instruction and the
+// extra argument, according to the platform convention.
+//
+void CJitEmitter::EmitCall( void* Func, TInstr* I, void* Extra )
+{
+#if FLU_JIT_X64
+	OpRR( 0x8b, JR_Arg0, JR_State, true );						// mov Arg0, rbx
+	MovImm( JR_Arg1, I );
+	MovImm( JR_Arg2, Extra );
+	MovImm( JR_EAX, Func );
+	OpRR( 0xff, 2, JR_EAX );									// call rax
+#else
+	Byte1( 0x68 ); DWord4( (DWord)(size_t)Extra );				// push Extra
+	Byte1( 0x68 ); DWord4( (DWord)(size_t)I );					// push I
+	Push( JR_State );
+	MovImm( JR_EAX, Func );
+	OpRR( 0xff, 2, JR_EAX );									// call eax
+	OpRR( 0x83, 0, JR_ESP ); Byte1( 12 );						// add esp, 12
+#endif
+}
+
+
+//
+// Copy a block of memory, through the ecx.
+//
+void CJitEmitter::EmitCopy( Byte DstBase, Integer DstDisp, Byte SrcBase, Integer SrcDisp, Integer Size )
+{
+	Integer i;
+	for( i=0; i+4<=Size; i+=4 )
+	{
+		Op( 0x8b, JR_ECX, SrcBase, SrcDisp + i );
+		Op( 0x89, JR_ECX, DstBase, DstDisp + i );
+	}
+	for( ; i<Size; i++ )
+	{
+		Op2( 0xb6, JR_ECX, SrcBase, SrcDisp + i );				// movzx ecx, byte [Src]
+		Op( 0x88, JR_ECX, DstBase, DstDisp + i );				// mov [Dst], cl
+	}
+}
+
+
+//
+// Store to register a pointer, relative to
+// the state field.
+//
+void CJitEmitter::EmitPointer( Byte iReg, Integer StateField, Integer Offset )
+{
+	OpW( 0x8b, JR_EAX, JR_State, StateField );
+	OpW( 0x8d, JR_EAX, JR_EAX, Offset );						// lea eax, [eax+Offset]
+	OpW( 0x89, JR_EAX, JR_Regs, RegOfs(iReg) );
+}
+
+
+//
+// Append a byte.
+//
+void CJitEmitter::Byte1( Byte B )
+{
+	Code.Push( B );
+}
+
+
+//
+// Append a dword.
+//
+void CJitEmitter::DWord4( DWord D )
+{
+	for( Integer i=0; i<4; i++ )
+		Code.Push( (D >> (i * 8)) & 0xff );
+}
+
+
+//
+// Append a REX prefix on x64, if instruction is 64-bit
+// or uses the new registers.
+//
+void CJitEmitter::Rex( Bool bWide, Byte Reg, Byte Base )
+{
+#if FLU_JIT_X64
+	Byte Prefix = 0x40 | (bWide ? 0x08 : 0) | ((Reg & 8) >> 1) | ((Base & 8) >> 3);
+	if( Prefix != 0x40 )
+		Byte1( Prefix );
+#else
+	assert(!bWide && Reg < 8 && Base < 8);
+#endif
+}
+
+
+//
+// Append a memory operand [Base+Disp32]. Base
+// should not be ESP or R12, since they require
+// SIB byte.
+//
+void CJitEmitter::ModRM( Byte Reg, Byte Base, Integer Disp )
+{
+	assert((Base & 7) != JR_ESP);
+	Byte1( 0x80 | ((Reg & 7) << 3) | (Base & 7) );
+	DWord4( Disp );
+}
+
+
+//
+// Append a register operand.
+//
+void CJitEmitter::ModRR( Byte Reg, Byte RM )
+{
+	Byte1( 0xc0 | ((Reg & 7) << 3) | (RM & 7) );
+}
+
+
+//
+// Append a one byte opcode instruction with
+// a memory operand.
+//
+void CJitEmitter::Op( Byte Opc, Byte Reg, Byte Base, Integer Disp )
+{
+	Rex( false, Reg, Base );
+	Byte1( Opc );
+	ModRM( Reg, Base, Disp );
+}
+
+
+//
+// Append a pointer sized instruction with a
+// memory operand.
+//
+void CJitEmitter::OpW( Byte Opc, Byte Reg, Byte Base, Integer Disp )
+{
+	Rex( FLU_JIT_X64, Reg, Base );
+	Byte1( Opc );
+	ModRM( Reg, Base, Disp );
+}
+
+
+//
+// Append a one byte opcode instruction with a
+// register operand, 64-bit if wide on x64.
+//
+void CJitEmitter::OpRR( Byte Opc, Byte Reg, Byte RM, Bool bWide )
+{
+	Rex( bWide && FLU_JIT_X64, Reg, RM );
+	Byte1( Opc );
+	ModRR( Reg, RM );
+}
+
+
+//
+// Append a two bytes 0x0f opcode instruction with
+// a memory operand.
+//
+void CJitEmitter::Op2( Byte Opc, Byte Reg, Byte Base, Integer Disp )
+{
+	Rex( false, Reg, Base );
+	Byte1( 0x0f );
+	Byte1( Opc );
+	ModRM( Reg, Base, Disp );
+}
+
+
+//
+// Append a SSE instruction with a memory operand.
+//
+void CJitEmitter::Sse( Byte Prefix, Byte Opc, Byte Xmm, Byte Base, Integer Disp )
+{
+	if( Prefix )
+		Byte1( Prefix );
+	Op2( Opc, Xmm, Base, Disp );
+}
+
+
+//
+// Append a SSE instruction with a register operand.
+//
+void CJitEmitter::SseRR( Byte Prefix, Byte Opc, Byte Xmm, Byte RM )
+{
+	if( Prefix )
+		Byte1( Prefix );
+	Byte1( 0x0f );
+	Byte1( Opc );
+	ModRR( Xmm, RM );
+}
+
+
+//
+// Append an ALU instruction with a memory operand and
+// 32-bit immediate, which is sign extended, if wide.
+//
+void CJitEmitter::ImmOp( Byte Ext, Byte Base, Integer Disp, DWord Imm, Bool bWide )
+{
+	if( bWide )
+		OpW( 0x81, Ext, Base, Disp );
+	else
+		Op( 0x81, Ext, Base, Disp );
+	DWord4( Imm );
+}
+
+
+//
+// Load a pointer sized immediate to the register.
+//
+void CJitEmitter::MovImm( Byte Reg, const void* Imm )
+{
+	Rex( FLU_JIT_X64, 0, Reg );
+	Byte1( 0xb8 | (Reg & 7) );
+	DWord4( (DWord)(size_t)Imm );
+#if FLU_JIT_X64
+	DWord4( (DWord)((QWord)(size_t)Imm >> 32) );
+#endif
+}
+
+
+//
+// Push the register.
+//
+void CJitEmitter::Push( Byte Reg )
+{
+	Rex( false, 0, Reg );
+	Byte1( 0x50 | (Reg & 7) );
+}
+
+
+//
+// Pop the register.
+//
+void CJitEmitter::Pop( Byte Reg )
+{
+	Rex( false, 0, Reg );
+	Byte1( 0x58 | (Reg & 7) );
+}
+
+
+//
+// Set al to condition.
+//
+void CJitEmitter::SetCond( Byte Cond )
+{
+	Byte1( 0x0f ); Byte1( 0x90 | Cond ); ModRR( 0, JR_EAX );	// setcc al
+}
+
+
+//
+// Append a jump to the label.
+//
+void CJitEmitter::Jump( Integer iLabel )
+{
+	TFixup Fixup;
+	Byte1( 0xe9 );
+	Fixup.Pos		= Code.Num();
+	Fixup.iLabel	= iLabel;
+	Fixups.Push( Fixup );
+	DWord4( 0 );
+}
+
+
+//
+// Append a conditional jump to the label.
+//
+void CJitEmitter::JumpCond( Byte Cond, Integer iLabel )
+{
+	TFixup Fixup;
+	Byte1( 0x0f );
+	Byte1( 0x80 | Cond );
+	Fixup.Pos		= Code.Num();
+	Fixup.iLabel	= iLabel;
+	Fixups.Push( Fixup );
+	DWord4( 0 );
+}
+
+
+//
+// Append a short conditional jump forward, over the
+// cold path. Return position to land it.
+//
+Integer CJitEmitter::JumpShort( Byte Cond )
+{
+	Byte1( 0x70 | Cond );
+	Byte1( 0 );
+	return Code.Num();
+}
+
+
+//
+// Land the short jump here.
+//
+void CJitEmitter::LandShort( Integer Pos )
+{
+	assert(Code.Num() - Pos < 128);
+	Code[Pos-1]	= Code.Num() - Pos;
+}
+
+#endif
+
+
+/*-----------------------------------------------------------------------------
+    CJit implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// JIT settings.
+//
+Bool	CJit::bEnabled		= true;
+Integer	CJit::HotCalls		= 16;
+
+
+//
+// JIT stats.
+//
+Integer	CJit::NumCompiled	= 0;
+Integer	CJit::NumRejected	= 0;
+DWord	CJit::CodeSize		= 0;
+
+
+//
+// Execute the function's machine code, compile it if the
+// function becomes hot. Return false, if function should
+// be executed by VM. Lean mode is checked at each entry,
+// as VM does, and code of the other mode is compiled again.
+//
+Bool CJit::Execute( CFrame& Frame, CLinkedCode* Linked )
+{
+	if( !bEnabled )
+		return false;
+
+	Bool bLean = CFrame::IsLean() && Linked->bVerified;
+	if( Linked->Jit && Linked->Jit->bLean != bLean )
+	{
+		// Function is still hot, so it's compiled at once.
+		CodeSize	-= Linked->Jit->Size;
+		freeandnil(Linked->Jit);
+	}
+
+	if( !Linked->Jit )
+	{
+		if( Linked->bNoJit || ++Linked->NumCalls < HotCalls )
+			return false;
+
+		Bool bRetry;
+		Linked->Jit	= Compile( Linked, bLean, bRetry );
+		if( !Linked->Jit )
+		{
+			// Function calls continuations are linked after
+			// the first return, so try again later.
+			Linked->NumCalls	= 0;
+			Linked->bNoJit		= !bRetry;
+			return false;
+		}
+	}
+
+	TJitState State;
+	State.Frame		= &Frame;
+	State.Regs		= Frame.Regs;
+	State.Locals	= Frame.Locals;
+	State.This		= Frame.This;
+	SetContext( &State, Frame.This );
+
+	// Machine code returns false, if it bailed out on the
+	// script error, which is already reported, so interrupt
+	// the VM here, as CFrame::ScriptError does.
+	typedef Bool (*TJitEntry)( TJitState* State );
+	if( !((TJitEntry)Linked->Jit->Entry)( &State ) )
+		throw nullptr;
+
+	return true;
+}
+
+
+//
+// Compile the linked function to the machine code. If
+// it's impossible now, but might be possible later,
+// bRetry is set.
+//
+CJitCode* CJit::Compile( CLinkedCode* Linked, Bool bLean, Bool& bRetry )
+{
+	bRetry	= false;
+
+#if FLU_JIT
+	CJitCode* Jit = new CJitCode();
+	Jit->Instrs	= Linked->Instrs;
+	Jit->bLean	= bLean;
+
+	CJitEmitter Emitter( Jit, bLean );
+	if( !Emitter.EmitFunction() )
+	{
+		bRetry	= Emitter.bRetry;
+		if( !bRetry )
+			NumRejected++;
+		delete Jit;
+		return nullptr;
+	}
+
+	// Memory is never writable and executable at once.
+	Jit->Size	= Emitter.Code.Num();
+	Jit->Entry	= GPlat->AllocExecutable( Jit->Size );
+	if( !Jit->Entry )
+	{
+		delete Jit;
+		return nullptr;
+	}
+	MemCopy( Jit->Entry, &Emitter.Code[0], Jit->Size );
+	if( !GPlat->ProtectExecutable( Jit->Entry, Jit->Size ) )
+	{
+		delete Jit;
+		return nullptr;
+	}
+
+	NumCompiled++;
+	CodeSize	+= Jit->Size;
+	return Jit;
+#else
+	return nullptr;
+#endif
+}
+
+
+//
+// Cache pointers of the new context.
+//
+void CJit::SetContext( TJitState* State, FEntity* Entity )
+{
+	CInstanceBuffer* Buffer = Entity->InstanceBuffer;
+
+	State->Context		= Entity;
+	State->Instance		= Buffer && Buffer->Data.Num() ? &Buffer->Data[0] : nullptr;
+	State->Base			= Entity->Base;
+	State->Components	= Entity->Components.Num() ? &Entity->Components[0] : nullptr;
+}
+
+
+//
+// A helper body. Script errors are thrown by the
+// CFrame::ScriptError, helper catches them, so they
+// never unwind the machine code, which bails out.
+//
+#define JIT_GUARD( Body )\
+	try\
+	{\
+		Body\
+	}\
+	catch( ... )\
+	{\
+		return false;\
+	}\
+	return true;
+
+
+//
+// Change current context.
+//
+Bool CJit::ChangeContext( TJitState* State, TInstr* I )
+{
+	JIT_GUARD
+	(
+		FEntity* NewContext = *(FEntity**)State->Regs[I->A].Value;
+		if( !NewContext )
+			State->Frame->ScriptError( L"Access to undefined entity" );
+		SetContext( State, NewContext );
+	)
+}
+
+
+//
+// Delegate execution to native functions.
+//
+Bool CJit::ExecuteNative( TJitState* State, TInstr* I )
+{
+	JIT_GUARD
+	(
+		State->Frame->Code	= I->Operands;
+		State->Frame->ExecuteNative( State->Context, (EOpCode)I->Op );
+	)
+}
+
+
+//
+// Call typed native function.
+//
+Bool CJit::CallNative( TJitState* State, TInstr* I, TNativeThunk Thunk )
+{
+	JIT_GUARD
+	(
+		Thunk( *State->Frame, &I->A );
+	)
+}
+
+
+//
+// Base method call.
+//
+Bool CJit::BaseMethod( TJitState* State, TInstr* I )
+{
+	JIT_GUARD
+	(
+		CNativeFunction* Native = CClassDatabase::GFuncs[I->W];
+		Native->ptrMethod( State->Base, *State->Frame, I->Operands );
+	)
+}
+
+
+//
+// Component method call.
+//
+Bool CJit::ComponentMethod( TJitState* State, TInstr* I )
+{
+	JIT_GUARD
+	(
+		CNativeFunction* Native = CClassDatabase::GFuncs[I->W];
+		Native->ptrMethod( State->Components[I->B], *State->Frame, I->Operands );
+	)
+}
+
+
+//
+// Call script function.
+//
+Bool CJit::CallFunction( TJitState* State, TInstr* I )
+{
+	JIT_GUARD
+	(
+		CFunction* Func = State->Context->Script->Functions[I->A];
+		State->Frame->CallFunction( State->Context, Func, I->Operands );
+	)
+}
+
+
+//
+// String operations.
+//
+Bool CJit::StringOp( TJitState* State, TInstr* I )
+{
+	CFrame&		Frame	= *State->Frame;
+	TRegister*	Regs	= State->Regs;
+
+	switch( I->Op )
+	{
+		case CODE_ConstString:
+			Frame.StrReg(I->A)	= Frame.Script->StrTable[I->W];
+			break;
+
+		case CODE_AssignString:
+			*(String*)Regs[I->A].Addr	= Frame.StrReg(I->B);
+			break;
+
+		case CODE_LToRString:
+			Frame.StrReg(I->A)	= *(String*)Regs[I->A].Addr;
+			break;
+
+		case CODE_Length:
+			*(Integer*)Regs[I->B].Value	= Frame.StrReg(I->A).Len();
+			break;
+
+		case CODE_Equal:
+			*(Bool*)Regs[I->A].Value	= Frame.StrReg(I->A) == Frame.StrReg(I->B);
+			break;
+
+		case CODE_NotEqual:
+			*(Bool*)Regs[I->A].Value	= Frame.StrReg(I->A) != Frame.StrReg(I->B);
+			break;
+	}
+	return true;
+}
+
+
+//
+// Array index is out of bounds.
+//
+Bool CJit::ArrayError( TJitState* State, TInstr* I )
+{
+	JIT_GUARD
+	(
+		State->Frame->ScriptError( L"Array violates bounds %i/%i", *(Integer*)State->Regs[I->B].Value, I->D );
+	)
+}
+
+
+//
+// Property of the null resource.
+//
+Bool CJit::ResourceError( TJitState* State, TInstr* I )
+{
+	JIT_GUARD
+	(
+		State->Frame->ScriptError( L"Access to null resource" );
+	)
+}
+
+
+//
+// Assertion failed.
+//
+Bool CJit::AssertError( TJitState* State, TInstr* I )
+{
+	JIT_GUARD
+	(
+		State->Frame->ScriptError( L"Assertion failed! Line: %d", I->W );
+	)
+}
+
+
+//
+// Infinity loop detected.
+//
+Bool CJit::LoopError( TJitState* State, TInstr* I )
+{
+	JIT_GUARD
+	(
+		State->Frame->ScriptError( L"Infinity loop" );
+	)
+}
+
+
+//
+// Poll the watchdog from the lean code.
+//
+Bool CJit::Watchdog( TJitState* State, TInstr* I )
+{
+	JIT_GUARD
+	(
+		State->Frame->CheckWatchdog();
+	)
+}
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
@@ -0,0 +1,107 @@
+/*=============================================================================
+    FrJit.h: Script baseline JIT compiler.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    CJitCode.
+-----------------------------------------------------------------------------*/
+
+//
+// A state of the function execution, shared between the
+// machine code and the helpers it calls. Machine code
+// addresses fields by offset, so it should stay POD.
+//
+struct TJitState
+{
+public:
+	CFrame*				Frame;
+	TRegister*			Regs;
+	Byte*				Locals;
+	FEntity*			This;
+	FEntity*			Context;
+	Byte*				Instance;		// Context's instance buffer.
+	FBaseComponent*		Base;			// Context's base component.
+	FExtraComponent**	Components;		// Context's extra components.
+};
+
+
+//
+// A machine code of the script function. It keeps the
+// copy of linked instructions, since helpers get them by
+// pointer, and the linked code might grow meanwhile.
+// Lean code skips the checks, so it's compiled for the
+// lean mode of the moment, see CJit::Execute.
+//
+class CJitCode
+{
+public:
+	// Variables.
+	void*				Entry;
+	DWord				Size;
+	Bool				bLean;
+	TArray<TInstr>		Instrs;
+
+	// CJitCode interface.
+	CJitCode();
+	~CJitCode();
+};
+
+
+/*-----------------------------------------------------------------------------
+    CJit.
+-----------------------------------------------------------------------------*/
+
+//
+// A baseline JIT compiler. It translates the linked code
+// of the hot function to the x86 or x64 machine code, one
+// instruction at once, without register allocation: script
+// registers stay in the frame, so natives and helpers see
+// them as the VM does. Functions with any instruction it
+// doesn't know are left to the VM, as well as the thread
+// code, which is suspended and resumed in the middle.
+// Exceptions never unwind the machine code: helpers catch
+// script errors, and machine code bails out to Execute,
+// which interrupts the VM.
+//
+class CJit
+{
+public:
+	// Settings.
+	static Bool		bEnabled;
+	static Integer	HotCalls;
+
+	// Stats.
+	static Integer	NumCompiled;
+	static Integer	NumRejected;
+	static DWord	CodeSize;
+
+	// CJit interface.
+	static Bool Execute( CFrame& Frame, CLinkedCode* Linked );
+	static CJitCode* Compile( CLinkedCode* Linked, Bool bLean, Bool& bRetry );
+
+private:
+	// Helpers, called from the machine code. They never
+	// throw, but return false on script error.
+	static void SetContext( TJitState* State, FEntity* Entity );
+	static Bool ChangeContext( TJitState* State, TInstr* I );
+	static Bool ExecuteNative( TJitState* State, TInstr* I );
+	static Bool CallNative( TJitState* State, TInstr* I, TNativeThunk Thunk );
+	static Bool BaseMethod( TJitState* State, TInstr* I );
+	static Bool ComponentMethod( TJitState* State, TInstr* I );
+	static Bool CallFunction( TJitState* State, TInstr* I );
+	static Bool StringOp( TJitState* State, TInstr* I );
+	static Bool ArrayError( TJitState* State, TInstr* I );
+	static Bool ResourceError( TJitState* State, TInstr* I );
+	static Bool AssertError( TJitState* State, TInstr* I );
+	static Bool LoopError( TJitState* State, TInstr* I );
+	static Bool Watchdog( TJitState* State, TInstr* I );
+
+	// Friends.
+	friend class CJitEmitter;
+};
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
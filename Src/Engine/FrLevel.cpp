@@ -23,6 +23,8 @@ FLevel::FLevel()
 		Soundtrack( nullptr ),
 		ScrollClamp( TVector(0.f, 0.f), WORLD_SIZE ),
 		CollHash( nullptr ),
+		PhysScene( nullptr ),
+		Scheduler( nullptr ),
 		GFXManager( nullptr ),
 		Navigator( nullptr ),
 		AmbientLight( COLOR_Black )
@@ -41,6 +43,8 @@ FLevel::~FLevel()
 {
 	// Test state.
 	assert(CollHash == nullptr);
+	assert(PhysScene == nullptr);
+	assert(Scheduler == nullptr);
 	assert(GFXManager == nullptr);
 
 	// Kill navigator.
@@ -159,6 +163,12 @@ void FLevel::BeginPlay()
 	// Allocate collision hash.
 	CollHash	= new CCollisionHash( this );
 
+	// Physics scene.
+	PhysScene	= new CPhysicsScene( this );
+
+	// Script threads scheduler.
+	Scheduler	= new CThreadScheduler( this );
+
 	// Level's GFX.
 	GFXManager	= new CGFXManager( this );
 
@@ -204,6 +214,16 @@ void FLevel::EndPlay()
 	delete CollHash;
 	CollHash	= nullptr;
 
+	// Release physics scene.
+	assert(PhysScene);
+	delete PhysScene;
+	PhysScene	= nullptr;
+
+	// Release threads scheduler.
+	assert(Scheduler);
+	delete Scheduler;
+	Scheduler	= nullptr;
+
 	// Release GFX man.
 	assert(GFXManager);
 	delete GFXManager;
@@ -352,19 +372,27 @@ void FLevel::Tick( Float Delta )
 	// Are we play now?
 	if( bIsPlaying && !bIsPause )
 	{
-		// Normally play level.
-		for( Integer i=0; i<Entities.Num(); i++ )
-			if( Entities[i]->Thread )
-				Entities[i]->Thread->Tick( Delta );
+		// Normally play level, scripts have a time budget.
+		CFrame::StartWatchdog();
+		Scheduler->Tick( Delta );
 
 		for( Integer i=0; i<TickObjects.Num(); i++ )
 			TickObjects[i]->PreTick( Delta );
 
+		// Solve rigid bodies, and notify scripts
+		// after all bodies are resolved.
+		PhysScene->Tick( Delta );
+		PhysScene->DispatchEvents();
+
 		for( Integer i=0; i<TickObjects.Num(); i++ )
 			TickObjects[i]->Tick( Delta );
 
+		// Notify about arcade bodies events.
+		PhysScene->DispatchEvents();
+
 		// Update GFX interpolation.
 		GFXManager->Tick( Delta );
+		CFrame::StopWatchdog();
 	}
 	else
 	{
@@ -657,7 +685,10 @@ void FEntity::BeginPlay()
 	{
 		// Allocate an entity thread if any.
 		if( Script->Thread )
+		{
 			Thread	= new CEntityThread( this, Script->Thread );
+			Level->Scheduler->AddThread( Thread );
+		}
 	}
 
 	// Notify all components.
@@ -680,6 +711,7 @@ void FEntity::EndPlay()
 	// Destroy thread if any.
 	if( Thread )
 	{
+		Level->Scheduler->RemoveThread( Thread );
 		delete Thread;
 		Thread	= nullptr;
 	}
@@ -60,11 +60,15 @@ public:
 	TArray<FPuppetComponent*>	Puppets;
 	TArray<FInputComponent*>	Inputs;
 	TArray<FPainterComponent*>	Painters;
+	TArray<FRigidBodyComponent*>	RigidBodies;
+	TArray<FJointComponent*>		Joints;
 
 	// Level objects
 	FCameraComponent*			Camera;
 	FSkyComponent*				Sky;
 	CCollisionHash*				CollHash;
+	CPhysicsScene*				PhysScene;
+	CThreadScheduler*			Scheduler;
 	CGFXManager*				GFXManager;
 	CNavigator*					Navigator;
 
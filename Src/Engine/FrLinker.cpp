@@ -0,0 +1,1875 @@
+/*=============================================================================
+    FrLinker.cpp: Script bytecode linker.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+#include "Engine.h"
+
+/*-----------------------------------------------------------------------------
+    CLinkedCode implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Bytecode readers.
+//
+template<class T> inline T ReadOperand( Byte*& P )
+{
+	T R = *(T*)P;
+	P += sizeof(T);
+	return R;
+}
+
+
+//
+// Whether optimize linked code.
+//
+Bool CLinkedCode::bOptimize = true;
+
+
+//
+// Number of functions, rejected by the verifier.
+//
+Integer CLinkedCode::NumRejected = 0;
+
+
+//
+// Linked code constructor.
+//
+CLinkedCode::CLinkedCode( FScript* InScript, CBytecode* InBytecode )
+	:	Script( InScript ),
+		Bytecode( InBytecode ),
+		Instrs(),
+		Map(),
+		Args(),
+		bPlainArgs( false ),
+		bPlainLocals( false ),
+		Signature( 0 ),
+		BadSignature( 0 ),
+		Jit( nullptr ),
+		NumCalls( 0 ),
+		bNoJit( false ),
+		bVerified( true )
+{
+	assert(Script && Bytecode);
+	Map.SetNum( Bytecode->Code.Num() );
+	for( Integer i=0; i<Map.Num(); i++ )
+		Map[i]	= -1;
+
+	// Prepare call info.
+	if( Bytecode != Script->Thread )
+	{
+		CFunction* Func = (CFunction*)Bytecode;
+		bPlainArgs		= true;
+		bPlainLocals	= true;
+
+		for( Integer i=0; i<Func->Locals.Num(); i++ )
+		{
+			CProperty* Local = Func->Locals[i];
+			Bool bPlain = Local->Type != TYPE_String;
+
+			if( i < Func->ParmsCount )
+			{
+				TCallArg Arg;
+				Arg.Offset	= Local->Offset;
+				Arg.Size	= Local->TypeSize();
+				Args.Push( Arg );
+				bPlainArgs	&= bPlain && !(Local->Flags & PROP_OutParm);
+
+				// Arrays and out parameters are never 
+				// matched by events.
+				if( i < 4 )
+				{
+					DWord Type = (Local->Flags & PROP_OutParm) || Local->ArrayDim != 1 ? 0xff : Local->Type;
+					Signature	|= Type << (i * 8);
+				}
+			}
+			bPlainLocals	&= bPlain;
+		}
+	}
+}
+
+
+//
+// Linked code destructor.
+//
+CLinkedCode::~CLinkedCode()
+{
+	freeandnil(Jit);
+}
+
+
+//
+// Return the linked code of the bytecode, link
+// it if required.
+//
+CLinkedCode* CLinkedCode::Link( FScript* InScript, CBytecode* InBytecode )
+{
+	if( !InBytecode->Linked )
+	{
+		InBytecode->Linked	= new CLinkedCode( InScript, InBytecode );
+		InBytecode->Linked->Resolve( 0 );
+	}
+	return InBytecode->Linked;
+}
+
+
+//
+// Link all script code, just after loading, to
+// avoid hitches while playing.
+//
+void CLinkedCode::LinkScript( FScript* InScript )
+{
+	if( !InScript->bHasText )
+		return;
+
+	for( Integer i=0; i<InScript->Functions.Num(); i++ )
+		Link( InScript, InScript->Functions[i] );
+
+	if( InScript->Thread )
+	{
+		CLinkedCode* Linked = Link( InScript, InScript->Thread );
+		for( Integer i=0; i<InScript->Thread->Labels.Num(); i++ )
+			Linked->Resolve( InScript->Thread->Labels[i].Address );
+	}
+}
+
+
+//
+// Drop all linked code of the script, it will be
+// linked again on the next call, with current linker
+// settings. Script shouldn't be executing now.
+//
+void CLinkedCode::UnlinkScript( FScript* InScript )
+{
+	for( Integer i=0; i<InScript->Functions.Num(); i++ )
+		freeandnil(InScript->Functions[i]->Linked);
+
+	if( InScript->Thread )
+		freeandnil(InScript->Thread->Linked);
+}
+
+
+//
+// Return an index of the instruction at the bytecode
+// address, decode it and all reachable code if it
+// wasn't decoded yet. Warning: Instrs may be reallocated.
+//
+Integer CLinkedCode::Resolve( Integer Addr )
+{
+	assert(Addr >= 0 && Addr < Map.Num());
+
+	Integer iFirst = Instrs.Num();
+	if( Map[Addr] == -1 )
+		Decode( Addr );
+
+	// Code is always entered in 'this' context.
+	if( bVerified && (iFirst != Instrs.Num() || !Joined[Map[Addr]]) )
+		bVerified	= Verify( iFirst, Map[Addr], -1 );
+
+	return Map[Addr];
+}
+
+
+//
+// Return an index of the instruction, where script
+// function call continues, and link the call to it. The
+// verifier should see this edge, since the call keeps
+// the execution context.
+//
+Integer CLinkedCode::ResolveCall( Integer iCall, Integer Addr )
+{
+	assert(Addr >= 0 && Addr < Map.Num());
+	assert(Instrs[iCall].Op == CODE_CallFunction || Instrs[iCall].Op == CODE_CallVF);
+
+	Integer iFirst = Instrs.Num();
+	if( Map[Addr] == -1 )
+		Decode( Addr );
+
+	Instrs[iCall].Target	= Map[Addr];
+	if( bVerified )
+		bVerified	= Verify( iFirst, -1, iCall );
+
+	return Map[Addr];
+}
+
+
+//
+// Decode the code at the bytecode address and all
+// reachable code, then optimize it.
+//
+void CLinkedCode::Decode( Integer Addr )
+{
+	TArray<Integer>	Pending;
+	TArray<TFixup>	Fixups;
+	Integer			iFirst	= Instrs.Num();
+
+	Pending.Push( Addr );
+	while( Pending.Num() > 0 )
+	{
+		Integer Next = Pending.Pop();
+		if( Map[Next] == -1 )
+			DecodeBlock( Next, Pending, Fixups );
+	}
+
+	// All jump targets are decoded now.
+	for( Integer i=0; i<Fixups.Num(); i++ )
+	{
+		assert(Map[Fixups[i].Addr] != -1);
+		Instrs[Fixups[i].iInstr].Target	= Map[Fixups[i].Addr];
+	}
+
+	// Optimize just decoded code.
+	if( bOptimize )
+		Optimize( iFirst, Map[Addr] );
+}
+
+
+//
+// Return the final target of the jump, skipping
+// all unconditional jumps in the chain.
+//
+Integer CLinkedCode::ThreadJump( Integer iTarget )
+{
+	for( Integer i=0; i<16; i++ )
+	{
+		TInstr& Target = Instrs[iTarget];
+		if( (Target.Op != CODE_Jump && Target.Op != XOP_Continue) || Target.Target == -1 )
+			break;
+		iTarget	= Target.Target;
+	}
+	return iTarget;
+}
+
+
+//
+// Whether instruction is fused with the next one, and
+// skips it, see EXOpCode.
+//
+static inline Bool IsFused( Word Op )
+{
+	return Op >= XOP_LocalDWord && Op <= XOP_JumpEqualDWord;
+}
+
+
+//
+// Whether instruction loads a constant, which is
+// stored in the TInstr::dValue.
+//
+static inline Bool IsValueConst( Word Op )
+{
+	switch( Op )
+	{
+		case CODE_ConstByte:
+		case CODE_ConstBool:
+		case CODE_ConstInteger:
+		case CODE_ConstFloat:
+		case CODE_ConstAngle:
+		case CODE_ConstColor:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+
+//
+// Whether instruction just writes a value to the
+// register, and never fails.
+//
+static inline Bool IsPureLoad( Word Op )
+{
+	switch( Op )
+	{
+		case CODE_ConstVector:
+		case CODE_ConstAABB:
+		case CODE_ConstResource:
+		case CODE_ConstEntity:
+		case CODE_LocalVar:
+			return true;
+
+		default:
+			return IsValueConst( Op );
+	}
+}
+
+
+//
+// Collect registers, read and written by the instruction,
+// a bit per register, and the number of bytes written from
+// the start of the register, or 0 if it's not known. Return
+// false, if instruction might touch any register.
+//
+static Bool RegisterEffect( const TInstr& I, DWord& Use, DWord& Def, Integer& Size )
+{
+	#define REG( r ) (1u << (r))
+
+	Use		= 0;
+	Def		= 0;
+	Size	= 0;
+
+	switch( I.Op )
+	{
+		case CODE_EOC:
+		case CODE_Jump:
+		case XOP_Continue:
+		{
+			// No registers.
+			return true;
+		}
+		case CODE_JumpZero:
+		case CODE_Switch:
+		case CODE_SwitchTable:
+		case CODE_SwitchSearch:
+		case UN_Inc_Integer:
+		case UN_Inc_Float:
+		case UN_Dec_Integer:
+		case UN_Dec_Float:
+		{
+			// Read a value or an address.
+			Use		= REG(I.A);
+			return true;
+		}
+		case CODE_Assign:
+		case CODE_AssignDWord:
+		case BIN_AddEqual_Integer:
+		case BIN_AddEqual_Float:
+		case BIN_SubEqual_Integer:
+		case BIN_SubEqual_Float:
+		case BIN_MulEqual_Float:
+		case XOP_JumpNotLess_Integer:
+		case XOP_JumpNotLessEq_Integer:
+		case XOP_JumpNotGreater_Integer:
+		case XOP_JumpNotGreaterEq_Integer:
+		case XOP_JumpNotLess_Float:
+		case XOP_JumpNotLessEq_Float:
+		case XOP_JumpNotGreater_Float:
+		case XOP_JumpNotGreaterEq_Float:
+		case XOP_JumpNotEqualDWord:
+		case XOP_JumpEqualDWord:
+		{
+			// Read an address and a value, or two values.
+			Use		= REG(I.A) | REG(I.B);
+			return true;
+		}
+		case CODE_ConstByte:
+		case CODE_ConstBool:
+		{
+			Def		= REG(I.A);
+			Size	= sizeof(Byte);
+			return true;
+		}
+		case CODE_ConstInteger:
+		case CODE_ConstFloat:
+		case CODE_ConstAngle:
+		case CODE_ConstColor:
+		case XOP_LocalDWord:
+		case XOP_EntityDWord:
+		case XOP_BaseDWord:
+		{
+			Def		= REG(I.A);
+			Size	= sizeof(DWord);
+			return true;
+		}
+		case CODE_ConstVector:
+		{
+			Def		= REG(I.A);
+			Size	= sizeof(TVector);
+			return true;
+		}
+		case CODE_ConstAABB:
+		{
+			Def		= REG(I.A);
+			Size	= sizeof(TRect);
+			return true;
+		}
+		case CODE_ConstResource:
+		case CODE_ConstEntity:
+		case CODE_LocalVar:
+		case CODE_EntityProperty:
+		case CODE_BaseProperty:
+		{
+			Def		= REG(I.A);
+			Size	= sizeof(void*);
+			return true;
+		}
+		case CODE_LToR:
+		case CODE_LToRDWord:
+		case CAST_ByteToInteger:
+		case CAST_ByteToFloat:
+		case CAST_ByteToAngle:
+		case CAST_IntegerToFloat:
+		case CAST_IntegerToByte:
+		case CAST_IntegerToAngle:
+		case CAST_AngleToInteger:
+		case UN_Minus_Integer:
+		case UN_Minus_Float:
+		case UN_Not_Bool:
+		{
+			// Register is replaced by its function.
+			Use		= REG(I.A);
+			Def		= REG(I.A);
+			return true;
+		}
+		case CODE_Equal:
+		case CODE_NotEqual:
+		case BIN_Mult_Integer:
+		case BIN_Mult_Float:
+		case BIN_Mult_Vector:
+		case BIN_Div_Float:
+		case BIN_Add_Integer:
+		case BIN_Add_Float:
+		case BIN_Add_Vector:
+		case BIN_Sub_Integer:
+		case BIN_Sub_Float:
+		case BIN_Sub_Vector:
+		case BIN_Less_Integer:
+		case BIN_Less_Float:
+		case BIN_LessEq_Integer:
+		case BIN_LessEq_Float:
+		case BIN_Greater_Integer:
+		case BIN_Greater_Float:
+		case BIN_GreaterEq_Integer:
+		case BIN_GreaterEq_Float:
+		case BIN_And_Integer:
+		case BIN_Or_Integer:
+		case BIN_Dot_Vector:
+		case BIN_Cross_Vector:
+		{
+			// Binary operator, result replaces first operand.
+			Use		= REG(I.A) | REG(I.B);
+			Def		= REG(I.A);
+			return true;
+		}
+		case OP_Abs:
+		case OP_Cos:
+		case OP_Sin:
+		case OP_Sqrt:
+		case OP_Frac:
+		case OP_Round:
+		case OP_Normalize:
+		case OP_VectorSize:
+		{
+			// Inline math.
+			Use		= REG(I.A);
+			Def		= REG(I.B);
+			return true;
+		}
+		case OP_Distance:
+		{
+			Use		= REG(I.A) | REG(I.B);
+			Def		= REG(I.C);
+			return true;
+		}
+		case XOP_Native:
+		{
+			// Bound native touches only its operands.
+			Integer NumRegs;
+			CFrame::FindNative( I.W, NumRegs );
+			for( Integer i=0; i<NumRegs; i++ )
+				Use	|= REG((&I.A)[i]);
+			Def		= Use;
+			return true;
+		}
+		default:
+		{
+			// Unknown or thread control instruction.
+			return false;
+		}
+	}
+
+	#undef REG
+}
+
+
+//
+// Peephole optimization of the just decoded instructions.
+// Fused instruction skips the second one, so it's never 
+// removed. Constants are tracked in registers only if all
+// code is decoded, otherwise new code might continue in 
+// the middle of the old one, with other registers.
+//
+void CLinkedCode::Optimize( Integer iFirst, Integer iEntry )
+{
+	// Jumps threading.
+	for( Integer i=iFirst; i<Instrs.Num(); i++ )
+	{
+		TInstr& I = Instrs[i];
+		if( I.Target != -1 && I.Op != CODE_CallFunction && I.Op != CODE_CallVF )
+			I.Target	= ThreadJump( I.Target );
+	}
+
+	// Superinstructions. Fused compare and jump doesn't store the
+	// result of comparison, since compiler never reads the condition
+	// register after jump.
+	for( Integer i=iFirst; i<Instrs.Num()-1; i++ )
+	{
+		TInstr& A = Instrs[i];
+		TInstr& B = Instrs[i+1];
+
+		if( B.Op == CODE_LToRDWord && B.A == A.A )
+		{
+			// Load a dword variable.
+			switch( A.Op )
+			{
+				case CODE_LocalVar:			A.Op = XOP_LocalDWord;		break;
+				case CODE_EntityProperty:	A.Op = XOP_EntityDWord;		break;
+				case CODE_BaseProperty:		A.Op = XOP_BaseDWord;		break;
+			}
+		}
+		else if( B.Op == CODE_JumpZero && B.A == A.A )
+		{
+			// Compare and jump.
+			Word Fused = A.Op;
+			switch( A.Op )
+			{
+				case BIN_Less_Integer:		Fused = XOP_JumpNotLess_Integer;		break;
+				case BIN_LessEq_Integer:	Fused = XOP_JumpNotLessEq_Integer;		break;
+				case BIN_Greater_Integer:	Fused = XOP_JumpNotGreater_Integer;		break;
+				case BIN_GreaterEq_Integer:	Fused = XOP_JumpNotGreaterEq_Integer;	break;
+				case BIN_Less_Float:		Fused = XOP_JumpNotLess_Float;			break;
+				case BIN_LessEq_Float:		Fused = XOP_JumpNotLessEq_Float;		break;
+				case BIN_Greater_Float:		Fused = XOP_JumpNotGreater_Float;		break;
+				case BIN_GreaterEq_Float:	Fused = XOP_JumpNotGreaterEq_Float;		break;
+				case CODE_Equal:			if( A.C == 4 ) Fused = XOP_JumpNotEqualDWord;	break;
+				case CODE_NotEqual:			if( A.C == 4 ) Fused = XOP_JumpEqualDWord;		break;
+			}
+			if( Fused != A.Op )
+			{
+				A.Op		= Fused;
+				A.Target	= B.Target;
+			}
+		}
+	}
+
+	// Function is complete, if it's decoded from the start,
+	// and has no calls, whose continuations are decoded later.
+	Bool bComplete = iFirst == 0 && Bytecode != Script->Thread;
+	for( Integer i=iFirst; i<Instrs.Num() && bComplete; i++ )
+		if( Instrs[i].Op == CODE_CallFunction || Instrs[i].Op == CODE_CallVF )
+			bComplete	= false;
+
+	TArray<Bool> Removed;
+	Removed.SetNum( Instrs.Num() );
+	for( Integer i=0; i<Removed.Num(); i++ )
+		Removed[i]	= false;
+
+	if( bComplete )
+	{
+		// Loops, the last jump to the head closes the loop.
+		TArray<Integer> Last;
+		Last.SetNum( Instrs.Num() );
+		for( Integer i=0; i<Last.Num(); i++ )
+			Last[i]	= -1;
+		for( Integer i=0; i<Instrs.Num(); i++ )
+			if( Instrs[i].Target >= 0 && Instrs[i].Target <= i )
+				Last[Instrs[i].Target]	= i;
+
+		for( Integer i=0; i<Instrs.Num(); i++ )
+			if( Last[i] != -1 )
+				HoistConstants( i, Last[i], iEntry );
+
+		RemoveRedundantConstants( iEntry, Removed );
+	}
+
+	RemoveDeadStores( iFirst, Removed );
+	Compact( iFirst, Removed );
+}
+
+
+//
+// Mark instructions, which might be reached not only
+// from the previous one: entry, jumps targets and
+// switch cases.
+//
+void CLinkedCode::FindLeaders( Integer iEntry, TArray<Bool>& Leaders )
+{
+	TArray<Integer> Succ;
+
+	Leaders.SetNum( Instrs.Num() );
+	for( Integer i=0; i<Leaders.Num(); i++ )
+		Leaders[i]	= false;
+	Leaders[iEntry]	= true;
+
+	for( Integer i=0; i<Instrs.Num(); i++ )
+	{
+		Successors( i, Succ );
+		for( Integer j=0; j<Succ.Num(); j++ )
+			if( Succ[j] >= 0 && Succ[j] < Instrs.Num() && !(IsFused(Instrs[i].Op) && Succ[j] == i+2) )
+				Leaders[Succ[j]]	= true;
+	}
+}
+
+
+//
+// Move constants out of the loop. Constants from the start
+// of the loop head are moved to the head start, and jumps 
+// of the loop skip them. Constant's register should be 
+// written only by the same constant in the loop, and loop
+// should be entered only through its head, so register
+// always keeps the constant, when loop jumps back.
+//
+void CLinkedCode::HoistConstants( Integer iHeader, Integer iLast, Integer iEntry )
+{
+	TArray<Integer>	Succ;
+	TArray<Bool>	Leaders;
+	TArray<TInstr>	Hoisted;
+	TArray<TInstr>	Rest;
+	Word			ConstOp[TRegister::NUM_REGS];
+	DWord			ConstValue[TRegister::NUM_REGS];
+	DWord			Seen	= 0,
+					Bad		= 0,
+					Touched	= 0;
+	DWord			Use, Def;
+	Integer			Size;
+
+	// Loop is entered only through the head.
+	if( iEntry > iHeader && iEntry <= iLast )
+		return;
+
+	for( Integer i=0; i<Instrs.Num(); i++ )
+		if( i < iHeader || i > iLast )
+		{
+			Successors( i, Succ );
+			for( Integer j=0; j<Succ.Num(); j++ )
+				if( Succ[j] > iHeader && Succ[j] <= iLast )
+					return;
+		}
+
+	// Registers, written in the loop not only by the constant.
+	for( Integer i=iHeader; i<=iLast; i++ )
+	{
+		TInstr& I = Instrs[i];
+		if( !RegisterEffect( I, Use, Def, Size ) )
+			return;
+
+		if( IsValueConst(I.Op) )
+		{
+			if( !(Seen & (1u << I.A)) )
+			{
+				Seen				|= 1u << I.A;
+				ConstOp[I.A]		= I.Op;
+				ConstValue[I.A]		= I.dValue;
+			}
+			else if( ConstOp[I.A] != I.Op || ConstValue[I.A] != I.dValue )
+				Bad	|= 1u << I.A;
+		}
+		else
+			Bad	|= Def;
+	}
+
+	// Split the straight line start of the head, constants,
+	// whose registers are not touched before, go first.
+	FindLeaders( iEntry, Leaders );
+
+	Integer iEnd = iHeader;
+	while( iEnd <= iLast && (iEnd == iHeader || !Leaders[iEnd]) )
+	{
+		TInstr& I = Instrs[iEnd];
+		Bool	bPair = IsFused(I.Op);
+
+		if( I.Target != -1 || !RegisterEffect( I, Use, Def, Size ) )
+			break;
+		if( bPair ? iEnd+1 > iLast || Leaders[iEnd+1] : !Successors( iEnd, Succ ) )
+			break;
+
+		if( IsValueConst(I.Op) && !((Bad | Touched) & (1u << I.A)) )
+		{
+			Hoisted.Push( I );
+		}
+		else
+		{
+			Touched	|= Use | Def;
+			Rest.Push( I );
+			if( bPair )
+				Rest.Push( Instrs[++iEnd] );
+		}
+		iEnd++;
+	}
+
+	if( Hoisted.Num() == 0 )
+		return;
+
+	// Reorder, head's address still enters the loop.
+	Word HeadAddr = Instrs[iHeader].Addr;
+	for( Integer i=0; i<Hoisted.Num(); i++ )
+		Instrs[iHeader+i]	= Hoisted[i];
+	for( Integer i=0; i<Rest.Num(); i++ )
+		Instrs[iHeader+Hoisted.Num()+i]	= Rest[i];
+	for( Integer i=iHeader; i<iEnd; i++ )
+		Map[Instrs[i].Addr]	= i;
+	Map[HeadAddr]	= iHeader;
+
+	// Jumps back skip the constants.
+	for( Integer i=iHeader; i<=iLast; i++ )
+		if( Instrs[i].Target == iHeader )
+			Instrs[i].Target	= iHeader + Hoisted.Num();
+}
+
+
+//
+// Mark loads of the constant, which is already in the
+// register. Registers are tracked only through the straight
+// line code, and forgotten at joins.
+//
+void CLinkedCode::RemoveRedundantConstants( Integer iEntry, TArray<Bool>& Removed )
+{
+	TArray<Integer>	Succ;
+	TArray<Bool>	Leaders;
+	Bool			bKnown[TRegister::NUM_REGS];
+	Word			KnownOp[TRegister::NUM_REGS];
+	DWord			KnownValue[TRegister::NUM_REGS];
+	Bool			bFlow	= false;
+	DWord			Use, Def;
+	Integer			Size;
+
+	FindLeaders( iEntry, Leaders );
+
+	for( Integer i=0; i<Instrs.Num(); i++ )
+	{
+		TInstr& I = Instrs[i];
+
+		if( !bFlow || Leaders[i] )
+			for( Integer r=0; r<TRegister::NUM_REGS; r++ )
+				bKnown[r]	= false;
+
+		if( IsValueConst(I.Op) && bKnown[I.A] && KnownOp[I.A] == I.Op && KnownValue[I.A] == I.dValue )
+		{
+			// Register already keeps it.
+			Removed[i]	= true;
+			bFlow		= true;
+			continue;
+		}
+
+		if( !RegisterEffect( I, Use, Def, Size ) )
+		{
+			bFlow	= false;
+			continue;
+		}
+
+		for( Integer r=0; r<TRegister::NUM_REGS; r++ )
+			if( Def & (1u << r) )
+				bKnown[r]	= false;
+
+		if( IsValueConst(I.Op) )
+		{
+			bKnown[I.A]		= true;
+			KnownOp[I.A]	= I.Op;
+			KnownValue[I.A]	= I.dValue;
+		}
+
+		if( IsFused(I.Op) )
+		{
+			// Skip the second instruction of the pair.
+			bFlow	= !Leaders[i+1];
+			i++;
+		}
+		else
+			bFlow	= Successors( i, Succ );
+	}
+}
+
+
+//
+// Mark constants and local addresses, which are
+// overwritten before any read in the straight line 
+// code. Walks the code backward.
+//
+void CLinkedCode::RemoveDeadStores( Integer iFirst, TArray<Bool>& Removed )
+{
+	TArray<Integer>	Succ;
+	Integer			Cover[TRegister::NUM_REGS];
+	DWord			Use, Def;
+	Integer			Size;
+
+	// Number of bytes of the register, which are written
+	// later, before any read.
+	for( Integer r=0; r<TRegister::NUM_REGS; r++ )
+		Cover[r]	= 0;
+
+	for( Integer i=Instrs.Num()-1; i>=iFirst; i-- )
+	{
+		TInstr& I = Instrs[i];
+		if( Removed[i] )
+			continue;
+
+		Bool bStraight	=	I.Target == -1 && 
+							!(i > 0 && IsFused(Instrs[i-1].Op)) && 
+							Successors( i, Succ ) && 
+							RegisterEffect( I, Use, Def, Size );
+		if( !bStraight )
+		{
+			for( Integer r=0; r<TRegister::NUM_REGS; r++ )
+				Cover[r]	= 0;
+			continue;
+		}
+
+		if( IsPureLoad(I.Op) && Cover[I.A] >= Size )
+		{
+			// Value is never read.
+			Removed[i]	= true;
+			continue;
+		}
+
+		for( Integer r=0; r<TRegister::NUM_REGS; r++ )
+		{
+			if( Def & (1u << r) )
+				Cover[r]	= Max( Cover[r], Size );
+			if( Use & (1u << r) )
+				Cover[r]	= 0;
+		}
+	}
+}
+
+
+//
+// Remove marked instructions of the just decoded code,
+// jumps and entries to them go to the next instruction.
+//
+void CLinkedCode::Compact( Integer iFirst, const TArray<Bool>& Removed )
+{
+	Integer			NumInstrs	= Instrs.Num();
+	Integer			iNew		= iFirst;
+	TArray<Integer>	NewIndex;
+
+	NewIndex.SetNum( NumInstrs - iFirst );
+	for( Integer i=iFirst; i<NumInstrs; i++ )
+	{
+		NewIndex[i-iFirst]	= iNew;
+		if( !Removed[i] )
+			Instrs[iNew++]	= Instrs[i];
+	}
+
+	if( iNew == NumInstrs )
+		return;
+
+	assert(!Removed[NumInstrs-1]);
+	Instrs.SetNum( iNew );
+
+	for( Integer i=0; i<Instrs.Num(); i++ )
+		if( Instrs[i].Target >= iFirst )
+			Instrs[i].Target	= NewIndex[Instrs[i].Target - iFirst];
+
+	for( Integer i=0; i<Map.Num(); i++ )
+		if( Map[i] >= iFirst )
+			Map[i]	= NewIndex[Map[i] - iFirst];
+}
+
+
+//
+// Return the size of operands of the native function,
+// or -1 if opcode is not a native. Iterators operands
+// are followed by the iterator offset.
+//
+Integer CLinkedCode::NativeOperands( Integer iOpCode, Bool* bForeach )
+{
+	static Integer	Operands[256];
+	static Bool		Foreach[256];
+	static Bool		bInitialized = false;
+
+	if( !bInitialized )
+	{
+		for( Integer i=0; i<256; i++ )
+		{
+			Operands[i]	= -1;
+			Foreach[i]	= false;
+		}
+
+		for( Integer i=0; i<CClassDatabase::GFuncs.Num(); i++ )
+		{
+			CNativeFunction* Native = CClassDatabase::GFuncs[i];
+			if( Native->Flags & NFUN_Method )
+				continue;
+
+			Integer Num = 0;
+			if( Native->Flags & NFUN_UnaryOp )
+			{
+				Num	= 1;
+			}
+			else if( Native->Flags & NFUN_BinaryOp )
+			{
+				Num	= 2;
+			}
+			else
+			{
+				for( Integer j=0; j<8 && Native->ParamsType[j].Type != TYPE_None; j++ )
+					Num++;
+				if( Native->ResultType.Type != TYPE_None )
+					Num++;
+			}
+
+			// Iterators are followed by the iterator offset.
+			if( Native->Flags & NFUN_Foreach )
+				Num	+= sizeof(Word);
+
+			Operands[Native->iOpCode]	= Num;
+			Foreach[Native->iOpCode]	= (Native->Flags & NFUN_Foreach) != 0;
+		}
+		bInitialized	= true;
+	}
+
+	if( bForeach )
+		*bForeach	= Foreach[iOpCode & 0xff];
+	return Operands[iOpCode & 0xff];
+}
+
+
+//
+// Return the number of register operands of the
+// native method.
+//
+static Integer MethodOperands( Word iNative )
+{
+	CNativeFunction* Native = CClassDatabase::GFuncs[iNative];
+	Integer Num = 0;
+
+	for( Integer j=0; j<8 && Native->ParamsType[j].Type != TYPE_None; j++ )
+		Num++;
+	if( Native->ResultType.Type != TYPE_None )
+		Num++;
+
+	// Typed method should match its declaration.
+	assert(Num == Native->NumRegs);
+	return Num;
+}
+
+
+//
+// Whether native is trivial enough to be executed by
+// the linked code VM itself, see CFrame::ExecuteInstrs.
+//
+static inline Bool IsInlineNative( Integer iOpCode )
+{
+	switch( iOpCode )
+	{
+		case OP_Abs:
+		case OP_Cos:
+		case OP_Sin:
+		case OP_Sqrt:
+		case OP_Distance:
+		case OP_Frac:
+		case OP_Round:
+		case OP_Normalize:
+		case OP_VectorSize:
+		case BIN_Dot_Vector:
+		case BIN_Cross_Vector:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+
+//
+// Decode a straight-line block of code, until
+// the end of code, unconditional jump or call with
+// unknown length. Jumps targets are added to the
+// pending list.
+//
+void CLinkedCode::DecodeBlock( Integer Addr, TArray<Integer>& Pending, TArray<TFixup>& Fixups )
+{
+	Byte*	Start	= &Bytecode->Code[0];
+	Byte*	P		= Start + Addr;
+
+	for( ; ; )
+	{
+		Integer Here = P - Start;
+		if( Here >= Bytecode->Code.Num() )
+			error( L"Script '%s' bytecode is out of bounds", *Script->GetName() );
+
+		// Fall through into already decoded code.
+		if( Map[Here] != -1 )
+		{
+			TInstr Continue;
+			MemZero( &Continue, sizeof(TInstr) );
+			Continue.Op		= XOP_Continue;
+			Continue.Addr	= Here;
+			Continue.Target	= Map[Here];
+			Instrs.Push( Continue );
+			return;
+		}
+
+		TInstr I;
+		MemZero( &I, sizeof(TInstr) );
+		I.Op		= *P++;
+		I.Addr		= Here;
+		I.Target	= -1;
+		Map[Here]	= Instrs.Num();
+
+		TFixup	Fixup;
+		Fixup.iInstr	= Map[Here];
+		Fixup.Addr		= -1;
+		Bool	bEnd	= false;
+
+		switch( I.Op )
+		{
+			case CODE_EOC:
+			{
+				bEnd		= true;
+				break;
+			}
+			case CODE_Jump:
+			{
+				Fixup.Addr	= ReadOperand<Word>( P );
+				bEnd		= true;
+				break;
+			}
+			case CODE_JumpZero:
+			{
+				Fixup.Addr	= ReadOperand<Word>( P );
+				I.A			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_Switch:
+			{
+				I.C			= ReadOperand<Byte>( P );
+				I.A			= ReadOperand<Byte>( P );
+				Fixup.Addr	= ReadOperand<Word>( P );
+				I.Operands	= Start + ReadOperand<Word>( P );
+
+				// Decode all cases.
+				Byte*	Table	= I.Operands;
+				Integer	NumLabs	= ReadOperand<Byte>( Table );
+				for( Integer i=0; i<NumLabs; i++ )
+				{
+					Table	+= I.C;
+					Pending.Push( ReadOperand<Word>( Table ) );
+				}
+				break;
+			}
+			case CODE_SwitchTable:
+			case CODE_SwitchSearch:
+			{
+				I.C			= ReadOperand<Byte>( P );
+				I.A			= ReadOperand<Byte>( P );
+				Fixup.Addr	= ReadOperand<Word>( P );
+				I.Operands	= Start + ReadOperand<Word>( P );
+
+				// Decode all cases.
+				Byte*	Table	= I.Operands;
+				if( I.Op == CODE_SwitchTable )
+					Table	+= sizeof(Integer);
+
+				Integer NumLabs	= ReadOperand<Word>( Table );
+				for( Integer i=0; i<NumLabs; i++ )
+				{
+					if( I.Op == CODE_SwitchSearch )
+						Table	+= sizeof(Integer);
+					Pending.Push( ReadOperand<Word>( Table ) );
+				}
+				break;
+			}
+			case CODE_Foreach:
+			{
+				I.iValue	= ReadOperand<Word>( P );
+				I.W			= ReadOperand<Word>( P );
+				Fixup.Addr	= ReadOperand<Word>( P );
+				break;
+			}
+			case CODE_ConstByte:
+			{
+				I.dValue	= ReadOperand<Byte>( P );
+				I.A			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_ConstBool:
+			{
+				I.dValue	= ReadOperand<Bool>( P );
+				I.A			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_ConstInteger:
+			case CODE_ConstFloat:
+			case CODE_ConstAngle:
+			case CODE_ConstColor:
+			{
+				I.dValue	= ReadOperand<DWord>( P );
+				I.A			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_ConstString:
+			{
+				I.W			= ReadOperand<Word>( P );
+				I.A			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_ConstVector:
+			{
+				I.Operands	= P;
+				P			+= sizeof(TVector);
+				I.A			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_ConstAABB:
+			{
+				I.Operands	= P;
+				P			+= sizeof(TRect);
+				I.A			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_ConstResource:
+			{
+				Byte iRes	= ReadOperand<Byte>( P );
+				I.Resource	= iRes != 0xff ? Script->ResTable[iRes] : nullptr;
+				I.A			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_ConstEntity:
+			{
+				I.iValue	= ReadOperand<Integer>( P );
+				I.A			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_EntityCast:
+			{
+				I.A			= ReadOperand<Byte>( P );
+				I.Script	= (FScript*)GObjectDatabase->GObjects[ReadOperand<Integer>( P )];
+				assert(I.Script->IsA(FScript::MetaClass));
+				break;
+			}
+			case CODE_In:
+			case CODE_FamilyCast:
+			{
+				I.A			= ReadOperand<Byte>( P );
+				I.iValue	= ReadOperand<Integer>( P );
+				break;
+			}
+			case CODE_Assert:
+			{
+				I.W			= ReadOperand<Word>( P );
+				I.A			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_Log:
+			{
+				// Format string and a pair of type and
+				// register per format symbol.
+				I.Operands	= P;
+				const String& Fmt = Script->StrTable[ReadOperand<Word>( P )];
+
+				for( Integer i=0; i<Fmt.Len(); i++ )
+					if( Fmt[i] == L'%' )
+					{
+						P	+= 2;
+						i++;
+					}
+				break;
+			}
+			case CODE_This:
+			case CODE_Context:
+			case CODE_Delete:
+			case CODE_Label:
+			case CODE_LToRDWord:
+			case CODE_LToRString:
+			case CAST_ByteToInteger:
+			case CAST_ByteToFloat:
+			case CAST_ByteToAngle:
+			case CAST_IntegerToFloat:
+			case CAST_IntegerToByte:
+			case CAST_IntegerToAngle:
+			case CAST_AngleToInteger:
+			{
+				I.A			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_Is:
+			case CODE_New:
+			case CODE_Length:
+			case CODE_AssignDWord:
+			case CODE_AssignString:
+			{
+				I.A			= ReadOperand<Byte>( P );
+				I.B			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_Assign:
+			case CODE_Equal:
+			case CODE_NotEqual:
+			case CODE_VectorCnstr:
+			{
+				I.A			= ReadOperand<Byte>( P );
+				I.B			= ReadOperand<Byte>( P );
+				I.C			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_ConditionalOp:
+			{
+				I.A			= ReadOperand<Byte>( P );
+				I.B			= ReadOperand<Byte>( P );
+				I.C			= ReadOperand<Byte>( P );
+				I.D			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_LToR:
+			case CODE_LMember:
+			case CODE_RMember:
+			{
+				I.A			= ReadOperand<Byte>( P );
+				I.C			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_ArrayElem:
+			{
+				I.A			= ReadOperand<Byte>( P );
+				I.B			= ReadOperand<Byte>( P );
+				I.C			= ReadOperand<Byte>( P );
+				I.D			= ReadOperand<Byte>( P );
+				break;
+			}
+			case CODE_LocalVar:
+			case CODE_EntityProperty:
+			case CODE_BaseProperty:
+			case CODE_ResourceProperty:
+			{
+				I.A			= ReadOperand<Byte>( P );
+				I.W			= ReadOperand<Word>( P );
+				break;
+			}
+			case CODE_ComponentProperty:
+			{
+				I.B			= ReadOperand<Byte>( P );
+				I.A			= ReadOperand<Byte>( P );
+				I.W			= ReadOperand<Word>( P );
+				break;
+			}
+			case CODE_ProtoProperty:
+			{
+				I.Script	= (FScript*)GObjectDatabase->GObjects[ReadOperand<Integer>( P )];
+				assert(I.Script->IsA(FScript::MetaClass));
+				I.B			= ReadOperand<Byte>( P );
+				I.A			= ReadOperand<Byte>( P );
+				I.W			= ReadOperand<Word>( P );
+				break;
+			}
+			case CODE_BaseMethod:
+			{
+				I.W			= ReadOperand<Word>( P );
+				I.Operands	= P;
+				P			+= MethodOperands( I.W );
+				break;
+			}
+			case CODE_ComponentMethod:
+			{
+				I.W			= ReadOperand<Word>( P );
+				I.B			= ReadOperand<Byte>( P );
+				I.Operands	= P;
+				P			+= MethodOperands( I.W );
+				break;
+			}
+			case CODE_CallFunction:
+			case CODE_CallVF:
+			{
+				// Length of arguments list depends on the callee,
+				// so the rest is decoded after the first call.
+				I.A			= ReadOperand<Byte>( P );
+				I.Operands	= P;
+				bEnd		= true;
+				break;
+			}
+			case CODE_Stop:
+			case CODE_Interrupt:
+			{
+				I.iValue	= P - Start;
+				break;
+			}
+			case CODE_Sleep:
+			case CODE_Goto:
+			{
+				I.A			= ReadOperand<Byte>( P );
+				I.iValue	= P - Start;
+				break;
+			}
+			case CODE_Wait:
+			{
+				I.W			= ReadOperand<Word>( P );
+				I.A			= ReadOperand<Byte>( P );
+				I.iValue	= P - Start;
+				break;
+			}
+			default:
+			{
+				// Native function or operator.
+				Integer NumOperands = NativeOperands( I.Op );
+				if( NumOperands == -1 )
+					error( L"Unknown instruction '%i' in script '%s'", I.Op, *Script->GetName() );
+
+				I.Operands	= P;
+				I.A			= NumOperands > 0 ? P[0] : 0;
+				I.B			= NumOperands > 1 ? P[1] : 0;
+				I.C			= NumOperands > 2 ? P[2] : 0;
+				I.D			= NumOperands > 3 ? P[3] : 0;
+				P			+= NumOperands;
+
+				// Bind typed native, unless VM executes it inline, or
+				// operands don't fit the instruction.
+				Integer			NumRegs;
+				TNativeThunk	Thunk	= CFrame::FindNative( I.Op, NumRegs );
+				if( Thunk && !IsInlineNative( I.Op ) && NumRegs <= MAX_INSTR_REGS )
+				{
+					assert( NumRegs == NumOperands );
+					I.W			= I.Op;
+					I.Op		= XOP_Native;
+					I.Native	= Thunk;
+				}
+				break;
+			}
+		}
+
+		Instrs.Push( I );
+
+		if( Fixup.Addr != -1 )
+		{
+			Fixups.Push( Fixup );
+			Pending.Push( Fixup.Addr );
+		}
+		if( bEnd )
+			return;
+	}
+}
+
+
+/*-----------------------------------------------------------------------------
+    Verifier.
+-----------------------------------------------------------------------------*/
+
+//
+// Execution context, known by the verifier.
+//
+enum EVerifyContext
+{
+	VCTX_None,		// Instruction is not reached yet.
+	VCTX_This,		// 'this' entity.
+	VCTX_Other		// Any entity.
+};
+
+
+//
+// Collect instructions, where control goes after the
+// instruction, except the next one. Return true, if
+// control might go to the next instruction too. Bad
+// targets are returned as -1.
+//
+Bool CLinkedCode::Successors( Integer iInstr, TArray<Integer>& Succ )
+{
+	TInstr& I = Instrs[iInstr];
+	Succ.Empty();
+
+	switch( I.Op )
+	{
+		case CODE_EOC:
+		case CODE_Stop:
+		case CODE_Sleep:
+		case CODE_Wait:
+		case CODE_Interrupt:
+		{
+			// Leave the code.
+			return false;
+		}
+		case CODE_Jump:
+		case XOP_Continue:
+		{
+			Succ.Push( I.Target );
+			return false;
+		}
+		case CODE_JumpZero:
+		case CODE_Foreach:
+		{
+			Succ.Push( I.Target );
+			return true;
+		}
+		case CODE_CallFunction:
+		case CODE_CallVF:
+		{
+			// Continuation is known after the first return.
+			if( I.Target != -1 )
+				Succ.Push( I.Target );
+			return false;
+		}
+		case XOP_LocalDWord:
+		case XOP_EntityDWord:
+		case XOP_BaseDWord:
+		{
+			Succ.Push( iInstr + 2 );
+			return false;
+		}
+		case XOP_JumpNotLess_Integer:
+		case XOP_JumpNotLessEq_Integer:
+		case XOP_JumpNotGreater_Integer:
+		case XOP_JumpNotGreaterEq_Integer:
+		case XOP_JumpNotLess_Float:
+		case XOP_JumpNotLessEq_Float:
+		case XOP_JumpNotGreater_Float:
+		case XOP_JumpNotGreaterEq_Float:
+		case XOP_JumpNotEqualDWord:
+		case XOP_JumpEqualDWord:
+		{
+			Succ.Push( I.Target );
+			Succ.Push( iInstr + 2 );
+			return false;
+		}
+		case CODE_Switch:
+		case CODE_SwitchTable:
+		case CODE_SwitchSearch:
+		{
+			// Default and all cases.
+			Byte*	Table	= I.Operands;
+			Integer	NumLabs;
+			Succ.Push( I.Target );
+
+			if( I.Op == CODE_Switch )
+			{
+				NumLabs	= ReadOperand<Byte>( Table );
+			}
+			else
+			{
+				if( I.Op == CODE_SwitchTable )
+					Table	+= sizeof(Integer);
+				NumLabs	= ReadOperand<Word>( Table );
+			}
+
+			for( Integer i=0; i<NumLabs; i++ )
+			{
+				if( I.Op == CODE_Switch )
+					Table	+= I.C;
+				else if( I.Op == CODE_SwitchSearch )
+					Table	+= sizeof(Integer);
+
+				Word Addr	= ReadOperand<Word>( Table );
+				Succ.Push( Addr < Map.Num() ? Map[Addr] : -1 );
+			}
+			return false;
+		}
+		default:
+		{
+			// Straight-line instruction.
+			return true;
+		}
+	}
+}
+
+
+//
+// Verify operands of the single instruction. Context
+// dependent operands are verified only in 'this' context,
+// others are still checked while executing.
+//
+Bool CLinkedCode::VerifyInstr( Integer iInstr, Byte Context, String& Problem )
+{
+	TInstr&	I			= Instrs[iInstr];
+	Bool	bThis		= Context == VCTX_This;
+	DWord	FrameSize	= Bytecode != Script->Thread ? ((CFunction*)Bytecode)->FrameSize : 0;
+	Byte*	Operands	= nullptr;
+	Integer	NumRegs		= 0;
+
+	#define REJECT( msg ) { Problem = msg; return false; }
+
+	switch( I.Op )
+	{
+		case CODE_EOC:
+		case CODE_Jump:
+		case CODE_Stop:
+		case CODE_Interrupt:
+		case XOP_Continue:
+		{
+			// No operands.
+			break;
+		}
+		case CODE_JumpZero:
+		case CODE_ConstByte:
+		case CODE_ConstBool:
+		case CODE_ConstInteger:
+		case CODE_ConstFloat:
+		case CODE_ConstAngle:
+		case CODE_ConstColor:
+		case CODE_ConstVector:
+		case CODE_ConstAABB:
+		case CODE_ConstResource:
+		case CODE_ConstEntity:
+		case CODE_This:
+		case CODE_Context:
+		case CODE_Delete:
+		case CODE_Label:
+		case CODE_LToRDWord:
+		case CODE_LToRString:
+		case CAST_ByteToInteger:
+		case CAST_ByteToFloat:
+		case CAST_ByteToAngle:
+		case CAST_IntegerToFloat:
+		case CAST_IntegerToByte:
+		case CAST_IntegerToAngle:
+		case CAST_AngleToInteger:
+		case CODE_Assert:
+		case CODE_EntityCast:
+		case CODE_In:
+		case CODE_FamilyCast:
+		case CODE_BaseProperty:
+		case CODE_ResourceProperty:
+		case CODE_LMember:
+		case CODE_Sleep:
+		case CODE_Goto:
+		case CODE_Wait:
+		case XOP_BaseDWord:
+		{
+			// Single register.
+			NumRegs	= 1;
+			break;
+		}
+		case CODE_ConstString:
+		{
+			NumRegs	= 1;
+			if( I.W >= Script->StrTable.Num() )
+				REJECT( L"Bad string constant" );
+			break;
+		}
+		case CODE_LToR:
+		case CODE_RMember:
+		{
+			NumRegs	= 1;
+			if( I.C > sizeof(TRegister) || (I.Op == CODE_RMember && I.C == sizeof(TRegister)) )
+				REJECT( L"Value doesn't fit register" );
+			break;
+		}
+		case CODE_Switch:
+		case CODE_SwitchTable:
+		case CODE_SwitchSearch:
+		{
+			NumRegs	= 1;
+			if( I.Op == CODE_Switch ? I.C < 1 || I.C > sizeof(Integer) : I.C != sizeof(Byte) && I.C != sizeof(Integer) )
+				REJECT( L"Bad switch expression size" );
+			break;
+		}
+		case CODE_LocalVar:
+		case XOP_LocalDWord:
+		{
+			NumRegs	= 1;
+			if( I.W + (I.Op == XOP_LocalDWord ? sizeof(DWord) : 1) > FrameSize )
+				REJECT( L"Local variable out of frame" );
+			break;
+		}
+		case CODE_EntityProperty:
+		case XOP_EntityDWord:
+		{
+			NumRegs	= 1;
+			if( bThis && I.W + (I.Op == XOP_EntityDWord ? sizeof(DWord) : 1) > Script->InstanceSize )
+				REJECT( L"Entity property out of instance" );
+			break;
+		}
+		case CODE_ComponentProperty:
+		{
+			NumRegs	= 1;
+			if( bThis && I.B >= Script->Components.Num() )
+				REJECT( L"Bad component index" );
+			break;
+		}
+		case CODE_ProtoProperty:
+		{
+			NumRegs	= 1;
+			if( I.B == 0xff ? I.W >= I.Script->InstanceSize : I.B != 0xfe && I.B >= I.Script->Components.Num() )
+				REJECT( L"Bad prototype property" );
+			break;
+		}
+		case CODE_Is:
+		case CODE_New:
+		case CODE_Length:
+		case CODE_AssignDWord:
+		case CODE_AssignString:
+		case XOP_JumpNotLess_Integer:
+		case XOP_JumpNotLessEq_Integer:
+		case XOP_JumpNotGreater_Integer:
+		case XOP_JumpNotGreaterEq_Integer:
+		case XOP_JumpNotLess_Float:
+		case XOP_JumpNotLessEq_Float:
+		case XOP_JumpNotGreater_Float:
+		case XOP_JumpNotGreaterEq_Float:
+		case XOP_JumpNotEqualDWord:
+		case XOP_JumpEqualDWord:
+		{
+			// Pair of registers.
+			NumRegs	= 2;
+			break;
+		}
+		case CODE_Assign:
+		case CODE_Equal:
+		case CODE_NotEqual:
+		{
+			NumRegs	= 2;
+			if( I.C > sizeof(TRegister) )
+				REJECT( L"Value doesn't fit register" );
+			break;
+		}
+		case CODE_ArrayElem:
+		{
+			NumRegs	= 2;
+			if( I.C == 0 || I.D == 0 )
+				REJECT( L"Bad array" );
+			break;
+		}
+		case CODE_VectorCnstr:
+		{
+			NumRegs	= 3;
+			break;
+		}
+		case CODE_ConditionalOp:
+		{
+			NumRegs	= 4;
+			break;
+		}
+		case CODE_Foreach:
+		{
+			if( I.iValue + sizeof(TIterator) > FrameSize || I.W + sizeof(FEntity*) > FrameSize )
+				REJECT( L"Iterator out of frame" );
+			break;
+		}
+		case CODE_Log:
+		{
+			// Pairs of type and register.
+			Byte* P = I.Operands;
+			const String& Fmt = Script->StrTable[ReadOperand<Word>( P )];
+			for( Integer i=0; i<Fmt.Len(); i++ )
+				if( Fmt[i] == L'%' )
+				{
+					if( P[1] >= TRegister::NUM_REGS )
+						REJECT( L"Bad register" );
+					P	+= 2;
+					i++;
+				}
+			break;
+		}
+		case CODE_CallFunction:
+		case CODE_CallVF:
+		{
+			// Callee is known only in 'this' context.
+			if( bThis )
+			{
+				if( I.A >= (I.Op == CODE_CallFunction ? Script->Functions.Num() : Script->VFTable.Num()) )
+					REJECT( L"Bad function index" );
+
+				// Lean code doesn't test abstract method call.
+				CFunction* Func	= I.Op == CODE_CallFunction ? Script->Functions[I.A] : Script->VFTable[I.A];
+				if( !Func && I.Op == CODE_CallVF )
+					REJECT( L"Abstract method call" );
+				if( Func )
+				{
+					Operands	= I.Operands;
+					NumRegs		= Func->ParmsCount + (Func->ResultVar ? 1 : 0);
+				}
+			}
+			break;
+		}
+		case CODE_BaseMethod:
+		case CODE_ComponentMethod:
+		{
+			if( I.W >= CClassDatabase::GFuncs.Num() || !(CClassDatabase::GFuncs[I.W]->Flags & NFUN_Method) )
+				REJECT( L"Bad native method" );
+			if( I.Op == CODE_ComponentMethod && bThis && I.B >= Script->Components.Num() )
+				REJECT( L"Bad component index" );
+
+			Operands	= I.Operands;
+			NumRegs		= MethodOperands( I.W );
+			break;
+		}
+		case XOP_Native:
+		{
+			// Bound native, operands are decoded.
+			if( !CFrame::FindNative( I.W, NumRegs ) )
+				REJECT( L"Bad native" );
+			break;
+		}
+		default:
+		{
+			// Native function or operator.
+			Bool	bForeach;
+			Integer	NumOperands	= NativeOperands( I.Op, &bForeach );
+			if( NumOperands == -1 )
+				REJECT( L"Unknown instruction" );
+
+			Operands	= I.Operands;
+			NumRegs		= bForeach ? NumOperands - sizeof(Word) : NumOperands;
+			if( bForeach && *(Word*)(Operands + NumRegs) + sizeof(TIterator) > FrameSize )
+				REJECT( L"Iterator out of frame" );
+			break;
+		}
+	}
+
+	// Test registers.
+	Byte Fields[4] = { I.A, I.B, I.C, I.D };
+	for( Integer i=0; i<NumRegs; i++ )
+		if( (Operands ? Operands[i] : Fields[i]) >= TRegister::NUM_REGS )
+			REJECT( L"Bad register" );
+
+	#undef REJECT
+	return true;
+}
+
+
+//
+// Verify the just linked code. Verifier proves registers
+// are in bounds, jump targets are decoded, values fit the
+// registers, variables fit their storage, and tables indexes
+// are valid. Execution context is tracked through the code,
+// to verify component and property access in 'this' context,
+// and to mark instructions for the lean mode. Verification
+// is incremental: only new instructions, given entry and new
+// call continuation edge are walked, and old instructions
+// are verified again only if their context is changed, so
+// each instruction is verified at most three times. Return
+// false, if code is rejected, it runs with all runtime
+// checks then.
+//
+Bool CLinkedCode::Verify( Integer iFirst, Integer iEntry, Integer iEdge )
+{
+	Integer			NumInstrs	= Instrs.Num();
+	Integer			iBad		= -1;
+	String			Problem;
+	TArray<Integer>	Succ;
+	TArray<Integer>	Work;
+	TArray<Integer>	Changed;
+
+	Contexts.SetNum( NumInstrs );
+	Joined.SetNum( NumInstrs );
+
+	// Control flow of the new code. Instructions, which might be
+	// reached not only from the previous one, are joined.
+	for( Integer i=iFirst; i<NumInstrs && iBad == -1; i++ )
+	{
+		if( Successors( i, Succ ) && i+1 >= NumInstrs )
+		{
+			iBad	= i;
+			Problem	= L"Code falls out of bounds";
+		}
+		for( Integer j=0; j<Succ.Num() && iBad == -1; j++ )
+			if( Succ[j] < 0 || Succ[j] >= NumInstrs )
+			{
+				iBad	= i;
+				Problem	= L"Bad jump target";
+			}
+			else if( !Joined[Succ[j]] )
+			{
+				// Join changes the context of the old instruction.
+				Joined[Succ[j]]	= true;
+				if( Succ[j] < iFirst )
+					Work.Push( Succ[j] );
+			}
+
+		Changed.Push( i );
+		if( Contexts[i] != VCTX_None )
+			Work.Push( i );
+	}
+
+	if( iBad == -1 && iEdge != -1 )
+	{
+		// Function call continuation.
+		Integer iNext = Instrs[iEdge].Target;
+		if( iNext < 0 || iNext >= NumInstrs )
+		{
+			iBad	= iEdge;
+			Problem	= L"Bad jump target";
+		}
+		else
+		{
+			if( !Joined[iNext] )
+			{
+				Joined[iNext]	= true;
+				Work.Push( iNext );
+			}
+			Work.Push( iEdge );
+		}
+	}
+
+	if( iBad == -1 && iEntry != -1 )
+	{
+		// Code entry point, frame always starts in 'this' context,
+		// thread is entered at labels and where it was left.
+		Joined[iEntry]	= true;
+		if( Contexts[iEntry] < VCTX_This )
+		{
+			Contexts[iEntry]	= VCTX_This;
+			if( iEntry < iFirst )
+				Changed.Push( iEntry );
+		}
+		Work.Push( iEntry );
+	}
+
+	if( iBad == -1 )
+	{
+		// Propagate context, 'this' context is set only by
+		// "this; context" pair, which isn't a join.
+		while( Work.Num() > 0 )
+		{
+			Integer	i	= Work.Pop();
+			TInstr&	I	= Instrs[i];
+			Byte	Out	= Contexts[i];
+
+			if( Out == VCTX_None )
+				continue;
+
+			if( I.Op == CODE_Context )
+			{
+				Out	=	i > 0 && !Joined[i] && Instrs[i-1].Op == CODE_This && Instrs[i-1].A == I.A ? 
+						VCTX_This : VCTX_Other;
+
+				I.Flags	&= ~IF_ThisResult;
+				if( Out == VCTX_This )
+					I.Flags	|= IF_ThisResult;
+			}
+
+			if( Successors( i, Succ ) )
+				Succ.Push( i+1 );
+
+			for( Integer j=0; j<Succ.Num(); j++ )
+				if( Contexts[Succ[j]] < Out )
+				{
+					Contexts[Succ[j]]	= Out;
+					Work.Push( Succ[j] );
+					if( Succ[j] < iFirst )
+						Changed.Push( Succ[j] );
+				}
+		}
+
+		// Operands of the new instructions, and of the old
+		// ones in the new context.
+		for( Integer i=0; i<Changed.Num() && iBad == -1; i++ )
+		{
+			Integer	iInstr	= Changed[i];
+			TInstr&	I		= Instrs[iInstr];
+
+			if( !VerifyInstr( iInstr, Contexts[iInstr], Problem ) )
+				iBad	= iInstr;
+
+			I.Flags	&= ~IF_ThisContext;
+			if( Contexts[iInstr] == VCTX_This )
+				I.Flags	|= IF_ThisContext;
+		}
+	}
+
+	if( iBad != -1 )
+	{
+		log
+		( 
+			L"Linker: %s::%s rejected by verifier at %d: %s", 
+			*Script->GetName(),
+			Bytecode == Script->Thread ? L"Thread" : *((CFunction*)Bytecode)->Name,
+			Instrs[iBad].Addr,
+			*Problem
+		);
+		NumRejected++;
+		return false;
+	}
+
+	// Mark loops of the new code.
+	for( Integer i=iFirst; i<NumInstrs; i++ )
+	{
+		TInstr& I = Instrs[i];
+		if( I.Op == CODE_Jump || I.Op == CODE_JumpZero || (I.Op >= XOP_JumpNotLess_Integer && I.Op <= XOP_JumpEqualDWord) )
+			if( Instrs[I.Target].Addr <= I.Addr )
+				I.Flags	|= IF_BackEdge;
+	}
+
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
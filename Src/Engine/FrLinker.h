@@ -0,0 +1,188 @@
+/*=============================================================================
+    FrLinker.h: Script bytecode linker.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    TInstr.
+-----------------------------------------------------------------------------*/
+
+//
+// Extended operations. They are never emitted by the
+// compiler and exist only in the linked code. Fused
+// operations replace the first instruction of the pair
+// and skip the second one.
+//
+enum EXOpCode
+{
+	XOP_Continue					= 0x100,	// Continue at Target, without loop counting.
+	XOP_LocalDWord					= 0x101,	// LocalVar + LToRDWord.
+	XOP_EntityDWord					= 0x102,	// EntityProperty + LToRDWord.
+	XOP_BaseDWord					= 0x103,	// BaseProperty + LToRDWord.
+	XOP_JumpNotLess_Integer			= 0x104,	// BIN_Less_Integer + JumpZero.
+	XOP_JumpNotLessEq_Integer		= 0x105,	// BIN_LessEq_Integer + JumpZero.
+	XOP_JumpNotGreater_Integer		= 0x106,	// BIN_Greater_Integer + JumpZero.
+	XOP_JumpNotGreaterEq_Integer	= 0x107,	// BIN_GreaterEq_Integer + JumpZero.
+	XOP_JumpNotLess_Float			= 0x108,	// BIN_Less_Float + JumpZero.
+	XOP_JumpNotLessEq_Float			= 0x109,	// BIN_LessEq_Float + JumpZero.
+	XOP_JumpNotGreater_Float		= 0x10a,	// BIN_Greater_Float + JumpZero.
+	XOP_JumpNotGreaterEq_Float		= 0x10b,	// BIN_GreaterEq_Float + JumpZero.
+	XOP_JumpNotEqualDWord			= 0x10c,	// Equal of DWord + JumpZero.
+	XOP_JumpEqualDWord				= 0x10d,	// NotEqual of DWord + JumpZero.
+	XOP_Native						= 0x10e,	// Typed native, W is the native opcode.
+	XOP_MAX
+};
+
+
+//
+// Instruction flags, set by the verifier.
+//
+enum EInstrFlags
+{
+	IF_BackEdge		= 0x0001,	// Jump to the same or earlier address, loop.
+	IF_ThisContext	= 0x0002,	// Context is proven to be 'this' entity.
+	IF_ThisResult	= 0x0004,	// Context instruction is proven to switch to 'this'.
+};
+
+
+//
+// Number of the registers operands, stored in the
+// instruction itself.
+//
+#define MAX_INSTR_REGS		4
+
+
+//
+// A pre-decoded instruction. All operands are parsed
+// once, while linking, so VM doesn't parse bytecode and
+// jumps go directly to the target instruction.
+//
+struct TInstr
+{
+public:
+	Word		Op;			// EOpCode or EXOpCode.
+	Word		Addr;		// Address of the instruction in bytecode.
+	Byte		A;			// Registers or small operands.
+	Byte		B;
+	Byte		C;
+	Byte		D;
+	Word		W;			// Offset or index operand.
+	Word		Flags;		// EInstrFlags.
+	Integer		Target;		// Target instruction, -1 if not resolved yet.
+	union
+	{
+		Integer		iValue;
+		Float		fValue;
+		DWord		dValue;
+		Byte*		Operands;	// Raw operands in the bytecode.
+		TNativeThunk	Native;	// Bound native function.
+		FResource*	Resource;
+		FScript*	Script;
+	};
+};
+
+
+/*-----------------------------------------------------------------------------
+    CLinkedCode.
+-----------------------------------------------------------------------------*/
+
+//
+// A function parameter, passed by value.
+//
+struct TCallArg
+{
+public:
+	Word		Offset;		// Offset in the callee's locals.
+	Word		Size;		// Size of value.
+};
+
+
+//
+// A linked bytecode, ready for execution. Bytecode is
+// decoded lazily from the entry points, since the length
+// of script function call depends on the callee, known
+// only while executing. Linked code is owned by the
+// bytecode and dies with it.
+//
+class CLinkedCode
+{
+public:
+	// Variables.
+	FScript*			Script;
+	CBytecode*			Bytecode;
+	TArray<TInstr>		Instrs;
+	TArray<Integer>		Map;
+
+	// Function call info. If all parameters are plain
+	// values, they are passed by block copy, without
+	// types dispatch.
+	TArray<TCallArg>	Args;
+	Bool				bPlainArgs;
+	Bool				bPlainLocals;
+
+	// Event signature, script types of the first four
+	// parameters, one byte per type. Last mismatched
+	// signature is stored to report it only once.
+	DWord				Signature;
+	DWord				BadSignature;
+
+	// Machine code of the function, compiled when it
+	// becomes hot, see FrJit.h.
+	CJitCode*			Jit;
+	Integer				NumCalls;
+	Bool				bNoJit;
+
+	// Whether all linked code passed the verifier, so
+	// it can run in lean mode, see CFrame::bLeanCode.
+	Bool				bVerified;
+
+	// CLinkedCode interface.
+	CLinkedCode( FScript* InScript, CBytecode* InBytecode );
+	~CLinkedCode();
+	Integer Resolve( Integer Addr );
+	Integer ResolveCall( Integer iCall, Integer Addr );
+
+	// Whether optimize linked code.
+	static Bool bOptimize;
+
+	// Number of functions, rejected by the verifier.
+	static Integer NumRejected;
+
+	// Static.
+	static CLinkedCode* Link( FScript* InScript, CBytecode* InBytecode );
+	static void LinkScript( FScript* InScript );
+	static void UnlinkScript( FScript* InScript );
+
+private:
+	// A jump to fix after decoding.
+	struct TFixup
+	{
+	public:
+		Integer		iInstr;
+		Integer		Addr;
+	};
+
+	// Verifier state, per instruction.
+	TArray<Byte>		Contexts;
+	TArray<Bool>		Joined;
+
+	// Internal.
+	void Decode( Integer Addr );
+	void DecodeBlock( Integer Addr, TArray<Integer>& Pending, TArray<TFixup>& Fixups );
+	void Optimize( Integer iFirst, Integer iEntry );
+	Integer ThreadJump( Integer iTarget );
+	void FindLeaders( Integer iEntry, TArray<Bool>& Leaders );
+	void HoistConstants( Integer iHeader, Integer iLast, Integer iEntry );
+	void RemoveRedundantConstants( Integer iEntry, TArray<Bool>& Removed );
+	void RemoveDeadStores( Integer iFirst, TArray<Bool>& Removed );
+	void Compact( Integer iFirst, const TArray<Bool>& Removed );
+	Bool Verify( Integer iFirst, Integer iEntry, Integer iEdge );
+	Bool VerifyInstr( Integer iInstr, Byte Context, String& Problem );
+	Bool Successors( Integer iInstr, TArray<Integer>& Succ );
+	static Integer NativeOperands( Integer iOpCode, Bool* bForeach = nullptr );
+};
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
@@ -298,12 +298,8 @@ void FLogicComponent::Render( CCanvas* Canvas )
 //
 // Induce the signal and send it from the appropriate plug.
 //
-void FLogicComponent::nativeInduceSignal( CFrame& Frame )
+void FLogicComponent::nativeInduceSignal( CFrame& Frame, FEntity* Creator, String PlugName )
 {
-	// Pop parameters.
-	FEntity*	Creator		= POP_ENTITY;
-	String		PlugName	= POP_STRING;
-
 	// Don't induce if disabled.
 	if( !bEnabled )
 		return;
@@ -440,32 +440,25 @@ void FModelComponent::InitForEntity( FEntity* InEntity )
 //
 // Get tile index at specified matrix location.
 //
-void FModelComponent::nativeGetTile( CFrame& Frame )
+Integer FModelComponent::nativeGetTile( CFrame& Frame, Integer X, Integer Y )
 {
-	Integer	X	= POP_INTEGER,
-			Y	= POP_INTEGER;
-
 	if	( 
 			X >= 0 && X < MapXSize &&
 			Y >= 0 && Y < MapYSize
 		)
 	{
-		*POPA_INTEGER	= Map[X+Y*MapXSize];
+		return Map[X+Y*MapXSize];
 	}
 	else
-		*POPA_INTEGER	= -1;
+		return -1;
 }
 
 
 //
 // Set tile index at specified location.
 //
-void FModelComponent::nativeSetTile( CFrame& Frame )
+void FModelComponent::nativeSetTile( CFrame& Frame, Integer X, Integer Y, Integer iTile )
 {
-	Integer	X		= POP_INTEGER,
-			Y		= POP_INTEGER,
-			iTile	= POP_INTEGER;
-
 	if	( 
 			X >= 0 && X < MapXSize &&
 			Y >= 0 && Y < MapYSize
@@ -479,10 +472,9 @@ void FModelComponent::nativeSetTile( CFrame& Frame )
 //
 // Convert world point to index in tile map.
 //
-void FModelComponent::nativeWorldToMap( CFrame& Frame )
+Integer FModelComponent::nativeWorldToMap( CFrame& Frame, const TVector& V )
 {
-	TVector	V	= POP_VECTOR;
-	*POPA_INTEGER	= WorldToMapIndex( V.X, V.Y );
+	return WorldToMapIndex( V.X, V.Y );
 }
 
 
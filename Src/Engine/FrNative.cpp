@@ -6,305 +6,420 @@
 #include "Engine.h"
 
 /*-----------------------------------------------------------------------------
-    CFrame implementation.
+    Native functions.
 -----------------------------------------------------------------------------*/
 
 //
-// Execute a native function.
+// Engine functions.
 //
-void CFrame::ExecuteNative( FEntity* Context, EOpCode Code )
+static void nativePlaySoundFX( CFrame& Frame, FResource* Sound, Float Gain, Float Pitch )
 {
-	CFrame& Frame = *this;
-	switch(	Code )	
+	if( Sound )
+		GApp->GAudio->PlayFX( (FSound*)Sound, Gain, Pitch );
+}
+static void nativePlayMusic( CFrame& Frame, FResource* Music, Float FadeTime )
+{
+	GApp->GAudio->PlayMusic( (FMusic*)Music, FadeTime );
+}
+static Bool nativeKeyIsPressed( CFrame& Frame, Integer iKey )
+{
+	return GApp->GInput->KeyIsPressed( iKey );
+}
+static FEntity* nativeGetCamera( CFrame& Frame )
+{
+	return Frame.This->Level->Camera->Entity;
+}
+static TVector nativeGetScreenCursor( CFrame& Frame )
+{
+	return TVector( GApp->GInput->MouseX, GApp->GInput->MouseY );
+}
+static TVector nativeGetWorldCursor( CFrame& Frame )
+{
+	return GApp->GInput->WorldCursor;
+}
+static String nativeLocalize( CFrame& Frame, const String& Section, const String& Key )
+{
+	return GApp->Config->ReadString( *Section, *Key );
+}
+static FResource* nativeGetScript( CFrame& Frame, FEntity* Entity )
+{
+	return Entity ? Entity->Script : nullptr;
+}
+static void nativeStaticPush( CFrame& Frame, const String& Key, const String& Value )
+{
+	GStaticBuffer.Put( Key, Value );
+}
+static String nativeStaticPop( CFrame& Frame, const String& Key, const String& Default )
+{
+	String* Value = GStaticBuffer.Get( Key );
+	return Value ? *Value : Default;
+}
+static void nativeTravelTo( CFrame& Frame, FResource* Res, Bool bCopy )
+{
+	FLevel* Level = As<FLevel>(Res);
+	if( Level )
 	{
-		//
-		// Engine functions.
-		//
-		case OP_PlaySoundFX:
-		{
-			FSound* S		= (FSound*)POP_RESOURCE;
-			Float	Gain	= POP_FLOAT;
-			Float	Pitch	= POP_FLOAT;
-			if( S )
-				GApp->GAudio->PlayFX( S, Gain, Pitch );
-			break;
-		}
-		case OP_PlayMusic:
-		{
-			FMusic*		M		= (FMusic*)POP_RESOURCE;
-			Float	FadeTime	= POP_FLOAT;
-			GApp->GAudio->PlayMusic( M, FadeTime );
-			break;
-		}
-		case OP_KeyIsPressed:
-		{
-			Integer iKey	= POP_INTEGER;
-			*POPA_BOOL		= GApp->GInput->KeyIsPressed(iKey);
-			break;
-		}
-		case OP_GetCamera:
-		{
-			*POPA_ENTITY	= This->Level->Camera->Entity;
-			break;
-		}
-		case OP_GetScreenCursor:
-		{
-			*POPA_VECTOR	= TVector( GApp->GInput->MouseX, GApp->GInput->MouseY );
-			break;
-		}
-		case OP_GetWorldCursor:
-		{
-			*POPA_VECTOR	= GApp->GInput->WorldCursor;
-			break;
-		}
-		case OP_Localize:
-		{
-			String	Section	= POP_STRING;
-			String	Key		= POP_STRING;
-			*POPA_STRING	= GApp->Config->ReadString( *Section, *Key );
-			break;
-		}
-		case OP_GetScript:
-		{
-			FEntity* Entity	= POP_ENTITY;
-			*POPA_RESOURCE	= Entity ? Entity->Script : nullptr;
-			break;
-		}
-		case OP_StaticPush:
-		{
-			String	Key		= POP_STRING,
-					Value	= POP_STRING;
-			GStaticBuffer.Put( Key, Value );
-			break;
-		}
-		case OP_StaticPop:
-		{
-			String	Key		= POP_STRING,
-					Default	= POP_STRING;
-			String*	Value	= GStaticBuffer.Get( Key );
-			*POPA_STRING	= Value ? *Value : Default;
-			break;
-		}
-		case OP_TravelTo:
-		{
-			FLevel*	Level	= As<FLevel>(POP_RESOURCE);
-			Bool	bCopy	= POP_BOOL;
-			if( Level )
-			{
-				GIncomingLevel.Destination	= Level;
-				GIncomingLevel.bCopy		= bCopy;
-				GIncomingLevel.Teleportee	= This;
-			}
-			else
-				ScriptError( L"An attempt to travel into nowhere." );
-			break;
-		}
-		case OP_FindEntity:
-		{
-			FObject* Obj	= GObjectDatabase->FindObject( POP_STRING, FEntity::MetaClass, This->Level );
-			*POPA_ENTITY	= As<FEntity>(Obj);
-			break;
-		}
+		GIncomingLevel.Destination	= Level;
+		GIncomingLevel.bCopy		= bCopy;
+		GIncomingLevel.Teleportee	= Frame.This;
+	}
+	else
+		Frame.ScriptError( L"An attempt to travel into nowhere." );
+}
+static FEntity* nativeFindEntity( CFrame& Frame, const String& Name )
+{
+	FObject* Obj = GObjectDatabase->FindObject( Name, FEntity::MetaClass, Frame.This->Level );
+	return As<FEntity>(Obj);
+}
 
 
-		//
-		// Math functions.
-		//
-		case OP_Abs:
-		{
-			Float A = POP_FLOAT;
-			*POPA_FLOAT = Abs( A );
-			break;
-		}
-		case OP_ArcTan:
-		{
-			Float A = POP_FLOAT;
-			*POPA_FLOAT = ArcTan( A );
-			break;
-		}
-		case OP_ArcTan2:
-		{
-			Float Y = POP_FLOAT;
-			Float X = POP_FLOAT;
-			*POPA_FLOAT = ArcTan2( Y, X );
-			break;
-		}
-		case OP_Cos:
-		{
-			Float A = POP_FLOAT;
-			*POPA_FLOAT = Cos( A );
-			break;
-		}
-		case OP_Sin:
-		{
-			Float A = POP_FLOAT;
-			*POPA_FLOAT = Sin( A );
-			break;
-		}
-		case OP_Sqrt:
-		{
-			Float A = POP_FLOAT;
-			if( A < 0.f ) ScriptError( L"Negative X in 'sqrt'" );
-			*POPA_FLOAT = Sqrt( A );
-			break;
-		}
-		case OP_Distance:
-		{
-			TVector A = POP_VECTOR;
-			TVector B = POP_VECTOR;
-			*POPA_FLOAT = Distance( A, B );
-			break;
-		}
-		case OP_Exp:
-		{
-			Float A = POP_FLOAT;
-			*POPA_FLOAT = exp( A );
-			break;
-		}
-		case OP_Ln:
-		{
-			Float A = POP_FLOAT;
-			*POPA_FLOAT = Ln( A );
-			break;
-		}
-		case OP_Frac:
-		{
-			Float A = POP_FLOAT;
-			*POPA_FLOAT = Frac( A );
-			break;
-		}
-		case OP_Round:
-		{
-			Float A = POP_FLOAT;
-			*POPA_INTEGER = Round( A );
-			break;
-		}
-		case OP_Normalize:
-		{
-			TVector A = POP_VECTOR;
-			A.Normalize();
-			*POPA_VECTOR = A;
-			break;
-		}
-		case OP_Random:
-		{
-			Integer A = POP_INTEGER;
-			*POPA_INTEGER = Random( A );
-			break;
-		}
-		case OP_RandomF:
-		{
-			*POPA_FLOAT = RandomF();
-			break;
-		}
-		case OP_VectorSize:
-		{
-			TVector A = POP_VECTOR;
-			*POPA_FLOAT = A.Size();
-			break;
-		}
-		case OP_VectorToAngle:
-		{
-			TVector A = POP_VECTOR;
-			*POPA_ANGLE = VectorToAngle(A);
-			break;
-		}
-		case OP_AngleToVector:
-		{
-			TAngle A = POP_ANGLE;
-			*POPA_VECTOR = AngleToVector(A);
-			break;
-		}
-		case OP_RGBA:
-		{
-			Byte	R	= POP_BYTE;
-			Byte	G	= POP_BYTE;
-			Byte	B	= POP_BYTE;
-			Byte	A	= POP_BYTE;
-			*POPA_COLOR	= TColor( R, G, B, A );
-			break;
-		}
-		case OP_IToS:
-		{
-			Integer i = POP_INTEGER;
-			*POPA_STRING	= String::Format( L"%i", i );
-			break;
-		}
-		case OP_CharAt:
-		{
-			String	S = POP_STRING;
-			Integer i = Clamp( POP_INTEGER, 0, S.Len()-1 );
-			Char Tmp[2] = { S[i], 0 };
-			*POPA_STRING	= String(Tmp);
-			break;
-		}
-		case OP_IndexOf:
-		{
-			String Needle	= POP_STRING;
-			String HayStack	= POP_STRING;
-			*POPA_INTEGER = String::Pos( Needle, HayStack );
-			break;
-		}
-		case OP_Execute:
-		{
-			GApp->ConsoleExecute(POP_STRING);
-			break;
-		}
-		case OP_Now:
-		{
-			*POPA_FLOAT	= GPlat->Now();
-			break;
-		}
+//
+// Math functions.
+//
+static Float nativeAbs( CFrame& Frame, Float A )
+{
+	return Abs( A );
+}
+static Float nativeArcTan( CFrame& Frame, Float A )
+{
+	return ArcTan( A );
+}
+static Float nativeArcTan2( CFrame& Frame, Float Y, Float X )
+{
+	return ArcTan2( Y, X );
+}
+static Float nativeCos( CFrame& Frame, Float A )
+{
+	return Cos( A );
+}
+static Float nativeSin( CFrame& Frame, Float A )
+{
+	return Sin( A );
+}
+static Float nativeSqrt( CFrame& Frame, Float A )
+{
+	if( A < 0.f ) Frame.ScriptError( L"Negative X in 'sqrt'" );
+	return Sqrt( A );
+}
+static Float nativeDistance( CFrame& Frame, const TVector& A, const TVector& B )
+{
+	return Distance( A, B );
+}
+static Float nativeExp( CFrame& Frame, Float A )
+{
+	return exp( A );
+}
+static Float nativeLn( CFrame& Frame, Float A )
+{
+	return Ln( A );
+}
+static Float nativeFrac( CFrame& Frame, Float A )
+{
+	return Frac( A );
+}
+static Integer nativeRound( CFrame& Frame, Float A )
+{
+	return Round( A );
+}
+static TVector nativeNormalize( CFrame& Frame, TVector A )
+{
+	A.Normalize();
+	return A;
+}
+static Integer nativeRandom( CFrame& Frame, Integer A )
+{
+	return Random( A );
+}
+static Float nativeRandomF( CFrame& Frame )
+{
+	return RandomF();
+}
+static Float nativeVectorSize( CFrame& Frame, const TVector& A )
+{
+	return A.Size();
+}
+static TAngle nativeVectorToAngle( CFrame& Frame, const TVector& A )
+{
+	return VectorToAngle( A );
+}
+static TVector nativeAngleToVector( CFrame& Frame, TAngle A )
+{
+	return AngleToVector( A );
+}
+
+
+//
+// String functions.
+//
+static String nativeIToS( CFrame& Frame, Integer i )
+{
+	return String::Format( L"%i", i );
+}
+static String nativeCharAt( CFrame& Frame, const String& S, Integer i )
+{
+	i = Clamp( i, 0, S.Len()-1 );
+	Char Tmp[2] = { S[i], 0 };
+	return String( Tmp );
+}
+static Integer nativeIndexOf( CFrame& Frame, const String& Needle, const String& HayStack )
+{
+	return String::Pos( Needle, HayStack );
+}
+static void nativeExecute( CFrame& Frame, const String& Command )
+{
+	GApp->ConsoleExecute( Command );
+}
+static Float nativeNow( CFrame& Frame )
+{
+	return GPlat->Now();
+}
+
+
+//
+// Color functions.
+//
+static TColor nativeRGBA( CFrame& Frame, Byte R, Byte G, Byte B, Byte A )
+{
+	return TColor( R, G, B, A );
+}
+
+
+/*-----------------------------------------------------------------------------
+    Typed bindings.
+-----------------------------------------------------------------------------*/
+
+//
+// A thunk generator. Operands types are deduced from the
+// native function signature, arguments are followed by
+// the result, as compiler emits them, so the thunk reads
+// registers, decoded by the linker, without bytecode parsing.
+//
+template<class F, F Fn> struct TNativeBind;
+
+#define ARG( T, i )	TNativeArg<T>::Get( Frame, Regs[i] )
 
+template<class R, R(*Fn)( CFrame& )> 
+struct TNativeBind<R(*)( CFrame& ), Fn>
+{
+	enum{ NumRegs = 1 };
+	static void Thunk( CFrame& Frame, const Byte* Regs )
+	{
+		ARG( R, 0 ) = Fn( Frame );
+	}
+};
+
+template<class R, class A1, R(*Fn)( CFrame&, A1 )> 
+struct TNativeBind<R(*)( CFrame&, A1 ), Fn>
+{
+	enum{ NumRegs = 2 };
+	static void Thunk( CFrame& Frame, const Byte* Regs )
+	{
+		ARG( R, 1 ) = Fn( Frame, ARG( A1, 0 ) );
+	}
+};
+
+template<class R, class A1, class A2, R(*Fn)( CFrame&, A1, A2 )> 
+struct TNativeBind<R(*)( CFrame&, A1, A2 ), Fn>
+{
+	enum{ NumRegs = 3 };
+	static void Thunk( CFrame& Frame, const Byte* Regs )
+	{
+		ARG( R, 2 ) = Fn( Frame, ARG( A1, 0 ), ARG( A2, 1 ) );
+	}
+};
+
+template<class R, class A1, class A2, class A3, R(*Fn)( CFrame&, A1, A2, A3 )> 
+struct TNativeBind<R(*)( CFrame&, A1, A2, A3 ), Fn>
+{
+	enum{ NumRegs = 4 };
+	static void Thunk( CFrame& Frame, const Byte* Regs )
+	{
+		ARG( R, 3 ) = Fn( Frame, ARG( A1, 0 ), ARG( A2, 1 ), ARG( A3, 2 ) );
+	}
+};
+
+template<class R, class A1, class A2, class A3, class A4, R(*Fn)( CFrame&, A1, A2, A3, A4 )> 
+struct TNativeBind<R(*)( CFrame&, A1, A2, A3, A4 ), Fn>
+{
+	enum{ NumRegs = 5 };
+	static void Thunk( CFrame& Frame, const Byte* Regs )
+	{
+		ARG( R, 4 ) = Fn( Frame, ARG( A1, 0 ), ARG( A2, 1 ), ARG( A3, 2 ), ARG( A4, 3 ) );
+	}
+};
 
+template<class A1, void(*Fn)( CFrame&, A1 )> 
+struct TNativeBind<void(*)( CFrame&, A1 ), Fn>
+{
+	enum{ NumRegs = 1 };
+	static void Thunk( CFrame& Frame, const Byte* Regs )
+	{
+		Fn( Frame, ARG( A1, 0 ) );
+	}
+};
+
+template<class A1, class A2, void(*Fn)( CFrame&, A1, A2 )> 
+struct TNativeBind<void(*)( CFrame&, A1, A2 ), Fn>
+{
+	enum{ NumRegs = 2 };
+	static void Thunk( CFrame& Frame, const Byte* Regs )
+	{
+		Fn( Frame, ARG( A1, 0 ), ARG( A2, 1 ) );
+	}
+};
+
+template<class A1, class A2, class A3, void(*Fn)( CFrame&, A1, A2, A3 )> 
+struct TNativeBind<void(*)( CFrame&, A1, A2, A3 ), Fn>
+{
+	enum{ NumRegs = 3 };
+	static void Thunk( CFrame& Frame, const Byte* Regs )
+	{
+		Fn( Frame, ARG( A1, 0 ), ARG( A2, 1 ), ARG( A3, 2 ) );
+	}
+};
+
+#undef ARG
+
+
+//
+// A bound native function.
+//
+struct TNativeBinding
+{
+public:
+	Integer			iOpCode;
+	TNativeThunk	Thunk;
+	Integer			NumRegs;
+};
+
+
+//
+// List of bound natives. Signature of the function
+// should match its DECLARE_FUNCTION in FrScript.cpp.
+//
+#define BIND_NATIVE( op, fn ) { op, &TNativeBind<decltype(&fn), &fn>::Thunk, TNativeBind<decltype(&fn), &fn>::NumRegs }
+
+static const TNativeBinding GNativeBindings[] =
+{
+	BIND_NATIVE( OP_PlaySoundFX,		nativePlaySoundFX ),
+	BIND_NATIVE( OP_PlayMusic,			nativePlayMusic ),
+	BIND_NATIVE( OP_KeyIsPressed,		nativeKeyIsPressed ),
+	BIND_NATIVE( OP_GetCamera,			nativeGetCamera ),
+	BIND_NATIVE( OP_GetScreenCursor,	nativeGetScreenCursor ),
+	BIND_NATIVE( OP_GetWorldCursor,		nativeGetWorldCursor ),
+	BIND_NATIVE( OP_Localize,			nativeLocalize ),
+	BIND_NATIVE( OP_GetScript,			nativeGetScript ),
+	BIND_NATIVE( OP_StaticPush,			nativeStaticPush ),
+	BIND_NATIVE( OP_StaticPop,			nativeStaticPop ),
+	BIND_NATIVE( OP_TravelTo,			nativeTravelTo ),
+	BIND_NATIVE( OP_FindEntity,			nativeFindEntity ),
+	BIND_NATIVE( OP_Abs,				nativeAbs ),
+	BIND_NATIVE( OP_ArcTan,				nativeArcTan ),
+	BIND_NATIVE( OP_ArcTan2,			nativeArcTan2 ),
+	BIND_NATIVE( OP_Cos,				nativeCos ),
+	BIND_NATIVE( OP_Sin,				nativeSin ),
+	BIND_NATIVE( OP_Sqrt,				nativeSqrt ),
+	BIND_NATIVE( OP_Distance,			nativeDistance ),
+	BIND_NATIVE( OP_Exp,				nativeExp ),
+	BIND_NATIVE( OP_Ln,					nativeLn ),
+	BIND_NATIVE( OP_Frac,				nativeFrac ),
+	BIND_NATIVE( OP_Round,				nativeRound ),
+	BIND_NATIVE( OP_Normalize,			nativeNormalize ),
+	BIND_NATIVE( OP_Random,				nativeRandom ),
+	BIND_NATIVE( OP_RandomF,			nativeRandomF ),
+	BIND_NATIVE( OP_VectorSize,			nativeVectorSize ),
+	BIND_NATIVE( OP_VectorToAngle,		nativeVectorToAngle ),
+	BIND_NATIVE( OP_AngleToVector,		nativeAngleToVector ),
+	BIND_NATIVE( OP_IToS,				nativeIToS ),
+	BIND_NATIVE( OP_CharAt,				nativeCharAt ),
+	BIND_NATIVE( OP_IndexOf,			nativeIndexOf ),
+	BIND_NATIVE( OP_Execute,			nativeExecute ),
+	BIND_NATIVE( OP_Now,				nativeNow ),
+	BIND_NATIVE( OP_RGBA,				nativeRGBA ),
+};
+
+#undef BIND_NATIVE
+
+
+//
+// Return the typed native function of the opcode, or
+// nullptr, if native is not bound, and executed by the
+// switch in ExecuteNative.
+//
+TNativeThunk CFrame::FindNative( Integer iOpCode, Integer& NumRegs )
+{
+	static const TNativeBinding*	Table[256];
+	static Bool						bInitialized = false;
+
+	if( !bInitialized )
+	{
+		for( Integer i=0; i<256; i++ )
+			Table[i]	= nullptr;
+		for( Integer i=0; i<array_length(GNativeBindings); i++ )
+			Table[GNativeBindings[i].iOpCode]	= &GNativeBindings[i];
+		bInitialized	= true;
+	}
+
+	const TNativeBinding* Binding = iOpCode >= 0 && iOpCode < 256 ? Table[iOpCode] : nullptr;
+	NumRegs	= Binding ? Binding->NumRegs : 0;
+	return Binding ? Binding->Thunk : nullptr;
+}
+
+
+/*-----------------------------------------------------------------------------
+    CFrame implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Execute a native function, which is not bound.
+//
+void CFrame::ExecuteNative( FEntity* Context, EOpCode Code )
+{
+	CFrame& Frame = *this;
+	switch(	Code )	
+	{
 		//
-		// Iterators.
+		// Iterators. They are called once per foreach, so
+		// they aren't bound, since operands are followed by
+		// the iterator offset.
 		//
 		case IT_AllEntities:
 		{
-			FScript*	Script	= As<FScript>(POP_RESOURCE);
-			FLevel*		Level	= This->Level;
-			Foreach.Collection.Empty();
-			if( Script )
-			{
-				for( Integer i=0; i<Level->Entities.Num(); i++ )
-					if( Level->Entities[i]->Script == Script && !Level->Entities[i]->Base->bDestroyed )
-						Foreach.Collection.Push(Level->Entities[i]);
-			}
-			else
-			{
-				for( Integer i=0; i<Level->Entities.Num(); i++ )
-					if( !Level->Entities[i]->Base->bDestroyed )
-						Foreach.Collection.Push(Level->Entities[i]);
-			}
+			FScript*	Script	= As<FScript>(TNativeArg<FResource*>::Get( Frame, ReadByte() ));
+			TIterator*	Iter	= (TIterator*)&Locals[ReadWord()];
+			Iter->Type		= IT_AllEntities;
+			Iter->Level		= This->Level;
+			Iter->Script	= Script;
+			Iter->i			= 0;
 			break;
 		}
 		case IT_RectEntities:
 		{
-			FScript*		Script		= As<FScript>(POP_RESOURCE);
-			TRect			Area		= POP_AABB;
-			FLevel*			Level		= This->Level;
-			Integer			NumBases	= 0;
-			FBaseComponent*	Bases[MAX_COLL_LIST_OBJS];
-			Foreach.Collection.Empty();		
-			if( Script )
-				Level->CollHash->GetOverlappedByScript( Area, Script, NumBases, Bases );
-			else
-				Level->CollHash->GetOverlapped( Area, NumBases, Bases );
-			for( Integer i=0; i<NumBases; i++ )
-				Foreach.Collection.Push(Bases[i]->Entity);
+			FScript*	Script	= As<FScript>(TNativeArg<FResource*>::Get( Frame, ReadByte() ));
+			TRect		Area	= TNativeArg<TRect>::Get( Frame, ReadByte() );
+			TIterator*	Iter	= (TIterator*)&Locals[ReadWord()];
+			Iter->Type			= IT_RectEntities;
+			Iter->Level			= This->Level;
+			Iter->Script		= Script;
+			Iter->Bounds		= Area;
+			Iter->X				= -1;
+			Iter->Y				= -1;
+			Iter->i				= -1;
+			Iter->Mem			= &Stack->LocalsMem;
+			Iter->MemBase		= nullptr;
+			Iter->ModCount		= This->Level->CollHash->ModCount;
+			Iter->Walked		= nullptr;
+			Iter->Snapshot		= nullptr;
+			Iter->NumSnapshot	= 0;
 			break;
 		}
 		case IT_TouchedEntities:
 		{
-			Foreach.Collection.Empty();
-			if( This->Base->IsA(FPhysicComponent::MetaClass) )
-			{
-				FPhysicComponent* Phys = (FPhysicComponent*)This->Base;
-				for( Integer i=0; i<array_length(FPhysicComponent::Touched); i++ )
-					if( Phys->Touched[i] )
-						Foreach.Collection.Push(Phys->Touched[i]);
-			}
+			TIterator*	Iter	= (TIterator*)&Locals[ReadWord()];
+			Iter->Type		= This->Base->IsA(FPhysicComponent::MetaClass) ? IT_TouchedEntities : 0;
+			Iter->Level		= This->Level;
+			Iter->Phys		= (FPhysicComponent*)This->Base;
+			Iter->i			= 0;
 			break;
 		}
 
@@ -402,23 +517,30 @@ void CFrame::ExecuteNative( FEntity* Context, EOpCode Code )
 		case BIN_AddEqual_String:
 		{
 			Byte iReg = ReadByte();
-			*(String*)Regs[iReg].Addr += Regs[iReg].StrValue;
+			*(String*)Regs[iReg].Addr += StrReg(ReadByte());
 			break;
 		}
 		case BIN_Add_String:
 		{
 			Byte iReg=ReadByte();
-			Regs[iReg].StrValue += Regs[ReadByte()].StrValue;
+			StrReg(iReg) += StrReg(ReadByte());
 			break;
 		}
 
 		//
-		// Invalid opcode.
+		// Typed natives.
 		//
 		default:
 		{
-			// Bad instruction.
-			ScriptError( L"Unknown instruction '%i'", Code );
+			// Operands are read straight from the bytecode.
+			Integer			NumRegs;
+			TNativeThunk	Thunk	= FindNative( Code, NumRegs );
+			if( !Thunk )
+				ScriptError( L"Unknown instruction '%i'", Code );
+
+			const Byte* Operands = this->Code;
+			this->Code	+= NumRegs;
+			Thunk( Frame, Operands );
 			break;
 		}
 	}
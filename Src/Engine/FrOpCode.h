@@ -15,6 +15,8 @@ enum EOpCode
 	CODE_Jump				= 0x01,
 	CODE_JumpZero			= 0x02,
 	CODE_Switch				= 0x03,
+	CODE_SwitchTable		= 0x3f,
+	CODE_SwitchSearch		= 0x81,
 	CODE_Foreach			= 0x3d,
 
 	// Constants.
@@ -98,7 +100,6 @@ enum EOpCode
 	CAST_IntegerToByte		= 0x36,
 	CAST_IntegerToAngle		= 0x37,
 	CAST_AngleToInteger		= 0x38,
-	// Available op-codes: 0x3f-0x3f.
 
 	// Unary operators.
 	UN_Inc_Integer			= 0x40,
@@ -168,7 +169,7 @@ enum EOpCode
 	BIN_AndEqual_Integer	= 0x7e,
 	BIN_XorEqual_Integer	= 0x7f,
 	BIN_OrEqual_Integer		= 0x80,
-	// Available op-codes: 0x81-0x8f.
+	// Available op-codes: 0x82-0x8f.
 
 	// Native core functions.
 	OP_Abs					= 0x90,
@@ -216,6 +217,21 @@ enum EOpCode
 };
 
 
+//
+// Switch statements have the same header: label size,
+// expression register, default address and table address.
+// Tables are:
+//	CODE_Switch:		Byte Num, { Label, Word Addr }[Num].
+//	CODE_SwitchTable:	Integer Min, Word Num, Word Addr[Num], 
+//						missing labels go to default.
+//	CODE_SwitchSearch:	Word Num, { Integer Label, Word Addr }[Num],
+//						sorted by label.
+//
+#define SWITCH_MIN_TABLE		4		// Minimum labels for jump table.
+#define SWITCH_MIN_SEARCH		8		// Minimum labels for binary search.
+#define SWITCH_MAX_DENSITY		2		// Maximum range per label in jump table.
+
+
 /*-----------------------------------------------------------------------------
     The End.
 -----------------------------------------------------------------------------*/
\ No newline at end of file
@@ -0,0 +1,646 @@
+/*=============================================================================
+    FrPhysBench.cpp: Physics benchmark scenes.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+#include "Engine.h"
+
+/*-----------------------------------------------------------------------------
+    CPhysicsBench implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Benchmark magic numbers.
+//
+#define BENCH_ORIGIN		TVector( 0.f, 1024.f )	// Arena location, far from level.
+#define BENCH_SETTLE		240						// Frames to settle pile.
+#define BENCH_CHAIN			16						// Links per chain.
+#define BENCH_RIDERS		3						// Riders per mover.
+#define BENCH_WALK_SPEED	8.f						// Walkers speed.
+#define BENCH_BULLET_SPEED	600.f					// Bullets speed.
+#define BENCH_BULLET_RANGE	32.f					// Distance to the wall.
+#define BENCH_BULLET_ROWS	32						// Bullets per column.
+#define BENCH_WALL_THICK	0.25f					// Thin wall thickness.
+#define BENCH_STACK			20						// Boxes in the stack.
+#define BENCH_STACK_SPEED	0.05f					// Stack box is resting below it.
+#define BENCH_OLD_SUBSTEPS	3						// Substeps of the old per-pair solver.
+
+
+//
+// Standard scene sizes.
+//
+const Integer GPhysBenchSizes[PBENCH_NUM_SIZES] =
+{
+	1000,
+	5000,
+	10000
+};
+
+
+//
+// Scenes names, used in reports.
+//
+static const Char* GSceneNames[PBENCH_MAX] =
+{
+	L"SettledPile",
+	L"FallingPile",
+	L"Walkers",
+	L"SpringChains",
+	L"Movers",
+	L"Bullets",
+	L"BoxStack",
+	L"BoxStackSubsteps"
+};
+
+
+//
+// Benchmark constructor.
+//
+CPhysicsBench::CPhysicsBench( FLevel* InLevel )
+	:	Level( InLevel ),
+		Scene( PBENCH_SettledPile ),
+		NumObjects( 0 ),
+		Time( 0.f ),
+		Walkers(),
+		WalkDirs(),
+		Movers(),
+		MoverOrigins(),
+		Bullets(),
+		WallX( 0.f ),
+		Stack(),
+		StackOrigins(),
+		OldSubsteps( CPhysicsScene::NumSubsteps ),
+		OldIterations( CPhysicsScene::NumIterations )
+{
+	assert(InLevel);
+}
+
+
+//
+// Benchmark destructor, restore solver settings.
+//
+CPhysicsBench::~CPhysicsBench()
+{
+	CPhysicsScene::NumSubsteps		= OldSubsteps;
+	CPhysicsScene::NumIterations	= OldIterations;
+}
+
+
+//
+// Return a name of the scene.
+//
+const Char* CPhysicsBench::GetSceneName( EPhysBench Scene )
+{
+	return GSceneNames[Scene];
+}
+
+
+//
+// Whether scene has a fixed number of objects.
+//
+Bool CPhysicsBench::IsFixedScene( EPhysBench Scene )
+{
+	return Scene == PBENCH_BoxStack || Scene == PBENCH_BoxStackSubsteps;
+}
+
+
+//
+// Build a scene in the level. Return false, if project
+// has no scripts to build this scene.
+//
+Bool CPhysicsBench::Setup( EPhysBench InScene, Integer InNumObjects )
+{
+	Scene		= InScene;
+	NumObjects	= Max( InNumObjects, 1 );
+	Time		= 0.f;
+
+	switch( Scene )
+	{
+		case PBENCH_SettledPile:	return SetupPile( false );
+		case PBENCH_FallingPile:	return SetupPile( true );
+		case PBENCH_Walkers:		return SetupWalkers();
+		case PBENCH_SpringChains:	return SetupChains();
+		case PBENCH_Movers:			return SetupMovers();
+		case PBENCH_Bullets:		return SetupBullets();
+		case PBENCH_BoxStack:		return SetupStack( false );
+		case PBENCH_BoxStackSubsteps:	return SetupStack( true );
+		default:					return false;
+	}
+}
+
+
+//
+// Tick the level and collect timings. Bodies are hashed
+// after each frame, out of timings, so runs with different
+// number of threads can be compared.
+//
+void CPhysicsBench::Run( Integer NumFrames, Float Delta, TPhysBenchResult& Result )
+{
+	CPhysicsScene* Phys = Level->PhysScene;
+	NumFrames	= Max( NumFrames, 1 );
+
+	// Let the pile fall asleep.
+	if( Scene == PBENCH_SettledPile )
+		for( Integer i=0; i<BENCH_SETTLE; i++ )
+		{
+			Drive( Delta );
+			Level->Tick( Delta );
+		}
+
+	Double	TotalTime	= 0.0,
+			MaxTime		= 0.0,
+			BroadTime	= 0.0,
+			NarrowTime	= 0.0,
+			SolveTime	= 0.0,
+			EventsTime	= 0.0;
+	Integer	NumSwept	= 0,
+			NumHits		= 0,
+			SettleFrame	= 0;
+	DWord	TraceHash	= 2166136261;
+
+	for( Integer iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		Drive( Delta );
+
+		Double	Start	= GPlat->TimeStamp();
+		Level->Tick( Delta );
+		Double	Frame	= GPlat->TimeStamp() - Start;
+
+		TotalTime	+= Frame;
+		MaxTime		= Max( MaxTime, Frame );
+		BroadTime	+= Phys->StatBuildTime;
+		NarrowTime	+= Phys->StatNarrowTime;
+		SolveTime	+= Max( Phys->StatSolveTime - Phys->StatNarrowTime, 0.0 );
+		EventsTime	+= Phys->StatDispatchTime;
+		NumSwept	+= Phys->StatSwept;
+		NumHits		+= Phys->StatSweepHits;
+		TraceHash	= CPhysicsReplay::HashBodies( Level, TraceHash );
+
+		if( IsStackMoving() )
+			SettleFrame	= iFrame + 1;
+	}
+
+	// Stack drift from the spawn locations.
+	Float Drift	= 0.f;
+	for( Integer i=0; i<Stack.Num(); i++ )
+	{
+		Drift	= Max( Drift, (Stack[i]->Base->Location - StackOrigins[i]).Size() );
+	}
+
+	// Count bullets, which are behind the wall.
+	Integer NumTunneled	= 0;
+	for( Integer i=0; i<Bullets.Num(); i++ )
+		if( Bullets[i]->Base->Location.X > WallX )
+			NumTunneled++;
+
+	Result.Scene		= Scene;
+	Result.bSkipped		= false;
+	Result.NumObjects	= NumObjects;
+	Result.NumFrames	= NumFrames;
+	Result.NumThreads	= CPhysicsScene::bParallel ? GPlat->NumWorkers() : 1;
+	Result.TraceHash	= TraceHash;
+	Result.bMatchSerial	= true;
+	Result.FPS			= NumFrames / Max( TotalTime, 1e-9 );
+	Result.FrameTime	= TotalTime * 1000.0 / NumFrames;
+	Result.MaxFrameTime	= MaxTime * 1000.0;
+	Result.BroadTime	= BroadTime * 1000.0 / NumFrames;
+	Result.NarrowTime	= NarrowTime * 1000.0 / NumFrames;
+	Result.SolveTime	= SolveTime * 1000.0 / NumFrames;
+	Result.EventsTime	= EventsTime * 1000.0 / NumFrames;
+	Result.OtherTime	= Max( Result.FrameTime - Result.BroadTime - Result.NarrowTime - Result.SolveTime - Result.EventsTime, 0.0 );
+	Result.PeakMemory	= GPlat->PeakMemory();
+	Result.NumAwake		= Phys->StatBodies;
+	Result.NumAsleep	= Phys->StatSleeping;
+	Result.NumSwept		= NumSwept;
+	Result.NumSweepHits	= NumHits;
+	Result.NumTunneled	= NumTunneled;
+	Result.SettleFrame	= SettleFrame < NumFrames ? SettleFrame : -1;
+	Result.Drift		= Drift;
+}
+
+
+//
+// Convert result to the single line JSON object.
+//
+String CPhysicsBench::ToJSON( const TPhysBenchResult& Result )
+{
+	if( Result.bSkipped )
+		return String::Format
+		(
+			L"{ \"scene\": \"%s\", \"skipped\": true }",
+			GetSceneName(Result.Scene)
+		);
+
+	return String::Format
+	(
+		L"{ \"scene\": \"%s\", \"objects\": %d, \"frames\": %d, \"threads\": %d, "
+		L"\"trace_hash\": \"%08x\", \"match_serial\": %s, \"fps\": %.2f, "
+		L"\"frame_ms\": %.4f, \"max_frame_ms\": %.4f, \"broadphase_ms\": %.4f, "
+		L"\"narrowphase_ms\": %.4f, \"solve_ms\": %.4f, \"events_ms\": %.4f, "
+		L"\"other_ms\": %.4f, \"peak_memory_kb\": %u, "
+		L"\"awake\": %d, \"asleep\": %d, \"swept\": %d, \"sweep_hits\": %d%s }",
+		GetSceneName(Result.Scene),
+		Result.NumObjects,
+		Result.NumFrames,
+		Result.NumThreads,
+		Result.TraceHash,
+		Result.bMatchSerial ? L"true" : L"false",
+		Result.FPS,
+		Result.FrameTime,
+		Result.MaxFrameTime,
+		Result.BroadTime,
+		Result.NarrowTime,
+		Result.SolveTime,
+		Result.EventsTime,
+		Result.OtherTime,
+		Result.PeakMemory,
+		Result.NumAwake,
+		Result.NumAsleep,
+		Result.NumSwept,
+		Result.NumSweepHits,
+		Result.Scene == PBENCH_Bullets ? *String::Format( L", \"tunneled\": %d", Result.NumTunneled ) :
+		IsFixedScene(Result.Scene) ? *String::Format( L", \"settle_frame\": %d, \"drift\": %.4f", Result.SettleFrame, Result.Drift ) : L""
+	);
+}
+
+
+//
+// Find a project's script with base component
+// of the given class.
+//
+FScript* CPhysicsBench::FindScript( CClass* BaseClass )
+{
+	for( Integer i=0; i<GObjectDatabase->GObjects.Num(); i++ )
+	{
+		FScript* Script = As<FScript>(GObjectDatabase->GObjects[i]);
+
+		if( Script && Script->Base && Script->Base->IsA(BaseClass) )
+			return Script;
+	}
+	return nullptr;
+}
+
+
+//
+// Spawn a solid brush box.
+//
+FEntity* CPhysicsBench::SpawnBrush( const TVector& Min, const TVector& Max )
+{
+	FScript* Script = FindScript( FBrushComponent::MetaClass );
+	if( !Script )
+		return nullptr;
+
+	FEntity*			Entity	= Level->CreateEntity( Script, L"", (Min + Max) * 0.5f );
+	FBrushComponent*	Brush	= (FBrushComponent*)Entity->Base;
+	TVector				Half	= (Max - Min) * 0.5f;
+
+	// Brush is already hashed.
+	if( Brush->IsHashed() )
+		Level->CollHash->RemoveFromHash( Brush );
+	{
+		Brush->Type			= BRUSH_Solid;
+		Brush->NumVerts		= 4;
+		Brush->Vertices[0]	= TVector( -Half.X, -Half.Y );
+		Brush->Vertices[1]	= TVector( -Half.X, +Half.Y );
+		Brush->Vertices[2]	= TVector( +Half.X, +Half.Y );
+		Brush->Vertices[3]	= TVector( +Half.X, -Half.Y );
+	}
+	if( Brush->bHashable )
+		Level->CollHash->AddToHash( Brush );
+
+	return Entity;
+}
+
+
+//
+// Spawn an object in the arena.
+//
+FEntity* CPhysicsBench::SpawnObject( FScript* Script, const TVector& Location )
+{
+	return Level->CreateEntity( Script, L"", BENCH_ORIGIN + Location );
+}
+
+
+//
+// Build the arena: floor and two walls.
+//
+void CPhysicsBench::SetupArena( Float HalfWidth, Float Height )
+{
+	TVector Origin	= BENCH_ORIGIN;
+
+	SpawnBrush( Origin + TVector( -HalfWidth-4.f, -4.f ), Origin + TVector( HalfWidth+4.f, 0.f ) );
+	SpawnBrush( Origin + TVector( -HalfWidth-4.f, 0.f ), Origin + TVector( -HalfWidth, Height ) );
+	SpawnBrush( Origin + TVector( HalfWidth, 0.f ), Origin + TVector( HalfWidth+4.f, Height ) );
+}
+
+
+//
+// Build a pile of rigid bodies in columns. Falling pile
+// is spawned with a gap, so bodies collide in flight.
+//
+Bool CPhysicsBench::SetupPile( Bool bFalling )
+{
+	FScript* Script = FindScript( FRigidBodyComponent::MetaClass );
+	if( !Script || !FindScript( FBrushComponent::MetaClass ) )
+		return false;
+
+	TVector	Size	= Script->Base->Size;
+	Integer	NumCols	= Max( Floor(Sqrt((Float)NumObjects)), 1 );
+	Integer	NumRows	= (NumObjects + NumCols - 1) / NumCols;
+	TVector	Space	= TVector( Size.X * 1.05f, Size.Y * (bFalling ? 2.f : 1.01f) );
+	Float	Half	= NumCols * Space.X * 0.5f;
+
+	SetupArena( Half + Size.X, NumRows * Space.Y + Size.Y );
+
+	for( Integer i=0; i<NumObjects; i++ )
+	{
+		TVector Location	= TVector
+		(
+			-Half + ((i % NumCols) + 0.5f) * Space.X,
+			((i / NumCols) + 0.5f) * Space.Y + (bFalling ? 8.f : 0.f)
+		);
+
+		// Falling bodies are shuffled a little.
+		if( bFalling )
+			Location.X	+= RandomRange( -0.2f, +0.2f ) * Size.X;
+
+		SpawnObject( Script, Location );
+	}
+
+	return true;
+}
+
+
+//
+// Build a row of arcade walkers.
+//
+Bool CPhysicsBench::SetupWalkers()
+{
+	FScript* Script = FindScript( FArcadeBodyComponent::MetaClass );
+	if( !Script || !FindScript( FBrushComponent::MetaClass ) )
+		return false;
+
+	TVector	Size	= Script->Base->Size;
+	Float	Space	= Size.X * 2.f;
+	Float	Half	= NumObjects * Space * 0.5f;
+
+	SetupArena( Half + Size.X, Size.Y * 4.f );
+
+	for( Integer i=0; i<NumObjects; i++ )
+	{
+		Walkers.Push( SpawnObject( Script, TVector( -Half + (i + 0.5f) * Space, Size.Y * 0.5f ) ) );
+		WalkDirs.Push( Random(2) ? 1.f : -1.f );
+	}
+
+	return true;
+}
+
+
+//
+// Build chains of rigid bodies, hanged on the brush
+// by springs or hinges, which project has.
+//
+Bool CPhysicsBench::SetupChains()
+{
+	FScript* Link	= FindScript( FRigidBodyComponent::MetaClass );
+	FScript* Joint	= FindScript( FSpringComponent::MetaClass );
+	if( !Joint )
+		Joint	= FindScript( FHingeComponent::MetaClass );
+
+	if( !Link || !Joint || !FindScript( FBrushComponent::MetaClass ) )
+		return false;
+
+	Bool	bHinge		= Joint->Base->IsA(FHingeComponent::MetaClass);
+	TVector	Size		= Link->Base->Size;
+	Float	Space		= Size.X * 1.5f;
+	Float	Height		= BENCH_CHAIN * Space * 1.5f;
+	Integer	NumChains	= Max( NumObjects / BENCH_CHAIN, 1 );
+	Float	Width		= BENCH_CHAIN * Space;
+	Float	Half		= NumChains * Width * 0.5f;
+
+	SetupArena( Half + Width, Height + 8.f );
+
+	for( Integer iChain=0; iChain<NumChains; iChain++ )
+	{
+		// Hang chain on the small brush.
+		TVector		Anchor	= TVector( -Half + iChain * Width, Height );
+		FEntity*	Prev	= SpawnBrush
+		(
+			BENCH_ORIGIN + Anchor - TVector( 1.f, 1.f ),
+			BENCH_ORIGIN + Anchor + TVector( 1.f, 1.f )
+		);
+
+		for( Integer i=0; i<BENCH_CHAIN; i++ )
+		{
+			TVector		Location	= Anchor + TVector( (i + 1) * Space, 0.f );
+			FEntity*	Next		= SpawnObject( Link, Location );
+			FEntity*	Entity		= SpawnObject( Joint, Location - TVector( Space * 0.5f, 0.f ) );
+
+			FJointComponent* Comp	= (FJointComponent*)Entity->Base;
+			Comp->Body1	= Prev;
+			Comp->Body2	= Next;
+
+			if( bHinge )
+			{
+				Comp->Hook1	= TVector( i == 0 ? 0.f : Space * 0.5f, 0.f );
+				Comp->Hook2	= TVector( i == 0 ? -Space : -Space * 0.5f, 0.f );
+			}
+			else
+			{
+				FSpringComponent* Spring	= (FSpringComponent*)Comp;
+				Comp->Hook1		= TVector( 0.f, 0.f );
+				Comp->Hook2		= TVector( 0.f, 0.f );
+				Spring->Length	= Space;
+			}
+
+			Prev	= Next;
+		}
+	}
+
+	return true;
+}
+
+
+//
+// Build moving platforms with riders on them.
+//
+Bool CPhysicsBench::SetupMovers()
+{
+	FScript* Mover	= FindScript( FMoverComponent::MetaClass );
+	FScript* Rider	= FindScript( FArcadeBodyComponent::MetaClass );
+	if( !Rider )
+		Rider	= FindScript( FRigidBodyComponent::MetaClass );
+
+	if( !Mover || !Rider || !FindScript( FBrushComponent::MetaClass ) )
+		return false;
+
+	TVector	Size		= Mover->Base->Size;
+	TVector	RiderSize	= Rider->Base->Size;
+	Integer	NumMovers	= Max( NumObjects / (BENCH_RIDERS + 1), 1 );
+	Float	Space		= Size.X * 3.f;
+	Float	Half		= NumMovers * Space * 0.5f;
+
+	SetupArena( Half + Space, Size.Y * 8.f + RiderSize.Y * 4.f );
+
+	for( Integer i=0; i<NumMovers; i++ )
+	{
+		TVector Location	= TVector( -Half + (i + 0.5f) * Space, Size.Y * 4.f );
+
+		Movers.Push( SpawnObject( Mover, Location ) );
+		MoverOrigins.Push( BENCH_ORIGIN + Location );
+
+		for( Integer j=0; j<BENCH_RIDERS; j++ )
+			SpawnObject
+			(
+				Rider,
+				Location + TVector
+				(
+					(j - (BENCH_RIDERS-1) * 0.5f) * Size.X / BENCH_RIDERS,
+					(Size.Y + RiderSize.Y) * 0.5f + 0.1f
+				)
+			);
+	}
+
+	return true;
+}
+
+
+//
+// Build columns of bullets in front of the thin wall,
+// bullets are fired in the first frame. Each frame bullet
+// moves far beyond the wall thickness, so only sweep
+// keeps it from passing through.
+//
+Bool CPhysicsBench::SetupBullets()
+{
+	FScript* Script = FindScript( FRigidBodyComponent::MetaClass );
+	if( !Script || !FindScript( FBrushComponent::MetaClass ) )
+		return false;
+
+	TVector	Size	= Script->Base->Size;
+	Integer	NumRows	= Min( NumObjects, BENCH_BULLET_ROWS );
+	Integer	NumCols	= (NumObjects + NumRows - 1) / NumRows;
+	TVector	Space	= TVector( Size.X * 2.f, Size.Y * 1.5f );
+	Float	Height	= NumRows * Space.Y + Size.Y;
+	Float	Half	= BENCH_BULLET_RANGE + NumCols * Space.X;
+
+	SetupArena( Half, Height );
+	SpawnBrush
+	( 
+		BENCH_ORIGIN + TVector( 0.f, 0.f ), 
+		BENCH_ORIGIN + TVector( BENCH_WALL_THICK, Height ) 
+	);
+	WallX	= BENCH_ORIGIN.X + BENCH_WALL_THICK;
+
+	for( Integer i=0; i<NumObjects; i++ )
+	{
+		FEntity* Bullet	= SpawnObject
+		(
+			Script,
+			TVector
+			(
+				-BENCH_BULLET_RANGE - ((i / NumRows) + 0.5f) * Space.X,
+				((i % NumRows) + 0.5f) * Space.Y
+			)
+		);
+
+		((FRigidBodyComponent*)Bullet->Base)->bBullet	= true;
+		Bullets.Push( Bullet );
+	}
+
+	return true;
+}
+
+
+//
+// Build a single column of boxes, resting on the floor.
+// Substeps variant is solved the way it was before the
+// iterative solver: a few substeps, single iteration each.
+//
+Bool CPhysicsBench::SetupStack( Bool bSubsteps )
+{
+	FScript* Script = FindScript( FRigidBodyComponent::MetaClass );
+	if( !Script || !FindScript( FBrushComponent::MetaClass ) )
+		return false;
+
+	TVector	Size	= Script->Base->Size;
+	NumObjects		= BENCH_STACK;
+
+	SetupArena( Size.X * 4.f, BENCH_STACK * Size.Y * 1.01f + Size.Y );
+
+	for( Integer i=0; i<BENCH_STACK; i++ )
+	{
+		TVector Location	= TVector( 0.f, (i + 0.5f) * Size.Y * 1.01f );
+
+		Stack.Push( SpawnObject( Script, Location ) );
+		StackOrigins.Push( BENCH_ORIGIN + Location );
+	}
+
+	if( bSubsteps )
+	{
+		CPhysicsScene::NumSubsteps		= BENCH_OLD_SUBSTEPS;
+		CPhysicsScene::NumIterations	= 1;
+	}
+
+	return true;
+}
+
+
+//
+// Whether any box of the stack is still moving.
+//
+Bool CPhysicsBench::IsStackMoving()
+{
+	for( Integer i=0; i<Stack.Num(); i++ )
+	{
+		FRigidBodyComponent* Body = (FRigidBodyComponent*)Stack[i]->Base;
+
+		if( !Body->bSleeping && ( Body->Velocity.SizeSquared() > Sqr(BENCH_STACK_SPEED) || Abs(Body->AngVelocity) > BENCH_STACK_SPEED ) )
+			return true;
+	}
+	return false;
+}
+
+
+//
+// Drive scene objects before the level tick.
+//
+void CPhysicsBench::Drive( Float Delta )
+{
+	Time	+= Delta;
+
+	// Fire bullets.
+	if( Time <= Delta )
+		for( Integer i=0; i<Bullets.Num(); i++ )
+			((FPhysicComponent*)Bullets[i]->Base)->Velocity	= TVector( BENCH_BULLET_SPEED, 0.f );
+
+	// Walkers turn around, when they are blocked.
+	for( Integer i=0; i<Walkers.Num(); i++ )
+	{
+		FPhysicComponent* Body = (FPhysicComponent*)Walkers[i]->Base;
+
+		if( Body->Velocity.X * WalkDirs[i] <= 0.f && Time > Delta )
+			WalkDirs[i]	= -WalkDirs[i];
+
+		Body->Velocity.X	= WalkDirs[i] * BENCH_WALK_SPEED;
+	}
+
+	// Movers swing, mover carries riders itself.
+	for( Integer i=0; i<Movers.Num(); i++ )
+	{
+		FBaseComponent* Base = Movers[i]->Base;
+
+		if( Base->IsHashed() )
+			Level->CollHash->RemoveFromHash( Base );
+		{
+			Base->Location	= MoverOrigins[i] + TVector( Sin( Time * 1.5f + i ) * Base->Size.X, 0.f );
+		}
+		if( Base->bHashable )
+			Level->CollHash->AddToHash( Base );
+	}
+}
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
@@ -0,0 +1,123 @@
+/*=============================================================================
+    FrPhysBench.h: Physics benchmark scenes.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    CPhysicsBench.
+-----------------------------------------------------------------------------*/
+
+//
+// A benchmark scene.
+//
+enum EPhysBench
+{
+	PBENCH_SettledPile,		// Pile of rigid bodies, fallen asleep.
+	PBENCH_FallingPile,		// Pile of rigid bodies, falling down.
+	PBENCH_Walkers,			// Arcade bodies, walking back and forth.
+	PBENCH_SpringChains,	// Rigid bodies, linked with joints into chains.
+	PBENCH_Movers,			// Moving platforms with riders.
+	PBENCH_Bullets,			// Fast rigid bodies, shot into the thin wall.
+	PBENCH_BoxStack,		// Column of 20 boxes, solved with iterations.
+	PBENCH_BoxStackSubsteps,// The same column, solved with substeps.
+	PBENCH_MAX
+};
+
+
+//
+// A benchmark scene result. All times are average
+// per frame, in milliseconds.
+//
+struct TPhysBenchResult
+{
+public:
+	EPhysBench		Scene;
+	Bool			bSkipped;
+	Integer			NumObjects;
+	Integer			NumFrames;
+	Integer			NumThreads;		// Physics workers.
+	DWord			TraceHash;		// Bodies hash over all frames.
+	Bool			bMatchSerial;	// Trace hash equals 1 thread one.
+	Double			FPS;
+	Double			FrameTime;
+	Double			MaxFrameTime;
+	Double			BroadTime;
+	Double			NarrowTime;
+	Double			SolveTime;
+	Double			EventsTime;
+	Double			OtherTime;
+	DWord			PeakMemory;
+	Integer			NumAwake;		// Rigid bodies after the last frame.
+	Integer			NumAsleep;
+	Integer			NumSwept;		// Swept moves of fast bodies.
+	Integer			NumSweepHits;
+	Integer			NumTunneled;	// Bullets passed through the wall.
+	Integer			SettleFrame;	// Stack rests since this frame, or -1.
+	Float			Drift;			// Max stack box offset from its spawn.
+};
+
+
+//
+// Standard benchmark scene sizes, each size is run with
+// 1 thread and with all workers.
+//
+#define PBENCH_NUM_SIZES	3
+extern const Integer GPhysBenchSizes[PBENCH_NUM_SIZES];
+
+
+//
+// A physics benchmark. It builds a synthetic scene in the
+// played level, out of the project's own scripts, and ticks
+// the level without render and audio. Level should be just
+// started, and it is spoiled after the benchmark.
+//
+class CPhysicsBench
+{
+public:
+	// CPhysicsBench interface.
+	CPhysicsBench( FLevel* InLevel );
+	~CPhysicsBench();
+	Bool Setup( EPhysBench InScene, Integer InNumObjects );
+	void Run( Integer NumFrames, Float Delta, TPhysBenchResult& Result );
+	void Drive( Float Delta );
+
+	// Utility.
+	static const Char* GetSceneName( EPhysBench Scene );
+	static Bool IsFixedScene( EPhysBench Scene );
+	static String ToJSON( const TPhysBenchResult& Result );
+
+private:
+	// Variables.
+	FLevel*				Level;
+	EPhysBench			Scene;
+	Integer				NumObjects;
+	Float				Time;
+	TArray<FEntity*>	Walkers;
+	TArray<Float>		WalkDirs;
+	TArray<FEntity*>	Movers;
+	TArray<TVector>		MoverOrigins;
+	TArray<FEntity*>	Bullets;
+	Float				WallX;
+	TArray<FEntity*>	Stack;
+	TArray<TVector>		StackOrigins;
+	Integer				OldSubsteps;
+	Integer				OldIterations;
+
+	// Internal.
+	FScript* FindScript( CClass* BaseClass );
+	FEntity* SpawnBrush( const TVector& Min, const TVector& Max );
+	FEntity* SpawnObject( FScript* Script, const TVector& Location );
+	void SetupArena( Float HalfWidth, Float Height );
+	Bool SetupPile( Bool bFalling );
+	Bool SetupWalkers();
+	Bool SetupChains();
+	Bool SetupMovers();
+	Bool SetupBullets();
+	Bool SetupStack( Bool bSubsteps );
+	Bool IsStackMoving();
+};
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
@@ -6,6 +6,10 @@
 #include "Engine.h"
 #include <search.h>
 
+#if FLU_SSE
+#include <emmintrin.h>
+#endif
+
 /*-----------------------------------------------------------------------------
 	CPhysics implementation.
 -----------------------------------------------------------------------------*/
@@ -13,28 +17,41 @@
 //
 // Static variables.
 //
-TVector					CPhysics::HitNormal;
-TVector					CPhysics::HitSlope;
-Float					CPhysics::HitTime;
-EHitSide				CPhysics::HitSide;
-FLevel*					CPhysics::Level;
-EHitSolution			CPhysics::Solution;
-Bool					CPhysics::bBrake;
-Float					CPhysics::BodyInvMass;
-Float					CPhysics::BodyInvIner;
-Float					CPhysics::OtherInvMass;
-Float					CPhysics::OtherInvIner;
-FBaseComponent*			CPhysics::Other;
-FBaseComponent*			CPhysics::Others[MAX_COLL_LIST_OBJS];
-Integer					CPhysics::NumOthers;
-TVector					CPhysics::AVerts[16];
-TVector					CPhysics::ANorms[16];
-TVector					CPhysics::BVerts[16];
-TVector					CPhysics::BNorms[16];
-Integer					CPhysics::ANum;
-Integer					CPhysics::BNum;
-TVector					CPhysics::Contacts[2];
-Integer					CPhysics::NumConts;
+CPhysicsContext*		CPhysicsContext::Current = nullptr;
+
+
+//
+// Physics context constructor.
+//
+CPhysicsContext::CPhysicsContext( FLevel* InLevel )
+	:	Level( InLevel ),
+		HitNormal( 0.f, 0.f ),
+		HitSlope( 0.f, 0.f ),
+		HitTime( 0.f ),
+		HitSide( HSIDE_Top ),
+		Solution( HSOL_None ),
+		bBrake( false ),
+		Other( nullptr ),
+		NumOthers( 0 ),
+		APoly( nullptr ),
+		BPoly( nullptr ),
+		AVerts( nullptr ),
+		ANorms( nullptr ),
+		BVerts( nullptr ),
+		BNorms( nullptr ),
+		ANum( 0 ),
+		BNum( 0 ),
+		NumConts( 0 ),
+		bWorker( false ),
+		JointTime( 0.0 ),
+		NarrowTime( 0.0 ),
+		EventKey( 0 ),
+		HitKey( 0 ),
+		NumSwept( 0 ),
+		NumSweepHits( 0 ),
+		SweepTime( 0.0 )
+{
+}
 
 
 /*-----------------------------------------------------------------------------
@@ -84,7 +101,14 @@ static const TPhysMaterial GMaterials[PM_MAX]	=
 #define PHYS_PENET_PERCENT		0.65f		// Penetration percentage.
 #define PHYS_PENET_ALLOW		0.005f		// Penetration allowance.	
 #define INFINITE_MASS			999999.9f	
-#define SLEEP_THRESHOLD			0.01f
+#define PHYS_BOUNCE_VEL			0.5f		// Min hit velocity to bounce.
+#define PHYS_WARM_DIST			0.1f		// Max contact shift to warm start.
+#define SLEEP_THRESHOLD			0.04f		// Squared velocity of resting body.
+#define SLEEP_ANG_THRESHOLD		0.1f		// Angular velocity of resting body.
+#define SLEEP_TIME				0.5f		// Rest time before island falls asleep.
+#define CCD_MOVE_RATIO			0.5f		// Step move to size ratio of fast body.
+#define CCD_SKIN				0.02f		// Penetration into obstacle after sweep.
+#define JOINT_BAUMGARTE			0.2f		// Hinge position error correction.
 
 
 /*-----------------------------------------------------------------------------
@@ -141,6 +165,44 @@ inline Float GetInvInertia( FPhysicComponent* Body )
 }
 
 
+//
+// Whether rigid body is simulated by the scene now.
+//
+inline Bool IsSimulated( FRigidBodyComponent* Body )
+{
+	return Body->Mass > 0.f && !Body->bDestroyed && !(Body->bCanSleep && Body->bSleeping);
+}
+
+
+//
+// Return relative velocity of the manifold
+// contact point.
+//
+inline TVector RelativeVelocity( const TManifold& M, const TContactPoint& P )
+{
+	TVector Vel	= -M.Body->Velocity - (P.RadBody / M.Body->AngVelocity);
+	if( M.PhysOther )
+		Vel	+= M.PhysOther->Velocity + (P.RadOther / M.PhysOther->AngVelocity);
+	return Vel;
+}
+
+
+//
+// Apply impulse to the manifold contact point.
+//
+inline void ApplyImpulse( TManifold& M, const TContactPoint& P, const TVector& Impulse )
+{
+	M.Body->Velocity	-= Impulse * M.BodyInvMass;
+	M.Body->AngVelocity	-= (P.RadBody / Impulse) * M.BodyInvIner;
+
+	if( M.PhysOther )
+	{
+		M.PhysOther->Velocity		+= Impulse * M.OtherInvMass;
+		M.PhysOther->AngVelocity	+= (P.RadOther / Impulse) * M.OtherInvIner;
+	}
+}
+
+
 //
 // Retrieve body's polygon vertices.
 //
@@ -211,6 +273,77 @@ void BodyToPoly( FBaseComponent* Body, TVector* OutVerts, TVector* OutNorms, Int
 }
 
 
+//
+// Build SoA layout of the poly vertices.
+//
+void PackPoly( TPhysPoly* Poly )
+{
+	Poly->PackNum	= (Poly->Num + 3) & ~3;
+	for( Integer i=0; i<Poly->PackNum; i++ )
+	{
+		TVector& V		= Poly->Verts[Min( i, Poly->Num-1 )];
+		Poly->PackX[i]	= V.X;
+		Poly->PackY[i]	= V.Y;
+	}
+}
+
+
+//
+// Retrieve body's world-space polygon from the cache. Polygon
+// is rebuilt only if body moved or changed since last time.
+// Bodies which collide many others in a pile compute their
+// polygon once per step, static objects only once.
+//
+TPhysPoly* CPhysics::GetPoly( FBaseComponent* Body, TVector*& OutVerts, TVector*& OutNorms, Integer& OutNum )
+{
+	TPhysPoly*			Poly	= Body->PhysPoly;
+	FBrushComponent*	Brush	= As<FBrushComponent>(Body);
+
+	if( !Poly )
+	{
+		Poly			= new TPhysPoly();
+		Poly->Num		= 0;
+		Body->PhysPoly	= Poly;
+	}
+
+	// See if transform is changed.
+	Bool bValid	=	Poly->Num > 0 &&
+					Poly->Location == Body->Location &&
+					Poly->Rotation == Body->Rotation &&
+					Poly->Size == Body->Size &&
+					Poly->bFixedAngle == Body->bFixedAngle;
+
+	if( bValid && Brush )
+	{
+		bValid	= Poly->Num == Brush->NumVerts;
+		for( Integer i=0; i<Brush->NumVerts && bValid; i++ )
+			bValid	= Poly->Local[i] == Brush->Vertices[i];
+	}
+
+	// Rebuild polygon.
+	if( !bValid )
+	{
+		BodyToPoly( Body, Poly->Verts, Poly->Norms, Poly->Num );
+
+		Poly->Location		= Body->Location;
+		Poly->Rotation		= Body->Rotation;
+		Poly->Size			= Body->Size;
+		Poly->bFixedAngle	= Body->bFixedAngle;
+
+		if( Brush )
+			for( Integer i=0; i<Brush->NumVerts; i++ )
+				Poly->Local[i]	= Brush->Vertices[i];
+
+		PackPoly( Poly );
+	}
+
+	OutVerts	= Poly->Verts;
+	OutNorms	= Poly->Norms;
+	OutNum		= Poly->Num;
+	return Poly;
+}
+
+
 //
 // Mix object's friction.
 //
@@ -263,7 +396,10 @@ Float CalculateInertia( TVector* Verts, Integer NumVers, Float Mass )
 
 
 //
-// Object's mass comparison.
+// Object's mass comparison for qsort. Lighter objects go
+// first, objects of the same mass from top to bottom, and
+// the object id breaks ties, so order never depends on the
+// overlap query order.
 //
 int MassCompare( const void* Arg1, const void* Arg2 )
 {
@@ -275,12 +411,13 @@ int MassCompare( const void* Arg1, const void* Arg2 )
 	Float Mass1	= P1 ? P1->Mass : INFINITE_MASS;
 	Float Mass2 = P2 ? P2->Mass : INFINITE_MASS;
 
-	if( Abs(Mass1-Mass2) < 0.5f )
-	{
-		return Obj1->Location.Y < Obj2->Location.Y;
-	}
-	else
-		return Mass1 > Mass2;
+	if( Abs(Mass1-Mass2) >= 0.5f )
+		return Mass1 > Mass2 ? 1 : -1;
+
+	if( Obj1->Location.Y != Obj2->Location.Y )
+		return Obj1->Location.Y < Obj2->Location.Y ? 1 : -1;
+
+	return Obj1->GetId() > Obj2->GetId() ? 1 : Obj1->GetId() < Obj2->GetId() ? -1 : 0;
 }
 
 
@@ -358,6 +495,157 @@ Bool PolysIsOverlap( TVector* AVerts, Integer ANum, TVector* BVerts, Integer BNu
 }
 
 
+/*-----------------------------------------------------------------------------
+    Packed polygon overlap detection.
+-----------------------------------------------------------------------------*/
+
+//
+// Project packed poly onto axis, four vertices per
+// step. Return bounds, exactly as ProjectPoly does.
+//
+inline void ProjectPacked( const TVector& Axis, const TPhysPoly* Poly, Float& OutMin, Float& OutMax )
+{
+#if FLU_SSE
+	__m128	AxisX	= _mm_set1_ps( Axis.X );
+	__m128	AxisY	= _mm_set1_ps( Axis.Y );
+	__m128	Lo		= _mm_add_ps
+	(
+		_mm_mul_ps( _mm_loadu_ps( &Poly->PackX[0] ), AxisX ),
+		_mm_mul_ps( _mm_loadu_ps( &Poly->PackY[0] ), AxisY )
+	);
+	__m128	Hi		= Lo;
+
+	for( Integer i=4; i<Poly->PackNum; i+=4 )
+	{
+		__m128 Dot	= _mm_add_ps
+		(
+			_mm_mul_ps( _mm_loadu_ps( &Poly->PackX[i] ), AxisX ),
+			_mm_mul_ps( _mm_loadu_ps( &Poly->PackY[i] ), AxisY )
+		);
+		Lo	= _mm_min_ps( Lo, Dot );
+		Hi	= _mm_max_ps( Hi, Dot );
+	}
+
+	// Reduce lanes.
+	Lo	= _mm_min_ps( Lo, _mm_shuffle_ps( Lo, Lo, _MM_SHUFFLE(2, 3, 0, 1) ) );
+	Lo	= _mm_min_ps( Lo, _mm_shuffle_ps( Lo, Lo, _MM_SHUFFLE(1, 0, 3, 2) ) );
+	Hi	= _mm_max_ps( Hi, _mm_shuffle_ps( Hi, Hi, _MM_SHUFFLE(2, 3, 0, 1) ) );
+	Hi	= _mm_max_ps( Hi, _mm_shuffle_ps( Hi, Hi, _MM_SHUFFLE(1, 0, 3, 2) ) );
+
+	OutMin	= _mm_cvtss_f32( Lo );
+	OutMax	= _mm_cvtss_f32( Hi );
+#else
+	OutMin	= OutMax	= Poly->PackX[0]*Axis.X + Poly->PackY[0]*Axis.Y;
+	for( Integer i=1; i<Poly->Num; i++ )
+	{
+		Float Test = Poly->PackX[i]*Axis.X + Poly->PackY[i]*Axis.Y;
+		OutMin	= Min( Test, OutMin );
+		OutMax	= Max( Test, OutMax );
+	}
+#endif
+}
+
+
+//
+// Figure out is two packed polys overlap. Test the
+// same axes as unpacked version.
+//
+Bool PolysIsOverlap( TPhysPoly* A, TPhysPoly* B )
+{
+	TPhysPoly* Polys[2]	= { A, B };
+
+	for( Integer p=0; p<2; p++ )
+	{
+		TPhysPoly*	Poly	= Polys[p];
+		TVector		P1		= Poly->Verts[Poly->Num-1];
+
+		for( Integer i=0; i<Poly->Num; i++ )
+		{
+			TVector	P2		= Poly->Verts[i];
+			TVector	Axis	= (P2 - P1).Cross();
+
+			Float MinA, MinB, MaxA, MaxB;
+			ProjectPacked( Axis, A, MinA, MaxA );
+			ProjectPacked( Axis, B, MinB, MaxB );
+
+			if( !((MinA < MaxB) && (MinB < MaxA)) )
+				return false;
+
+			P1	= P2;
+		}
+	}
+
+	// They are overlap.
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------------
+    Polygon sweep detection.
+-----------------------------------------------------------------------------*/
+
+//
+// Sweep poly A along the move vector against the static
+// poly B, using separating axes of both polys. Return true
+// and time of impact in range [0..1], if polys are separated
+// at the start and A hits B during the move.
+//
+Bool SweepPolys( TPhysPoly* A, TPhysPoly* B, const TVector& Move, Float& OutTime )
+{
+	Float Enter	= -1.f;
+	Float Exit	= 2.f;
+
+	for( Integer i=0; i<A->Num+B->Num; i++ )
+	{
+		TVector	Axis	= i < A->Num ? A->Norms[i] : B->Norms[i-A->Num];
+		Float	Speed	= Move * Axis;
+
+		Float MinA, MaxA, MinB, MaxB;
+		ProjectPacked( Axis, A, MinA, MaxA );
+		ProjectPacked( Axis, B, MinB, MaxB );
+
+		if( MaxA < MinB )
+		{
+			// A is behind B.
+			if( Speed <= 0.f )
+				return false;
+
+			Enter	= Max( Enter, (MinB - MaxA) / Speed );
+			Exit	= Min( Exit, (MaxB - MinA) / Speed );
+		}
+		else if( MaxB < MinA )
+		{
+			// A is ahead of B.
+			if( Speed >= 0.f )
+				return false;
+
+			Enter	= Max( Enter, (MaxB - MinA) / Speed );
+			Exit	= Min( Exit, (MinB - MaxA) / Speed );
+		}
+		else if( Speed > 0.f )
+		{
+			// Overlap on this axis, until A leave B.
+			Exit	= Min( Exit, (MaxB - MinA) / Speed );
+		}
+		else if( Speed < 0.f )
+		{
+			Exit	= Min( Exit, (MinB - MaxA) / Speed );
+		}
+
+		if( Enter > Exit || Enter > 1.f )
+			return false;
+	}
+
+	// Polys already overlap, it's handled by
+	// regular collision.
+	if( Enter < 0.f )
+		return false;
+
+	OutTime	= Enter;
+	return true;
+}
+
+
 /*-----------------------------------------------------------------------------
     Polygon collision detection.
 -----------------------------------------------------------------------------*/
@@ -417,6 +705,34 @@ Float FindAxisLeastTime
 }
 
 
+//
+// Figure out face with a least penetration, using
+// packed poly B. Support point along -Normal is the
+// one with least projection onto Normal.
+//
+Float FindAxisLeastTime( TPhysPoly* A, TPhysPoly* B, Integer& Index )
+{
+	Float Result = -999999.0;
+
+	for( Integer i=0; i<A->Num; i++ )
+	{
+		TVector	Normal	= A->Norms[i];
+
+		Float MinB, MaxB;
+		ProjectPacked( Normal, B, MinB, MaxB );
+		Float	Time	= MinB - Normal * A->Verts[i];
+
+		if( Time > Result )
+		{
+			Result	= Time;
+			Index	= i;
+		}
+	}
+
+	return Result;
+}
+
+
 void FindIncidentFace
 (
 	TVector* V,
@@ -488,7 +804,7 @@ Integer Clip( TVector N, Float C, TVector* Face )
 // if bodies are not collided, otherwise return true, and set up
 // the collision info.
 //
-Bool CPhysics::DetectArcadeCollision( EAxis Axis, FPhysicComponent* Body, FBaseComponent* Other )
+Bool CPhysics::DetectArcadeCollision( CPhysicsContext& Ctx, EAxis Axis, FPhysicComponent* Body, FBaseComponent* Other )
 {	
 	if( Other->IsA(FBrushComponent::MetaClass) )
 	{
@@ -499,8 +815,8 @@ Bool CPhysics::DetectArcadeCollision( EAxis Axis, FPhysicComponent* Body, FBaseC
 		Float				TestTime	= 1000.f;
 		TRect				BodyRect	= Body->GetAABB();
 
-		HitTime							= 500.f;
-		HitNormal						= TVector( 0.f, 0.f );
+		Ctx.HitTime							= 500.f;
+		Ctx.HitNormal						= TVector( 0.f, 0.f );
 
 		P1	= Brush->Vertices[Brush->NumVerts-1] + Brush->Location;
 		for( Integer i=0; i<Brush->NumVerts; i++ )
@@ -645,11 +961,11 @@ Bool CPhysics::DetectArcadeCollision( EAxis Axis, FPhysicComponent* Body, FBaseC
 			}
 
 			// Select least time.
-			if( TestTime+ExtraTime < HitTime )
+			if( TestTime+ExtraTime < Ctx.HitTime )
 			{
-				HitNormal	= TestNormal;
-				HitTime		= TestTime;
-				HitSlope	= TestSlope;
+				Ctx.HitNormal	= TestNormal;
+				Ctx.HitTime		= TestTime;
+				Ctx.HitSlope	= TestSlope;
 				Result		= true;				
 			}
 
@@ -685,16 +1001,16 @@ Bool CPhysics::DetectArcadeCollision( EAxis Axis, FPhysicComponent* Body, FBaseC
 				// Figure out the axis with least penetration.
 				if( OverlapX < OverlapY )
 				{
-					HitNormal	= TVector( Dir.X<0.f ? -1.f : +1.f, 0.f );
-					HitTime		= OverlapX;
-					HitSlope	= HitNormal;
+					Ctx.HitNormal	= TVector( Dir.X<0.f ? -1.f : +1.f, 0.f );
+					Ctx.HitTime		= OverlapX;
+					Ctx.HitSlope	= Ctx.HitNormal;
 					return Axis == AXIS_X || Axis == AXIS_None;
 				}
 				else
 				{
-					HitNormal	= TVector( 0.f, Dir.Y<0.f ? -1.f : +1.f );
-					HitTime		= OverlapY;
-					HitSlope	= HitNormal;
+					Ctx.HitNormal	= TVector( 0.f, Dir.Y<0.f ? -1.f : +1.f );
+					Ctx.HitTime		= OverlapY;
+					Ctx.HitSlope	= Ctx.HitNormal;
 					return Axis == AXIS_Y || Axis == AXIS_None;
 				}
 			}
@@ -721,31 +1037,21 @@ Bool CPhysics::DetectArcadeCollision( EAxis Axis, FPhysicComponent* Body, FBaseC
 // Return false if bodies doesn't collided, otherwise return true,
 // and set up the collision info.
 //
-Bool CPhysics::DetectComplexCollision()
+Bool CPhysics::DetectComplexCollision( CPhysicsContext& Ctx )
 {
-	NumConts	= 0;
-	HitTime		= 0.f;
+	Ctx.NumConts	= 0;
+	Ctx.HitTime		= 0.f;
 
 	Integer FaceA, FaceB;
 
 	// Check for SAP with A planes.
-	Float TimeA	= FindAxisLeastTime
-	(
-		AVerts, ANorms, ANum,
-		BVerts, BNorms, BNum,
-		FaceA
-	);
+	Float TimeA	= FindAxisLeastTime( Ctx.APoly, Ctx.BPoly, FaceA );
 
 	if( TimeA >= 0.f )
 		return false;
 
 	// Check for SAP with B planes.
-	Float TimeB	= FindAxisLeastTime
-	(
-		BVerts, BNorms, BNum,
-		AVerts, ANorms, ANum,
-		FaceB
-	);
+	Float TimeB	= FindAxisLeastTime( Ctx.BPoly, Ctx.APoly, FaceB );
 
 	if( TimeB >= 0.f )
 		return false;
@@ -769,16 +1075,16 @@ Bool CPhysics::DetectComplexCollision()
 		FindIncidentFace
 		(
 			IncFace,
-			AVerts, ANorms, ANum,
-			BVerts, BNorms, BNum,
+			Ctx.AVerts, Ctx.ANorms, Ctx.ANum,
+			Ctx.BVerts, Ctx.BNorms, Ctx.BNum,
 			RefInd
 		);
 	else
 		FindIncidentFace
 		(
 			IncFace,
-			BVerts, BNorms, BNum,
-			AVerts, ANorms, ANum,
+			Ctx.BVerts, Ctx.BNorms, Ctx.BNum,
+			Ctx.AVerts, Ctx.ANorms, Ctx.ANum,
 			RefInd
 		);
 
@@ -786,13 +1092,13 @@ Bool CPhysics::DetectComplexCollision()
 	TVector V1, V2;
 	if( !bFlip )
 	{
-		V1	= AVerts[RefInd];
-		V2	= AVerts[(RefInd+1) % ANum];
+		V1	= Ctx.AVerts[RefInd];
+		V2	= Ctx.AVerts[(RefInd+1) % Ctx.ANum];
 	}
 	else
 	{
-		V1	= BVerts[RefInd];
-		V2	= BVerts[(RefInd+1) % BNum];
+		V1	= Ctx.BVerts[RefInd];
+		V2	= Ctx.BVerts[(RefInd+1) % Ctx.BNum];
 	}
 
 	TVector PlaneNormal = V2 - V1;
@@ -811,27 +1117,27 @@ Bool CPhysics::DetectComplexCollision()
 		return false;
 
 	// Flip if any.
-	HitNormal	= bFlip ? -RefNormal : +RefNormal;
+	Ctx.HitNormal	= bFlip ? -RefNormal : +RefNormal;
 
 	Integer Cp	= 0;
 	Float	Sep	= (RefNormal * IncFace[0]) - RefC;
 	if( Sep <= 0.f )
 	{
-		Contacts[Cp++]	= IncFace[0];
-		HitTime	= -Sep;
+		Ctx.Contacts[Cp++]	= IncFace[0];
+		Ctx.HitTime	= -Sep;
 	}
 	else
-		HitTime	= 0.f;
+		Ctx.HitTime	= 0.f;
 
 	Sep	= (RefNormal * IncFace[1]) - RefC;
 	if( Sep <= 0.f )
 	{
-		Contacts[Cp++]	= IncFace[1];
-		HitTime	-=	Sep;
-		HitTime	/= Cp;
+		Ctx.Contacts[Cp++]	= IncFace[1];
+		Ctx.HitTime	-=	Sep;
+		Ctx.HitTime	/= Cp;
 	}
 
-	NumConts	= Cp;
+	Ctx.NumConts	= Cp;
 	return Cp > 0;
 }
 
@@ -845,323 +1151,422 @@ Bool CPhysics::DetectComplexCollision()
 // portals, touches compute forces and so on. It's pretty
 // expensive, so don't use it too often.
 //
-void CPhysics::PhysicComplex( FPhysicComponent* Body, Float Delta )
-{
-	// Don't process unmovable body.
-	if( Body->Mass <= 0.f )
-		return;
-
-	// Setup pointers.
-	Level	= Body->Level;
-
-	// Unhash body to perform movement.
-	// And return to it back.
-	Level->CollHash->RemoveFromHash( Body );
-	{
-		// Prepare.
-		FZoneComponent*	DetectedZone	= nullptr;
-		TVector			OldLocation		= Body->Location;
-		BodyInvMass		= GetInvMass(Body);
-		BodyInvIner		= GetInvInertia(Body);
+// Complex physics is driven by the CPhysicsScene in phases: 
+// integrate forces of all island bodies and collide them,
+// let scripts answer hits on the main thread, then make 
+// contact manifolds, iteratively solve manifolds, move
+// bodies and finally handle touches, zones and portals.
+//
 
-		// Integrate translate forces.
-		Body->Velocity	+=	Body->Forces * (BodyInvMass * Delta);
-		Body->Forces	=	TVector( 0.f, 0.f );
+//
+// Integrate complex body forces.
+//
+void CPhysics::BeginComplex( CPhysicsContext& Ctx, FPhysicComponent* Body, Float Delta )
+{
+	Float InvMass	= GetInvMass(Body);
+	Float InvIner	= GetInvInertia(Body);
 
-		//
-		// Here we clamp delta, to avoid very long distances.
-		// It's reduce situations when body fall, or pass
-		// through obstacles. I think max delta it's 95%
-		// of body's size.
-		//
-		TVector VelDelta	= Body->Velocity * Delta;
-		VelDelta.X	= Clamp( VelDelta.X, -Body->Size.X*0.95f, +Body->Size.X*0.95f );
-		VelDelta.Y	= Clamp( VelDelta.Y, -Body->Size.Y*0.95f, +Body->Size.Y*0.95f );
+	// Integrate translate forces.
+	Body->Velocity	+=	Body->Forces * (InvMass * Delta);
+	Body->Forces	=	TVector( 0.f, 0.f );
 
-		Body->Location	+= VelDelta;
+	// Integrate rotation forces.
+	Body->AngVelocity	+=	Body->Torque * (InvIner * Delta);
+	Body->Torque		=	0.f;
+}
 
-		// Integrate rotation forces.
-		Body->AngVelocity	+=	Body->Torque * (BodyInvIner * Delta);
-		Body->Rotation		+=	TAngle( Body->AngVelocity * Delta );
-		Body->Torque		=	0.f;
 
-		// Get list of potential collide bodies, using cheap
-		// AABB test.
-		TRect OtherAABB, BodyAABB = Body->GetAABB();
-		Level->CollHash->GetOverlapped( BodyAABB, NumOthers, Others );
+//
+// Detect collision of complex body with other object, and
+// record a hit, script will decide how to handle it later.
+// Body's poly should be already prepared in the context.
+//
+void CPhysics::CollideComplex( CPhysicsContext& Ctx, FPhysicComponent* Body, FBaseComponent* Other, FZoneComponent*& DetectedZone )
+{
+	Ctx.Other	= Other;
 
-		// Sort list of objects's for proper processing order.
-		qsort( Others, NumOthers, sizeof(FBaseComponent*), MassCompare );
+	// Cheap AABB test first.
+	if( !Body->GetAABB().IsOverlap(Other->GetAABB()) )
+		return;
 
-		// Convert Body to polygon.
-		TVector	PolyOrig	= Body->Location;
-		BodyToPoly( Body, AVerts, ANorms, ANum );
+	// See if body already touch other.
+	if( IsTouch( Body, Other ) )
+		return;
 
-		// Test collision with all bodies.
-		for( Integer i=0; i<NumOthers; i++ )
-		{
-			// Figure out is body still overlaps with
-			// Others[i] due position correction.
-			Other		=	Others[i];
-			BodyAABB	=	Body->GetAABB();
-			OtherAABB	=	Other->GetAABB();
+	// Compute collsion.
+	Ctx.BPoly	= GetPoly( Other, Ctx.BVerts, Ctx.BNorms, Ctx.BNum );
+	DetectComplexCollision( Ctx );
+	Ctx.HitSide	= OppositeSide(NormalToSide(Ctx.HitNormal));
 
-			if( !BodyAABB.IsOverlap(OtherAABB) )
-				continue;
+	// No collision?
+	if( Ctx.NumConts == 0 )
+		return;
 
-			// See if body already touch other.
-			if( IsTouch( Body, Other ) )
-				continue;
+	// Handle zones.
+	if( Other->IsA(FZoneComponent::MetaClass) )
+	{
+		DetectedZone	= (FZoneComponent*)Other;
+		return;
+	}
 
-			// Polys for collision.
-			BodyToPoly( Other, BVerts, BNorms, BNum );
-			if( Body->Location != PolyOrig )
-				BodyToPoly( Body, AVerts, ANorms, ANum );
+	// Record the hit.
+	TPhysHit Hit;
+	Hit.Key			= Ctx.HitKey++;
+	Hit.Body		= Body;
+	Hit.Other		= Other;
+	Hit.Normal		= Ctx.HitNormal;
+	Hit.Penetration	= Ctx.HitTime;
+	Hit.Side		= Ctx.HitSide;
+	Hit.Solution	= HSOL_None;
+	Hit.bBrake		= false;
+	Hit.NumConts	= Ctx.NumConts;
+	for( Integer k=0; k<Ctx.NumConts; k++ )
+		Hit.Contacts[k]	= Ctx.Contacts[k];
+	Ctx.Hits.Push( Hit );
+}
 
-			// Compute collsion.
-			DetectComplexCollision();
-			HitSide	= OppositeSide(NormalToSide(HitNormal));
 
-			// No collision?
-			if( NumConts == 0 )
-				continue;
+//
+// Ask scripts how to handle the hit. Called on the
+// main thread, after all hits of the step or of the 
+// arcade move are detected, and before any of them is
+// resolved.
+//
+void CPhysics::AnswerHit( CPhysicsContext& Ctx, TPhysHit& Hit )
+{
+	Ctx.Solution	= HSOL_None;
+	Ctx.bBrake		= false;
+	CallEvent( Ctx, Hit.Body->Entity, EVENT_OnCollide, Hit.Other->Entity, Hit.Side );
+	CallEvent( Ctx, Hit.Other->Entity, EVENT_OnCollide, Hit.Body->Entity, OppositeSide(Hit.Side) );
+	Hit.Solution	= Ctx.Solution;
+	Hit.bBrake		= Ctx.bBrake;
+}
 
-			// Handle zones.
-			if( Other->IsA(FZoneComponent::MetaClass) )
-			{
-				DetectedZone	= (FZoneComponent*)Other;
-				continue;
-			}
 
-			// Compute other's physics properties.
-			FPhysicComponent* PhysOther = nullptr;
-			if( Other->IsA(FPhysicComponent::MetaClass) )
-			{
-				PhysOther		= (FPhysicComponent*)Other;
-				OtherInvMass	= GetInvMass(PhysOther);
-				OtherInvIner	= GetInvInertia(PhysOther);
-			}
-			else
-			{
-				OtherInvMass	= 0.f;
-				OtherInvIner	= 0.f;
-			}
-			FRigidBodyComponent* RigidOther	= As<FRigidBodyComponent>(PhysOther);
-
-			// Ask script how to handle hit.
-			Solution	= HSOL_None;
-			bBrake		= false;
-			Body->Entity->CallEvent( EVENT_OnCollide, Other->Entity, (Byte)HitSide );
-			Other->Entity->CallEvent( EVENT_OnCollide, Body->Entity, (Byte)OppositeSide(HitSide) );
-
-			if
-				(
-					(Solution == HSOL_Solid) ||
-					(Solution == HSOL_Oneway && HitSide == HSIDE_Top && Body->Velocity.Y < 0.f)
-				)
-			{
-				// Handle solid collision.
-
-				// Process REAL physics interaction.
-				Float SFriction	= !PhysOther ? GMaterials[Body->Material].SFriction : MixFriction
-				(
-					GMaterials[Body->Material].SFriction,
-					GMaterials[PhysOther->Material].SFriction
-				);
-				Float DFriction	= !PhysOther ? GMaterials[Body->Material].DFriction : MixFriction
-				(
-					GMaterials[Body->Material].DFriction,
-					GMaterials[PhysOther->Material].DFriction
-				);
-
-				// Awake other if any.
-				if( RigidOther )
-					RigidOther->bSleeping	= false;
-
-				Float	AV1 = 0.f, 
-						AV2 = 0.f;
-				TVector	V1 = TVector( 0.f, 0.f ), 
-						V2 = TVector (0.f, 0.f );
-
-				for( Integer k=0; k<NumConts; k++ )
-				{
-					// Radii vectors.
-					TVector RadBody		= Contacts[k] - Body->Location;
-					TVector	RadOther	= Contacts[k] - Other->Location;
-
-					// Relative velocity.
-					TVector RelVel;
-					if( PhysOther )
-						RelVel	=	PhysOther->Velocity + (RadOther / PhysOther->AngVelocity) -
-									Body->Velocity		- (RadBody / Body->AngVelocity);
-					else
-						RelVel	= -Body->Velocity - (RadBody / Body->AngVelocity);
-
-					// Project velocity along hit normal.
-					Float ProjVel	= RelVel * HitNormal;
-
-					// Collide only when velocity along hit normal
-					// and satisfied script's solution about this hit.
-					if 
-						(
-							(ProjVel <= 0.f) &&
-							(	( Solution == HSOL_Solid )||
-								( Solution == HSOL_Oneway && HitSide == HSIDE_Top ) )
-						)
-					{
-						Float	RACrossN	= RadBody / HitNormal;
-						Float	RBCrossN	= RadOther / HitNormal;
+//
+// Record a hit of the arcade body, detected in the
+// context.
+//
+void CPhysics::AddArcadeHit( CPhysicsContext& Ctx, FPhysicComponent* Body )
+{
+	TPhysHit Hit;
+	Hit.Key			= Ctx.HitKey++;
+	Hit.Body		= Body;
+	Hit.Other		= Ctx.Other;
+	Hit.Normal		= Ctx.HitNormal;
+	Hit.Penetration	= Ctx.HitTime;
+	Hit.Side		= NormalToSide(Ctx.HitNormal);
+	Hit.Solution	= HSOL_None;
+	Hit.bBrake		= false;
+	Hit.NumConts	= 0;
+	Ctx.Hits.Push( Hit );
+}
 
-						Float	InvMassTotal	=	BodyInvMass + OtherInvMass +
-													Sqr(RACrossN) * BodyInvIner +
-													Sqr(RBCrossN) * OtherInvIner;
 
-						// Pick elasticity for hit solving.
-						Float	e	=	!PhysOther ? GMaterials[Body->Material].Elasticity :
-										Min( GMaterials[Body->Material].Elasticity, GMaterials[PhysOther->Material].Elasticity );
+//
+// Handle the answered hit: make a contact manifold for
+// solid hit, or touch objects.
+//
+void CPhysics::ResolveHit( CPhysicsContext& Ctx, const TPhysHit& Hit )
+{
+	FPhysicComponent*		Body		= Hit.Body;
+	FBaseComponent*			Other		= Hit.Other;
+	FPhysicComponent*		PhysOther	= As<FPhysicComponent>(Other);
+	FRigidBodyComponent*	RigidOther	= As<FRigidBodyComponent>(PhysOther);
 
-						// Scalar impulse.
-						Float	j	= -(1 + e) * ProjVel / (InvMassTotal*NumConts);
-						TVector	TotalImpulse	= HitNormal * j;
+	if
+		(
+			(Hit.Solution == HSOL_Solid) ||
+			(Hit.Solution == HSOL_Oneway && Hit.Side == HSIDE_Top && Body->Velocity.Y < 0.f)
+		)
+	{
+		// Handle solid collision.
+
+		// Awake other if any.
+		if( RigidOther )
+			RigidOther->bSleeping	= false;
+
+		// Make contact manifold.
+		TManifold Manifold;
+		Manifold.Key			= ((QWord)Body->GetId() << 32) | (DWord)Other->GetId();
+		Manifold.Body			= Body;
+		Manifold.Other			= Other;
+		Manifold.PhysOther		= PhysOther;
+		Manifold.Normal			= Hit.Normal;
+		Manifold.Penetration	= Hit.Penetration;
+		Manifold.BodyInvMass	= GetInvMass(Body);
+		Manifold.BodyInvIner	= GetInvInertia(Body);
+		Manifold.OtherInvMass	= PhysOther ? GetInvMass(PhysOther) : 0.f;
+		Manifold.OtherInvIner	= PhysOther ? GetInvInertia(PhysOther) : 0.f;
+		Manifold.Friction		= !PhysOther ? GMaterials[Body->Material].SFriction : MixFriction
+		(
+			GMaterials[Body->Material].SFriction,
+			GMaterials[PhysOther->Material].SFriction
+		);
+		Manifold.Elasticity		= !PhysOther ? GMaterials[Body->Material].Elasticity :
+									Min( GMaterials[Body->Material].Elasticity, GMaterials[PhysOther->Material].Elasticity );
 
-						// Apply impulse friction.
-						TVector	Tangent	= RelVel - (HitNormal * (RelVel*HitNormal));
-						Tangent.Normalize();
-						Float jt	= -(RelVel * Tangent) / (InvMassTotal*NumConts);
+		Manifold.NumPoints	= Hit.NumConts;
+		for( Integer k=0; k<Hit.NumConts; k++ )
+		{
+			Manifold.Points[k].Point	= Hit.Contacts[k];
+			Manifold.Points[k].Pn		= 0.f;
+			Manifold.Points[k].Pt		= 0.f;
+		}
+		Ctx.Manifolds.Push( Manifold );
 
-						// Don't apply too small friction.
-						if( ( jt <= -0.001f )||( jt >= +0.001f ) )
-						{
-							if( Abs(jt) < j*SFriction )
-							{
-								// Static friction.
-								TotalImpulse	+=	Tangent * jt;
-							}
-							else
-							{
-								// Dynamic friction.
-								TotalImpulse	+=	Tangent * (-j*DFriction);
-							}
-						}
+		// Handle floor.
+		if( Hit.Side == HSIDE_Top )
+		{
+			// Body get floor slab.
+			FMoverComponent* Mover = As<FMoverComponent>(Other);
+			if( Mover )
+				Mover->AddRider( Body );
+			Body->Floor		= Other->Entity;
+		}
+		else if( Hit.Side == HSIDE_Bottom )
+		{
+			// Other get floor slab.
+			if( PhysOther )
+				PhysOther->Floor	= Body->Entity;
+		}
+	}
+	else
+	{
+		// Bodies don't want to collide, so
+		// touch 'em.
+		if( Hit.Solution != HSOL_Oneway )
+			BeginTouch( Ctx, Body, Other );
+	}
+}
 
-						// Apply sum of impulses to bodies movement.
-						V1 += TotalImpulse * BodyInvMass;
-						if( PhysOther )
-							V2	+= TotalImpulse * OtherInvMass;
 
-						// Apply sum of impulses to bodies rotation.
-						AV1 += (RadBody/TotalImpulse)*BodyInvIner;
-						if( PhysOther )
-							AV2 += (RadOther/TotalImpulse)*OtherInvIner;
-					}
-				}
+//
+// Prepare manifold for solving. Compute effective masses,
+// restitution bias and apply cached impulses of the same
+// contact from the last step (warm starting).
+//
+void CPhysics::PrepareManifold( TManifold& M, const TCachedManifold* Cached )
+{
+	TVector Tangent	= M.Normal.Cross();
 
-				// Apply sum of impulses to bodies movement.
-				Body->Velocity -= V1;
-				if( PhysOther )
+	for( Integer k=0; k<M.NumPoints; k++ )
+	{
+		TContactPoint& P = M.Points[k];
+
+		// Radii vectors.
+		P.RadBody	= P.Point - M.Body->Location;
+		P.RadOther	= P.Point - M.Other->Location;
+
+		// Effective masses.
+		Float	RACrossN	= P.RadBody / M.Normal;
+		Float	RBCrossN	= P.RadOther / M.Normal;
+		Float	RACrossT	= P.RadBody / Tangent;
+		Float	RBCrossT	= P.RadOther / Tangent;
+
+		Float	KNormal		=	M.BodyInvMass + M.OtherInvMass +
+								Sqr(RACrossN) * M.BodyInvIner +
+								Sqr(RBCrossN) * M.OtherInvIner;
+		Float	KTangent	=	M.BodyInvMass + M.OtherInvMass +
+								Sqr(RACrossT) * M.BodyInvIner +
+								Sqr(RBCrossT) * M.OtherInvIner;
+
+		P.NormalMass	= KNormal > 0.f ? 1.f/KNormal : 0.f;
+		P.TangentMass	= KTangent > 0.f ? 1.f/KTangent : 0.f;
+
+		// Bounce only on fast hit, otherwise stack jitters.
+		Float ProjVel	= RelativeVelocity( M, P ) * M.Normal;
+		P.Bias	= ProjVel < -PHYS_BOUNCE_VEL ? -M.Elasticity * ProjVel : 0.f;
+
+		// Warm starting.
+		if( Cached )
+			for( Integer c=0; c<Cached->NumPoints; c++ )
+				if( (Cached->Points[c].Point - P.Point).SizeSquared() < Sqr(PHYS_WARM_DIST) )
 				{
-					//if( PhysOther->IsA(FArcadeBodyComponent::MetaClass) )
-					//{
-					//	PhysOther->Velocity.X += V2.X;
-					//}
-					//else
-						PhysOther->Velocity	+= V2;
+					P.Pn	= Cached->Points[c].Pn;
+					P.Pt	= Cached->Points[c].Pt;
+					ApplyImpulse( M, P, M.Normal*P.Pn + Tangent*P.Pt );
+					break;
 				}
+	}
+}
 
-				// Apply sum of impulses to bodies rotation.
-				Body->AngVelocity -= AV1;
-				if( PhysOther )
-					PhysOther->AngVelocity += AV2;
 
-				// Apply correction to bodies location.
-				TVector Correct =	HitNormal * PHYS_PENET_PERCENT * 
-									(Max( 0.f, HitTime-PHYS_PENET_ALLOW )/(BodyInvMass+OtherInvMass)); 
+//
+// Perform an iteration of sequential impulses
+// for the manifold.
+//
+void CPhysics::SolveManifold( TManifold& M )
+{
+	TVector Tangent	= M.Normal.Cross();
 
-				Body->Location -= Correct * BodyInvMass;
+	for( Integer k=0; k<M.NumPoints; k++ )
+	{
+		TContactPoint& P = M.Points[k];
+
+		// Normal impulse, never pull bodies.
+		Float	ProjVel	= RelativeVelocity( M, P ) * M.Normal;
+		Float	OldPn	= P.Pn;
+		P.Pn	= Max( OldPn + (P.Bias - ProjVel) * P.NormalMass, 0.f );
+		ApplyImpulse( M, P, M.Normal * (P.Pn - OldPn) );
+
+		// Friction impulse, limited by Coulomb's cone.
+		Float	TangVel	= RelativeVelocity( M, P ) * Tangent;
+		Float	OldPt	= P.Pt;
+		Float	MaxPt	= P.Pn * M.Friction;
+		P.Pt	= Clamp( OldPt - TangVel * P.TangentMass, -MaxPt, +MaxPt );
+		ApplyImpulse( M, P, Tangent * (P.Pt - OldPt) );
+	}
+}
 
-				if( PhysOther )
-				{
-					// Don't let sink.
-					Level->CollHash->RemoveFromHash(PhysOther);
-					PhysOther->Location += Correct * OtherInvMass;
-					Level->CollHash->AddToHash(PhysOther);
-				}
 
-				// Handle floor.
-				if( HitSide == HSIDE_Top )
-				{
-					// Body get floor slab.
-					FMoverComponent* Mover = As<FMoverComponent>(Other);
-					if( Mover )
-						Mover->AddRider( Body );
-					Body->Floor		= Other->Entity;
-				}
-				else if( HitSide == HSIDE_Bottom )
-				{
-					// Other get floor slab.
-					if( Other->IsA(FPhysicComponent::MetaClass) )
-						((FPhysicComponent*)Other)->Floor	= Body->Entity;
-				}
-			}
-			else
-			{
-				// Bodies don't want to collide, so
-				// touch 'em.
-				if( Solution != HSOL_Oneway )
-				{
-					BeginTouch( Body, Other );
-					BodyAABB = Body->GetAABB();
-				}
-			}
-		}
+//
+// Push bodies of the manifold apart, to avoid
+// sinking.
+//
+void CPhysics::CorrectManifold( TManifold& M )
+{
+	Float InvMassTotal	= M.BodyInvMass + M.OtherInvMass;
+	if( InvMassTotal <= 0.f )
+		return;
 
+	TVector Correct =	M.Normal * PHYS_PENET_PERCENT * 
+						(Max( 0.f, M.Penetration-PHYS_PENET_ALLOW )/InvMassTotal); 
+
+	M.Body->Location -= Correct * M.BodyInvMass;
+	if( M.PhysOther )
+		M.PhysOther->Location += Correct * M.OtherInvMass;
+}
+
+
+//
+// Move complex body according to its velocity.
+//
+void CPhysics::MoveComplex( CPhysicsContext& Ctx, FPhysicComponent* Body, Float Delta )
+{
+	TVector VelDelta	= Body->Velocity * Delta;
+
+	if( IsFastBody( Body, VelDelta ) )
+	{
+		// Fast body may pass through thin obstacles, so
+		// sweep it against collision candidates.
+		VelDelta	= SweepComplex( Ctx, Body, VelDelta );
+	}
+	else
+	{
 		//
-		// See if no more touch touched actors.
+		// Here we clamp delta, to avoid very long distances.
+		// It's reduce situations when body fall, or pass
+		// through obstacles. I think max delta it's 95%
+		// of body's size.
 		//
-		{
-			BodyToPoly( Body, AVerts, ANorms, ANum );
-			for( Integer i=0; i<array_length(Body->Touched); i++ )
-				if( Body->Touched[i] )
-				{
-					Other	= Body->Touched[i]->Base;
-					BodyToPoly( Other, BVerts, BNorms, BNum );
+		VelDelta.X	= Clamp( VelDelta.X, -Body->Size.X*0.95f, +Body->Size.X*0.95f );
+		VelDelta.Y	= Clamp( VelDelta.Y, -Body->Size.Y*0.95f, +Body->Size.Y*0.95f );
+	}
 
-					if( !PolysIsOverlap( AVerts, ANum, BVerts, BNum ) )
-						EndTouch( Body, Other );
-				}
-		}
+	Body->Location	+= VelDelta;
+	Body->Rotation	+= TAngle( Body->AngVelocity * Delta );
+}
 
-		// Process zone.
-		SetBodyZone( Body, DetectedZone );
 
-		// Process portal pass.
-		HandlePortals( Body, OldLocation );	
-		
-		// Handle sleeping of rigid.
-		// Not each frame, let them heat up for begging.
-		if( !((GFrameStamp ^ Body->GetId()) & 63) )
-		{
-			if( Abs(Body->AngVelocity) <= 0.1f )
-				Body->AngVelocity	= 0.f;
-			if( Body->Velocity.SizeSquared() <= SLEEP_THRESHOLD )
-				Body->Velocity	= TVector( 0.f, 0.f );
-		}
+//
+// Whether body moves too fast for discrete collision
+// and should be swept. Bullets are always swept.
+//
+Bool CPhysics::IsFastBody( FPhysicComponent* Body, const TVector& Move )
+{
+	if( !CPhysicsScene::bCCD )
+		return false;
 
-		FRigidBodyComponent* Rigid	= (FRigidBodyComponent*)Body;
-		if( Rigid->bCanSleep )
-		{
-			if	( 
-					Body->AngVelocity == 0.f && 
-					Body->Velocity == TVector( 0.f, 0.f ) &&
-					Body->Floor
-				)
+	FRigidBodyComponent* Rigid = As<FRigidBodyComponent>(Body);
+	if( Rigid && Rigid->bBullet )
+		return true;
+
+	return	Abs(Move.X) > Body->Size.X*CCD_MOVE_RATIO || 
+			Abs(Move.Y) > Body->Size.Y*CCD_MOVE_RATIO;
+}
+
+
+//
+// Sweep body along the move against objects in the
+// context's list and return a move until the first hit.
+// Body stops slightly inside an obstacle, so hit will be
+// handled by regular collision next step, and script
+// will decide how to handle it. Other bodies are swept
+// as static, rotation is not swept.
+//
+TVector CPhysics::SweepComplex( CPhysicsContext& Ctx, FPhysicComponent* Body, const TVector& Move )
+{
+	Float Dist = Move.Size();
+	if( Dist <= 0.f )
+		return Move;
+
+	Double	StartTime	= GPlat->TimeStamp();
+	Float	MoveTime	= 1.f;
+
+	// Swept bounds.
+	TRect Swept = Body->GetAABB();
+	if( Move.X < 0.f )	Swept.Min.X += Move.X;	else	Swept.Max.X += Move.X;
+	if( Move.Y < 0.f )	Swept.Min.Y += Move.Y;	else	Swept.Max.Y += Move.Y;
+
+	Ctx.APoly	= GetPoly( Body, Ctx.AVerts, Ctx.ANorms, Ctx.ANum );
+	for( Integer i=0; i<Ctx.NumOthers; i++ )
+	{
+		FBaseComponent* Other = Ctx.Others[i];
+
+		// Zones and touched objects never block.
+		if( Other->IsA(FZoneComponent::MetaClass) || IsTouch( Body, Other ) )
+			continue;
+
+		if( !Swept.IsOverlap(Other->GetAABB()) )
+			continue;
+
+		Float HitTime;
+		Ctx.BPoly	= GetPoly( Other, Ctx.BVerts, Ctx.BNorms, Ctx.BNum );
+		if( SweepPolys( Ctx.APoly, Ctx.BPoly, Move, HitTime ) )
+			MoveTime	= Min( MoveTime, HitTime );
+	}
+
+	// Stop at first hit.
+	if( MoveTime < 1.f )
+	{
+		MoveTime	= Min( MoveTime + CCD_SKIN/Dist, 1.f );
+		Ctx.NumSweepHits++;
+	}
+
+	Ctx.NumSwept++;
+	Ctx.SweepTime	+= GPlat->TimeStamp() - StartTime;
+	return Move * MoveTime;
+}
+
+
+//
+// Finish complex body step. Handle touches,
+// zones and portals.
+//
+void CPhysics::EndComplex( CPhysicsContext& Ctx, FPhysicComponent* Body, FZoneComponent* DetectedZone, const TVector& OldLocation )
+{
+	//
+	// See if no more touch touched actors.
+	//
+	{
+		Ctx.APoly	= GetPoly( Body, Ctx.AVerts, Ctx.ANorms, Ctx.ANum );
+		for( Integer i=0; i<array_length(Body->Touched); i++ )
+			if( Body->Touched[i] )
 			{
-				// Sweet dreams are made of this!
-				Rigid->bSleeping	= true;		
+				Ctx.Other	= Body->Touched[i]->Base;
+				Ctx.BPoly	= GetPoly( Ctx.Other, Ctx.BVerts, Ctx.BNorms, Ctx.BNum );
+
+				if( !PolysIsOverlap( Ctx.APoly, Ctx.BPoly ) )
+					EndTouch( Ctx, Body, Ctx.Other );
 			}
-		}
 	}
-	Level->CollHash->AddToHash( Body );		
+
+	// Process zone.
+	SetBodyZone( Ctx, Body, DetectedZone );
+
+	// Process portal pass.
+	HandlePortals( Ctx, Body, OldLocation );	
 }
 
 
@@ -1170,14 +1575,14 @@ void CPhysics::PhysicComplex( FPhysicComponent* Body, Float Delta )
 // No friction, no rotation. Perfectly for
 // player figures.
 //
-void CPhysics::PhysicArcade( FPhysicComponent* Body, Float Delta )
+void CPhysics::PhysicArcade( CPhysicsContext& Ctx, FPhysicComponent* Body, Float Delta )
 {
 	// Setup pointers.
-	Level	= Body->Level;
+	Ctx.Level	= Body->Level;
 
 	// Unhash body to perform movement.
 	// And return to it back.
-	Level->CollHash->RemoveFromHash( Body );
+	Ctx.Level->CollHash->RemoveFromHash( Body );
 	{
 		// Prepare.
 		FZoneComponent*	DetectedZone	= nullptr;
@@ -1202,53 +1607,60 @@ void CPhysics::PhysicArcade( FPhysicComponent* Body, Float Delta )
 			// Get list of potential collide bodies, using cheap
 			// AABB test.
 			TRect BodyAABB = Body->GetAABB();
-			Level->CollHash->GetOverlapped( BodyAABB, NumOthers, Others );
+			Ctx.Level->CollHash->GetOverlapped( BodyAABB, Ctx.NumOthers, Ctx.Others );
 
-			// Test collision with all actors.
-			for( Integer iOther=0; iOther<NumOthers; iOther++ )
+			// Test collision with all actors, script answers
+			// hits after all of them are detected.
+			Integer iFirstHit = Ctx.Hits.Num();
+			for( Integer iOther=0; iOther<Ctx.NumOthers; iOther++ )
 			{
-				// Figure out is body still overlaps with
-				// Others[i] due position correction.
-				Other		= Others[iOther];
+				Ctx.Other		= Ctx.Others[iOther];
 	
 				// See if body already touch other.
-				if( IsTouch( Body, Other ) )
+				if( IsTouch( Body, Ctx.Other ) )
 					continue;
 
 				// Handle zones.
-				if( Other->IsA(FZoneComponent::MetaClass) && BodyAABB.IsOverlap(Other->GetAABB()) )
+				if( Ctx.Other->IsA(FZoneComponent::MetaClass) && BodyAABB.IsOverlap(Ctx.Other->GetAABB()) )
 				{
-					DetectedZone	= (FZoneComponent*)Other;
+					DetectedZone	= (FZoneComponent*)Ctx.Other;
 					continue;
 				}
 
 				// Figure out collision hit info.
-				if( !DetectArcadeCollision( AXIS_X, Body, Other ) )
-					continue;
+				if( DetectArcadeCollision( Ctx, AXIS_X, Body, Ctx.Other ) )
+					AddArcadeHit( Ctx, Body );
+			}
+
+			for( Integer i=iFirstHit; i<Ctx.Hits.Num(); i++ )
+				AnswerHit( Ctx, Ctx.Hits[i] );
 
-				// Ask script how to handle hit.
-				HitSide		= NormalToSide(HitNormal);
-				Solution	= HSOL_None;
-				bBrake		= false;
-				Body->Entity->CallEvent( EVENT_OnCollide, Other->Entity, (Byte)HitSide );
-				Other->Entity->CallEvent( EVENT_OnCollide, Body->Entity, (Byte)OppositeSide(HitSide) );
+			// Process collisions.
+			for( Integer i=iFirstHit; i<Ctx.Hits.Num(); i++ )
+			{
+				TPhysHit& Hit	= Ctx.Hits[i];
+				Ctx.Other		= Hit.Other;
 
-				// Process collision.
-				if( Solution == HSOL_Solid )
+				if( Hit.Solution == HSOL_Solid )
 				{
+					// Figure out is body still overlaps with
+					// other due position correction.
+					if( !DetectArcadeCollision( Ctx, AXIS_X, Body, Ctx.Other ) )
+						continue;
+
 					// Handle solid collision.
 					// Push up actor's location.
-					Body->Location.X	+= HitNormal.X * HitTime;
-					BodyAABB			= Body->GetAABB();
+					Ctx.HitSide			= NormalToSide(Ctx.HitNormal);
+					Body->Location.X	+= Ctx.HitNormal.X * Ctx.HitTime;
 
 					// Brake velocity.
-					if( bBrake && HitNormal.X != 0.f )
+					if( Hit.bBrake && Ctx.HitNormal.X != 0.f )
 					{
 						// Brake X-vector.
-						if( HitSide == HSIDE_Left && Body->Velocity.X > 0.f )
+						if( Ctx.HitSide == HSIDE_Left && Body->Velocity.X > 0.f )
 							Body->Velocity.X	= 0.f;
 
-						if( HitSide == HSIDE_Right && Body->Velocity.X < 0.f )
+						if( Ctx.HitSide == HSIDE_Right && Body->Velocity.X < 0.f )
 							Body->Velocity.X	= 0.f;
 					}
 				}
@@ -1256,13 +1668,11 @@ void CPhysics::PhysicArcade( FPhysicComponent* Body, Float Delta )
 				{
 					// Bodies don't want to collide, so
 					// touch 'em.
-					if( Solution != HSOL_Oneway )
-					{
-						BeginTouch( Body, Other );
-						BodyAABB = Body->GetAABB();
-					}
+					if( Hit.Solution != HSOL_Oneway )
+						BeginTouch( Ctx, Body, Ctx.Other );
 				}
 			}
+			Ctx.Hits.SetNum( iFirstHit );
 		}
 
 		//
@@ -1276,86 +1686,90 @@ void CPhysics::PhysicArcade( FPhysicComponent* Body, Float Delta )
 			// Get list of potential collide bodies, using cheap
 			// AABB test.
 			TRect BodyAABB = Body->GetAABB();
-			Level->CollHash->GetOverlapped( BodyAABB, NumOthers, Others );
+			Ctx.Level->CollHash->GetOverlapped( BodyAABB, Ctx.NumOthers, Ctx.Others );
 
-			// Test collision with all actors.
-			for( Integer iOther=0; iOther<NumOthers; iOther++ )
+			// Test collision with all actors, script answers
+			// hits after all of them are detected.
+			Integer iFirstHit = Ctx.Hits.Num();
+			for( Integer iOther=0; iOther<Ctx.NumOthers; iOther++ )
 			{
-				// Figure out is body still overlaps with
-				// Others[i] due position correction.
-				Other		= Others[iOther];
+				Ctx.Other		= Ctx.Others[iOther];
 
 				// See if body already touch other.
-				if( IsTouch( Body, Other ) )
+				if( IsTouch( Body, Ctx.Other ) )
 					continue;
 
 				// Handle zones.
-				if( Other->IsA(FZoneComponent::MetaClass) && BodyAABB.IsOverlap(Other->GetAABB()) )
+				if( Ctx.Other->IsA(FZoneComponent::MetaClass) && BodyAABB.IsOverlap(Ctx.Other->GetAABB()) )
 				{
-					DetectedZone	= (FZoneComponent*)Other;
+					DetectedZone	= (FZoneComponent*)Ctx.Other;
 					continue;
 				}
 
 				// Figure out collision hit info.
-				if( !DetectArcadeCollision( bNoMove ? AXIS_None : AXIS_Y, Body, Other ) )
-					continue;
+				if( DetectArcadeCollision( Ctx, bNoMove ? AXIS_None : AXIS_Y, Body, Ctx.Other ) )
+					AddArcadeHit( Ctx, Body );
+			}
 
-				// Ask script how to handle hit.
-				HitSide		= NormalToSide(HitNormal);
-				Solution	= HSOL_None;
-				bBrake		= false;
-				Body->Entity->CallEvent( EVENT_OnCollide, Other->Entity, (Byte)HitSide );
-				Other->Entity->CallEvent( EVENT_OnCollide, Body->Entity, (Byte)OppositeSide(HitSide) );
-
-				// Process collision.
-				if	(	
-						( Solution == HSOL_Solid ) ||
-						( Solution == HSOL_Oneway && HitSide == HSIDE_Top && Body->Velocity.Y < 0.f )
-					)
+			for( Integer i=iFirstHit; i<Ctx.Hits.Num(); i++ )
+				AnswerHit( Ctx, Ctx.Hits[i] );
+
+			// Process collisions.
+			for( Integer i=iFirstHit; i<Ctx.Hits.Num(); i++ )
+			{
+				TPhysHit& Hit	= Ctx.Hits[i];
+				Ctx.Other		= Hit.Other;
+
+				if( Hit.Solution == HSOL_Solid || Hit.Solution == HSOL_Oneway )
 				{
+					// Figure out is body still overlaps with
+					// other due position correction.
+					if( !DetectArcadeCollision( Ctx, bNoMove ? AXIS_None : AXIS_Y, Body, Ctx.Other ) )
+						continue;
+
+					Ctx.HitSide	= NormalToSide(Ctx.HitNormal);
+					if( Hit.Solution == HSOL_Oneway && !(Ctx.HitSide == HSIDE_Top && Body->Velocity.Y < 0.f) )
+						continue;
+
 					// Handle solid collision.
 					// Push up actor's location.
-					Body->Location.Y	+= HitNormal.Y * HitTime;
-					BodyAABB			= Body->GetAABB();
+					Body->Location.Y	+= Ctx.HitNormal.Y * Ctx.HitTime;
 
 					// Brake velocity, but not for slopes surfaces.
-					if( bBrake && HitSlope == HitNormal )
+					if( Hit.bBrake && Ctx.HitSlope == Ctx.HitNormal )
 					{
 						// Brake Y-vector.
-						if( HitSide == HSIDE_Bottom && Body->Velocity.Y > 0.f )
+						if( Ctx.HitSide == HSIDE_Bottom && Body->Velocity.Y > 0.f )
 							Body->Velocity.Y	= 0.f;
 
-						if( HitSide == HSIDE_Top && Body->Velocity.Y < 0.f )
+						if( Ctx.HitSide == HSIDE_Top && Body->Velocity.Y < 0.f )
 							Body->Velocity.Y	= 0.f;
 					}
 
 					// Handle floor.
-					if( HitSide == HSIDE_Top )
+					if( Ctx.HitSide == HSIDE_Top )
 					{
 						// Body get floor slab.
-						FMoverComponent* Mover = As<FMoverComponent>(Other);
+						FMoverComponent* Mover = As<FMoverComponent>(Ctx.Other);
 						if( Mover )
 							Mover->AddRider( Body );
-						Body->Floor		= Other->Entity;
+						Body->Floor		= Ctx.Other->Entity;
 					}
-					else if( HitSide == HSIDE_Bottom )
+					else if( Ctx.HitSide == HSIDE_Bottom )
 					{
 						// Other get floor slab.
-						if( Other->IsA(FPhysicComponent::MetaClass) )
-							((FPhysicComponent*)Other)->Floor	= Body->Entity;
+						if( Ctx.Other->IsA(FPhysicComponent::MetaClass) )
+							((FPhysicComponent*)Ctx.Other)->Floor	= Body->Entity;
 					}
 				}
 				else
 				{
 					// Bodies don't want to collide, so
 					// touch 'em.
-					if( Solution != HSOL_Oneway )
-					{
-						BeginTouch( Body, Other );
-						BodyAABB = Body->GetAABB();
-					}
+					BeginTouch( Ctx, Body, Ctx.Other );
 				}
 			}
+			Ctx.Hits.SetNum( iFirstHit );
 		}
 
 		//
@@ -1375,18 +1789,18 @@ void CPhysics::PhysicArcade( FPhysicComponent* Body, Float Delta )
 					{
 						TRect OtherRect = Other->GetAABB();
 						if( !ThisRect.IsOverlap(OtherRect) )
-							EndTouch( Body, Other );
+							EndTouch( Ctx, Body, Other );
 					}
 				}
 		}
 		
 		// Process zone.
-		SetBodyZone( Body, DetectedZone );
+		SetBodyZone( Ctx, Body, DetectedZone );
 
 		// Process portal pass.
-		HandlePortals( Body, OldLocation );	
+		HandlePortals( Ctx, Body, OldLocation );	
 	}
-	Level->CollHash->AddToHash( Body );			
+	Ctx.Level->CollHash->AddToHash( Body );			
 }
 
 
@@ -1595,7 +2009,7 @@ void CPhysics::ComputeRigidMaterial( FRigidBodyComponent* Rigid )
 // entity will got a script notification, if NewZone is already
 // entity's zone return false.
 //
-Bool CPhysics::SetBodyZone( FPhysicComponent* Body, FZoneComponent* NewZone )
+Bool CPhysics::SetBodyZone( CPhysicsContext& Ctx, FPhysicComponent* Body, FZoneComponent* NewZone )
 {
 	if	(	
 			( NewZone && NewZone->Entity != Body->Zone ) || 
@@ -1604,7 +2018,7 @@ Bool CPhysics::SetBodyZone( FPhysicComponent* Body, FZoneComponent* NewZone )
 	{
 		// Enter new zone.
 		Body->Zone	= NewZone ? NewZone->Entity : nullptr;
-		Body->Entity->CallEvent( EVENT_OnZoneChange );
+		QueueEvent( Ctx, Body->Entity, EVENT_OnZoneChange, nullptr, Body->Zone );
 		return true;
 	}
 	else
@@ -1623,7 +2037,7 @@ Bool CPhysics::SetBodyZone( FPhysicComponent* Body, FZoneComponent* NewZone )
 // Handle portal features for this entity.
 // during physics performing.
 //
-void CPhysics::HandlePortals( FPhysicComponent* Body, const TVector& OldLocation )
+void CPhysics::HandlePortals( CPhysicsContext& Ctx, FPhysicComponent* Body, const TVector& OldLocation )
 {
 	assert(Body);
 	assert(!Body->IsHashed());
@@ -1632,9 +2046,9 @@ void CPhysics::HandlePortals( FPhysicComponent* Body, const TVector& OldLocation
 	if( Body->Location == OldLocation )
 		return;
 
-	for( Integer iPortal=0; iPortal<Level->Portals.Num(); iPortal++ )
+	for( Integer iPortal=0; iPortal<Ctx.Level->Portals.Num(); iPortal++ )
 	{
-		FPortalComponent* Portal = Level->Portals[iPortal];
+		FPortalComponent* Portal = Ctx.Level->Portals[iPortal];
 
 		if( Portal->IsA(FWarpComponent::MetaClass) )
 		{
@@ -1655,7 +2069,7 @@ void CPhysics::HandlePortals( FPhysicComponent* Body, const TVector& OldLocation
 				)
 			{
 				// Pass through mirror portal.
-				Body->Entity->CallEvent( EVENT_OnWarpPass, Warp->Entity );
+				QueueEvent( Ctx, Body->Entity, EVENT_OnWarpPass, Warp->Entity );
 
 				// Transfer object location & velocity.
 				Body->Location		= Warp->TransferPoint( Body->Location );	
@@ -1682,7 +2096,7 @@ void CPhysics::HandlePortals( FPhysicComponent* Body, const TVector& OldLocation
 				if( Body->Location.Y >= C && Body->Location.Y <= D )
 				{
 					// Pass through mirror portal.
-					Body->Entity->CallEvent( EVENT_OnMirrorPass, Mirror->Entity );
+					QueueEvent( Ctx, Body->Entity, EVENT_OnMirrorPass, Mirror->Entity );
 
 					// Flip forces.
 					Body->Location		= Mirror->TransferPoint( Body->Location );
@@ -1727,7 +2141,7 @@ Bool CPhysics::IsTouch( FPhysicComponent* Body, FBaseComponent* Other )
 // already touched or no available place found,
 // otherwise return true.
 //
-Bool CPhysics::BeginTouch( FPhysicComponent* Body, FBaseComponent* Other )
+Bool CPhysics::BeginTouch( CPhysicsContext& Ctx, FPhysicComponent* Body, FBaseComponent* Other )
 {
 	Integer iA = -1, iB = -1;
 
@@ -1767,10 +2181,10 @@ Bool CPhysics::BeginTouch( FPhysicComponent* Body, FBaseComponent* Other )
 
 		// Touch to A.
 		Body->Touched[iA]	= Other->Entity;
-		Body->Entity->CallEvent( EVENT_OnBeginTouch, Other->Entity );
+		QueueEvent( Ctx, Body->Entity, EVENT_OnBeginTouch, Other->Entity );
 
 		// Anyway notify other.
-		Other->Entity->CallEvent( EVENT_OnBeginTouch, Body->Entity );
+		QueueEvent( Ctx, Other->Entity, EVENT_OnBeginTouch, Body->Entity );
 	}
 	else
 	{
@@ -1787,7 +2201,7 @@ Bool CPhysics::BeginTouch( FPhysicComponent* Body, FBaseComponent* Other )
 // the touched list. Return true if valid entities was touched,
 // otherwise return false.
 //
-Bool CPhysics::EndTouch( FPhysicComponent* Body, FBaseComponent* Other )
+Bool CPhysics::EndTouch( CPhysicsContext& Ctx, FPhysicComponent* Body, FBaseComponent* Other )
 {
 	Integer iA = -1, iB = -1;
 
@@ -1811,7 +2225,7 @@ Bool CPhysics::EndTouch( FPhysicComponent* Body, FBaseComponent* Other )
 	{
 		// They are touched.
 		Body->Touched[iA]	= nullptr;
-		Body->Entity->CallEvent( EVENT_OnEndTouch, Other->Entity );
+		QueueEvent( Ctx, Body->Entity, EVENT_OnEndTouch, Other->Entity );
 
 		if( Phys )
 		{
@@ -1819,7 +2233,7 @@ Bool CPhysics::EndTouch( FPhysicComponent* Body, FBaseComponent* Other )
 			Phys->Touched[iB]	= nullptr;
 		}
 		// Anyway notify other.
-		Other->Entity->CallEvent( EVENT_OnEndTouch, Body->Entity );
+		QueueEvent( Ctx, Other->Entity, EVENT_OnEndTouch, Body->Entity );
 
 		return true;
 	}
@@ -1832,6 +2246,1539 @@ Bool CPhysics::EndTouch( FPhysicComponent* Body, FBaseComponent* Other )
 }
 
 
+
+//
+// Call an entity script event from the solver. Script
+// is not thread-safe, so it's never called from the 
+// worker threads, they queue events and hits instead.
+//
+void CPhysics::CallEvent( CPhysicsContext& Ctx, FEntity* Entity, EEventName Event, FEntity* Other, Integer Side )
+{
+	assert(!Ctx.bWorker);
+
+	// Let script natives know which context to use.
+	CPhysicsContext* OldCurrent	= CPhysicsContext::Current;
+	CPhysicsContext::Current	= &Ctx;
+	{
+		if( Side != -1 )
+			Entity->CallEvent( Event, Other, (Byte)Side );
+		else if( Other )
+			Entity->CallEvent( Event, Other );
+		else
+			Entity->CallEvent( Event );
+	}
+	CPhysicsContext::Current	= OldCurrent;
+}
+
+
+//
+// Queue an entity script event, it will be called by the
+// physics scene after all bodies are resolved. Unlike hit
+// events, such events don't affect the solver.
+//
+void CPhysics::QueueEvent( CPhysicsContext& Ctx, FEntity* Entity, EEventName Event, FEntity* Other, FEntity* Subject )
+{
+	TPhysEvent E;
+	E.Key		= Ctx.EventKey++;
+	E.Entity	= Entity;
+	E.Other		= Other;
+	E.Subject	= Other ? Other : Subject;
+	E.Event		= Event;
+	E.iEvent	= 0;
+	E.bSkip		= false;
+	Ctx.Events.Push( E );
+}
+
+
+/*-----------------------------------------------------------------------------
+    Benchmarks.
+-----------------------------------------------------------------------------*/
+
+//
+// Make a random convex poly. Vertices are placed
+// clockwise on the circle, as BodyToPoly does.
+//
+static void RandomPoly( TPhysPoly& Poly, const TVector& Center, Float Radius )
+{
+	Float Base	= RandomF() * 2.f * PI;
+
+	Poly.Num	= RandomRange( 3, 8 );
+	for( Integer i=0; i<Poly.Num; i++ )
+	{
+		Float Angle		= Base - (i + 0.1f + 0.8f*RandomF()) * 2.f * PI / Poly.Num;
+		Poly.Verts[i]	= Center + TVector( cosf(Angle), sinf(Angle) ) * Radius;
+	}
+	for( Integer i=0; i<Poly.Num; i++ )
+	{
+		TVector N	= Poly.Verts[(i+1) % Poly.Num] - Poly.Verts[i];
+		N.Normalize();
+		Poly.Norms[i]	= N.Cross();
+	}
+
+	PackPoly( &Poly );
+}
+
+
+//
+// Compare packed and scalar SAT on random convex
+// polys pairs, report timings and mismatches.
+//
+void CPhysics::BenchmarkSAT( Integer NumPairs )
+{
+	NumPairs	= Max( NumPairs, 1 );
+
+	TArray<TPhysPoly> Polys;
+	Polys.SetNum( NumPairs * 2 );
+	for( Integer i=0; i<Polys.Num(); i++ )
+		RandomPoly
+		( 
+			Polys[i], 
+			TVector( RandomRange( -4.f, 4.f ), RandomRange( -4.f, 4.f ) ), 
+			RandomRange( 0.5f, 3.f ) 
+		);
+
+	Integer	NumOverlap[2]	= { 0, 0 };
+	Float	TotalTime[2]	= { 0.f, 0.f };
+	Integer	Index;
+	Double	Start;
+
+	// Scalar overlap.
+	Start	= GPlat->TimeStamp();
+	for( Integer i=0; i<NumPairs; i++ )
+	{
+		TPhysPoly& A = Polys[i*2+0], & B = Polys[i*2+1];
+		NumOverlap[0]	+= PolysIsOverlap( A.Verts, A.Num, B.Verts, B.Num );
+	}
+	Double ScalarOverlap	= GPlat->TimeStamp() - Start;
+
+	// Packed overlap.
+	Start	= GPlat->TimeStamp();
+	for( Integer i=0; i<NumPairs; i++ )
+		NumOverlap[1]	+= PolysIsOverlap( &Polys[i*2+0], &Polys[i*2+1] );
+	Double PackedOverlap	= GPlat->TimeStamp() - Start;
+
+	// Scalar least axis.
+	Start	= GPlat->TimeStamp();
+	for( Integer i=0; i<NumPairs; i++ )
+	{
+		TPhysPoly& A = Polys[i*2+0], & B = Polys[i*2+1];
+		TotalTime[0]	+= FindAxisLeastTime( A.Verts, A.Norms, A.Num, B.Verts, B.Norms, B.Num, Index );
+	}
+	Double ScalarAxis	= GPlat->TimeStamp() - Start;
+
+	// Packed least axis.
+	Start	= GPlat->TimeStamp();
+	for( Integer i=0; i<NumPairs; i++ )
+		TotalTime[1]	+= FindAxisLeastTime( &Polys[i*2+0], &Polys[i*2+1], Index );
+	Double PackedAxis	= GPlat->TimeStamp() - Start;
+
+	// Verify results pair by pair.
+	Integer NumMismatches	= 0;
+	for( Integer i=0; i<NumPairs; i++ )
+	{
+		TPhysPoly& A = Polys[i*2+0], & B = Polys[i*2+1];
+
+		Bool	bScalar		= PolysIsOverlap( A.Verts, A.Num, B.Verts, B.Num );
+		Bool	bPacked		= PolysIsOverlap( &A, &B );
+		Float	ScalarTime	= FindAxisLeastTime( A.Verts, A.Norms, A.Num, B.Verts, B.Norms, B.Num, Index );
+		Float	PackedTime	= FindAxisLeastTime( &A, &B, Index );
+
+		if( bScalar != bPacked || Abs(ScalarTime - PackedTime) > 0.001f )
+			NumMismatches++;
+	}
+
+	log( L"** SAT benchmark: %d pairs, %d overlapped, %s", NumPairs, NumOverlap[1], FLU_SSE ? L"SSE2" : L"scalar fallback" );
+	log( L"SAT: overlap scalar %.3f ms, packed %.3f ms, x%.2f", ScalarOverlap*1000.0, PackedOverlap*1000.0, ScalarOverlap/Max(PackedOverlap, 1e-9) );
+	log( L"SAT: least axis scalar %.3f ms, packed %.3f ms, x%.2f", ScalarAxis*1000.0, PackedAxis*1000.0, ScalarAxis/Max(PackedAxis, 1e-9) );
+	log( L"SAT: %d mismatches (%.3f vs %.3f total time)", NumMismatches, TotalTime[0], TotalTime[1] );
+}
+
+
+/*-----------------------------------------------------------------------------
+    CPhysicsScene implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Static variables.
+//
+Bool	CPhysicsScene::bParallel		= false;
+Integer	CPhysicsScene::NumSubsteps		= 1;
+Integer	CPhysicsScene::NumIterations	= 8;
+Bool	CPhysicsScene::bCCD				= true;
+Bool	CPhysicsScene::bCoalesceEvents	= false;
+Bool	CPhysicsScene::bBatchJoints		= true;
+Integer	CPhysicsScene::NumJointIterations	= 8;
+
+
+//
+// Physics scene constructor.
+//
+CPhysicsScene::CPhysicsScene( FLevel* InLevel )
+	:	Level( InLevel ),
+		iSubstep( 0 ),
+		Mark( 0 ),
+		iFreeSleep( 1 ),
+		NumAsleep( 0 ),
+		SubDelta( 0.f ),
+		StatBodies( 0 ),
+		StatSleeping( 0 ),
+		StatIslands( 0 ),
+		StatBuildTime( 0.0 ),
+		StatSolveTime( 0.0 ),
+		StatNarrowTime( 0.0 ),
+		StatSwept( 0 ),
+		StatSweepHits( 0 ),
+		StatSweepTime( 0.0 ),
+		StatJoints( 0 ),
+		StatJointTime( 0.0 ),
+		StatEvents( 0 ),
+		StatCoalesced( 0 ),
+		StatDispatchTime( 0.0 )
+{
+	// Allocate context per each worker.
+	for( Integer i=0; i<GPlat->NumWorkers(); i++ )
+		Contexts.Push( new CPhysicsContext( InLevel ) );
+
+	// Sleep island id 0 means awake body.
+	SleepSizes.Push( 0 );
+	SleepWoken.Push( false );
+}
+
+
+//
+// Physics scene destructor.
+//
+CPhysicsScene::~CPhysicsScene()
+{
+	for( Integer i=0; i<Contexts.Num(); i++ )
+		delete Contexts[i];
+
+	Contexts.Empty();
+}
+
+
+//
+// Simulate all awake rigid bodies.
+//
+void CPhysicsScene::Tick( Float Delta )
+{
+	// Events stats are counted per frame.
+	StatEvents			= 0;
+	StatCoalesced		= 0;
+	StatDispatchTime	= 0.0;
+
+	// Split bodies into islands.
+	Double StartTime	= GPlat->TimeStamp();
+	WakeIslands();
+	BuildIslands( Delta );
+	Double BuildTime	= GPlat->TimeStamp();
+
+	// Solve islands.
+	NumSubsteps	= Clamp( NumSubsteps, 1, 8 );
+	SubDelta	= Delta / NumSubsteps;
+
+	for( iSubstep=0; iSubstep<NumSubsteps; iSubstep++ )
+	{
+		// Scripts answer hits on the main thread, between
+		// collision and solving.
+		if( bParallel && Islands.Num() > 1 && Contexts.Num() > 1 )
+		{
+			// Solve in parallel.
+			for( Integer i=0; i<Contexts.Num(); i++ )
+				Contexts[i]->bWorker	= true;
+
+			GPlat->ParallelFor( CollideIslandJob, this, Islands.Num() );
+
+			for( Integer i=0; i<Contexts.Num(); i++ )
+				Contexts[i]->bWorker	= false;
+
+			AnswerHits();
+
+			for( Integer i=0; i<Contexts.Num(); i++ )
+				Contexts[i]->bWorker	= true;
+
+			GPlat->ParallelFor( SolveIslandJob, this, Islands.Num() );
+
+			for( Integer i=0; i<Contexts.Num(); i++ )
+				Contexts[i]->bWorker	= false;
+		}
+		else
+		{
+			// Solve serially.
+			for( Integer i=0; i<Islands.Num(); i++ )
+				CollideIsland( MainContext(), i );
+
+			AnswerHits();
+
+			for( Integer i=0; i<Islands.Num(); i++ )
+				SolveIsland( MainContext(), i );
+		}
+
+		// Remember impulses for the next step.
+		UpdateCache();
+	}
+
+	// Islands are solved without collision hash
+	// modification, so update all moved objects now.
+	for( Integer i=0; i<Nodes.Num(); i++ )
+	{
+		FBaseComponent* Node = Nodes[i];
+
+		if( Node->IsHashed() && Node->IsA(FPhysicComponent::MetaClass) )
+		{
+			Level->CollHash->RemoveFromHash( Node );
+			Level->CollHash->AddToHash( Node );
+		}
+	}
+
+	// Put resting islands to sleep, after
+	// their bodies are rehashed.
+	Integer NumSlept	= 0;
+	for( Integer i=0; i<Islands.Num(); i++ )
+		if( Islands[i].bResting )
+		{
+			SleepIsland( i );
+			NumSlept	+= Islands[i].NumBodies;
+		}
+
+	if( NumSlept )
+		RemoveFromTick();
+
+	// Update stats.
+	StatBodies		= Bodies.Num() - NumSlept;
+	StatSleeping	+= NumSlept;
+	StatIslands		= Islands.Num();
+	StatBuildTime	= BuildTime - StartTime;
+	StatSolveTime	= GPlat->TimeStamp() - BuildTime;
+	StatNarrowTime	= 0.0;
+	StatSwept		= 0;
+	StatSweepHits	= 0;
+	StatSweepTime	= 0.0;
+	StatJoints		= Joints.Num();
+	StatJointTime	= 0.0;
+
+	for( Integer i=0; i<Contexts.Num(); i++ )
+	{
+		CPhysicsContext* Ctx = Contexts[i];
+
+		StatSwept		+= Ctx->NumSwept;
+		StatSweepHits	+= Ctx->NumSweepHits;
+		StatSweepTime	+= Ctx->SweepTime;
+		StatJointTime	+= Ctx->JointTime;
+		StatNarrowTime	+= Ctx->NarrowTime;
+
+		Ctx->NumSwept		= 0;
+		Ctx->NumSweepHits	= 0;
+		Ctx->SweepTime		= 0.0;
+		Ctx->JointTime		= 0.0;
+		Ctx->NarrowTime		= 0.0;
+	}
+}
+
+
+//
+// An awake body for the sweep along X axis.
+//
+struct TSweptBody
+{
+public:
+	Float		MinX;
+	Integer		iBody;
+};
+
+
+//
+// Swept bodies comparison.
+//
+static Bool SweptBodyCmp( const TSweptBody& A, const TSweptBody& B )
+{
+	return A.MinX < B.MinX;
+}
+
+
+//
+// Whether object is a body of the awake list.
+//
+Bool CPhysicsScene::IsAwakeBody( const TArray<TIslandBody>& Awake, FBaseComponent* Object )
+{
+	FRigidBodyComponent* Rigid = As<FRigidBodyComponent>(Object);
+
+	return	Rigid && 
+			Rigid->iSceneBody >= 0 && 
+			Rigid->iSceneBody < Awake.Num() && 
+			Awake[Rigid->iSceneBody].Body == Rigid;
+}
+
+
+//
+// Split all awake rigid bodies into islands. Each island
+// is a group of bodies that may interact with each other 
+// or share the same moving object this frame, so islands
+// can be solved independently. For each body collect the
+// list of collision candidates in advance, since the
+// collision hash is not thread-safe.
+//
+void CPhysicsScene::BuildIslands( Float Delta )
+{
+	// Prepare.
+	Mark++;
+	Nodes.Empty();
+	Parents.Empty();
+	Islands.Empty();
+	Bodies.Empty();
+	Joints.Empty();
+	Candidates.Empty();
+	Sleepers.Empty();
+
+	// Compute swept bounds of each awake body.
+	TArray<TIslandBody>	Awake;
+	TArray<TRect>		Swept;
+
+	for( Integer i=0; i<Level->RigidBodies.Num(); i++ )
+	{
+		FRigidBodyComponent* Body = Level->RigidBodies[i];
+
+		if( !IsSimulated(Body) )
+			continue;
+
+		// Predict movement, like MoveComplex does. Without 
+		// continuous collision move is limited per substep.
+		TVector	Velocity	= Body->Velocity + Body->Forces * (GetInvMass(Body) * Delta);
+		TVector	Move		= TVector( Abs(Velocity.X * Delta), Abs(Velocity.Y * Delta) );
+		if( !bCCD )
+		{
+			Move.X	= Min( Move.X, Body->Size.X * 0.95f * NumSubsteps );
+			Move.Y	= Min( Move.Y, Body->Size.Y * 0.95f * NumSubsteps );
+		}
+
+		// Any rotation fits in circumscribed bounds.
+		Float Diag		= FastSqrt( Sqr(Body->Size.X) + Sqr(Body->Size.Y) );
+		TRect Bounds	= TRect( Body->Location, Diag );
+		Bounds.Min		-= Move;
+		Bounds.Max		+= Move;
+
+		// Index in the awake list, until bodies are grouped.
+		Body->iSceneBody	= Awake.Num();
+
+		TIslandBody Item;
+		Item.Body				= Body;
+		Item.iFirstCandidate	= 0;
+		Item.NumCandidates		= 0;
+		Item.Zone				= nullptr;
+		Item.OldLocation		= Body->Location;
+		Awake.Push( Item );
+		Swept.Push( Bounds );
+	}
+
+	// Collect other objects, which swept bounds of each
+	// body overlap, and merge interacting bodies. Awake
+	// bodies are paired later by their swept bounds.
+	TArray<FBaseComponent*>	Found;
+	TArray<Integer>			FirstFound( Awake.Num()+1 );
+
+	for( Integer i=0; i<Awake.Num(); i++ )
+	{
+		FRigidBodyComponent*	Body	= Awake[i].Body;
+		Integer					iNode	= GetNode( Body );
+		Integer					NumOverlapped;
+
+		FirstFound[i]	= Found.Num();
+		Level->CollHash->GetOverlapped( Swept[i], NumOverlapped, Overlapped );
+
+		for( Integer j=0; j<NumOverlapped; j++ )
+		{
+			FBaseComponent* Other = Overlapped[j];
+			if( Other == Body || IsAwakeBody( Awake, Other ) )
+				continue;
+
+			Found.Push( Other );
+
+			// Bodies and movers are modified by solver, so
+			// they should belong to the same island.
+			if( Other->IsA(FPhysicComponent::MetaClass) || Other->IsA(FMoverComponent::MetaClass) )
+				MergeNodes( iNode, GetNode(Other) );
+		}
+
+		// Touched objects are notified on untouch.
+		for( Integer j=0; j<array_length(Body->Touched); j++ )
+			if( Body->Touched[j] )
+				MergeNodes( iNode, GetNode(Body->Touched[j]->Base) );
+	}
+	FirstFound[Awake.Num()]	= Found.Num();
+
+	// Pair awake bodies, which swept bounds overlap, sort
+	// and sweep them along X axis.
+	TArray<TSweptBody>	Sorted( Awake.Num() );
+	TArray<Integer>		Pairs;
+
+	for( Integer i=0; i<Awake.Num(); i++ )
+	{
+		Sorted[i].MinX	= Swept[i].Min.X;
+		Sorted[i].iBody	= i;
+	}
+	Sorted.Sort( SweptBodyCmp );
+
+	for( Integer i=0; i<Sorted.Num(); i++ )
+	{
+		Integer iA = Sorted[i].iBody;
+
+		for( Integer j=i+1; j<Sorted.Num() && Sorted[j].MinX <= Swept[iA].Max.X; j++ )
+		{
+			Integer iB = Sorted[j].iBody;
+
+			if( Swept[iA].IsOverlap(Swept[iB]) )
+			{
+				Pairs.Push( iA );
+				Pairs.Push( iB );
+				MergeNodes( GetNode(Awake[iA].Body), GetNode(Awake[iB].Body) );
+			}
+		}
+	}
+
+	// List partners of each body.
+	TArray<Integer> FirstPartner( Awake.Num()+1 );
+	TArray<Integer> Partners( Pairs.Num() );
+
+	for( Integer i=0; i<=Awake.Num(); i++ )
+		FirstPartner[i]	= 0;
+
+	for( Integer i=0; i<Pairs.Num(); i++ )
+		FirstPartner[Pairs[i]+1]++;
+
+	for( Integer i=0; i<Awake.Num(); i++ )
+		FirstPartner[i+1]	+= FirstPartner[i];
+
+	for( Integer i=0; i<Pairs.Num(); i+=2 )
+	{
+		Partners[FirstPartner[Pairs[i]]++]		= Pairs[i+1];
+		Partners[FirstPartner[Pairs[i+1]]++]	= Pairs[i];
+	}
+
+	for( Integer i=Awake.Num(); i>0; i-- )
+		FirstPartner[i]	= FirstPartner[i-1];
+	FirstPartner[0]	= 0;
+
+	// Make candidates lists.
+	for( Integer i=0; i<Awake.Num(); i++ )
+	{
+		TIslandBody& Item = Awake[i];
+
+		Item.iFirstCandidate	= Candidates.Num();
+		for( Integer j=FirstFound[i]; j<FirstFound[i+1]; j++ )
+			Candidates.Push( Found[j] );
+
+		for( Integer j=FirstPartner[i]; j<FirstPartner[i+1]; j++ )
+			Candidates.Push( Awake[Partners[j]].Body );
+
+		Item.NumCandidates	= Candidates.Num() - Item.iFirstCandidate;
+	}
+
+	// Gather joints of simulated bodies, jointed bodies
+	// should belong to the same island.
+	TArray<TIslandJoint> Jointed;
+
+	for( Integer i=0; i<Level->Joints.Num(); i++ )
+	{
+		FJointComponent* Joint = Level->Joints[i];
+
+		if( !IsBatchedJoint(Joint) || Joint->Body1->Base->bDestroyed || Joint->Body2->Base->bDestroyed )
+			continue;
+
+		FRigidBodyComponent* Rigid1 = As<FRigidBodyComponent>(Joint->Body1->Base);
+		FRigidBodyComponent* Rigid2 = As<FRigidBodyComponent>(Joint->Body2->Base);
+
+		TIslandJoint J;
+		J.Joint		= Joint;
+		J.Base1		= Joint->Body1->Base;
+		J.Base2		= Joint->Body2->Base;
+		J.Body1		= Rigid1 && IsSimulated(Rigid1) ? Rigid1 : nullptr;
+		J.Body2		= Rigid2 && IsSimulated(Rigid2) ? Rigid2 : nullptr;
+		J.bHinge	= Joint->IsA(FHingeComponent::MetaClass);
+		J.iIsland	= -1;
+
+		if( !J.Body1 && !J.Body2 )
+			continue;
+
+		// Sleeping body will be awaked on next tick, now
+		// it's static.
+		if( Rigid1 && !J.Body1 )
+			Rigid1->bSleeping	= false;
+		if( Rigid2 && !J.Body2 )
+			Rigid2->bSleeping	= false;
+
+		if( J.Body1 && J.Body2 )
+			MergeNodes( GetNode(J.Body1), GetNode(J.Body2) );
+
+		Jointed.Push( J );
+	}
+
+	// Sentinel, so each body has a valid candidates list.
+	Candidates.Push( nullptr );
+
+	// Refresh polygons of all objects, so workers only
+	// read polygons of objects shared by islands.
+	TVector*	Verts;
+	TVector*	Norms;
+	Integer		Num;
+
+	for( Integer i=0; i<Candidates.Num()-1; i++ )
+		CPhysics::GetPoly( Candidates[i], Verts, Norms, Num );
+
+	for( Integer i=0; i<Nodes.Num(); i++ )
+		CPhysics::GetPoly( Nodes[i], Verts, Norms, Num );
+
+	// Assign islands in order of bodies, to keep
+	// solving order deterministic.
+	TArray<Integer> BodyIsland( Awake.Num() );
+
+	NodeIsland.SetNum( Nodes.Num() );
+	for( Integer i=0; i<Nodes.Num(); i++ )
+		NodeIsland[i]	= -1;
+
+	for( Integer i=0; i<Awake.Num(); i++ )
+	{
+		Integer iRoot = FindRoot( Awake[i].Body->iPhysNode );
+
+		if( NodeIsland[iRoot] == -1 )
+		{
+			TIsland Island;
+			Island.iFirstBody	= 0;
+			Island.NumBodies	= 0;
+			Island.iFirstJoint	= 0;
+			Island.NumJoints	= 0;
+			Island.iFirstHit	= 0;
+			Island.NumHits		= 0;
+			Island.iFirstSleeper	= 0;
+			Island.NumSleepers	= 0;
+			Island.bResting		= false;
+			NodeIsland[iRoot]	= Islands.Push( Island );
+		}
+
+		BodyIsland[i]	= NodeIsland[iRoot];
+		Islands[BodyIsland[i]].NumBodies++;
+	}
+
+	// Group bodies by islands.
+	for( Integer i=0, iFirst=0; i<Islands.Num(); i++ )
+	{
+		Islands[i].iFirstBody	= iFirst;
+		iFirst					+= Islands[i].NumBodies;
+		Islands[i].NumBodies	= 0;
+	}
+
+	Bodies.SetNum( Awake.Num() );
+	for( Integer i=0; i<Awake.Num(); i++ )
+	{
+		TIsland& Island = Islands[BodyIsland[i]];
+		Awake[i].Body->iSceneBody	= Island.iFirstBody + Island.NumBodies;
+		Bodies[Island.iFirstBody + Island.NumBodies++]	= Awake[i];
+	}
+
+	// Group joints by islands.
+	for( Integer i=0; i<Jointed.Num(); i++ )
+	{
+		FRigidBodyComponent* Body = Jointed[i].Body1 ? Jointed[i].Body1 : Jointed[i].Body2;
+
+		Jointed[i].iIsland	= NodeIsland[FindRoot(Body->iPhysNode)];
+		Islands[Jointed[i].iIsland].NumJoints++;
+	}
+
+	for( Integer i=0, iFirst=0; i<Islands.Num(); i++ )
+	{
+		Islands[i].iFirstJoint	= iFirst;
+		iFirst					+= Islands[i].NumJoints;
+		Islands[i].NumJoints	= 0;
+	}
+
+	Joints.SetNum( Jointed.Num() );
+	for( Integer i=0; i<Jointed.Num(); i++ )
+	{
+		TIsland& Island = Islands[Jointed[i].iIsland];
+		Joints[Island.iFirstJoint + Island.NumJoints++]	= Jointed[i];
+	}
+
+	// Group already sleeping bodies, islands rest on, by 
+	// islands, so they fall asleep together.
+	if( NumAsleep == 0 )
+		return;
+
+	TArray<FRigidBodyComponent*>	Resting;
+	TArray<Integer>					RestingIsland;
+
+	for( Integer i=0; i<Nodes.Num(); i++ )
+	{
+		FRigidBodyComponent*	Rigid	= As<FRigidBodyComponent>(Nodes[i]);
+		Integer					iIsland	= NodeIsland[FindRoot(i)];
+
+		if( Rigid && Rigid->iSleepIsland && iIsland != -1 )
+		{
+			Resting.Push( Rigid );
+			RestingIsland.Push( iIsland );
+			Islands[iIsland].NumSleepers++;
+		}
+	}
+
+	for( Integer i=0, iFirst=0; i<Islands.Num(); i++ )
+	{
+		Islands[i].iFirstSleeper	= iFirst;
+		iFirst						+= Islands[i].NumSleepers;
+		Islands[i].NumSleepers		= 0;
+	}
+
+	Sleepers.SetNum( Resting.Num() );
+	for( Integer i=0; i<Resting.Num(); i++ )
+	{
+		TIsland& Island = Islands[RestingIsland[i]];
+		Sleepers[Island.iFirstSleeper + Island.NumSleepers++]	= Resting[i];
+	}
+}
+
+
+//
+// Return an island graph node for the object.
+//
+Integer CPhysicsScene::GetNode( FBaseComponent* Object )
+{
+	if( Object->PhysMark != Mark )
+	{
+		Object->PhysMark	= Mark;
+		Object->iPhysNode	= Nodes.Push( Object );
+		Parents.Push( Object->iPhysNode );
+	}
+	return Object->iPhysNode;
+}
+
+
+//
+// Return a root node of the island.
+//
+Integer CPhysicsScene::FindRoot( Integer iNode )
+{
+	while( Parents[iNode] != iNode )
+	{
+		// Path halving.
+		Parents[iNode]	= Parents[Parents[iNode]];
+		iNode			= Parents[iNode];
+	}
+	return iNode;
+}
+
+
+//
+// Merge islands of two nodes.
+//
+void CPhysicsScene::MergeNodes( Integer iA, Integer iB )
+{
+	Integer RootA	= FindRoot( iA );
+	Integer RootB	= FindRoot( iB );
+
+	if( RootA < RootB )
+		Parents[RootB]	= RootA;
+	else if( RootB < RootA )
+		Parents[RootA]	= RootB;
+}
+
+
+//
+// Integrate forces of all bodies of the island and
+// collide them, hits are recorded for scripts.
+//
+void CPhysicsScene::CollideIsland( CPhysicsContext& Ctx, Integer iIsland )
+{
+	TIsland& Island = Islands[iIsland];
+
+	// Hits are ordered by island, regardless of which
+	// worker collides the island.
+	Ctx.HitKey	= (QWord)iIsland << 32;
+
+	// Integrate forces.
+	for( Integer i=0; i<Island.NumBodies; i++ )
+	{
+		TIslandBody& Item = Bodies[Island.iFirstBody + i];
+
+		Item.OldLocation	= Item.Body->Location;
+		Item.Zone			= nullptr;
+		CPhysics::BeginComplex( Ctx, Item.Body, SubDelta );
+	}
+
+	// Detect collisions and make manifolds.
+	Double NarrowStart	= GPlat->TimeStamp();
+	for( Integer i=0; i<Island.NumBodies; i++ )
+	{
+		Integer			iBody	= Island.iFirstBody + i;
+		TIslandBody&	Item	= Bodies[iBody];
+
+		// Sort list of objects's for proper processing order.
+		if( Ctx.Others.Num() < Item.NumCandidates )
+			Ctx.Others.SetNum( Item.NumCandidates );
+
+		Ctx.NumOthers	= Item.NumCandidates;
+		for( Integer j=0; j<Item.NumCandidates; j++ )
+			Ctx.Others[j]	= Candidates[Item.iFirstCandidate + j];
+
+		if( Ctx.NumOthers > 1 )
+			qsort( &Ctx.Others[0], Ctx.NumOthers, sizeof(FBaseComponent*), MassCompare );
+
+		Ctx.APoly	= CPhysics::GetPoly( Item.Body, Ctx.AVerts, Ctx.ANorms, Ctx.ANum );
+		for( Integer j=0; j<Ctx.NumOthers; j++ )
+			if( !IsHandledPair( iBody, Ctx.Others[j] ) )
+				CPhysics::CollideComplex( Ctx, Item.Body, Ctx.Others[j], Item.Zone );
+	}
+	Ctx.NarrowTime	+= GPlat->TimeStamp() - NarrowStart;
+}
+
+
+//
+// Solve all bodies of the island with sequential
+// impulses, after scripts answered its hits.
+//
+void CPhysicsScene::SolveIsland( CPhysicsContext& Ctx, Integer iIsland )
+{
+	TIsland& Island = Islands[iIsland];
+	Ctx.Manifolds.Empty();
+
+	// Events are ordered by step and island, regardless
+	// of which worker solves the island.
+	Ctx.EventKey	= (QWord)(iSubstep*Islands.Num() + iIsland) << 32;
+
+	// Make manifolds of solid hits.
+	for( Integer i=0; i<Island.NumHits; i++ )
+		CPhysics::ResolveHit( Ctx, Hits[Island.iFirstHit + i] );
+
+	// Solve velocities.
+	for( Integer m=0; m<Ctx.Manifolds.Num(); m++ )
+		CPhysics::PrepareManifold( Ctx.Manifolds[m], FindCached(Ctx.Manifolds[m].Key) );
+
+	Double JointStart = GPlat->TimeStamp();
+	for( Integer j=0; j<Island.NumJoints; j++ )
+		PrepareJoint( Joints[Island.iFirstJoint + j] );
+	Ctx.JointTime	+= GPlat->TimeStamp() - JointStart;
+
+	// Joints and contacts are solved together, so
+	// contacts don't break joints and vice versa.
+	for( Integer iIter=0; iIter<Max( NumIterations, NumJointIterations ); iIter++ )
+	{
+		if( iIter < NumJointIterations && Island.NumJoints > 0 )
+		{
+			JointStart	= GPlat->TimeStamp();
+			for( Integer j=0; j<Island.NumJoints; j++ )
+				SolveJoint( Joints[Island.iFirstJoint + j] );
+			Ctx.JointTime	+= GPlat->TimeStamp() - JointStart;
+		}
+
+		if( iIter < NumIterations )
+			for( Integer m=0; m<Ctx.Manifolds.Num(); m++ )
+				CPhysics::SolveManifold( Ctx.Manifolds[m] );
+	}
+
+	// Move bodies, fast bodies are swept against
+	// their candidates.
+	for( Integer i=0; i<Island.NumBodies; i++ )
+	{
+		TIslandBody& Item = Bodies[Island.iFirstBody + i];
+
+		if( Ctx.Others.Num() < Item.NumCandidates )
+			Ctx.Others.SetNum( Item.NumCandidates );
+
+		Ctx.NumOthers	= Item.NumCandidates;
+		for( Integer j=0; j<Item.NumCandidates; j++ )
+			Ctx.Others[j]	= Candidates[Item.iFirstCandidate + j];
+
+		CPhysics::MoveComplex( Ctx, Item.Body, SubDelta );
+	}
+
+	for( Integer m=0; m<Ctx.Manifolds.Num(); m++ )
+	{
+		TManifold&		M	= Ctx.Manifolds[m];
+		TCachedManifold	C;
+
+		CPhysics::CorrectManifold( M );
+
+		// Store impulses.
+		C.Key		= M.Key;
+		C.NumPoints	= M.NumPoints;
+		for( Integer k=0; k<M.NumPoints; k++ )
+		{
+			C.Points[k].Point	= M.Points[k].Point;
+			C.Points[k].Pn		= M.Points[k].Pn;
+			C.Points[k].Pt		= M.Points[k].Pt;
+		}
+		Ctx.Cache.Push( C );
+	}
+
+	// Handle touches, zones and portals.
+	for( Integer i=0; i<Island.NumBodies; i++ )
+	{
+		TIslandBody& Item = Bodies[Island.iFirstBody + i];
+		CPhysics::EndComplex( Ctx, Item.Body, Item.Zone, Item.OldLocation );
+	}
+
+	// Island may fall asleep only when all its bodies 
+	// are resting long enough.
+	Island.bResting	= true;
+	for( Integer i=0; i<Island.NumBodies; i++ )
+	{
+		FRigidBodyComponent* Body = Bodies[Island.iFirstBody + i].Body;
+
+		if	(
+				Body->Velocity.SizeSquared() <= SLEEP_THRESHOLD &&
+				Abs(Body->AngVelocity) <= SLEEP_ANG_THRESHOLD
+			)
+			Body->SleepTime	+= SubDelta;
+		else
+			Body->SleepTime	= 0.f;
+
+		Island.bResting	= Island.bResting && Body->bCanSleep && Body->SleepTime >= SLEEP_TIME;
+	}
+}
+
+
+//
+// Whether joint should be solved by the scene. Joints of
+// rigid bodies only are solved by the scene, other joints
+// apply forces themselves.
+//
+Bool CPhysicsScene::IsBatchedJoint( FJointComponent* Joint )
+{
+	if( !bBatchJoints || !Joint->Body1 || !Joint->Body2 )
+		return false;
+
+	FSpringComponent* Spring = As<FSpringComponent>(Joint);
+	if( Spring )
+	{
+		// Spring without stiffness and damping doesn't
+		// affect bodies.
+		if( Spring->Spring <= 0.f && Spring->Damping <= 0.f )
+			return false;
+	}
+	else if( !Joint->IsA(FHingeComponent::MetaClass) )
+		return false;
+
+	FPhysicComponent* Phys1 = As<FPhysicComponent>(Joint->Body1->Base);
+	FPhysicComponent* Phys2 = As<FPhysicComponent>(Joint->Body2->Base);
+
+	if	(
+			( Phys1 && !Phys1->IsA(FRigidBodyComponent::MetaClass) ) ||
+			( Phys2 && !Phys2->IsA(FRigidBodyComponent::MetaClass) )
+		)
+		return false;
+
+	// Hinge moves only the second body.
+	if( !Spring )
+		return Phys2 != nullptr;
+
+	return Phys1 || Phys2;
+}
+
+
+//
+// Apply impulse to the joint's bodies.
+//
+void CPhysicsScene::ApplyJointImpulse( TIslandJoint& J, const TVector& P )
+{
+	if( J.Body1 )
+	{
+		J.Body1->Velocity		-= P * J.InvMass1;
+		J.Body1->AngVelocity	-= (J.Rad1 / P) * J.InvIner1;
+	}
+	if( J.Body2 )
+	{
+		J.Body2->Velocity		+= P * J.InvMass2;
+		J.Body2->AngVelocity	+= (J.Rad2 / P) * J.InvIner2;
+	}
+}
+
+
+//
+// Prepare joint for solving. Compute effective masses,
+// bias and apply impulse from the last step. Spring is a 
+// soft distance constraint, hinge is a point constraint.
+//
+void CPhysicsScene::PrepareJoint( TIslandJoint& J )
+{
+	TCoords ToWorld1	= J.Base1->ToWorld(),
+			ToWorld2	= J.Base2->ToWorld();
+
+	J.Rad1		= TransformVectorBy( J.Joint->Hook1, ToWorld1 );
+	J.Rad2		= TransformVectorBy( J.Joint->Hook2, ToWorld2 );
+	J.InvMass1	= J.Body1 && !J.bHinge ? GetInvMass(J.Body1) : 0.f;
+	J.InvIner1	= J.Body1 && !J.bHinge ? GetInvInertia(J.Body1) : 0.f;
+	J.InvMass2	= J.Body2 ? GetInvMass(J.Body2) : 0.f;
+	J.InvIner2	= J.Body2 ? GetInvInertia(J.Body2) : 0.f;
+
+	TVector Delta	= (J.Base2->Location + J.Rad2) - (J.Base1->Location + J.Rad1);
+	Float	InvMass	= J.InvMass1 + J.InvMass2;
+
+	if( !J.bHinge )
+	{
+		// Spring.
+		FSpringComponent* Spring = (FSpringComponent*)J.Joint;
+		Float Length	= Delta.Size();
+
+		J.Axis	= Length > 0.001f ? Delta * (1.f / Length) : TVector( 0.f, 1.f );
+		InvMass	+=	J.InvIner1 * Sqr(J.Rad1 / J.Axis) + 
+					J.InvIner2 * Sqr(J.Rad2 / J.Axis);
+
+		Float Gamma	= SubDelta * (Spring->Damping + SubDelta * Spring->Spring);
+		J.Gamma		= Gamma > 0.f ? 1.f / Gamma : 0.f;
+		J.SpringBias	= (Length - Spring->Length) * SubDelta * Spring->Spring * J.Gamma;
+		InvMass		+= J.Gamma;
+		J.Mass		= InvMass > 0.f ? 1.f / InvMass : 0.f;
+
+		J.Joint->Impulse.Y	= 0.f;
+		ApplyJointImpulse( J, J.Axis * J.Joint->Impulse.X );
+	}
+	else
+	{
+		// Hinge pins only the second body, as unbatched
+		// hinge does, so the first one has infinite mass.
+		J.K11	= InvMass + J.InvIner1*Sqr(J.Rad1.Y) + J.InvIner2*Sqr(J.Rad2.Y);
+		J.K12	= -J.InvIner1*J.Rad1.X*J.Rad1.Y - J.InvIner2*J.Rad2.X*J.Rad2.Y;
+		J.K22	= InvMass + J.InvIner1*Sqr(J.Rad1.X) + J.InvIner2*Sqr(J.Rad2.X);
+		J.Bias	= Delta * (JOINT_BAUMGARTE / SubDelta);
+
+		ApplyJointImpulse( J, J.Joint->Impulse );
+	}
+}
+
+
+//
+// Solve joint velocity constraint.
+//
+void CPhysicsScene::SolveJoint( TIslandJoint& J )
+{
+	// Relative velocity of hooks.
+	TVector Vel	= TVector( 0.f, 0.f );
+	if( J.Body1 )
+		Vel	-= J.Body1->Velocity + (J.Rad1 / J.Body1->AngVelocity);
+	if( J.Body2 )
+		Vel	+= J.Body2->Velocity + (J.Rad2 / J.Body2->AngVelocity);
+
+	if( !J.bHinge )
+	{
+		// Spring.
+		Float Lambda	= -J.Mass * (Vel * J.Axis + J.SpringBias + J.Gamma * J.Joint->Impulse.X);
+
+		J.Joint->Impulse.X	+= Lambda;
+		ApplyJointImpulse( J, J.Axis * Lambda );
+	}
+	else
+	{
+		// Hinge.
+		Float Det	= J.K11*J.K22 - J.K12*J.K12;
+		if( Det == 0.f )
+			return;
+
+		TVector Cdot	= Vel + J.Bias;
+		Float	InvDet	= 1.f / Det;
+		TVector	P		= TVector
+		(
+			-InvDet * (J.K22*Cdot.X - J.K12*Cdot.Y),
+			-InvDet * (J.K11*Cdot.Y - J.K12*Cdot.X)
+		);
+
+		J.Joint->Impulse	+= P;
+		ApplyJointImpulse( J, P );
+	}
+}
+
+
+//
+// Whether the pair of island bodies is already handled,
+// by the other body. Each pair is collided only once.
+//
+Bool CPhysicsScene::IsHandledPair( Integer iBody, FBaseComponent* Other )
+{
+	FRigidBodyComponent* Rigid = As<FRigidBodyComponent>(Other);
+	if( !Rigid )
+		return false;
+
+	Integer iOther = Rigid->iSceneBody;
+	if( iOther < 0 || iOther >= iBody || Bodies[iOther].Body != Rigid )
+		return false;
+
+	FRigidBodyComponent* Body = Bodies[iBody].Body;
+	for( Integer i=0; i<Bodies[iOther].NumCandidates; i++ )
+		if( Candidates[Bodies[iOther].iFirstCandidate + i] == Body )
+			return true;
+
+	return false;
+}
+
+
+//
+// Manifolds comparison.
+//
+static Bool CachedCmp( const TCachedManifold& A, const TCachedManifold& B )
+{
+	return A.Key < B.Key;
+}
+
+
+//
+// Gather impulses of all solved manifolds, to
+// warm start the next step.
+//
+void CPhysicsScene::UpdateCache()
+{
+	Cache.Empty();
+
+	for( Integer i=0; i<Contexts.Num(); i++ )
+	{
+		CPhysicsContext* Ctx = Contexts[i];
+
+		for( Integer j=0; j<Ctx->Cache.Num(); j++ )
+			Cache.Push( Ctx->Cache[j] );
+
+		Ctx->Cache.Empty();
+	}
+
+	Cache.Sort( CachedCmp );
+}
+
+
+//
+// Find impulses of the manifold from the last step,
+// return nullptr if not found.
+//
+const TCachedManifold* CPhysicsScene::FindCached( QWord Key )
+{
+	Integer Low = 0, High = Cache.Num();
+	while( Low < High )
+	{
+		Integer Middle = Low + (High-Low) / 2;
+		if( Cache[Middle].Key < Key )
+			Low		= Middle+1;
+		else
+			High	= Middle;
+	}
+	return Low < Cache.Num() && Cache[Low].Key == Key ? &Cache[Low] : nullptr;
+}
+
+
+//
+// Put all bodies of the island to sleep. Sleeping bodies
+// are removed from the level's tick list after all islands,
+// and not handled by the scene until awaked. Sleep island
+// ids are reused, once all their bodies are awaked or
+// destroyed.
+//
+void CPhysicsScene::SleepIsland( Integer iIsland )
+{
+	TIsland& Island	= Islands[iIsland];
+
+	// Find a free id.
+	while( iFreeSleep < SleepSizes.Num() && SleepSizes[iFreeSleep] != 0 )
+		iFreeSleep++;
+
+	if( iFreeSleep == SleepSizes.Num() )
+	{
+		SleepSizes.Push( 0 );
+		SleepWoken.Push( false );
+	}
+
+	DWord Id	= iFreeSleep;
+	SleepSizes[Id]	= Island.NumBodies;
+
+	for( Integer i=0; i<Island.NumBodies; i++ )
+	{
+		FRigidBodyComponent* Body = Bodies[Island.iFirstBody + i].Body;
+
+		Body->bSleeping		= true;
+		Body->iSleepIsland	= Id;
+		Body->Velocity		= TVector( 0.f, 0.f );
+		Body->Forces		= TVector( 0.f, 0.f );
+		Body->AngVelocity	= 0.f;
+		Body->Torque		= 0.f;
+		Body->bOffTick		= true;
+
+		TickChanged.Push( Body );
+	}
+	NumAsleep	+= Island.NumBodies;
+
+	// Already sleeping bodies, the island is rest on,
+	// will be awaked together with this island.
+	for( Integer i=0; i<Island.NumSleepers; i++ )
+	{
+		FRigidBodyComponent* Rigid = Sleepers[Island.iFirstSleeper + i];
+
+		if( Rigid->iSleepIsland != Id )
+		{
+			SleepSizes[Rigid->iSleepIsland]--;
+			SleepSizes[Id]++;
+			Rigid->iSleepIsland	= Id;
+		}
+	}
+}
+
+
+//
+// Wake up entire sleeping islands, if any of their
+// bodies was awaked by contact or by script. Islands
+// sizes are recounted here, to forget destroyed bodies.
+// Awaked bodies return to their tick list places.
+//
+void CPhysicsScene::WakeIslands()
+{
+	Bool bWoken		= false;
+	StatSleeping	= 0;
+	iFreeSleep		= 1;
+
+	// Nothing sleeps, don't walk all the bodies.
+	if( NumAsleep == 0 )
+		return;
+
+	NumAsleep	= 0;
+	for( Integer i=1; i<SleepSizes.Num(); i++ )
+	{
+		SleepSizes[i]	= 0;
+		SleepWoken[i]	= false;
+	}
+
+	for( Integer i=0; i<Level->RigidBodies.Num(); i++ )
+	{
+		FRigidBodyComponent* Body = Level->RigidBodies[i];
+
+		if( Body->iSleepIsland )
+		{
+			SleepSizes[Body->iSleepIsland]++;
+			NumAsleep++;
+
+			if( !Body->bSleeping || !Body->bCanSleep )
+			{
+				SleepWoken[Body->iSleepIsland]	= true;
+				bWoken							= true;
+			}
+			else
+				StatSleeping++;
+		}
+	}
+
+	if( !bWoken )
+		return;
+
+	for( Integer i=0; i<Level->RigidBodies.Num(); i++ )
+	{
+		FRigidBodyComponent* Body = Level->RigidBodies[i];
+
+		if( Body->iSleepIsland && SleepWoken[Body->iSleepIsland] )
+		{
+			if( Body->bSleeping )
+				StatSleeping--;
+
+			SleepSizes[Body->iSleepIsland]--;
+			NumAsleep--;
+
+			Body->bSleeping		= false;
+			Body->iSleepIsland	= 0;
+			Body->SleepTime		= 0.f;
+
+			// Return to the tick list, only what was
+			// removed from there.
+			if( Body->bOffTick )
+			{
+				TickChanged.Push( Body );
+				Body->bOffTick	= false;
+			}
+		}
+	}
+
+	ReturnToTick();
+}
+
+
+//
+// Tick addons comparison by addition order.
+//
+static Bool TickOrderCmp( CTickAddon* const& A, CTickAddon* const& B )
+{
+	return A->TickOrder < B->TickOrder;
+}
+
+
+//
+// Remove bodies, sent to sleep this tick, from the level's
+// tick list in a single pass. Tick list is sorted by the
+// addition order, so others keep their order.
+//
+void CPhysicsScene::RemoveFromTick()
+{
+	TArray<CTickAddon*>& TickObjects = Level->TickObjects;
+	TickChanged.Sort( TickOrderCmp );
+
+	Integer iChanged = 0, iNew = 0;
+	for( Integer i=0; i<TickObjects.Num(); i++ )
+	{
+		CTickAddon* Addon = TickObjects[i];
+
+		while( iChanged < TickChanged.Num() && TickChanged[iChanged]->TickOrder < Addon->TickOrder )
+			iChanged++;
+
+		if( iChanged < TickChanged.Num() && TickChanged[iChanged] == Addon )
+			iChanged++;
+		else
+			TickObjects[iNew++]	= Addon;
+	}
+
+	TickObjects.SetNum( iNew );
+	TickChanged.Empty();
+}
+
+
+//
+// Return awaked bodies to the level's tick list, to their
+// original places, so the tick order doesn't depend on
+// sleeping. Lists are merged by the addition order.
+//
+void CPhysicsScene::ReturnToTick()
+{
+	if( TickChanged.Num() == 0 )
+		return;
+
+	TArray<CTickAddon*>& TickObjects = Level->TickObjects;
+	TickChanged.Sort( TickOrderCmp );
+
+	Integer iOld = TickObjects.Num() - 1;
+	Integer iNew = iOld + TickChanged.Num();
+	TickObjects.SetNum( iNew + 1 );
+
+	for( Integer i=TickChanged.Num()-1; i>=0; i-- )
+	{
+		while( iOld >= 0 && TickObjects[iOld]->TickOrder > TickChanged[i]->TickOrder )
+			TickObjects[iNew--]	= TickObjects[iOld--];
+
+		TickObjects[iNew--]	= TickChanged[i];
+	}
+
+	TickChanged.Empty();
+}
+
+
+//
+// Events comparison by order.
+//
+static Bool EventKeyCmp( const TPhysEvent& A, const TPhysEvent& B )
+{
+	return A.Key < B.Key;
+}
+
+
+//
+// Call all script events, queued by the solver, in
+// order they were queued. Scripts may safely move or 
+// destroy bodies from here.
+//
+void CPhysicsScene::DispatchEvents()
+{
+	Double StartTime	= GPlat->TimeStamp();
+
+	// Gather events of all contexts.
+	Events.Empty();
+	for( Integer i=0; i<Contexts.Num(); i++ )
+	{
+		CPhysicsContext* Ctx = Contexts[i];
+
+		for( Integer j=0; j<Ctx->Events.Num(); j++ )
+			Events.Push( Ctx->Events[j] );
+
+		Ctx->Events.Empty();
+		Ctx->EventKey	= 0;
+	}
+
+	if( Events.Num() == 0 )
+		return;
+
+	Events.Sort( EventKeyCmp );
+
+	if( bCoalesceEvents )
+		CoalesceEvents();
+
+	// Call events. Event may queue new events,
+	// they will be called on next dispatch.
+	for( Integer i=0; i<Events.Num(); i++ )
+	{
+		TPhysEvent& E = Events[i];
+
+		if( E.bSkip )
+		{
+			StatCoalesced++;
+			continue;
+		}
+
+		if( E.Other )
+			E.Entity->CallEvent( E.Event, E.Other );
+		else
+			E.Entity->CallEvent( E.Event );
+
+		StatEvents++;
+	}
+
+	Events.Empty();
+	StatDispatchTime	+= GPlat->TimeStamp() - StartTime;
+}
+
+
+//
+// Return a group of the event for coalescing. Begin and
+// end touch events of the pair are in the same group.
+//
+static inline Integer EventGroup( EEventName Event )
+{
+	return Event == EVENT_OnEndTouch ? EVENT_OnBeginTouch : Event;
+}
+
+
+//
+// Events comparison by group.
+//
+static Bool EventGroupCmp( const TPhysEvent& A, const TPhysEvent& B )
+{
+	if( A.Entity != B.Entity )
+		return A.Entity < B.Entity;
+
+	if( EventGroup(A.Event) != EventGroup(B.Event) )
+		return EventGroup(A.Event) < EventGroup(B.Event);
+
+	if( A.Subject != B.Subject )
+		return A.Subject < B.Subject;
+
+	return A.Key < B.Key;
+}
+
+
+//
+// Mark duplicate events to skip. Events are duplicate if
+// they have the same entity, kind and subject, which is the
+// other entity or the new zone. Only the first event of the
+// kind is called. Touch events of the pair are alternate, so
+// keep the first one, and the last one if pair returned to
+// the initial state, to notify about short touch.
+//
+void CPhysicsScene::CoalesceEvents()
+{
+	TArray<TPhysEvent> Sorted;
+	for( Integer i=0; i<Events.Num(); i++ )
+	{
+		Events[i].iEvent	= i;
+		Sorted.Push( Events[i] );
+	}
+
+	Sorted.Sort( EventGroupCmp );
+
+	for( Integer iFirst=0, iLast; iFirst<Sorted.Num(); iFirst=iLast+1 )
+	{
+		TPhysEvent& First = Sorted[iFirst];
+
+		// Find the group.
+		iLast	= iFirst;
+		while	(	
+					iLast+1 < Sorted.Num() &&
+					Sorted[iLast+1].Entity == First.Entity &&
+					EventGroup(Sorted[iLast+1].Event) == EventGroup(First.Event) &&
+					Sorted[iLast+1].Subject == First.Subject
+				)
+			iLast++;
+
+		Bool bTouch		= EventGroup(First.Event) == EVENT_OnBeginTouch;
+		Bool bKeepLast	= bTouch && (iLast-iFirst+1) % 2 == 0;
+
+		for( Integer i=iFirst+1; i<=iLast; i++ )
+			if( !(bKeepLast && i == iLast) )
+				Events[Sorted[i].iEvent].bSkip	= true;
+	}
+}
+
+
+//
+// Hits comparison by order.
+//
+static Bool HitKeyCmp( const TPhysHit& A, const TPhysHit& B )
+{
+	return A.Key < B.Key;
+}
+
+
+//
+// Gather hits of all contexts, and let scripts answer
+// them in order, as serial solver does. Hits are grouped
+// by islands for solving.
+//
+void CPhysicsScene::AnswerHits()
+{
+	Hits.Empty();
+	for( Integer i=0; i<Contexts.Num(); i++ )
+	{
+		CPhysicsContext* Ctx = Contexts[i];
+
+		for( Integer j=0; j<Ctx->Hits.Num(); j++ )
+			Hits.Push( Ctx->Hits[j] );
+
+		Ctx->Hits.Empty();
+	}
+
+	Hits.Sort( HitKeyCmp );
+
+	for( Integer i=0; i<Islands.Num(); i++ )
+	{
+		Islands[i].iFirstHit	= 0;
+		Islands[i].NumHits		= 0;
+	}
+
+	for( Integer i=0; i<Hits.Num(); i++ )
+	{
+		TIsland& Island = Islands[(Integer)(Hits[i].Key >> 32)];
+
+		if( Island.NumHits++ == 0 )
+			Island.iFirstHit	= i;
+
+		CPhysics::AnswerHit( MainContext(), Hits[i] );
+	}
+}
+
+
+//
+// Parallel job to collide an island.
+//
+void CPhysicsScene::CollideIslandJob( void* Param, Integer iJob, Integer iWorker )
+{
+	CPhysicsScene* Scene = (CPhysicsScene*)Param;
+	Scene->CollideIsland( *Scene->Contexts[iWorker], iJob );
+}
+
+
+//
+// Parallel job to solve an island.
+//
+void CPhysicsScene::SolveIslandJob( void* Param, Integer iJob, Integer iWorker )
+{
+	CPhysicsScene* Scene = (CPhysicsScene*)Param;
+	Scene->SolveIsland( *Scene->Contexts[iWorker], iJob );
+}
+
+
+//
+// Dump scene info.
+//
+void CPhysicsScene::DebugScene()
+{
+	log( L"** Physics scene \"%s\" info", *Level->GetFullName() );
+	log( L"Phys: %d awake bodies in %d islands", StatBodies, StatIslands );
+	log( L"Phys: %d sleeping bodies", StatSleeping );
+	log( L"Phys: %d workers, parallel %s", Contexts.Num(), bParallel ? L"on" : L"off" );
+	log( L"Phys: %d substeps, %d iterations, %d cached manifolds", NumSubsteps, NumIterations, Cache.Num() );
+	log( L"Phys: islands build %.3f ms, solve %.3f ms (narrow %.3f ms)", StatBuildTime*1000.0, StatSolveTime*1000.0, StatNarrowTime*1000.0 );
+	log( L"Phys: ccd %s, %d sweeps, %d hits, %.3f ms", bCCD ? L"on" : L"off", StatSwept, StatSweepHits, StatSweepTime*1000.0 );
+	log( L"Phys: %d events, %d coalesced, dispatch %.3f ms", StatEvents, StatCoalesced, StatDispatchTime*1000.0 );
+	log
+	( 
+		L"Phys: %d joints, %d iterations, %.3f ms, %.3f ms per 1000 joints", 
+		StatJoints, 
+		NumJointIterations, 
+		StatJointTime*1000.0, 
+		StatJoints > 0 ? StatJointTime*1000.0*1000.0/StatJoints : 0.0 
+	);
+}
+
 /*-----------------------------------------------------------------------------
     The End.
 -----------------------------------------------------------------------------*/
\ No newline at end of file
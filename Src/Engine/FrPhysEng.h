@@ -42,6 +42,206 @@ enum EAxis
 };
 
 
+//
+// A contact point of the manifold.
+//
+struct TContactPoint
+{
+public:
+	TVector			Point;			// World contact location.
+	TVector			RadBody;		// Radius vector from body.
+	TVector			RadOther;		// Radius vector from other.
+	Float			NormalMass;		// Effective mass along normal.
+	Float			TangentMass;	// Effective mass along tangent.
+	Float			Bias;			// Restitution velocity.
+	Float			Pn;				// Accumulated normal impulse.
+	Float			Pt;				// Accumulated tangent impulse.
+};
+
+
+//
+// A contact manifold of two colliding objects.
+//
+struct TManifold
+{
+public:
+	QWord				Key;
+	FPhysicComponent*	Body;
+	FBaseComponent*		Other;
+	FPhysicComponent*	PhysOther;
+	TVector				Normal;
+	Float				Penetration;
+	Float				Friction;
+	Float				Elasticity;
+	Float				BodyInvMass;
+	Float				BodyInvIner;
+	Float				OtherInvMass;
+	Float				OtherInvIner;
+	Integer				NumPoints;
+	TContactPoint		Points[2];
+};
+
+
+//
+// A manifold impulses, stored between steps
+// for warm starting.
+//
+struct TCachedManifold
+{
+public:
+	QWord		Key;
+	Integer		NumPoints;
+	struct
+	{
+		TVector		Point;
+		Float		Pn;
+		Float		Pt;
+	} Points[2];
+};
+
+
+//
+// A script event, deferred by the solver until all
+// bodies are resolved.
+//
+struct TPhysEvent
+{
+public:
+	QWord			Key;
+	FEntity*		Entity;
+	FEntity*		Other;
+	FEntity*		Subject;	// Other, or new zone, events are coalesced by it.
+	EEventName		Event;
+	Integer			iEvent;
+	Bool			bSkip;
+};
+
+
+//
+// A collision hit, recorded by the solver and answered
+// by scripts on the main thread.
+//
+struct TPhysHit
+{
+public:
+	QWord				Key;
+	FPhysicComponent*	Body;
+	FBaseComponent*		Other;
+	TVector				Normal;
+	Float				Penetration;
+	EHitSide			Side;
+	EHitSolution		Solution;
+	Bool				bBrake;
+	Integer				NumConts;
+	TVector				Contacts[2];
+};
+
+
+//
+// A world-space polygon of the collision object, cached
+// between frames. It's rebuilt only when object's
+// transform or shape is changed.
+//
+struct TPhysPoly
+{
+public:
+	// Transform key.
+	TVector			Location;
+	TAngle			Rotation;
+	TVector			Size;
+	Bool			bFixedAngle;
+	TVector			Local[FBrushComponent::MAX_BRUSH_VERTS];
+
+	// Polygon.
+	Integer			Num;
+	TVector			Verts[16];
+	TVector			Norms[16];
+
+	// Polygon vertices in SoA layout, padded with last
+	// vertex up to multiple of 4, for SIMD projection.
+	Integer			PackNum;
+	Float			PackX[16];
+	Float			PackY[16];
+};
+
+
+//
+// A physics solver context. It holds all temporary state of
+// the solver, so each worker thread solves own islands with
+// own context.
+//
+class CPhysicsContext
+{
+public:
+	// Level to solve.
+	FLevel*			Level;
+
+	// Detected collision info.
+	TVector			HitNormal;
+	TVector			HitSlope;
+	Float			HitTime;
+	EHitSide		HitSide;
+
+	// Script communication variables.
+	EHitSolution	Solution;
+	Bool			bBrake;
+
+	// List of collide objects, it grows as needed,
+	// only first NumOthers are valid.
+	FBaseComponent*			Other;
+	TArray<FBaseComponent*>	Others;
+	Integer					NumOthers;
+
+	// Contact manifolds of the island being solved, and
+	// their impulses to warm start the next step.
+	TArray<TManifold>		Manifolds;
+	TArray<TCachedManifold>	Cache;
+
+	// Deferred script events.
+	TArray<TPhysEvent>		Events;
+	QWord					EventKey;
+
+	// Hits to answer by scripts.
+	TArray<TPhysHit>		Hits;
+	QWord					HitKey;
+
+	// Polys, point to the cached polygons.
+	TPhysPoly*		APoly;
+	TPhysPoly*		BPoly;
+	TVector*		AVerts;
+	TVector*		ANorms;
+	TVector*		BVerts;
+	TVector*		BNorms;
+	Integer			ANum;
+	Integer			BNum;
+
+	// Contact info.
+	TVector			Contacts[2];
+	Integer			NumConts;
+
+	// Whether context used by worker thread.
+	Bool			bWorker;
+
+	// Continuous collision stats.
+	Integer			NumSwept;
+	Integer			NumSweepHits;
+	Double			SweepTime;
+
+	// Joints stats.
+	Double			JointTime;
+
+	// Collision detection stats.
+	Double			NarrowTime;
+
+	// Context which script communicates with now, scripts
+	// are called only from the main thread.
+	static CPhysicsContext*	Current;
+
+	// CPhysicsContext interface.
+	CPhysicsContext( FLevel* InLevel );
+};
+
+
 //
 // Rigid-body physics simulator.
 //
@@ -50,68 +250,218 @@ class CPhysics
 public:
 	// Top level physics functions.
 	static void SetupPhysics( FPhysicComponent* Body, Float Delta );
-	static void PhysicComplex( FPhysicComponent* Body, Float Delta );
-	static void PhysicArcade( FPhysicComponent* Body, Float Delta );
+	static void PhysicArcade( CPhysicsContext& Ctx, FPhysicComponent* Body, Float Delta );
 	static void PhysicKeyframe( FKeyframeComponent* Object, Float Delta );
 
+	// Benchmarks.
+	static void BenchmarkSAT( Integer NumPairs );
+
 private:
-	// Detected collision info.
-	static TVector			HitNormal;
-	static TVector			HitSlope;
-	static Float			HitTime;
-	static EHitSide			HitSide;
+	// Complex physics phases.
+	static void BeginComplex( CPhysicsContext& Ctx, FPhysicComponent* Body, Float Delta );
+	static void CollideComplex( CPhysicsContext& Ctx, FPhysicComponent* Body, FBaseComponent* Other, FZoneComponent*& DetectedZone );
+	static void AnswerHit( CPhysicsContext& Ctx, TPhysHit& Hit );
+	static void AddArcadeHit( CPhysicsContext& Ctx, FPhysicComponent* Body );
+	static void ResolveHit( CPhysicsContext& Ctx, const TPhysHit& Hit );
+	static void PrepareManifold( TManifold& M, const TCachedManifold* Cached );
+	static void SolveManifold( TManifold& M );
+	static void CorrectManifold( TManifold& M );
+	static void MoveComplex( CPhysicsContext& Ctx, FPhysicComponent* Body, Float Delta );
+	static TVector SweepComplex( CPhysicsContext& Ctx, FPhysicComponent* Body, const TVector& Move );
+	static void EndComplex( CPhysicsContext& Ctx, FPhysicComponent* Body, FZoneComponent* DetectedZone, const TVector& OldLocation );
 
 	// Collision detection functions.
-	static Bool DetectArcadeCollision( EAxis Axis, FPhysicComponent* Body, FBaseComponent* Other );
-	static Bool DetectComplexCollision();
+	static Bool DetectArcadeCollision( CPhysicsContext& Ctx, EAxis Axis, FPhysicComponent* Body, FBaseComponent* Other );
+	static Bool DetectComplexCollision( CPhysicsContext& Ctx );
 
 	// Touching.
-	static Bool BeginTouch( FPhysicComponent* Body, FBaseComponent* Other );
-	static Bool EndTouch( FPhysicComponent* Body, FBaseComponent* Other );
+	static Bool BeginTouch( CPhysicsContext& Ctx, FPhysicComponent* Body, FBaseComponent* Other );
+	static Bool EndTouch( CPhysicsContext& Ctx, FPhysicComponent* Body, FBaseComponent* Other );
 	static Bool IsTouch( FPhysicComponent* Body, FBaseComponent* Other );
 
+	// Continuous collision.
+	static Bool IsFastBody( FPhysicComponent* Body, const TVector& Move );
+
 	// Portals.
-	static void HandlePortals( FPhysicComponent* Body, const TVector& OldLocation );
+	static void HandlePortals( CPhysicsContext& Ctx, FPhysicComponent* Body, const TVector& OldLocation );
 
 	// Zones.
-	static Bool SetBodyZone( FPhysicComponent* Body, FZoneComponent* NewZone );
+	static Bool SetBodyZone( CPhysicsContext& Ctx, FPhysicComponent* Body, FZoneComponent* NewZone );
 
-	// Other.
-	static void ComputeRigidMaterial( FRigidBodyComponent* Rigid );
+	// Script events.
+	static void CallEvent( CPhysicsContext& Ctx, FEntity* Entity, EEventName Event, FEntity* Other = nullptr, Integer Side = -1 );
+	static void QueueEvent( CPhysicsContext& Ctx, FEntity* Entity, EEventName Event, FEntity* Other = nullptr, FEntity* Subject = nullptr );
 
-	// Script communication variables.
-	static FLevel*			Level;
-	static EHitSolution		Solution;
-	static Bool				bBrake;
-
-	// Complex physics.
-	static Float			BodyInvMass;
-	static Float			BodyInvIner;
-	static Float			OtherInvMass;
-	static Float			OtherInvIner;
-
-	// List of collide objects.
-	static FBaseComponent*	Other;
-	static FBaseComponent*	Others[MAX_COLL_LIST_OBJS];
-	static Integer			NumOthers;
-
-	// Polys.
-	static TVector			AVerts[16];
-	static TVector			ANorms[16];
-	static TVector			BVerts[16];
-	static TVector			BNorms[16];
-	static Integer			ANum;
-	static Integer			BNum;
+	// Polygons cache.
+	static TPhysPoly* GetPoly( FBaseComponent* Body, TVector*& OutVerts, TVector*& OutNorms, Integer& OutNum );
 
-	// Contact info.
-	static TVector			Contacts[2];
-	static Integer			NumConts;
+	// Other.
+	static void ComputeRigidMaterial( FRigidBodyComponent* Rigid );
 
 	// Friends.
 	friend FPhysicComponent;
 	friend FArcadeBodyComponent;
 	friend FRigidBodyComponent;
 	friend FLevel;
+	friend CPhysicsScene;
+};
+
+
+/*-----------------------------------------------------------------------------
+	CPhysicsScene.
+-----------------------------------------------------------------------------*/
+
+//
+// A level physics scene. Splits rigid bodies into islands
+// of bodies that interact each other and solves islands
+// independently, on the worker threads if allowed. Resting
+// islands fall asleep and don't tick until awaked.
+//
+class CPhysicsScene
+{
+public:
+	// Solver settings.
+	static Bool		bParallel;
+	static Integer	NumSubsteps;
+	static Integer	NumIterations;
+	static Bool		bCCD;
+	static Bool		bCoalesceEvents;
+	static Bool		bBatchJoints;
+	static Integer	NumJointIterations;
+
+	// CPhysicsScene interface.
+	CPhysicsScene( FLevel* InLevel );
+	~CPhysicsScene();
+	void Tick( Float Delta );
+	void DispatchEvents();
+	void DebugScene();
+	static Bool IsBatchedJoint( FJointComponent* Joint );
+
+	// Accessors.
+	inline CPhysicsContext& MainContext()
+	{
+		return *Contexts[0];
+	}
+
+private:
+	// An island of bodies.
+	struct TIsland
+	{
+	public:
+		Integer		iFirstBody;
+		Integer		NumBodies;
+		Integer		iFirstJoint;
+		Integer		NumJoints;
+		Integer		iFirstHit;
+		Integer		NumHits;
+		Integer		iFirstSleeper;
+		Integer		NumSleepers;
+		Bool		bResting;
+	};
+
+	// A body to solve.
+	struct TIslandBody
+	{
+	public:
+		FRigidBodyComponent*	Body;
+		Integer					iFirstCandidate;
+		Integer					NumCandidates;
+		FZoneComponent*			Zone;
+		TVector					OldLocation;
+	};
+
+	// A joint to solve. Joints are stored contiguously
+	// and grouped by islands, as bodies.
+	struct TIslandJoint
+	{
+	public:
+		FJointComponent*		Joint;
+		FBaseComponent*			Base1;
+		FBaseComponent*			Base2;
+		FRigidBodyComponent*	Body1;
+		FRigidBodyComponent*	Body2;
+		Bool					bHinge;
+		Float					InvMass1;
+		Float					InvIner1;
+		Float					InvMass2;
+		Float					InvIner2;
+		TVector					Rad1;
+		TVector					Rad2;
+		TVector					Axis;
+		Float					Mass;
+		Float					Gamma;
+		Float					SpringBias;
+		TVector					Bias;
+		Float					K11;
+		Float					K12;
+		Float					K22;
+		Integer					iIsland;
+	};
+
+	// Variables.
+	FLevel*							Level;
+	TArray<CPhysicsContext*>		Contexts;
+	TArray<TIsland>					Islands;
+	TArray<TIslandBody>				Bodies;
+	TArray<TIslandJoint>			Joints;
+	TArray<FBaseComponent*>			Candidates;
+	TArray<FBaseComponent*>			Overlapped;
+	TArray<TCachedManifold>			Cache;
+	TArray<FBaseComponent*>			Nodes;
+	TArray<Integer>					Parents;
+	TArray<Integer>					NodeIsland;
+	TArray<TPhysEvent>				Events;
+	TArray<TPhysHit>				Hits;
+	Integer							iSubstep;
+	DWord							Mark;
+	TArray<Integer>					SleepSizes;
+	TArray<Bool>					SleepWoken;
+	Integer							iFreeSleep;
+	Integer							NumAsleep;
+	TArray<FRigidBodyComponent*>	Sleepers;
+	TArray<CTickAddon*>				TickChanged;
+	Float							SubDelta;
+
+	// Stats.
+	friend CPhysicsReplay;
+	friend CPhysicsBench;
+	Integer		StatBodies;
+	Integer		StatIslands;
+	Integer		StatSleeping;
+	Double		StatBuildTime;
+	Double		StatSolveTime;
+	Double		StatNarrowTime;
+	Integer		StatSwept;
+	Integer		StatSweepHits;
+	Double		StatSweepTime;
+	Integer		StatJoints;
+	Double		StatJointTime;
+	Integer		StatEvents;
+	Integer		StatCoalesced;
+	Double		StatDispatchTime;
+
+	// Internal.
+	void BuildIslands( Float Delta );
+	static Bool IsAwakeBody( const TArray<TIslandBody>& Awake, FBaseComponent* Object );
+	Integer GetNode( FBaseComponent* Object );
+	Integer FindRoot( Integer iNode );
+	void MergeNodes( Integer iA, Integer iB );
+	void CollideIsland( CPhysicsContext& Ctx, Integer iIsland );
+	void AnswerHits();
+	void SolveIsland( CPhysicsContext& Ctx, Integer iIsland );
+	void PrepareJoint( TIslandJoint& J );
+	void ApplyJointImpulse( TIslandJoint& J, const TVector& P );
+	void SolveJoint( TIslandJoint& J );
+	void SleepIsland( Integer iIsland );
+	void WakeIslands();
+	void RemoveFromTick();
+	void ReturnToTick();
+	void UpdateCache();
+	const TCachedManifold* FindCached( QWord Key );
+	Bool IsHandledPair( Integer iBody, FBaseComponent* Other );
+	void CoalesceEvents();
+	static void CollideIslandJob( void* Param, Integer iJob, Integer iWorker );
+	static void SolveIslandJob( void* Param, Integer iJob, Integer iWorker );
 };
 
 
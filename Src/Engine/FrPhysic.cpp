@@ -18,18 +18,29 @@ FJointComponent::FJointComponent()
 		Body1( nullptr ),
 		Body2( nullptr ),
 		Hook1( 0.f, 0.f ),
-		Hook2( 0.f, 0.f )
+		Hook2( 0.f, 0.f ),
+		Impulse( 0.f, 0.f )
 {
 }
 
 
+//
+// Joint destructor.
+//
+FJointComponent::~FJointComponent()
+{
+	com_remove(Joints);
+}
+
+
 //
 // Initialize joint for level.
 //
 void FJointComponent::InitForEntity( FEntity* InEntity )
 {
 	FRectComponent::InitForEntity( InEntity );
-	com_add(TickObjects);
+	com_add_tick();
+	com_add(Joints);
 }
 
 
@@ -205,6 +216,10 @@ void FSpringComponent::PreTick( Float Delta )
 {
 	if( !Body1 || !Body2 )
 		return;
+
+	// Rigid bodies springs are solved by the physics scene.
+	if( CPhysicsScene::IsBatchedJoint( this ) )
+		return;
 	
 	FPhysicComponent* Phys1	= As<FPhysicComponent>( Body1->Base );
 	FPhysicComponent* Phys2	= As<FPhysicComponent>( Body2->Base );
@@ -329,6 +344,10 @@ void FHingeComponent::PreTick( Float Delta )
 	if( !Body1 || !Body2 )
 		return;
 
+	// Rigid bodies hinges are solved by the physics scene.
+	if( CPhysicsScene::IsBatchedJoint( this ) )
+		return;
+
 	FPhysicComponent* Phys2 = As<FPhysicComponent>(Body2->Base);
 	if( !Phys2 )
 		return;
@@ -378,7 +397,7 @@ FKeyframeComponent::FKeyframeComponent()
 void FKeyframeComponent::InitForEntity( FEntity* InEntity )
 {
 	FExtraComponent::InitForEntity( InEntity );
-	com_add(TickObjects);
+	com_add_tick();
 }
 
 
@@ -469,10 +488,10 @@ void FKeyframeComponent::Export( CExporterBase& Ex )
 //
 // Start moving.
 //
-void FKeyframeComponent::nativeStart( CFrame& Frame )
+void FKeyframeComponent::nativeStart( CFrame& Frame, Float InSpeed, Bool bLoop )
 {
-	Speed		= POP_FLOAT;
-	bLooped		= POP_BOOL;
+	Speed		= InSpeed;
+	bLooped		= bLoop;
 	GlideType	= GLIDE_Forward;
 }
 
@@ -490,10 +509,10 @@ void FKeyframeComponent::nativeStop( CFrame& Frame )
 //
 // Move to the key from current location.
 //
-void FKeyframeComponent::nativeMoveTo( CFrame& Frame )
+void FKeyframeComponent::nativeMoveTo( CFrame& Frame, Float InSpeed, Integer iKey )
 {
-	Speed			= POP_FLOAT;
-	iTarget			= Clamp( POP_INTEGER, 0, Points.Num()-1 );
+	Speed			= InSpeed;
+	iTarget			= Clamp( iKey, 0, Points.Num()-1 );
 	StartLocation	= Base->Location;
 	GlideType		= GLIDE_Target;
 	Progress		= 0.f;
@@ -504,18 +523,38 @@ void FKeyframeComponent::nativeMoveTo( CFrame& Frame )
     FRigidBodyComponent implementation.
 -----------------------------------------------------------------------------*/
 
-// Physics per frame iterations count.		
-enum{ NUM_PHYS_ITERS = 3 };
-
-
 //
 // Initialize rigid body.
 //
 FRigidBodyComponent::FRigidBodyComponent()
 	:	FPhysicComponent(),
 		bSleeping( false ),
-		bCanSleep( true )
+		bCanSleep( true ),
+		bBullet( false ),
+		SleepTime( 0.f ),
+		iSleepIsland( 0 ),
+		iSceneBody( -1 ),
+		bOffTick( false )
+{
+}
+
+
+//
+// Rigid body destructor.
+//
+FRigidBodyComponent::~FRigidBodyComponent()
+{
+	com_remove(RigidBodies);
+}
+
+
+//
+// Initialize rigid body for entity.
+//
+void FRigidBodyComponent::InitForEntity( FEntity* InEntity )
 {
+	FPhysicComponent::InitForEntity( InEntity );
+	com_add(RigidBodies);
 }
 
 
@@ -536,16 +575,13 @@ void FRigidBodyComponent::PreTick( Float Delta )
 
 
 //
-// Tick rigid body.
+// Tick rigid body. Physics itself already processed
+// by the level's physics scene.
 //
 void FRigidBodyComponent::Tick( Float Delta )
 {
 	if( !bCanSleep || !bSleeping )
 	{
-		// Process physics.
-		for( Integer i=0; i<NUM_PHYS_ITERS; i++ )
-			CPhysics::PhysicComplex( this, Delta*(1.f/NUM_PHYS_ITERS) );
-
 		// Notify script.
 		Entity->CallEvent( EVENT_OnTick, Delta );
 	}
@@ -561,6 +597,7 @@ void FRigidBodyComponent::SerializeThis( CSerializer& S )
 	SerializeEnum( S, Material );
 	Serialize( S, bCanSleep );
 	Serialize( S, bSleeping );
+	Serialize( S, bBullet );
 	Serialize( S, Inertia );
 	Serialize( S, Forces );
 	Serialize( S, Torque );
@@ -577,6 +614,7 @@ void FRigidBodyComponent::Import( CImporterBase& Im )
 	IMPORT_BYTE( Material );
 	IMPORT_BOOL( bCanSleep );
 	IMPORT_BOOL( bSleeping );
+	IMPORT_BOOL( bBullet );
 	IMPORT_FLOAT( Inertia );
 }
 
@@ -591,6 +629,7 @@ void FRigidBodyComponent::Export( CExporterBase& Ex )
 	EXPORT_BYTE( Material );
 	EXPORT_BOOL( bCanSleep );
 	EXPORT_BOOL( bSleeping );
+	EXPORT_BOOL( bBullet );
 	EXPORT_FLOAT( Inertia );
 }
 
@@ -640,7 +679,7 @@ void FArcadeBodyComponent::PreTick( Float Delta )
 void FArcadeBodyComponent::Tick( Float Delta )
 {
 	// Process physics.
-	CPhysics::PhysicArcade( this, Delta );
+	CPhysics::PhysicArcade( Level->PhysScene->MainContext(), this, Delta );
 
 	// Notify script.
 	Entity->CallEvent( EVENT_OnTick, Delta );
@@ -678,7 +717,7 @@ FPhysicComponent::FPhysicComponent()
 void FPhysicComponent::InitForEntity( FEntity* InEntity )
 {
 	FRectComponent::InitForEntity( InEntity );
-	com_add(TickObjects);
+	com_add_tick();
 }
 
 
@@ -735,10 +774,15 @@ void FPhysicComponent::Import( CImporterBase& Im )
 //
 // Solve solid collision hit.
 //
-void FPhysicComponent::nativeSolveSolid( CFrame& Frame )
+void FPhysicComponent::nativeSolveSolid( CFrame& Frame, Bool bBrake )
 {
-	CPhysics::bBrake	= POP_BOOL || CPhysics::bBrake;
-	CPhysics::Solution	= Max( CPhysics::Solution, HSOL_Solid );
+	// Allowed only from collision event.
+	CPhysicsContext* Ctx = CPhysicsContext::Current;
+	if( Ctx )
+	{
+		Ctx->bBrake		= bBrake || Ctx->bBrake;
+		Ctx->Solution	= Max( Ctx->Solution, HSOL_Solid );
+	}
 }
 
 
@@ -746,30 +790,29 @@ void FPhysicComponent::nativeSolveSolid( CFrame& Frame )
 // Solve oneway collision hit. Very useful
 // for platformer stuff.
 //
-void FPhysicComponent::nativeSolveOneway( CFrame& Frame )
+void FPhysicComponent::nativeSolveOneway( CFrame& Frame, Bool bBrake )
 {
-	CPhysics::bBrake	= POP_BOOL || CPhysics::bBrake;
-	CPhysics::Solution	= Max( CPhysics::Solution, HSOL_Oneway );
+	// Allowed only from collision event.
+	CPhysicsContext* Ctx = CPhysicsContext::Current;
+	if( Ctx )
+	{
+		Ctx->bBrake		= bBrake || Ctx->bBrake;
+		Ctx->Solution	= Max( Ctx->Solution, HSOL_Oneway );
+	}
 }
 
 
 //
 // Return true if object touching other.
 //
-void FPhysicComponent::nativeIsTouching( CFrame& Frame )
+Bool FPhysicComponent::nativeIsTouching( CFrame& Frame, FEntity* Other )
 {
-	FEntity*	Other	= POP_ENTITY;
-	Bool		Result	= false;
-
 	if( Other )
 		for( Integer i=0; i<array_length(Touched); i++ )
 			if( Touched[i] == Other )
-			{
-				Result	= true;
-				break;
-			}
+				return true;
 
-	*POPA_BOOL	= Result;
+	return false;
 }
 
 
@@ -809,7 +852,7 @@ void FMoverComponent::BeginPlay()
 void FMoverComponent::InitForEntity( FEntity* InEntity )
 {
 	FRectComponent::InitForEntity( InEntity );
-	com_add(TickObjects);
+	com_add_tick();
 }
 
 
@@ -929,6 +972,7 @@ REGISTER_CLASS_CPP( FRigidBodyComponent, FPhysicComponent, CLASS_None )
 
 	ADD_PROPERTY( bCanSleep,	TYPE_Bool,		1,	PROP_Editable,	nullptr );
 	ADD_PROPERTY( bSleeping,	TYPE_Bool,		1,	PROP_Editable,	nullptr );
+	ADD_PROPERTY( bBullet,		TYPE_Bool,		1,	PROP_Editable,	nullptr );
 	ADD_PROPERTY( Material,		TYPE_Byte,		1,	PROP_Editable,	_EPhysMaterial );
 
 	return 0;
@@ -220,17 +220,15 @@ void FMirrorComponent::Render( CCanvas* Canvas )
 }
 
 
-void FMirrorComponent::nativeMirrorPoint( CFrame& Frame )
+TVector FMirrorComponent::nativeMirrorPoint( CFrame& Frame, const TVector& P )
 {
-	TVector P = POP_VECTOR;
-	*POPA_VECTOR = TransferPoint( P );
+	return TransferPoint( P );
 }
 
 
-void FMirrorComponent::nativeMirrorVector( CFrame& Frame )
+TVector FMirrorComponent::nativeMirrorVector( CFrame& Frame, const TVector& V )
 {
-	TVector V = POP_VECTOR;
-	*POPA_VECTOR = TransferVector( V );
+	return TransferVector( V );
 }
 
 
@@ -371,17 +369,15 @@ void FWarpComponent::Render( CCanvas* Canvas )
 }
 
 
-void FWarpComponent::nativeWarpPoint( CFrame& Frame )
+TVector FWarpComponent::nativeWarpPoint( CFrame& Frame, const TVector& P )
 {
-	TVector P = POP_VECTOR;
-	*POPA_VECTOR = Other ? TransferPoint( P ) : P;
+	return Other ? TransferPoint( P ) : P;
 }
 
 
-void FWarpComponent::nativeWarpVector( CFrame& Frame )
+TVector FWarpComponent::nativeWarpVector( CFrame& Frame, const TVector& V )
 {
-	TVector V = POP_VECTOR;
-	*POPA_VECTOR = Other ? TransferVector( V ) : V;
+	return Other ? TransferVector( V ) : V;
 }
 
 
@@ -0,0 +1,326 @@
+/*=============================================================================
+    FrReplay.cpp: Physics replay and regression harness.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+#include "Engine.h"
+
+/*-----------------------------------------------------------------------------
+    CPhysicsReplay implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Trace file signature.
+//
+#define REPLAY_SIGNATURE	L"FluPhysTrace"
+
+
+//
+// Add a bytes to the FNV-1a hash.
+//
+static inline DWord HashBytes( DWord Hash, const void* Data, Integer Size )
+{
+	const Byte* Walk = (const Byte*)Data;
+	for( Integer i=0; i<Size; i++ )
+		Hash	= (Hash ^ Walk[i]) * 16777619;
+
+	return Hash;
+}
+
+
+//
+// Replay constructor.
+//
+CPhysicsReplay::CPhysicsReplay()
+	:	Mode( RPL_None ),
+		Seed( 0 ),
+		Delta( 1.f/60.f ),
+		Scene( -1 ),
+		NumObjects( 0 ),
+		Level( nullptr ),
+		Input( nullptr ),
+		iFrame( 0 ),
+		iDiverged( -1 ),
+		DivergedHash( 0 ),
+		FrameStart( 0.0 ),
+		TickTime( 0.0 ),
+		MaxTickTime( 0.0 ),
+		BuildTime( 0.0 ),
+		SolveTime( 0.0 ),
+		SweepTime( 0.0 )
+{
+}
+
+
+//
+// Start recording of the level. Level should be just
+// started, and random generator seeded with InSeed.
+//
+void CPhysicsReplay::StartRecord( FLevel* InLevel, CInput* InInput, DWord InSeed, Float InDelta )
+{
+	assert(InLevel && InInput);
+
+	Mode		= RPL_Record;
+	Level		= InLevel;
+	Input		= InInput;
+	Seed		= InSeed;
+	Delta		= InDelta;
+	iFrame		= 0;
+	iDiverged	= -1;
+	Frames.Empty();
+}
+
+
+//
+// Start verification of the loaded trace. Level should be
+// just started, and random generator seeded with Seed.
+//
+void CPhysicsReplay::StartVerify( FLevel* InLevel, CInput* InInput )
+{
+	assert(InLevel && InInput);
+
+	Mode		= RPL_Verify;
+	Level		= InLevel;
+	Input		= InInput;
+	iFrame		= 0;
+	iDiverged	= -1;
+}
+
+
+//
+// Begin a frame, before level tick. Record the
+// input or replay recorded input.
+//
+void CPhysicsReplay::BeginFrame()
+{
+	if( Mode == RPL_Record )
+	{
+		// Store input state.
+		TFrame Frame;
+		MemZero( &Frame, sizeof(TFrame) );
+
+		for( Integer iKey=0; iKey<KEY_MAX; iKey++ )
+			if( Input->Keys[iKey] )
+				Frame.Keys[iKey >> 5]	|= 1 << (iKey & 31);
+
+		Frame.MouseX		= Input->MouseX;
+		Frame.MouseY		= Input->MouseY;
+		Frame.WorldCursor	= Input->WorldCursor;
+		Frames.Push( Frame );
+	}
+	else if( Mode == RPL_Verify && iFrame < Frames.Num() )
+	{
+		// Press and unpress keys, as it was recorded.
+		TFrame& Frame = Frames[iFrame];
+
+		for( Integer iKey=0; iKey<KEY_MAX; iKey++ )
+		{
+			Bool bPressed = (Frame.Keys[iKey >> 5] & (1 << (iKey & 31))) != 0;
+
+			if( bPressed && !Input->Keys[iKey] )
+				Input->OnKeyDown( iKey );
+			else if( !bPressed && Input->Keys[iKey] )
+				Input->OnKeyUp( iKey );
+		}
+
+		Input->MouseX		= Frame.MouseX;
+		Input->MouseY		= Frame.MouseY;
+		Input->WorldCursor	= Frame.WorldCursor;
+	}
+
+	FrameStart	= GPlat->TimeStamp();
+}
+
+
+//
+// End a frame, after level tick. Hash all bodies and
+// compare against the trace.
+//
+void CPhysicsReplay::EndFrame()
+{
+	if( Mode == RPL_None || iFrame >= Frames.Num() )
+		return;
+
+	// Count timings.
+	Double Time	= GPlat->TimeStamp() - FrameStart;
+	TickTime	+= Time;
+	MaxTickTime	= Max( MaxTickTime, Time );
+
+	if( Level->PhysScene )
+	{
+		BuildTime	+= Level->PhysScene->StatBuildTime;
+		SolveTime	+= Level->PhysScene->StatSolveTime;
+		SweepTime	+= Level->PhysScene->StatSweepTime;
+	}
+
+	// Hash bodies.
+	DWord Hash	= HashLevel();
+
+	if( Mode == RPL_Record )
+	{
+		Frames[iFrame].Hash	= Hash;
+	}
+	else if( iDiverged == -1 && Frames[iFrame].Hash != Hash )
+	{
+		iDiverged		= iFrame;
+		DivergedHash	= Hash;
+		log( L"Replay: Divergence at frame %d", iFrame );
+	}
+
+	iFrame++;
+}
+
+
+//
+// Hash transforms and velocities of all physics bodies
+// of the level, in order of entities.
+//
+DWord CPhysicsReplay::HashLevel()
+{
+	return HashBodies( Level, 2166136261 );
+}
+
+
+//
+// Continue the hash with transforms and velocities of
+// all physics bodies of the level.
+//
+DWord CPhysicsReplay::HashBodies( FLevel* Level, DWord Hash )
+{
+	for( Integer i=0; i<Level->Entities.Num(); i++ )
+	{
+		FPhysicComponent* Body = As<FPhysicComponent>(Level->Entities[i]->Base);
+		if( !Body )
+			continue;
+
+		Hash	= HashBytes( Hash, &Body->Location, sizeof(TVector) );
+		Hash	= HashBytes( Hash, &Body->Rotation, sizeof(TAngle) );
+		Hash	= HashBytes( Hash, &Body->Velocity, sizeof(TVector) );
+		Hash	= HashBytes( Hash, &Body->AngVelocity, sizeof(Float) );
+	}
+
+	return Hash;
+}
+
+
+//
+// Report replay results.
+//
+void CPhysicsReplay::Report()
+{
+	Integer NumFrames	= Max( iFrame, 1 );
+
+	log( L"** Physics replay: %d frames, seed %u, delta %.4f", iFrame, Seed, Delta );
+
+	if( Mode == RPL_Verify )
+	{
+		if( iDiverged != -1 )
+			log
+			(
+				L"Replay: FAILED, diverged at frame %d (expected %08x, got %08x)",
+				iDiverged,
+				Frames[iDiverged].Hash,
+				DivergedHash
+			);
+		else
+			log( L"Replay: PASSED, all frames match the trace" );
+	}
+
+	log( L"Replay: tick %.3f ms avg, %.3f ms max", TickTime*1000.0/NumFrames, MaxTickTime*1000.0 );
+	log( L"Replay: islands build %.3f ms avg", BuildTime*1000.0/NumFrames );
+	log( L"Replay: islands solve %.3f ms avg, ccd %.3f ms avg", SolveTime*1000.0/NumFrames, SweepTime*1000.0/NumFrames );
+	log( L"Replay: other %.3f ms avg", (TickTime-BuildTime-SolveTime)*1000.0/NumFrames );
+}
+
+
+//
+// Load a trace from the file. Return true if
+// loaded successfully.
+//
+Bool CPhysicsReplay::LoadTrace( String FileName )
+{
+	if( !GPlat->FileExists(FileName) )
+		return false;
+
+	CTextReader	Reader( FileName );
+	Integer		NumFrames	= 0;
+	DWord		DeltaBits	= 0;
+
+	// Benchmark scene is optional.
+	Scene		= -1;
+	NumObjects	= 0;
+	if( swscanf( *Reader.ReadLine(), REPLAY_SIGNATURE L" %u %x %d %d %d", &Seed, &DeltaBits, &NumFrames, &Scene, &NumObjects ) < 3 )
+		return false;
+
+	Delta	= *(Float*)&DeltaBits;
+	Frames.SetNum( NumFrames );
+
+	for( Integer i=0; i<NumFrames; i++ )
+	{
+		TFrame&	Frame	= Frames[i];
+		String	Line	= Reader.ReadLine();
+		DWord	X, Y;
+
+		if	(
+				swscanf
+				(
+					*Line,
+					L"%x %x %x %x %x %x %x %x %x %d %d %x %x",
+					&Frame.Hash,
+					&Frame.Keys[0], &Frame.Keys[1], &Frame.Keys[2], &Frame.Keys[3],
+					&Frame.Keys[4], &Frame.Keys[5], &Frame.Keys[6], &Frame.Keys[7],
+					&Frame.MouseX, &Frame.MouseY,
+					&X, &Y
+				) != 13
+			)
+		{
+			Frames.Empty();
+			return false;
+		}
+
+		Frame.WorldCursor.X	= *(Float*)&X;
+		Frame.WorldCursor.Y	= *(Float*)&Y;
+	}
+
+	return true;
+}
+
+
+//
+// Save recorded trace to the file. Floats are stored
+// as raw bits, so trace is reproducible exactly.
+//
+Bool CPhysicsReplay::SaveTrace( String FileName )
+{
+	if( Mode != RPL_Record )
+		return false;
+
+	CTextWriter Writer( FileName );
+
+	Writer.WriteString( String::Format( REPLAY_SIGNATURE L" %u %x %d %d %d", Seed, *(DWord*)&Delta, iFrame, Scene, NumObjects ) );
+
+	for( Integer i=0; i<iFrame; i++ )
+	{
+		TFrame& Frame = Frames[i];
+
+		Writer.WriteString
+		(
+			String::Format
+			(
+				L"%08x %x %x %x %x %x %x %x %x %d %d %x %x",
+				Frame.Hash,
+				Frame.Keys[0], Frame.Keys[1], Frame.Keys[2], Frame.Keys[3],
+				Frame.Keys[4], Frame.Keys[5], Frame.Keys[6], Frame.Keys[7],
+				Frame.MouseX, Frame.MouseY,
+				*(DWord*)&Frame.WorldCursor.X, *(DWord*)&Frame.WorldCursor.Y
+			)
+		);
+	}
+
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
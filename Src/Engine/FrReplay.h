@@ -0,0 +1,97 @@
+/*=============================================================================
+    FrReplay.h: Physics replay and regression harness.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    CPhysicsReplay.
+-----------------------------------------------------------------------------*/
+
+//
+// A replay mode.
+//
+enum EReplayMode
+{
+	RPL_None,			// Replay is not started.
+	RPL_Record,			// Record input and trace of played level.
+	RPL_Verify			// Replay input and compare against trace.
+};
+
+
+//
+// A physics replay. It records per-frame input and hash of
+// all physics bodies of the level, played with fixed delta
+// and known random seed. Later the recorded trace can be
+// replayed without render and audio, to verify physics
+// still produce the same bodies transforms and velocities,
+// and to measure physics phases timing.
+//
+class CPhysicsReplay
+{
+public:
+	// Variables.
+	EReplayMode		Mode;
+	DWord			Seed;
+	Float			Delta;
+	Integer			Scene;			// Benchmark scene, or -1 for level.
+	Integer			NumObjects;		// Benchmark scene objects.
+
+	// CPhysicsReplay interface.
+	CPhysicsReplay();
+	void StartRecord( FLevel* InLevel, CInput* InInput, DWord InSeed, Float InDelta );
+	void StartVerify( FLevel* InLevel, CInput* InInput );
+	void BeginFrame();
+	void EndFrame();
+	void Report();
+	static DWord HashBodies( FLevel* Level, DWord Hash );
+
+	// Trace file.
+	Bool LoadTrace( String FileName );
+	Bool SaveTrace( String FileName );
+
+	// Accessors.
+	inline Bool IsFinished() const
+	{
+		return Mode == RPL_Verify && iFrame >= Frames.Num();
+	}
+	inline Integer NumFrames() const
+	{
+		return Frames.Num();
+	}
+
+private:
+	// A frame record.
+	struct TFrame
+	{
+	public:
+		DWord		Hash;
+		DWord		Keys[(KEY_MAX+31)/32];
+		Integer		MouseX;
+		Integer		MouseY;
+		TVector		WorldCursor;
+	};
+
+	// Variables.
+	FLevel*			Level;
+	CInput*			Input;
+	TArray<TFrame>	Frames;
+	Integer			iFrame;
+	Integer			iDiverged;
+	DWord			DivergedHash;
+
+	// Timings.
+	Double			FrameStart;
+	Double			TickTime;
+	Double			MaxTickTime;
+	Double			BuildTime;
+	Double			SolveTime;
+	Double			SweepTime;
+
+	// Internal.
+	DWord HashLevel();
+};
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
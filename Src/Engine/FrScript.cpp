@@ -19,6 +19,7 @@ FScript::FScript()
 	bHasText		= false;
 	iFamily			= -1;
 	InstanceSize	= 0;
+	SourceHash		= 0;
 	InstanceBuffer	= nullptr;
 	Thread			= nullptr;
 	Base			= nullptr;
@@ -62,6 +63,7 @@ FScript::~FScript()
 	Functions.Empty();
 	Events.Empty();
 	ResTable.Empty();
+	StrTable.Empty();
 }
 
 
@@ -94,6 +96,10 @@ void FScript::EditChange()
 void FScript::PostLoad()
 {
 	FResource::PostLoad();
+
+	// Link code now, to avoid hitches while
+	// playing.
+	CLinkedCode::LinkScript( this );
 }
 
 
@@ -207,6 +213,87 @@ CFunction* FScript::FindEvent( const Char* InName )
 }
 #endif
 
+/*-----------------------------------------------------------------------------
+    Constant strings pool.
+-----------------------------------------------------------------------------*/
+
+//
+// All interned strings, hashed by the text. Strings, no
+// one refers to but the pool, are dropped lazily, when
+// their bucket is visited, or when the pool is swept.
+//
+#define STRING_POOL_SIZE	1024
+
+static TArray<String>	GStringPool[STRING_POOL_SIZE];
+static Integer			GNumPooled	= 0;
+static Integer			GSweepAt	= STRING_POOL_SIZE;
+
+
+//
+// Drop unreferenced strings from the pool bucket.
+//
+static void SweepStringBucket( TArray<String>& Bucket )
+{
+	for( Integer i=0; i<Bucket.Num(); )
+		if( Bucket[i].RefsCount() == 1 )
+		{
+			Bucket.Remove( i );
+			GNumPooled--;
+		}
+		else
+			i++;
+}
+
+
+//
+// Return a shared copy of the string. Pool holds a
+// reference, so string data is never reallocated and
+// loading of the constant is just a refcount increment.
+//
+String FScript::InternString( const String& InStr )
+{
+	if( !InStr )
+		return InStr;
+
+	TArray<String>& Bucket = GStringPool[InStr.HashCode() & (STRING_POOL_SIZE-1)];
+	for( Integer i=0; i<Bucket.Num(); i++ )
+		if( Bucket[i] == InStr )
+			return Bucket[i];
+
+	// Sweep whole pool, when it doubles since the
+	// last sweep, so it's amortized.
+	SweepStringBucket( Bucket );
+	if( GNumPooled >= GSweepAt )
+	{
+		for( Integer i=0; i<STRING_POOL_SIZE; i++ )
+			SweepStringBucket( GStringPool[i] );
+		GSweepAt	= Max( GNumPooled*2, STRING_POOL_SIZE );
+	}
+
+	Bucket.Push( InStr );
+	GNumPooled++;
+	return InStr;
+}
+
+
+//
+// Add a string constant to the script's table, if it's
+// not there yet. Return an index of constant, or -1 if
+// table is full, since code refers it by word.
+//
+Integer FScript::AddString( const String& InStr )
+{
+	Integer iStr = StrTable.FindItem( InStr );
+	if( iStr == -1 )
+	{
+		if( StrTable.Num() >= 65536 )
+			return -1;
+		iStr = StrTable.Push( InternString( InStr ) );
+	}
+	return iStr;
+}
+
+
 /*-----------------------------------------------------------------------------
     Script serialization.
 -----------------------------------------------------------------------------*/
@@ -422,8 +509,14 @@ void FScript::SerializeThis( CSerializer& S )
 	{
 		Serialize( S, iFamily );
 		Serialize( S, ResTable );
+		Serialize( S, StrTable );
 		Serialize( S, InstanceSize );
 
+		// Share loaded constants.
+		if( S.GetMode() == SM_Load )
+			for( Integer i=0; i<StrTable.Num(); i++ )
+				StrTable[i]	= InternString( StrTable[i] );
+
 		if( S.GetMode() == SM_Undefined )
 			Serialize( S, Text );
 
@@ -507,6 +600,7 @@ CBytecode::CBytecode()
 {
 	iLine	= -1;
 	iPos	= -1;
+	Linked	= nullptr;
 }
 
 
@@ -515,6 +609,7 @@ CBytecode::CBytecode()
 //
 CBytecode::~CBytecode()
 {
+	freeandnil(Linked);
 	Code.Empty();
 }
 
@@ -17,6 +17,7 @@ public:
 	TArray<Byte>		Code;
 	Integer				iLine	: 20;
 	Integer				iPos	: 12;
+	CLinkedCode*		Linked;
 
 	// CBytecode interface.
 	CBytecode();
@@ -135,6 +136,18 @@ public:
 	// Table of resources uses in bytecode.
 	TArray<FResource*>			ResTable;
 
+	// Table of string constants used in bytecode.
+	// Strings are interned, so identical literals
+	// share the same data across all scripts.
+	TArray<String>				StrTable;
+
+	// Incremental compilation info, it's not serialized,
+	// so the first compilation after loading is complete.
+	// Hash of the source script was compiled from, and
+	// names of scripts its code depends on.
+	DWord						SourceHash;
+	TArray<String>				Depends;
+
 	// FScript interface.
 	FScript();
 	~FScript();
@@ -150,6 +163,10 @@ public:
 	// FluScript functions.
 	CFunction* FindEvent( const Char* InName );
 	void ReorderEvents();
+	Integer AddString( const String& InStr );
+
+	// Constant strings pool.
+	static String InternString( const String& InStr );
 };
 
 
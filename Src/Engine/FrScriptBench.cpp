@@ -0,0 +1,841 @@
+/*=============================================================================
+    FrScriptBench.cpp: Script virtual machine benchmark.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+#include "Engine.h"
+
+/*-----------------------------------------------------------------------------
+    CScriptBench implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Benchmark magic numbers.
+//
+#define BENCH_LOOPS			1000		// Loop iterations per kernel call.
+#define BENCH_FIB			7			// Fibonacci number to compute, 41 calls.
+#define BENCH_ENTITIES		10000		// Entities which receive events.
+#define BENCH_STATES		40			// States of the switch kernels.
+
+// Kernels locals layout.
+#define LOCAL_I				0			// integer i.
+#define LOCAL_SUM			4			// integer sum.
+#define LOCAL_F				8			// float f.
+#define LOCAL_G				12			// float g.
+#define LOCAL_S				16			// string s.
+
+
+//
+// Kernels names, used in reports.
+//
+static const Char* GBenchNames[SBENCH_MAX] =
+{
+	L"Arithmetic",
+	L"Strings",
+	L"Calls",
+	L"EmptyCalls",
+	L"Fib",
+	L"Natives",
+	L"NativeScalar",
+	L"NativeVector",
+	L"NativeString",
+	L"NativeColor",
+	L"NativeMethod",
+	L"SwitchLinear",
+	L"SwitchTable",
+	L"SwitchSearch",
+	L"Constants",
+	L"Events"
+};
+
+
+//
+// Append a value to the function's bytecode.
+//
+template<class T> static void Emit( CFunction* Func, T Value )
+{
+	Integer i = Func->Code.Num();
+	Func->Code.SetNum( i + sizeof(T) );
+	*(T*)&Func->Code[i] = Value;
+}
+
+
+//
+// Append an opcode with a register operand.
+//
+static void EmitOp( CFunction* Func, Byte Op, Byte iReg )
+{
+	Emit<Byte>( Func, Op );
+	Emit<Byte>( Func, iReg );
+}
+
+
+//
+// Append an opcode with two register operands.
+//
+static void EmitOp( CFunction* Func, Byte Op, Byte iReg1, Byte iReg2 )
+{
+	Emit<Byte>( Func, Op );
+	Emit<Byte>( Func, iReg1 );
+	Emit<Byte>( Func, iReg2 );
+}
+
+
+//
+// Append a local variable address.
+//
+static void EmitLocal( CFunction* Func, Byte iReg, Word Offset )
+{
+	Emit<Byte>( Func, CODE_LocalVar );
+	Emit<Byte>( Func, iReg );
+	Emit<Word>( Func, Offset );
+}
+
+
+//
+// Benchmark constructor. Build a transient script
+// with all kernels.
+//
+CScriptBench::CScriptBench()
+	:	Script( nullptr ),
+		Entity( nullptr )
+{
+	Script					= NewObject<FScript>( L"ScriptBench" );
+	Script->bHasText		= true;
+	Script->InstanceBuffer	= new CInstanceBuffer( Script );
+
+	Entity					= NewObject<FEntity>( L"ScriptBenchEntity" );
+	Entity->Script			= Script;
+
+	// Base component for the methods kernel, entity is
+	// out of level, so it's never hashed.
+	FRectComponent* Base	= NewObject<FRectComponent>( L"ScriptBenchBase" );
+	Base->Entity			= Entity;
+	Entity->Base			= Base;
+
+	// function Add( integer a, integer b ): integer
+	// {
+	//     result = a + b;
+	// }
+	CFunction* Add = AddFunction( L"Add" );
+	Add->Locals.Push( new CProperty( CTypeInfo(TYPE_Integer), L"A", PROP_None, 0 ) );
+	Add->Locals.Push( new CProperty( CTypeInfo(TYPE_Integer), L"B", PROP_None, 4 ) );
+	Add->Locals.Push( new CProperty( CTypeInfo(TYPE_Integer), L"Result", PROP_None, 8 ) );
+	Add->ParmsCount	= 2;
+	Add->ResultVar	= Add->Locals[2];
+	Add->FrameSize	= 12;
+	Add->Flags		= FUNC_HasResult;
+
+	EmitLocal( Add, 0, 8 );
+	EmitLocal( Add, 1, 0 );
+	EmitOp( Add, CODE_LToRDWord, 1 );
+	EmitLocal( Add, 2, 4 );
+	EmitOp( Add, CODE_LToRDWord, 2 );
+	EmitOp( Add, BIN_Add_Integer, 1, 2 );
+	EmitOp( Add, CODE_AssignDWord, 0, 1 );
+	Emit<Byte>( Add, CODE_EOC );
+
+	// function Nop()
+	// {
+	// }
+	CFunction* Nop = AddFunction( L"Nop" );
+	Emit<Byte>( Nop, CODE_EOC );
+
+	// function Fib( integer n ): integer
+	// {
+	//     if( n < 2 )
+	//         result = n;
+	//     else
+	//         result = Fib( n-1 ) + Fib( n-2 );
+	// }
+	CFunction* Fib = AddFunction( L"Fib" );
+	Fib->Locals.Push( new CProperty( CTypeInfo(TYPE_Integer), L"N", PROP_None, 0 ) );
+	Fib->Locals.Push( new CProperty( CTypeInfo(TYPE_Integer), L"Result", PROP_None, 4 ) );
+	Fib->ParmsCount	= 1;
+	Fib->ResultVar	= Fib->Locals[1];
+	Fib->FrameSize	= 8;
+	Fib->Flags		= FUNC_HasResult;
+
+	EmitLocal( Fib, 0, 0 );
+	EmitOp( Fib, CODE_LToRDWord, 0 );
+	Emit<Byte>( Fib, CODE_ConstInteger );
+	Emit<Integer>( Fib, 2 );
+	Emit<Byte>( Fib, 1 );
+	EmitOp( Fib, BIN_Less_Integer, 0, 1 );
+	Emit<Byte>( Fib, CODE_JumpZero );
+	Integer iElse = Fib->Code.Num();
+	Emit<Word>( Fib, 0 );
+	Emit<Byte>( Fib, 0 );
+
+	EmitLocal( Fib, 0, 4 );
+	EmitLocal( Fib, 1, 0 );
+	EmitOp( Fib, CODE_LToRDWord, 1 );
+	EmitOp( Fib, CODE_AssignDWord, 0, 1 );
+	Emit<Byte>( Fib, CODE_EOC );
+
+	*(Word*)&Fib->Code[iElse]	= Fib->Code.Num();
+	EmitLocal( Fib, 0, 4 );
+	for( Integer i=1; i<=2; i++ )
+	{
+		Byte iArg = i * 2 - 1;
+		EmitLocal( Fib, iArg, 0 );
+		EmitOp( Fib, CODE_LToRDWord, iArg );
+		Emit<Byte>( Fib, CODE_ConstInteger );
+		Emit<Integer>( Fib, i );
+		Emit<Byte>( Fib, iArg+1 );
+		EmitOp( Fib, BIN_Sub_Integer, iArg, iArg+1 );
+		Emit<Byte>( Fib, CODE_CallFunction );
+		Emit<Byte>( Fib, 2 );
+		Emit<Byte>( Fib, iArg );
+		Emit<Byte>( Fib, iArg+1 );
+	}
+	EmitOp( Fib, BIN_Add_Integer, 2, 4 );
+	EmitOp( Fib, CODE_AssignDWord, 0, 2 );
+	Emit<Byte>( Fib, CODE_EOC );
+
+	// event OnTick( float delta )
+	// {
+	//     delta += 0.5;
+	// }
+	CFunction* OnTick = AddFunction( L"OnTick" );
+	OnTick->Locals.Push( new CProperty( CTypeInfo(TYPE_Float), L"Delta", PROP_None, 0 ) );
+	OnTick->ParmsCount	= 1;
+	OnTick->FrameSize	= 4;
+
+	EmitLocal( OnTick, 0, 0 );
+	Emit<Byte>( OnTick, CODE_ConstFloat );
+	Emit<Float>( OnTick, 0.5f );
+	Emit<Byte>( OnTick, 1 );
+	EmitOp( OnTick, BIN_AddEqual_Float, 0, 1 );
+	Emit<Byte>( OnTick, CODE_EOC );
+
+	Script->Events.SetNum( _EVENT_MAX );
+	Script->Events[EVENT_OnTick]	= OnTick;
+	Kernels[SBENCH_Events]			= OnTick;
+
+	for( Integer i=0; i<BENCH_ENTITIES; i++ )
+	{
+		FEntity* Other	= NewObject<FEntity>( String::Format( L"ScriptBenchEntity%d", i ) );
+		Other->Script	= Script;
+		Entities.Push( Other );
+	}
+
+	// Long string constant, used by the constants kernel.
+	Word iState = Script->AddString
+	(
+		L"ScriptBenchState: a string constant, which is longer than "
+		L"one hundred and twenty seven characters, to make sure it's "
+		L"not truncated while loading."
+	);
+
+	// Text, used by the string natives kernel.
+	Word iText = Script->AddString( L"abcdefghijklmnopqrstuvwxyz0123456789" );
+
+	// Methods, used by the methods kernel.
+	Word iSetLocation	= CClassDatabase::GFuncs.FindItem( FRectComponent::MetaClass->FindMethod( L"SetLocation" ) );
+	Word iGetAABB		= CClassDatabase::GFuncs.FindItem( FRectComponent::MetaClass->FindMethod( L"GetAABB" ) );
+
+	for( Integer i=0; i<SBENCH_Events; i++ )
+	{
+		CFunction*	Func = AddFunction( GBenchNames[i] );
+		Integer		iStart, iExit;
+		Kernels[i]	= Func;
+
+		EmitLocals( Func );
+		EmitLoopHead( Func, iStart, iExit );
+
+		switch( i )
+		{
+			case SBENCH_Arithmetic:
+			{
+				// sum += i * 3;
+				EmitLocal( Func, 0, LOCAL_SUM );
+				EmitLocal( Func, 1, LOCAL_I );
+				EmitOp( Func, CODE_LToRDWord, 1 );
+				Emit<Byte>( Func, CODE_ConstInteger );
+				Emit<Integer>( Func, 3 );
+				Emit<Byte>( Func, 2 );
+				EmitOp( Func, BIN_Mult_Integer, 1, 2 );
+				EmitOp( Func, BIN_AddEqual_Integer, 0, 1 );
+
+				// f += 0.5;
+				EmitLocal( Func, 0, LOCAL_F );
+				Emit<Byte>( Func, CODE_ConstFloat );
+				Emit<Float>( Func, 0.5f );
+				Emit<Byte>( Func, 1 );
+				EmitOp( Func, BIN_AddEqual_Float, 0, 1 );
+				break;
+			}
+			case SBENCH_Strings:
+			{
+				// s += itos( i );
+				EmitLocal( Func, 0, LOCAL_S );
+				EmitLocal( Func, 1, LOCAL_I );
+				EmitOp( Func, CODE_LToRDWord, 1 );
+				EmitOp( Func, OP_IToS, 1, 2 );
+				EmitOp( Func, BIN_AddEqual_String, 0, 2 );
+				break;
+			}
+			case SBENCH_Calls:
+			{
+				// sum = Add( sum, i );
+				EmitLocal( Func, 0, LOCAL_SUM );
+				EmitLocal( Func, 1, LOCAL_SUM );
+				EmitOp( Func, CODE_LToRDWord, 1 );
+				EmitLocal( Func, 2, LOCAL_I );
+				EmitOp( Func, CODE_LToRDWord, 2 );
+				Emit<Byte>( Func, CODE_CallFunction );
+				Emit<Byte>( Func, 0 );
+				Emit<Byte>( Func, 1 );
+				Emit<Byte>( Func, 2 );
+				Emit<Byte>( Func, 3 );
+				EmitOp( Func, CODE_AssignDWord, 0, 3 );
+				break;
+			}
+			case SBENCH_EmptyCalls:
+			{
+				// Nop();
+				Emit<Byte>( Func, CODE_CallFunction );
+				Emit<Byte>( Func, 1 );
+				break;
+			}
+			case SBENCH_Fib:
+			{
+				// sum += Fib( BENCH_FIB );
+				EmitLocal( Func, 0, LOCAL_SUM );
+				Emit<Byte>( Func, CODE_ConstInteger );
+				Emit<Integer>( Func, BENCH_FIB );
+				Emit<Byte>( Func, 1 );
+				Emit<Byte>( Func, CODE_CallFunction );
+				Emit<Byte>( Func, 2 );
+				Emit<Byte>( Func, 1 );
+				Emit<Byte>( Func, 2 );
+				EmitOp( Func, BIN_AddEqual_Integer, 0, 2 );
+				break;
+			}
+			case SBENCH_Natives:
+			{
+				// g += sin( f ); f += 0.5;
+				EmitLocal( Func, 0, LOCAL_G );
+				EmitLocal( Func, 1, LOCAL_F );
+				EmitOp( Func, CODE_LToRDWord, 1 );
+				EmitOp( Func, OP_Sin, 1, 2 );
+				EmitOp( Func, BIN_AddEqual_Float, 0, 2 );
+				EmitLocal( Func, 0, LOCAL_F );
+				Emit<Byte>( Func, CODE_ConstFloat );
+				Emit<Float>( Func, 0.5f );
+				Emit<Byte>( Func, 1 );
+				EmitOp( Func, BIN_AddEqual_Float, 0, 1 );
+				break;
+			}
+			case SBENCH_NativeScalar:
+			{
+				// g += arctan( abs( f ) ); f += 0.5;
+				EmitLocal( Func, 0, LOCAL_G );
+				EmitLocal( Func, 1, LOCAL_F );
+				EmitOp( Func, CODE_LToRDWord, 1 );
+				EmitOp( Func, OP_Abs, 1, 2 );
+				EmitOp( Func, OP_ArcTan, 2, 3 );
+				EmitOp( Func, BIN_AddEqual_Float, 0, 3 );
+				EmitLocal( Func, 0, LOCAL_F );
+				Emit<Byte>( Func, CODE_ConstFloat );
+				Emit<Float>( Func, 0.5f );
+				Emit<Byte>( Func, 1 );
+				EmitOp( Func, BIN_AddEqual_Float, 0, 1 );
+				break;
+			}
+			case SBENCH_NativeVector:
+			{
+				// v = [f, 1.0]; g += vsize( normalize( v ) ) + v * v; f += 0.5;
+				EmitLocal( Func, 0, LOCAL_G );
+				EmitLocal( Func, 1, LOCAL_F );
+				EmitOp( Func, CODE_LToRDWord, 1 );
+				Emit<Byte>( Func, CODE_ConstFloat );
+				Emit<Float>( Func, 1.f );
+				Emit<Byte>( Func, 2 );
+				Emit<Byte>( Func, CODE_VectorCnstr );
+				Emit<Byte>( Func, 3 );
+				Emit<Byte>( Func, 1 );
+				Emit<Byte>( Func, 2 );
+				EmitOp( Func, OP_Normalize, 3, 4 );
+				EmitOp( Func, OP_VectorSize, 4, 5 );
+				EmitOp( Func, BIN_Dot_Vector, 3, 3 );
+				EmitOp( Func, BIN_Add_Float, 5, 3 );
+				EmitOp( Func, BIN_AddEqual_Float, 0, 5 );
+				EmitLocal( Func, 0, LOCAL_F );
+				Emit<Byte>( Func, CODE_ConstFloat );
+				Emit<Float>( Func, 0.5f );
+				Emit<Byte>( Func, 1 );
+				EmitOp( Func, BIN_AddEqual_Float, 0, 1 );
+				break;
+			}
+			case SBENCH_NativeString:
+			{
+				// sum += indexOf( charAt( "...", i ), "..." );
+				EmitLocal( Func, 0, LOCAL_SUM );
+				Emit<Byte>( Func, CODE_ConstString );
+				Emit<Word>( Func, iText );
+				Emit<Byte>( Func, 1 );
+				EmitLocal( Func, 2, LOCAL_I );
+				EmitOp( Func, CODE_LToRDWord, 2 );
+				Emit<Byte>( Func, OP_CharAt );
+				Emit<Byte>( Func, 1 );
+				Emit<Byte>( Func, 2 );
+				Emit<Byte>( Func, 3 );
+				Emit<Byte>( Func, CODE_ConstString );
+				Emit<Word>( Func, iText );
+				Emit<Byte>( Func, 4 );
+				Emit<Byte>( Func, OP_IndexOf );
+				Emit<Byte>( Func, 3 );
+				Emit<Byte>( Func, 4 );
+				Emit<Byte>( Func, 5 );
+				EmitOp( Func, BIN_AddEqual_Integer, 0, 5 );
+				break;
+			}
+			case SBENCH_NativeColor:
+			{
+				// sum += rgba( i, 128, 64, 255 ).r;
+				EmitLocal( Func, 0, LOCAL_SUM );
+				EmitLocal( Func, 1, LOCAL_I );
+				EmitOp( Func, CODE_LToRDWord, 1 );
+				EmitOp( Func, CAST_IntegerToByte, 1 );
+				for( Integer c=0; c<3; c++ )
+				{
+					static const Byte Channels[3] = { 128, 64, 255 };
+					Emit<Byte>( Func, CODE_ConstByte );
+					Emit<Byte>( Func, Channels[c] );
+					Emit<Byte>( Func, 2+c );
+				}
+				Emit<Byte>( Func, OP_RGBA );
+				Emit<Byte>( Func, 1 );
+				Emit<Byte>( Func, 2 );
+				Emit<Byte>( Func, 3 );
+				Emit<Byte>( Func, 4 );
+				Emit<Byte>( Func, 5 );
+				EmitOp( Func, CAST_ByteToInteger, 5 );
+				EmitOp( Func, BIN_AddEqual_Integer, 0, 5 );
+				break;
+			}
+			case SBENCH_NativeMethod:
+			{
+				// SetLocation( [f, 1.0] ); g += GetAABB().min.x; f += 0.5;
+				EmitLocal( Func, 0, LOCAL_G );
+				EmitLocal( Func, 1, LOCAL_F );
+				EmitOp( Func, CODE_LToRDWord, 1 );
+				Emit<Byte>( Func, CODE_ConstFloat );
+				Emit<Float>( Func, 1.f );
+				Emit<Byte>( Func, 2 );
+				Emit<Byte>( Func, CODE_VectorCnstr );
+				Emit<Byte>( Func, 3 );
+				Emit<Byte>( Func, 1 );
+				Emit<Byte>( Func, 2 );
+				Emit<Byte>( Func, CODE_BaseMethod );
+				Emit<Word>( Func, iSetLocation );
+				Emit<Byte>( Func, 3 );
+				Emit<Byte>( Func, CODE_BaseMethod );
+				Emit<Word>( Func, iGetAABB );
+				Emit<Byte>( Func, 4 );
+				EmitOp( Func, BIN_AddEqual_Float, 0, 4 );
+				EmitLocal( Func, 0, LOCAL_F );
+				Emit<Byte>( Func, CODE_ConstFloat );
+				Emit<Float>( Func, 0.5f );
+				Emit<Byte>( Func, 1 );
+				EmitOp( Func, BIN_AddEqual_Float, 0, 1 );
+				break;
+			}
+			case SBENCH_SwitchLinear:
+			{
+				EmitSwitch( Func, CODE_Switch, 1 );
+				break;
+			}
+			case SBENCH_SwitchTable:
+			{
+				EmitSwitch( Func, CODE_SwitchTable, 1 );
+				break;
+			}
+			case SBENCH_SwitchSearch:
+			{
+				EmitSwitch( Func, CODE_SwitchSearch, 7 );
+				break;
+			}
+			case SBENCH_Constants:
+			{
+				// s = "...";
+				EmitLocal( Func, 0, LOCAL_S );
+				Emit<Byte>( Func, CODE_ConstString );
+				Emit<Word>( Func, iState );
+				Emit<Byte>( Func, 1 );
+				EmitOp( Func, CODE_AssignString, 0, 1 );
+
+				// sum += s == "...";
+				EmitLocal( Func, 0, LOCAL_SUM );
+				EmitLocal( Func, 1, LOCAL_S );
+				EmitOp( Func, CODE_LToRString, 1 );
+				Emit<Byte>( Func, CODE_ConstString );
+				Emit<Word>( Func, iState );
+				Emit<Byte>( Func, 2 );
+				Emit<Byte>( Func, CODE_Equal );
+				Emit<Byte>( Func, 1 );
+				Emit<Byte>( Func, 2 );
+				Emit<Byte>( Func, 0 );
+				EmitOp( Func, CAST_ByteToInteger, 1 );
+				EmitOp( Func, BIN_AddEqual_Integer, 0, 1 );
+				break;
+			}
+		}
+
+		EmitLoopTail( Func, iStart, iExit );
+	}
+}
+
+
+//
+// Benchmark destructor.
+//
+CScriptBench::~CScriptBench()
+{
+	for( Integer i=0; i<Entities.Num(); i++ )
+		DestroyObject( Entities[i] );
+
+	DestroyObject( Entity );
+	DestroyObject( Script );
+}
+
+
+//
+// Return a name of the kernel.
+//
+const Char* CScriptBench::GetBenchName( EScriptBench Bench )
+{
+	return GBenchNames[Bench];
+}
+
+
+//
+// Run a kernel with both interpreters and the JIT.
+//
+void CScriptBench::Run( EScriptBench InBench, Integer NumIterations, TScriptBenchResult& Result )
+{
+	CFunction* Func = Kernels[InBench];
+	NumIterations	= Max( NumIterations, 1 );
+
+	Result.Bench			= InBench;
+	Result.NumIterations	= NumIterations;
+
+	Double JitInstrs, CheckedInstrs;
+	if( InBench != SBENCH_Events )
+	{
+		Result.NumLoops		= BENCH_LOOPS;
+		Result.LegacyTime	= Measure( Func, NumIterations, false, false, false, Result.LegacyInstrs );
+		Result.CheckedTime	= Measure( Func, NumIterations, true, false, false, CheckedInstrs );
+		Result.LinkedTime	= Measure( Func, NumIterations, true, false, true, Result.LinkedInstrs );
+		Result.JitTime		= Measure( Func, NumIterations, true, true, true, JitInstrs );
+	}
+	else
+	{
+		Result.NumLoops		= Entities.Num();
+		Result.LegacyTime	= MeasureEvents( NumIterations, false, false, false, Result.LegacyInstrs );
+		Result.CheckedTime	= MeasureEvents( NumIterations, true, false, false, CheckedInstrs );
+		Result.LinkedTime	= MeasureEvents( NumIterations, true, false, true, Result.LinkedInstrs );
+		Result.JitTime		= MeasureEvents( NumIterations, true, true, true, JitInstrs );
+	}
+	Result.Speedup			= Result.LinkedTime > 0.0 ? Result.LegacyTime / Result.LinkedTime : 0.0;
+	Result.LeanSpeedup		= Result.LinkedTime > 0.0 ? Result.CheckedTime / Result.LinkedTime : 0.0;
+	Result.JitSpeedup		= Result.JitTime > 0.0 ? Result.LinkedTime / Result.JitTime : 0.0;
+	Result.bVerified		= Func->Linked && Func->Linked->bVerified;
+	Result.bJitted			= Func->Linked && Func->Linked->Jit;
+	Result.bJitMatch		= VerifyJit( Func );
+}
+
+
+//
+// Convert a kernel result to the JSON object.
+//
+String CScriptBench::ToJSON( const TScriptBenchResult& Result )
+{
+	return String::Format
+	(
+		L"{ \"bench\": \"%s\", \"iterations\": %d, \"loops\": %d, "
+		L"\"legacy_ns\": %.3f, \"checked_ns\": %.3f, \"linked_ns\": %.3f, \"jit_ns\": %.3f, "
+		L"\"speedup\": %.3f, \"lean_speedup\": %.3f, \"jit_speedup\": %.3f, "
+		L"\"legacy_instrs\": %.2f, \"linked_instrs\": %.2f, "
+		L"\"verified\": %s, \"jitted\": %s, \"jit_match\": %s }",
+		GetBenchName(Result.Bench),
+		Result.NumIterations,
+		Result.NumLoops,
+		Result.LegacyTime,
+		Result.CheckedTime,
+		Result.LinkedTime,
+		Result.JitTime,
+		Result.Speedup,
+		Result.LeanSpeedup,
+		Result.JitSpeedup,
+		Result.LegacyInstrs,
+		Result.LinkedInstrs,
+		Result.bVerified ? L"true" : L"false",
+		Result.bJitted ? L"true" : L"false",
+		Result.bJitMatch ? L"true" : L"false"
+	);
+}
+
+
+//
+// Add a new function to the benchmark script.
+//
+CFunction* CScriptBench::AddFunction( String InName )
+{
+	CFunction* Func = new CFunction();
+	Func->Name	= InName;
+	Script->Functions.Push( Func );
+	return Func;
+}
+
+
+//
+// Declare kernel's local variables.
+//
+void CScriptBench::EmitLocals( CFunction* Func )
+{
+	Func->Locals.Push( new CProperty( CTypeInfo(TYPE_Integer), L"I", PROP_None, LOCAL_I ) );
+	Func->Locals.Push( new CProperty( CTypeInfo(TYPE_Integer), L"Sum", PROP_None, LOCAL_SUM ) );
+	Func->Locals.Push( new CProperty( CTypeInfo(TYPE_Float), L"F", PROP_None, LOCAL_F ) );
+	Func->Locals.Push( new CProperty( CTypeInfo(TYPE_Float), L"G", PROP_None, LOCAL_G ) );
+	Func->Locals.Push( new CProperty( CTypeInfo(TYPE_String), L"S", PROP_None, LOCAL_S ) );
+	Func->FrameSize	= LOCAL_S + sizeof(String);
+}
+
+
+//
+// Emit loop condition: while( i < BENCH_LOOPS ).
+//
+void CScriptBench::EmitLoopHead( CFunction* Func, Integer& iStart, Integer& iExit )
+{
+	iStart	= Func->Code.Num();
+
+	EmitLocal( Func, 0, LOCAL_I );
+	EmitOp( Func, CODE_LToRDWord, 0 );
+	Emit<Byte>( Func, CODE_ConstInteger );
+	Emit<Integer>( Func, BENCH_LOOPS );
+	Emit<Byte>( Func, 1 );
+	EmitOp( Func, BIN_Less_Integer, 0, 1 );
+
+	Emit<Byte>( Func, CODE_JumpZero );
+	iExit	= Func->Code.Num();
+	Emit<Word>( Func, 0 );
+	Emit<Byte>( Func, 0 );
+}
+
+
+//
+// Emit loop increment and jump back.
+//
+void CScriptBench::EmitLoopTail( CFunction* Func, Integer iStart, Integer iExit )
+{
+	EmitLocal( Func, 0, LOCAL_I );
+	EmitOp( Func, UN_Inc_Integer, 0 );
+	Emit<Byte>( Func, CODE_Jump );
+	Emit<Word>( Func, iStart );
+
+	*(Word*)&Func->Code[iExit]	= Func->Code.Num();
+	Emit<Byte>( Func, CODE_EOC );
+}
+
+
+//
+// Emit a state machine switch, with given lowering:
+//	switch( (i % BENCH_STATES) * Step )
+//	{
+//		case k*Step:	sum += k;	break;
+//	}
+//
+void CScriptBench::EmitSwitch( CFunction* Func, Byte Op, Integer Step )
+{
+	// Switch expression.
+	EmitLocal( Func, 0, LOCAL_I );
+	EmitOp( Func, CODE_LToRDWord, 0 );
+	Emit<Byte>( Func, CODE_ConstInteger );
+	Emit<Integer>( Func, BENCH_STATES );
+	Emit<Byte>( Func, 1 );
+	EmitOp( Func, BIN_Mod_Integer, 0, 1 );
+	Emit<Byte>( Func, CODE_ConstInteger );
+	Emit<Integer>( Func, Step );
+	Emit<Byte>( Func, 1 );
+	EmitOp( Func, BIN_Mult_Integer, 0, 1 );
+
+	// Header.
+	Emit<Byte>( Func, Op );
+	Emit<Byte>( Func, sizeof(Integer) );
+	Emit<Byte>( Func, 0 );
+	Integer iDefault = Func->Code.Num();
+	Emit<Word>( Func, 0 );
+	Integer iTable = Func->Code.Num();
+	Emit<Word>( Func, 0 );
+
+	// Cases.
+	TArray<Word>	Cases;
+	TArray<Integer>	Outs;
+	for( Integer k=0; k<BENCH_STATES; k++ )
+	{
+		Cases.Push( Func->Code.Num() );
+		EmitLocal( Func, 0, LOCAL_SUM );
+		Emit<Byte>( Func, CODE_ConstInteger );
+		Emit<Integer>( Func, k );
+		Emit<Byte>( Func, 1 );
+		EmitOp( Func, BIN_AddEqual_Integer, 0, 1 );
+		Emit<Byte>( Func, CODE_Jump );
+		Outs.Push( Func->Code.Num() );
+		Emit<Word>( Func, 0 );
+	}
+
+	// Table, labels are sorted already.
+	*(Word*)&Func->Code[iTable]	= Func->Code.Num();
+	if( Op == CODE_Switch )
+		Emit<Byte>( Func, BENCH_STATES );
+	else if( Op == CODE_SwitchTable )
+		Emit<Integer>( Func, 0 );
+	if( Op != CODE_Switch )
+		Emit<Word>( Func, BENCH_STATES );
+
+	for( Integer k=0; k<BENCH_STATES; k++ )
+	{
+		if( Op != CODE_SwitchTable )
+			Emit<Integer>( Func, k * Step );
+		Emit<Word>( Func, Cases[k] );
+	}
+
+	// Out of switch.
+	*(Word*)&Func->Code[iDefault]	= Func->Code.Num();
+	for( Integer i=0; i<Outs.Num(); i++ )
+		*(Word*)&Func->Code[Outs[i]]	= Func->Code.Num();
+}
+
+
+//
+// Run kernel many times, and return average time 
+// per loop iteration in nanoseconds. Average number
+// of executed instructions is returned too.
+//
+Double CScriptBench::Measure( CFunction* Func, Integer NumIterations, Bool bLinked, Bool bJit, Bool bLean, Double& OutInstrs )
+{
+	Bool	bOldLinked	= CFrame::bLinkedCode;
+	Bool	bOldJit		= CJit::bEnabled;
+	Bool	bOldLean	= CFrame::bLeanCode;
+	Integer	OldHotCalls	= CJit::HotCalls;
+	Double	Time		= 0.0;
+	QWord	NumInstrs	= 0;
+	CFrame::bLinkedCode	= bLinked;
+	CFrame::bLeanCode	= bLean;
+	CJit::bEnabled		= bJit;
+	CJit::HotCalls		= 1;
+
+	try
+	{
+		// Warm up, it also links the code, and compiles
+		// it, once calls continuations are linked.
+		for( Integer i=0; i<2; i++ )
+		{
+			CFrame Frame( Entity, Func );
+			Frame.ProcessCode( nullptr );
+		}
+
+		QWord StartInstrs	= CFrame::NumExecuted;
+		Double StartTime	= GPlat->TimeStamp();
+		for( Integer i=0; i<NumIterations; i++ )
+		{
+			CFrame Frame( Entity, Func );
+			Frame.ProcessCode( nullptr );
+		}
+		Time		= GPlat->TimeStamp() - StartTime;
+		NumInstrs	= CFrame::NumExecuted - StartInstrs;
+	}
+	catch( ... )
+	{
+		log( L"ScriptBench: Kernel '%s' failed", *Func->Name );
+	}
+
+	CFrame::bLinkedCode	= bOldLinked;
+	CFrame::bLeanCode	= bOldLean;
+	CJit::bEnabled		= bOldJit;
+	CJit::HotCalls		= OldHotCalls;
+	OutInstrs			= (Double)NumInstrs / ((Double)NumIterations * BENCH_LOOPS);
+	return Time * 1000000000.0 / ((Double)NumIterations * BENCH_LOOPS);
+}
+
+
+//
+// Send OnTick event to all entities, each frame, and
+// return average time per event call in nanoseconds.
+//
+Double CScriptBench::MeasureEvents( Integer NumFrames, Bool bLinked, Bool bJit, Bool bLean, Double& OutInstrs )
+{
+	Bool	bOldLinked	= CFrame::bLinkedCode;
+	Bool	bOldJit		= CJit::bEnabled;
+	Bool	bOldLean	= CFrame::bLeanCode;
+	Integer	OldHotCalls	= CJit::HotCalls;
+	CFrame::bLinkedCode	= bLinked;
+	CFrame::bLeanCode	= bLean;
+	CJit::bEnabled		= bJit;
+	CJit::HotCalls		= 1;
+
+	// Warm up.
+	for( Integer i=0; i<Entities.Num(); i++ )
+		Entities[i]->CallEvent( EVENT_OnTick, 0.f );
+
+	QWord StartInstrs	= CFrame::NumExecuted;
+	Double StartTime	= GPlat->TimeStamp();
+	for( Integer iFrame=0; iFrame<NumFrames; iFrame++ )
+	{
+		Float Delta = 1.f / 60.f;
+		for( Integer i=0; i<Entities.Num(); i++ )
+			Entities[i]->CallEvent( EVENT_OnTick, Delta );
+	}
+	Double Time		= GPlat->TimeStamp() - StartTime;
+	QWord NumInstrs	= CFrame::NumExecuted - StartInstrs;
+
+	CFrame::bLinkedCode	= bOldLinked;
+	CFrame::bLeanCode	= bOldLean;
+	CJit::bEnabled		= bOldJit;
+	CJit::HotCalls		= OldHotCalls;
+	OutInstrs			= (Double)NumInstrs / ((Double)NumFrames * Entities.Num());
+	return Time * 1000000000.0 / ((Double)NumFrames * Entities.Num());
+}
+
+
+//
+// Run kernel once with the linked code and once with
+// the JIT, and compare their plain locals.
+//
+Bool CScriptBench::VerifyJit( CFunction* Func )
+{
+	Bool	bOldLinked	= CFrame::bLinkedCode;
+	Bool	bOldJit		= CJit::bEnabled;
+	Integer	Size		= Min<Integer>( Func->FrameSize, LOCAL_S );
+	Byte	Results[2][LOCAL_S];
+	Bool	bMatch		= false;
+	CFrame::bLinkedCode	= true;
+
+	try
+	{
+		for( Integer i=0; i<2; i++ )
+		{
+			CJit::bEnabled	= i == 1;
+			CFrame Frame( Entity, Func );
+			Frame.ProcessCode( nullptr );
+			MemCopy( Results[i], Frame.Locals, Size );
+		}
+		bMatch	= MemCmp( Results[0], Results[1], Size );
+	}
+	catch( ... )
+	{
+		log( L"ScriptBench: Kernel '%s' failed", *Func->Name );
+	}
+
+	CFrame::bLinkedCode	= bOldLinked;
+	CJit::bEnabled		= bOldJit;
+	return bMatch;
+}
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
@@ -0,0 +1,101 @@
+/*=============================================================================
+    FrScriptBench.h: Script virtual machine benchmark.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    CScriptBench.
+-----------------------------------------------------------------------------*/
+
+//
+// A benchmark kernel.
+//
+enum EScriptBench
+{
+	SBENCH_Arithmetic,		// Integer and float arithmetic loop.
+	SBENCH_Strings,			// String concatenation loop.
+	SBENCH_Calls,			// Script function calls loop.
+	SBENCH_EmptyCalls,		// Empty script function calls loop, frame overhead.
+	SBENCH_Fib,				// Recursive fibonacci numbers.
+	SBENCH_Natives,			// Native function calls loop.
+	SBENCH_NativeScalar,	// Inline and bound scalar math natives.
+	SBENCH_NativeVector,	// Inline vector math natives.
+	SBENCH_NativeString,	// Bound string natives.
+	SBENCH_NativeColor,		// Color native, with too many operands to bind.
+	SBENCH_NativeMethod,	// Base component native methods.
+	SBENCH_SwitchLinear,	// State machine switch, labels tested one by one.
+	SBENCH_SwitchTable,		// State machine switch, jump table.
+	SBENCH_SwitchSearch,	// State machine switch, sparse labels binary search.
+	SBENCH_Constants,		// String constants assignment and comparison.
+	SBENCH_Events,			// OnTick event calls from C++, for many entities.
+	SBENCH_MAX
+};
+
+
+//
+// A benchmark kernel result. Times are average per
+// loop iteration, or per event call, in nanoseconds.
+// Machine code executes no VM instructions, so it has
+// no instructions count.
+//
+struct TScriptBenchResult
+{
+public:
+	EScriptBench	Bench;
+	Integer			NumIterations;
+	Integer			NumLoops;
+	Double			LegacyTime;
+	Double			LinkedTime;
+	Double			CheckedTime;	// Linked code with all runtime checks.
+	Double			JitTime;
+	Double			Speedup;
+	Double			LeanSpeedup;	// Speedup of the lean code over the checked one.
+	Double			JitSpeedup;		// Speedup of the JIT over the linked code.
+	Double			LegacyInstrs;	// Executed instructions per iteration.
+	Double			LinkedInstrs;
+	Bool			bVerified;		// Whether kernel passed the verifier.
+	Bool			bJitted;		// Whether kernel was compiled.
+	Bool			bJitMatch;		// Whether JIT results match the VM's.
+};
+
+
+//
+// A script VM micro-benchmark. It builds a transient
+// script with hand-emitted bytecode kernels, and runs
+// each kernel with the bytecode interpreter, with the
+// linked code and with the JIT, to compare them.
+//
+class CScriptBench
+{
+public:
+	// CScriptBench interface.
+	CScriptBench();
+	~CScriptBench();
+	void Run( EScriptBench InBench, Integer NumIterations, TScriptBenchResult& Result );
+
+	// Utility.
+	static const Char* GetBenchName( EScriptBench Bench );
+	static String ToJSON( const TScriptBenchResult& Result );
+
+private:
+	// Variables.
+	FScript*			Script;
+	FEntity*			Entity;
+	CFunction*			Kernels[SBENCH_MAX];
+	TArray<FEntity*>	Entities;
+
+	// Internal.
+	CFunction* AddFunction( String InName );
+	void EmitLocals( CFunction* Func );
+	void EmitLoopHead( CFunction* Func, Integer& iStart, Integer& iExit );
+	void EmitLoopTail( CFunction* Func, Integer iStart, Integer iExit );
+	void EmitSwitch( CFunction* Func, Byte Op, Integer Step );
+	Double Measure( CFunction* Func, Integer NumIterations, Bool bLinked, Bool bJit, Bool bLean, Double& OutInstrs );
+	Double MeasureEvents( Integer NumFrames, Bool bLinked, Bool bJit, Bool bLean, Double& OutInstrs );
+	Bool VerifyJit( CFunction* Func );
+};
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
@@ -0,0 +1,220 @@
+/*=============================================================================
+    FrScriptDiff.cpp: Script VM differential test.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+#include "Engine.h"
+
+/*-----------------------------------------------------------------------------
+    CScriptDiff implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Save VM settings, modes change them.
+//
+CScriptDiff::CScriptDiff()
+{
+	bOldLinked		= CFrame::bLinkedCode;
+	bOldOptimize	= CLinkedCode::bOptimize;
+	bOldJit			= CJit::bEnabled;
+	bOldLean		= CFrame::bLeanCode;
+	OldHotCalls		= CJit::HotCalls;
+}
+
+
+//
+// Restore VM settings, and drop code, linked
+// in the test modes.
+//
+CScriptDiff::~CScriptDiff()
+{
+	CFrame::bLinkedCode		= bOldLinked;
+	CLinkedCode::bOptimize	= bOldOptimize;
+	CJit::bEnabled			= bOldJit;
+	CFrame::bLeanCode		= bOldLean;
+	CJit::HotCalls			= OldHotCalls;
+	UnlinkAll();
+}
+
+
+//
+// Switch VM to the mode. Linked code depends on the
+// linker settings, so all scripts are linked again.
+// In JIT modes each function is compiled at the first
+// call. Should be called, when no level is playing.
+//
+void CScriptDiff::SetMode( EScriptMode Mode )
+{
+	CFrame::bLinkedCode		= Mode != SMODE_Legacy;
+	CLinkedCode::bOptimize	= Mode >= SMODE_Optimized;
+	CJit::bEnabled			= Mode >= SMODE_Jit;
+	CJit::HotCalls			= Mode >= SMODE_Jit ? 1 : OldHotCalls;
+	CFrame::bLeanCode		= Mode == SMODE_JitLean ? true : bOldLean;
+	UnlinkAll();
+}
+
+
+//
+// Drop linked code of all scripts.
+//
+void CScriptDiff::UnlinkAll()
+{
+	for( Integer i=0; i<GObjectDatabase->GObjects.Num(); i++ )
+		if( GObjectDatabase->GObjects[i] && GObjectDatabase->GObjects[i]->IsA(FScript::MetaClass) )
+		{
+			FScript* Script = As<FScript>(GObjectDatabase->GObjects[i]);
+			if( Script->bHasText )
+				CLinkedCode::UnlinkScript( Script );
+		}
+}
+
+
+//
+// Store values of all properties of all the level's
+// entities: base, extra components and script ones,
+// a line per value. Level travel ends the run, so the
+// number of frames is stored too.
+//
+void CScriptDiff::Capture( FLevel* Level, Integer NumFrames, TArray<String>& State )
+{
+	State.Empty();
+	State.Push( String::Format( L"Frames=%d", NumFrames ) );
+	State.Push( String::Format( L"Entities=%d", Level->Entities.Num() ) );
+
+	for( Integer i=0; i<Level->Entities.Num(); i++ )
+	{
+		FEntity* Entity = Level->Entities[i];
+		if( !Entity )
+			continue;
+
+		CaptureObject( Entity->GetName(), Entity->Base, State );
+		for( Integer e=0; e<Entity->Components.Num(); e++ )
+			CaptureObject
+			(
+				String::Format( L"%s.$%s", *Entity->GetName(), *Entity->Components[e]->GetName() ),
+				Entity->Components[e],
+				State
+			);
+
+		if( !Entity->Script->bHasText )
+			continue;
+
+		for( Integer iProp=0; iProp<Entity->Script->Properties.Num(); iProp++ )
+		{
+			CProperty* Prop = Entity->Script->Properties[iProp];
+			CaptureValue
+			(
+				Entity->GetName() + L"." + Prop->Name,
+				*Prop,
+				&Entity->InstanceBuffer->Data[Prop->Offset],
+				State
+			);
+		}
+	}
+}
+
+
+//
+// Store values of all native properties of the
+// component.
+//
+void CScriptDiff::CaptureObject( String Name, FObject* Object, TArray<String>& State )
+{
+	for( CClass* C = Object->GetClass(); C; C = C->Super )
+		for( Integer iProp=0; iProp<C->Properties.Num(); iProp++ )
+		{
+			CProperty* Prop = C->Properties[iProp];
+			CaptureValue( Name + L"." + Prop->Name, *Prop, (Byte*)Object + Prop->Offset, State );
+		}
+}
+
+
+//
+// Store a value, each array element is stored
+// separately.
+//
+void CScriptDiff::CaptureValue( String Name, const CTypeInfo& Type, const void* Addr, TArray<String>& State )
+{
+	if( Type.ArrayDim == 1 )
+	{
+		State.Push( Name + L"=" + Type.ToString( Addr ) );
+		return;
+	}
+
+	CTypeInfo	Inner	= Type;
+	DWord		Size	= Type.TypeSize( true );
+	Inner.ArrayDim		= 1;
+
+	for( Integer i=0; i<Type.ArrayDim; i++ )
+		State.Push( String::Format( L"%s[%d]=%s", *Name, i, *Inner.ToString( (Byte*)Addr + i*Size ) ) );
+}
+
+
+//
+// Compare state with the reference state.
+//
+void CScriptDiff::Compare( const TArray<String>& Reference, const TArray<String>& State, TScriptDiffResult& Result )
+{
+	Result.NumValues		= Reference.Num();
+	Result.NumMismatches	= Abs( Reference.Num() - State.Num() );
+	Result.FirstMismatch	= L"";
+
+	if( Result.NumMismatches != 0 )
+		Result.FirstMismatch	= String::Format( L"%d values vs %d", Reference.Num(), State.Num() );
+
+	for( Integer i=0; i<Min( Reference.Num(), State.Num() ); i++ )
+		if( Reference[i] != State[i] )
+		{
+			if( Result.NumMismatches == 0 )
+				Result.FirstMismatch	= Reference[i] + L" vs " + State[i];
+			Result.NumMismatches++;
+		}
+}
+
+
+//
+// Return the name of the VM mode.
+//
+const Char* CScriptDiff::GetModeName( EScriptMode Mode )
+{
+	switch( Mode )
+	{
+		case SMODE_Legacy:		return L"Legacy";
+		case SMODE_Linked:		return L"Linked";
+		case SMODE_Optimized:	return L"Optimized";
+		case SMODE_Jit:			return L"Jit";
+		case SMODE_JitLean:		return L"JitLean";
+		default:				return L"Unknown";
+	}
+}
+
+
+//
+// Convert a mode result to the JSON object.
+//
+String CScriptDiff::ToJSON( const TScriptDiffResult& Result )
+{
+	// Script strings might break the JSON.
+	String Mismatch = Result.FirstMismatch;
+	for( Integer i=0; i<Mismatch.Len(); i++ )
+		if( Mismatch[i] == L'"' || Mismatch[i] == L'\\' )
+			Mismatch[i]	= L'\'';
+
+	return String::Format
+	(
+		L"{ \"mode\": \"%s\", \"frames\": %d, \"values\": %d, \"mismatches\": %d, \"first_mismatch\": \"%s\", \"instrs\": %.0f, \"jit_compiled\": %d, \"jit_rejected\": %d }",
+		GetModeName(Result.Mode),
+		Result.NumFrames,
+		Result.NumValues,
+		Result.NumMismatches,
+		*Mismatch,
+		(Double)Result.NumInstrs,
+		Result.NumCompiled,
+		Result.NumRejected
+	);
+}
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
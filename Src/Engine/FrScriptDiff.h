@@ -0,0 +1,81 @@
+/*=============================================================================
+    FrScriptDiff.h: Script VM differential test.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    CScriptDiff.
+-----------------------------------------------------------------------------*/
+
+//
+// A script VM mode, the level is played with.
+//
+enum EScriptMode
+{
+	SMODE_Legacy,		// Bytecode interpreter, the reference.
+	SMODE_Linked,		// Linked code, not optimized.
+	SMODE_Optimized,	// Optimized linked code.
+	SMODE_Jit,			// Machine code, with checks.
+	SMODE_JitLean,		// Machine code, lean if verified.
+	SMODE_MAX
+};
+
+
+//
+// A differential run result of the single mode,
+// compared with the reference mode.
+//
+struct TScriptDiffResult
+{
+public:
+	EScriptMode		Mode;
+	Integer			NumFrames;
+	Integer			NumValues;		// Values in the reference state.
+	Integer			NumMismatches;
+	String			FirstMismatch;	// Reference and mode's values.
+	QWord			NumInstrs;		// Executed VM instructions.
+	Integer			NumCompiled;	// Functions, compiled by JIT.
+	Integer			NumRejected;	// Functions, left to VM by JIT.
+};
+
+
+//
+// A script VM differential test. Level is played from the
+// same seed, with fixed delta, once per VM mode, and the
+// final state of all entities, their components and script
+// properties, and the number of played frames, is compared
+// with the bytecode interpreter's one, so optimizer and JIT
+// mistakes show up as different values.
+//
+class CScriptDiff
+{
+public:
+	// CScriptDiff interface.
+	CScriptDiff();
+	~CScriptDiff();
+	void SetMode( EScriptMode Mode );
+	void Capture( FLevel* Level, Integer NumFrames, TArray<String>& State );
+	static void Compare( const TArray<String>& Reference, const TArray<String>& State, TScriptDiffResult& Result );
+
+	// Utility.
+	static const Char* GetModeName( EScriptMode Mode );
+	static String ToJSON( const TScriptDiffResult& Result );
+
+private:
+	// Saved VM settings.
+	Bool			bOldLinked;
+	Bool			bOldOptimize;
+	Bool			bOldJit;
+	Bool			bOldLean;
+	Integer			OldHotCalls;
+
+	// Internal.
+	void UnlinkAll();
+	void CaptureObject( String Name, FObject* Object, TArray<String>& State );
+	void CaptureValue( String Name, const CTypeInfo& Type, const void* Addr, TArray<String>& State );
+};
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
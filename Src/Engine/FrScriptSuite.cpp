@@ -0,0 +1,146 @@
+/*=============================================================================
+    FrScriptSuite.cpp: Script benchmark suite runner.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+#include "Engine.h"
+
+/*-----------------------------------------------------------------------------
+    CScriptSuite implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Start playing the benchmark script in the new level.
+//
+CScriptSuite::CScriptSuite( FScript* InScript )
+	:	Script( InScript )
+{
+	assert(Script && Script->bHasText);
+
+	Level	= NewObject<FLevel>( String::Format( L"ScriptSuite%s", *Script->GetName() ) );
+	Level->CreateEntity( Script, L"", TVector( 0.f, 0.f ) );
+	Level->BeginPlay();
+}
+
+
+//
+// Stop playing and destroy the level with all
+// spawned entities.
+//
+CScriptSuite::~CScriptSuite()
+{
+	Level->EndPlay();
+	DestroyObject( Level, true );
+}
+
+
+//
+// Tick the level for a while, then measure the
+// next frames.
+//
+void CScriptSuite::Run( Integer NumWarmup, Integer NumFrames, Float Delta, TScriptSuiteResult& Result )
+{
+	NumFrames	= Max( NumFrames, 1 );
+
+	// Let threads start and code become hot.
+	for( Integer i=0; i<NumWarmup; i++ )
+		Tick( Delta );
+
+	Bool	bFound;
+	QWord	StartOps	= CountOps( bFound );
+	QWord	StartInstrs	= CFrame::NumExecuted;
+	long	StartAllocs	= GNumAllocs;
+	Double	StartTime	= GPlat->TimeStamp();
+
+	for( Integer i=0; i<NumFrames; i++ )
+		Tick( Delta );
+
+	Double	Time		= GPlat->TimeStamp() - StartTime;
+	long	NumAllocs	= GNumAllocs - StartAllocs;
+	QWord	NumInstrs	= CFrame::NumExecuted - StartInstrs;
+	QWord	NumOps		= CountOps( bFound ) - StartOps;
+
+	Result.Name			= Script->GetName();
+	Result.bFailed		= !bFound || NumOps == 0;
+	Result.NumFrames	= NumFrames;
+	Result.NumEntities	= Level->Entities.Num();
+	Result.NumOps		= NumOps;
+	Result.NsPerOp		= NumOps ? Time * 1000000000.0 / NumOps : 0.0;
+	Result.AllocsPerOp	= NumOps ? (Double)NumAllocs / NumOps : 0.0;
+	Result.InstrsPerOp	= NumOps ? (Double)NumInstrs / NumOps : 0.0;
+	Result.FrameTime	= Time * 1000.0 / NumFrames;
+}
+
+
+//
+// Tick the level and call OnTick of the entities,
+// which are not ticked by the physics.
+//
+void CScriptSuite::Tick( Float Delta )
+{
+	Level->Tick( Delta );
+
+	for( Integer i=0; i<Level->Entities.Num(); i++ )
+	{
+		FEntity* Entity = Level->Entities[i];
+		if( Entity && !Entity->Base->IsA(FPhysicComponent::MetaClass) )
+			Entity->CallEvent( EVENT_OnTick, Delta );
+	}
+}
+
+
+//
+// Sum 'Ops' properties of all entities in the level.
+//
+QWord CScriptSuite::CountOps( Bool& bFound )
+{
+	QWord Result	= 0;
+	bFound			= false;
+
+	for( Integer i=0; i<Level->Entities.Num(); i++ )
+	{
+		FEntity* Entity = Level->Entities[i];
+		if( !Entity || !Entity->Script->bHasText )
+			continue;
+
+		for( Integer iProp=0; iProp<Entity->Script->Properties.Num(); iProp++ )
+		{
+			CProperty* Prop = Entity->Script->Properties[iProp];
+			if( Prop->Type == TYPE_Integer && Prop->ArrayDim == 1 && Prop->Name == L"Ops" )
+			{
+				Result	+= *(Integer*)&Entity->InstanceBuffer->Data[Prop->Offset];
+				bFound	= true;
+				break;
+			}
+		}
+	}
+
+	return Result;
+}
+
+
+//
+// Convert a script result to the JSON object.
+//
+String CScriptSuite::ToJSON( const TScriptSuiteResult& Result )
+{
+	return String::Format
+	(
+		L"{ \"bench\": \"%s\", \"failed\": %s, \"frames\": %d, \"entities\": %d, \"ops\": %.0f, "
+		L"\"ns_per_op\": %.3f, \"allocs_per_op\": %.4f, \"instrs_per_op\": %.2f, \"frame_ms\": %.3f }",
+		*Result.Name,
+		Result.bFailed ? L"true" : L"false",
+		Result.NumFrames,
+		Result.NumEntities,
+		(Double)Result.NumOps,
+		Result.NsPerOp,
+		Result.AllocsPerOp,
+		Result.InstrsPerOp,
+		Result.FrameTime
+	);
+}
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
@@ -0,0 +1,61 @@
+/*=============================================================================
+    FrScriptSuite.h: Script benchmark suite runner.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    CScriptSuite.
+-----------------------------------------------------------------------------*/
+
+//
+// A benchmark script result. Each benchmark script counts
+// its work in the 'Ops' property, of itself, or of the
+// entities it spawns, all values are per such operation.
+//
+struct TScriptSuiteResult
+{
+public:
+	String			Name;
+	Bool			bFailed;		// Script has no 'Ops', or did nothing.
+	Integer			NumFrames;
+	Integer			NumEntities;	// Entities in the level after warmup.
+	QWord			NumOps;
+	Double			NsPerOp;
+	Double			AllocsPerOp;	// Heap allocations, see GNumAllocs.
+	Double			InstrsPerOp;	// Executed VM instructions.
+	Double			FrameTime;		// Average frame time, in milliseconds.
+};
+
+
+//
+// A benchmark scripts runner. It plays a single entity of
+// the compiled benchmark script in the fresh transient
+// level, and ticks the level without render and audio.
+// The rect based entities are not ticked by the physics,
+// so runner calls their OnTick itself.
+//
+class CScriptSuite
+{
+public:
+	// CScriptSuite interface.
+	CScriptSuite( FScript* InScript );
+	~CScriptSuite();
+	void Run( Integer NumWarmup, Integer NumFrames, Float Delta, TScriptSuiteResult& Result );
+
+	// Utility.
+	static String ToJSON( const TScriptSuiteResult& Result );
+
+private:
+	// Variables.
+	FScript*		Script;
+	FLevel*			Level;
+
+	// Internal.
+	void Tick( Float Delta );
+	QWord CountOps( Bool& bFound );
+};
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
@@ -350,7 +350,7 @@ FAnimatedSpriteComponent::FAnimatedSpriteComponent()
 void FAnimatedSpriteComponent::InitForEntity( FEntity* InEntity )
 {
 	FExtraComponent::InitForEntity( InEntity );
-	com_add(TickObjects);
+	com_add_tick();
 	com_add(RenderObjects);
 }
 
@@ -536,13 +536,8 @@ void FAnimatedSpriteComponent::Export( CExporterBase& Ex )
 //
 // Play an animation.
 //
-void FAnimatedSpriteComponent::nativePlayAnim( CFrame& Frame )
+void FAnimatedSpriteComponent::nativePlayAnim( CFrame& Frame, const String& ASeqName, Float ARate, Byte AType )
 {
-	// Pop arguments.
-	String		ASeqName	= POP_STRING;
-	Float		ARate		= POP_FLOAT;
-	EAnimType	AType		= (EAnimType)POP_BYTE;
-
 	if( !Animation )
 	{
 		log( L"Anim: Error in '%s': No animation to play", *Entity->GetFullName() );
@@ -563,12 +558,12 @@ void FAnimatedSpriteComponent::nativePlayAnim( CFrame& Frame )
 			this->Frame	= 0.f;
 
 		Rate		= ARate;
-		AnimType	= AType;
+		AnimType	= (EAnimType)AType;
 	}
 	else
 	{
 		// Start not sequence.
-		AnimType	= AType;
+		AnimType	= (EAnimType)AType;
 		iSequence	= iSeq;
 		bBackward	= false;
 		Rate		= ARate;
@@ -580,14 +575,14 @@ void FAnimatedSpriteComponent::nativePlayAnim( CFrame& Frame )
 //
 // Return the name of current played sequence.
 //
-void FAnimatedSpriteComponent::nativeGetAnimName( CFrame& Frame )
+String FAnimatedSpriteComponent::nativeGetAnimName( CFrame& Frame )
 {
 	if( Animation && Rate != 0.f && iSequence < Animation->Sequences.Num() )
 	{
-		*POPA_STRING	= Animation->Sequences[iSequence].Name;
+		return Animation->Sequences[iSequence].Name;
 	}
 	else
-		*POPA_STRING	= L"";
+		return L"";
 }
 
 
@@ -24,7 +24,7 @@ public:
 	{
 		Self	= Other.Self;
 		if( Self )
-			Self->RefsCount++;
+			AddRef();
 	}
 
 	// Characters array constructor.
@@ -108,7 +108,7 @@ public:
 		if( Other.Self )
 		{
 			Self	= Other.Self;
-			Self->RefsCount++;
+			AddRef();
 		}
 		return *this;
 	}
@@ -130,7 +130,7 @@ public:
 				New->Length	= Self->Length;
 				New->RefsCount	= 1;
 				MemCopy( New->Data, Self->Data, (Self->Length+1)*sizeof(Char) );
-				Self->RefsCount--;
+				DeleteString();
 				Self	= New;
 			}
 			return Self->Data[i];
@@ -254,6 +254,11 @@ public:
 	static Integer CompareText( String Str1, String Str2 );
 	static TArray<String> WrapText( String Text, Integer MaxColumnSize );
 
+	// Whether reference counters are changed atomically.
+	// Should be set, while strings are shared between
+	// threads, otherwise counting is cheaper.
+	static Bool bThreadSafe;
+
 	// Friends.
 	friend void Serialize( CSerializer& S, String& V );
 
@@ -283,12 +288,21 @@ private:
 	{
 		if( Self )
 		{
-			if( --Self->RefsCount == 0 )
+			if( bThreadSafe ? _InterlockedDecrement((volatile long*)&Self->RefsCount) == 0 : --Self->RefsCount == 0 )
 				MemFree(Self);
 			Self	= nullptr;
 		}
 	}
 
+	// Add a reference to the string data.
+	void AddRef()
+	{
+		if( bThreadSafe )
+			_InterlockedIncrement( (volatile long*)&Self->RefsCount );
+		else
+			Self->RefsCount++;
+	}
+
 	// Change string length.
 	void SetLength( Integer NewLen )
 	{
@@ -302,7 +316,7 @@ private:
 					New->Length	= NewLen;
 					New->RefsCount	= 1;
 					MemCopy( New->Data, Self->Data, Self->Length*sizeof(Char) );
-					Self->RefsCount--;
+					DeleteString();
 					Self	= New;
 				}
 				else
@@ -439,9 +439,9 @@ void FRectComponent::Render( CCanvas* Canvas )
 //
 // Return true, if rect appeared on screen.
 //
-void FRectComponent::nativeIsShown( CFrame& Frame )
+Bool FRectComponent::nativeIsShown( CFrame& Frame )
 {
-	*POPA_BOOL	= bShown;
+	return bShown;
 }
 
 
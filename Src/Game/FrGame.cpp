@@ -25,6 +25,12 @@
 #define CONFIG_DIR			L"Game.ini"
 
 
+//
+// Objects in the recorded physics benchmark scene.
+//
+#define REPLAY_BENCH_OBJECTS	400
+
+
 //
 // Forward declaration.
 //
@@ -53,7 +59,10 @@ CGame*	GGame	= nullptr;
 CGame::CGame()
 	:	CApplication(),
 		Console( nullptr ),
-		Level( nullptr )
+		Level( nullptr ),
+		Replay( nullptr ),
+		ReplayBench( nullptr ),
+		ExitCode( 0 )
 {
 	// Say hello to user.
 	log( L"========================="			);
@@ -187,6 +196,23 @@ void CGame::Init( HINSTANCE InhInstance )
 	GAudio->MusicVolume		= Config->ReadFloat( L"Audio",	L"MusicVolume",		1.f );
 	GAudio->FXVolume		= Config->ReadFloat( L"Audio",	L"FXVolume",		1.f );
 
+	// Physics settings.
+	CPhysicsScene::bParallel		= Config->ReadBool( L"Physics", L"Parallel", false );
+	CPhysicsScene::NumSubsteps		= Config->ReadInteger( L"Physics", L"Substeps", 1 );
+	CPhysicsScene::NumIterations	= Config->ReadInteger( L"Physics", L"Iterations", 8 );
+	CPhysicsScene::bCCD				= Config->ReadBool( L"Physics", L"CCD", true );
+	CPhysicsScene::bCoalesceEvents	= Config->ReadBool( L"Physics", L"CoalesceEvents", false );
+	CPhysicsScene::bBatchJoints		= Config->ReadBool( L"Physics", L"BatchJoints", true );
+	CPhysicsScene::NumJointIterations	= Config->ReadInteger( L"Physics", L"JointIterations", 8 );
+
+	// Script settings.
+	CFrame::bLinkedCode				= Config->ReadBool( L"Script", L"LinkedCode", true );
+	CLinkedCode::bOptimize			= Config->ReadBool( L"Script", L"Optimize", true );
+	CThreadScheduler::bWatchWaits	= Config->ReadBool( L"Script", L"WatchWaits", true );
+	CJit::bEnabled					= Config->ReadBool( L"Script", L"Jit", true );
+	CFrame::bLeanCode				= Config->ReadBool( L"Script", L"LeanCode", true );
+	CFrame::WatchdogBudget			= Config->ReadFloat( L"Script", L"WatchdogMs", 1000.f ) / 1000.0;
+
 	// Show the window.
 	ShowWindow( hWnd, /*SW_SHOWNORMAL*/SW_SHOWMAXIMIZED );
 	UpdateWindow( hWnd );
@@ -234,6 +260,22 @@ void CGame::Init( HINSTANCE InhInstance )
 		if( Entry )
 		{
 			RunLevel( Entry, true );
+
+			// Headless physics benchmark.
+			if( GCmdLine[3] == L"-physbench" )
+			{
+				BenchPhysics( L"All", 0, 600, GCmdLine[4] ? GCmdLine[4] : String(L"PhysBench.json") );
+				PostMessage( hWnd, WM_CLOSE, 0, 0 );
+			}
+
+			// Headless script VM differential test of all the
+			// game levels, any mismatch fails the process.
+			if( GCmdLine[3] == L"-scriptdiff" )
+			{
+				if( !DiffScripts( 600, GCmdLine[4] ? GCmdLine[4] : String(L"ScriptDiff.json"), true ) )
+					ExitCode	= 1;
+				PostMessage( hWnd, WM_CLOSE, 0, 0 );
+			}
 		}
 		else
 			log( L"Game: Entry level not found!" );
@@ -295,7 +337,21 @@ void CGame::Tick( Float Delta )
 		// Tick, things, which need tick.
 		if( Level )	
 		{
+			// Replay is recorded with fixed delta.
+			if( Replay )
+			{
+				Delta	= Replay->Delta;
+				Replay->BeginFrame();
+
+				if( ReplayBench )
+					ReplayBench->Drive( Delta );
+			}
+
 			Level->Tick( Delta );
+
+			if( Replay )
+				Replay->EndFrame();
+
 			GAudio->Tick( Delta, Level );
 		}
 
@@ -345,6 +401,9 @@ void CGame::Tick( Float Delta )
 //
 void CGame::Exit()
 {
+	// Finish recording.
+	StopReplay();
+
 	// Shutdown project, if any.
 	if( Project )
 	{
@@ -720,6 +779,9 @@ void CGame::RunLevel( FLevel* Source, Bool bCopy )
 {
 	assert(Source);
 
+	// Recorded level is finished.
+	StopReplay();
+
 	// Shutdown previous level.
 	if( Level )
 	{
@@ -766,6 +828,497 @@ FLevel* CGame::FindLevel( String LevName )
 }
 
 
+/*-----------------------------------------------------------------------------
+    Physics replay.
+-----------------------------------------------------------------------------*/
+
+//
+// Find a physics benchmark scene by name, return -1
+// if not found.
+//
+static Integer FindBenchScene( String SceneName )
+{
+	for( Integer i=0; i<PBENCH_MAX; i++ )
+		if( String::LowerCase(SceneName) == String::LowerCase(CPhysicsBench::GetSceneName((EPhysBench)i)) )
+			return i;
+
+	return -1;
+}
+
+
+//
+// Restart the current level and record its physics
+// replay, until StopReplay or level change. Optionally
+// the benchmark scene is built in the level.
+//
+void CGame::RecordReplay( String FileName, String SceneName )
+{
+	if( !Level || !Level->IsTemporal() )
+	{
+		log( L"Game: Current level is not restartable" );
+		return;
+	}
+
+	Integer Scene	= SceneName ? FindBenchScene( SceneName ) : -1;
+	if( SceneName && Scene == -1 )
+	{
+		log( L"Game: Bench scene '%s' not found", *SceneName );
+		return;
+	}
+
+	// Restart level with known seed.
+	DWord Seed	= GetTickCount();
+	srand( Seed );
+	RunLevel( Level->Original, true );
+
+	if( Scene != -1 )
+	{
+		ReplayBench	= new CPhysicsBench( Level );
+		if( !ReplayBench->Setup( (EPhysBench)Scene, REPLAY_BENCH_OBJECTS ) )
+		{
+			log( L"Game: Bench scene '%s' skipped, no suitable scripts in project", *SceneName );
+			freeandnil(ReplayBench);
+			return;
+		}
+	}
+
+	Replay		= new CPhysicsReplay();
+	ReplayFile	= String::Pos( L":\\", FileName ) != -1 ? FileName : GDirectory+L"\\"+FileName;
+	Replay->StartRecord( Level, GInput, Seed, 1.f/60.f );
+	Replay->Scene		= Scene;
+	Replay->NumObjects	= REPLAY_BENCH_OBJECTS;
+
+	log( L"Game: Recording replay to '%s'", *ReplayFile );
+}
+
+
+//
+// Stop replay recording and save the trace.
+//
+void CGame::StopReplay()
+{
+	if( !Replay )
+		return;
+
+	if( Replay->SaveTrace( ReplayFile ) )
+		log( L"Game: Replay saved to '%s'", *ReplayFile );
+
+	Replay->Report();
+	freeandnil(Replay);
+	freeandnil(ReplayBench);
+}
+
+
+//
+// Replay the recorded trace on the current level without
+// render and audio, and report whether physics diverged
+// from the trace.
+//
+void CGame::VerifyReplay( String FileName )
+{
+	if( !Level || !Level->IsTemporal() )
+	{
+		log( L"Game: Current level is not restartable" );
+		return;
+	}
+
+	StopReplay();
+
+	CPhysicsReplay	Verify;
+	FLevel*			Original	= Level->Original;
+
+	FileName	= String::Pos( L":\\", FileName ) != -1 ? FileName : GDirectory+L"\\"+FileName;
+	if( !Verify.LoadTrace( FileName ) )
+	{
+		log( L"Game: Bad replay file '%s'", *FileName );
+		return;
+	}
+
+	// Restart level with the recorded seed, and build
+	// the recorded scene.
+	srand( Verify.Seed );
+	RunLevel( Original, true );
+
+	CPhysicsBench Bench( Level );
+	if( Verify.Scene >= 0 && Verify.Scene < PBENCH_MAX && !Bench.Setup( (EPhysBench)Verify.Scene, Verify.NumObjects ) )
+	{
+		log( L"Game: Replay scene skipped, no suitable scripts in project" );
+		RunLevel( Original, true );
+		return;
+	}
+
+	Verify.StartVerify( Level, GInput );
+
+	// Run all the frames.
+	while( !Verify.IsFinished() && !GIncomingLevel )
+	{
+		Verify.BeginFrame();
+		if( Verify.Scene != -1 )
+			Bench.Drive( Verify.Delta );
+		Level->Tick( Verify.Delta );
+		Verify.EndFrame();
+	}
+
+	if( GIncomingLevel )
+	{
+		log( L"Game: Level travel during replay" );
+		GIncomingLevel.Destination	= nullptr;
+		GIncomingLevel.Teleportee	= nullptr;
+		GIncomingLevel.bCopy		= false;
+	}
+
+	Verify.Report();
+
+	// Replayed level is out of sync with input, so
+	// start it again.
+	RunLevel( Original, true );
+}
+
+
+/*-----------------------------------------------------------------------------
+    Physics benchmark.
+-----------------------------------------------------------------------------*/
+
+//
+// Run physics benchmark scenes on the copies of the
+// current level, without render and audio. Each scene runs
+// with 1 thread and with all workers, and traces of both
+// runs must match. Zero objects means the standard sizes.
+// Results are written to the file as JSON, to track them
+// across builds.
+//
+void CGame::BenchPhysics( String SceneName, Integer NumObjects, Integer NumFrames, String FileName )
+{
+	if( !Level || !Level->IsTemporal() )
+	{
+		log( L"Game: Current level is not restartable" );
+		return;
+	}
+
+	StopReplay();
+
+	FLevel*			Original		= Level->Original;
+	TArray<String>	Lines;
+	TArray<Integer>	Sizes;
+	Bool			bAll			= String::LowerCase(SceneName) == L"all";
+	Bool			bOldParallel	= CPhysicsScene::bParallel;
+	Integer			NumDiverged		= 0;
+
+	if( NumObjects > 0 )
+		Sizes.Push( NumObjects );
+	else
+		for( Integer i=0; i<PBENCH_NUM_SIZES; i++ )
+			Sizes.Push( GPhysBenchSizes[i] );
+
+	for( Integer i=0; i<PBENCH_MAX; i++ )
+	{
+		EPhysBench Scene = (EPhysBench)i;
+		if( !bAll && String::LowerCase(SceneName) != String::LowerCase(CPhysicsBench::GetSceneName(Scene)) )
+			continue;
+
+		// Fixed scenes ignore the size.
+		Integer	NumSizes	= CPhysicsBench::IsFixedScene(Scene) ? 1 : Sizes.Num();
+		Bool	bSkipped	= false;
+
+		for( Integer iSize=0; iSize<NumSizes && !bSkipped; iSize++ )
+		{
+			DWord SerialHash	= 0;
+
+			for( Integer iThreads=0; iThreads<2; iThreads++ )
+			{
+				// Each run is on the fresh level.
+				CPhysicsScene::bParallel	= iThreads == 1;
+				srand( 1 );
+				RunLevel( Original, true );
+
+				CPhysicsBench		Bench( Level );
+				TPhysBenchResult	Result;
+				MemZero( &Result, sizeof(TPhysBenchResult) );
+				Result.Scene	= Scene;
+
+				if( !Bench.Setup( Scene, Sizes[iSize] ) )
+				{
+					Result.bSkipped	= true;
+					bSkipped		= true;
+					log( L"PhysBench: %s skipped, no suitable scripts in project", CPhysicsBench::GetSceneName(Scene) );
+					Lines.Push( CPhysicsBench::ToJSON( Result ) );
+					break;
+				}
+
+				Bench.Run( NumFrames, 1.f/60.f, Result );
+
+				if( iThreads == 0 )
+					SerialHash				= Result.TraceHash;
+				else
+					Result.bMatchSerial		= Result.TraceHash == SerialHash;
+
+				log
+				( 
+					L"PhysBench: %s %d objects, %d threads, %.2f fps, broad %.3f ms, narrow %.3f ms, solve %.3f ms, events %.3f ms, other %.3f ms", 
+					CPhysicsBench::GetSceneName(Scene),
+					Result.NumObjects,
+					Result.NumThreads,
+					Result.FPS,
+					Result.BroadTime,
+					Result.NarrowTime,
+					Result.SolveTime,
+					Result.EventsTime,
+					Result.OtherTime
+				);
+
+				log( L"PhysBench: %d awake, %d asleep, frame %.3f ms, trace %08x", Result.NumAwake, Result.NumAsleep, Result.FrameTime, Result.TraceHash );
+
+				if( Scene == PBENCH_Bullets )
+					log( L"PhysBench: %d sweeps, %d hits, %d tunneled", Result.NumSwept, Result.NumSweepHits, Result.NumTunneled );
+
+				if( CPhysicsBench::IsFixedScene(Scene) )
+					log( L"PhysBench: settled at frame %d, drift %.4f", Result.SettleFrame, Result.Drift );
+
+				if( !Result.bMatchSerial )
+				{
+					log( L"PhysBench: %s %d threads diverged from 1 thread", CPhysicsBench::GetSceneName(Scene), Result.NumThreads );
+					NumDiverged++;
+				}
+
+				Lines.Push( CPhysicsBench::ToJSON( Result ) );
+			}
+		}
+	}
+
+	CPhysicsScene::bParallel	= bOldParallel;
+
+	// Leave level without pending travel.
+	if( GIncomingLevel )
+	{
+		GIncomingLevel.Destination	= nullptr;
+		GIncomingLevel.Teleportee	= nullptr;
+		GIncomingLevel.bCopy		= false;
+	}
+
+	// Write the report.
+	if( FileName && Lines.Num() > 0 )
+	{
+		FileName	= String::Pos( L":\\", FileName ) != -1 ? FileName : GDirectory+L"\\"+FileName;
+		CTextWriter Writer( FileName );
+
+		Writer.WriteString( L"{" );
+		Writer.WriteString( String::Format( L"  \"engine\": \"%s %s\",", FLU_NAME, FLU_VER ) );
+		Writer.WriteString( String::Format( L"  \"level\": \"%s\",", *Original->GetName() ) );
+		Writer.WriteString( String::Format( L"  \"workers\": %d,", GPlat->NumWorkers() ) );
+		Writer.WriteString( String::Format( L"  \"deterministic\": %s,", NumDiverged == 0 ? L"true" : L"false" ) );
+		Writer.WriteString( L"  \"scenes\":" );
+		Writer.WriteString( L"  [" );
+		for( Integer i=0; i<Lines.Num(); i++ )
+			Writer.WriteString( String::Format( L"    %s%s", *Lines[i], i < Lines.Num()-1 ? L"," : L"" ) );
+		Writer.WriteString( L"  ]" );
+		Writer.WriteString( L"}" );
+
+		log( L"Game: Physics benchmark saved to '%s'", *FileName );
+	}
+
+	// Restore spoiled level.
+	RunLevel( Original, true );
+}
+
+
+/*-----------------------------------------------------------------------------
+    Script benchmark.
+-----------------------------------------------------------------------------*/
+
+//
+// Run script VM kernels with the bytecode interpreter,
+// the linked code and the JIT. Results are written to
+// the file as JSON.
+//
+void CGame::BenchScript( Integer NumIterations, String FileName )
+{
+	CScriptBench		Bench;
+	TArray<String>		Lines;
+
+	for( Integer i=0; i<SBENCH_MAX; i++ )
+	{
+		TScriptBenchResult Result;
+		Bench.Run( (EScriptBench)i, NumIterations, Result );
+		log
+		( 
+			L"ScriptBench: %s legacy %.2f ns, linked %.2f ns, speedup %.2fx, instrs %.1f -> %.1f, lean speedup %.2fx%s, jit %.2f ns, speedup %.2fx%s", 
+			CScriptBench::GetBenchName(Result.Bench),
+			Result.LegacyTime,
+			Result.LinkedTime,
+			Result.Speedup,
+			Result.LegacyInstrs,
+			Result.LinkedInstrs,
+			Result.LeanSpeedup,
+			!Result.bVerified ? L" (not verified)" : L"",
+			Result.JitTime,
+			Result.JitSpeedup,
+			!Result.bJitted ? L" (not compiled)" : !Result.bJitMatch ? L" (MISMATCH)" : L""
+		);
+		Lines.Push( CScriptBench::ToJSON( Result ) );
+	}
+
+	// Write the report.
+	if( FileName )
+	{
+		FileName	= String::Pos( L":\\", FileName ) != -1 ? FileName : GDirectory+L"\\"+FileName;
+		CTextWriter Writer( FileName );
+
+		Writer.WriteString( L"{" );
+		Writer.WriteString( String::Format( L"  \"engine\": \"%s %s\",", FLU_NAME, FLU_VER ) );
+		Writer.WriteString( String::Format( L"  \"threaded\": %s,", FLU_THREADED_VM ? L"true" : L"false" ) );
+		Writer.WriteString( String::Format( L"  \"jit\": %s,", FLU_JIT && CJit::bEnabled ? L"true" : L"false" ) );
+		Writer.WriteString( L"  \"kernels\":" );
+		Writer.WriteString( L"  [" );
+		for( Integer i=0; i<Lines.Num(); i++ )
+			Writer.WriteString( String::Format( L"    %s%s", *Lines[i], i < Lines.Num()-1 ? L"," : L"" ) );
+		Writer.WriteString( L"  ]" );
+		Writer.WriteString( L"}" );
+
+		log( L"Game: Script benchmark saved to '%s'", *FileName );
+	}
+}
+
+
+//
+// Play the current level, or each game level, from the
+// same seed with each script VM mode, and compare the final
+// script state with the bytecode interpreter's one. Results
+// are written to the file as JSON. Return true, if all modes
+// match.
+//
+Bool CGame::DiffScripts( Integer NumFrames, String FileName, Bool bAllLevels )
+{
+	if( !Level || !Level->IsTemporal() )
+	{
+		log( L"Game: Current level is not restartable" );
+		return false;
+	}
+
+	StopReplay();
+
+	FLevel*				Original	= Level->Original;
+	TArray<FLevel*>		Levels;
+	TArray<String>		Reference, State;
+	TArray<String>		Lines;
+	Integer				NumFailed	= 0;
+
+	if( bAllLevels )
+		Levels	= LevelList;
+	else
+		Levels.Push( Original );
+
+	{
+		CScriptDiff Diff;
+
+		for( Integer iLevel=0; iLevel<Levels.Num(); iLevel++ )
+		{
+			TArray<String>	Modes;
+			Integer			NumModesFailed	= 0;
+
+			for( Integer i=0; i<SMODE_MAX; i++ )
+			{
+				EScriptMode Mode = (EScriptMode)i;
+
+				// Stop the level, before its code is unlinked.
+				Level->EndPlay();
+				DestroyObject( Level, true );
+				Level	= nullptr;
+				Diff.SetMode( Mode );
+
+				Integer	OldCompiled	= CJit::NumCompiled;
+				Integer	OldRejected	= CJit::NumRejected;
+
+				srand( 1 );
+				RunLevel( Levels[iLevel], true );
+
+				QWord	StartInstrs	= CFrame::NumExecuted;
+				Integer	iFrame;
+				for( iFrame=0; iFrame<NumFrames && !GIncomingLevel; iFrame++ )
+					Level->Tick( 1.f/60.f );
+
+				// Level travel stops the run, at the same frame in
+				// all modes, if they match.
+				if( GIncomingLevel )
+				{
+					GIncomingLevel.Destination	= nullptr;
+					GIncomingLevel.Teleportee	= nullptr;
+					GIncomingLevel.bCopy		= false;
+				}
+
+				TScriptDiffResult Result;
+				Result.Mode			= Mode;
+				Result.NumFrames	= iFrame;
+				Result.NumInstrs	= CFrame::NumExecuted - StartInstrs;
+				Result.NumCompiled	= CJit::NumCompiled - OldCompiled;
+				Result.NumRejected	= CJit::NumRejected - OldRejected;
+
+				Diff.Capture( Level, iFrame, i == SMODE_Legacy ? Reference : State );
+				CScriptDiff::Compare( Reference, i == SMODE_Legacy ? Reference : State, Result );
+
+				log
+				( 
+					L"ScriptDiff: %s %s %d values, %d mismatches, %.0f instrs, %d/%d jitted%s%s", 
+					*Levels[iLevel]->GetName(),
+					CScriptDiff::GetModeName(Mode),
+					Result.NumValues,
+					Result.NumMismatches,
+					(Double)Result.NumInstrs,
+					Result.NumCompiled,
+					Result.NumCompiled + Result.NumRejected,
+					Result.NumMismatches ? L", first " : L"",
+					*Result.FirstMismatch
+				);
+
+				NumModesFailed	+= Result.NumMismatches ? 1 : 0;
+				Modes.Push( CScriptDiff::ToJSON( Result ) );
+			}
+
+			// Level entry of the report.
+			Lines.Push( L"    {" );
+			Lines.Push( String::Format( L"      \"level\": \"%s\",", *Levels[iLevel]->GetName() ) );
+			Lines.Push( String::Format( L"      \"match\": %s,", NumModesFailed == 0 ? L"true" : L"false" ) );
+			Lines.Push( L"      \"modes\":" );
+			Lines.Push( L"      [" );
+			for( Integer i=0; i<Modes.Num(); i++ )
+				Lines.Push( String::Format( L"        %s%s", *Modes[i], i < Modes.Num()-1 ? L"," : L"" ) );
+			Lines.Push( L"      ]" );
+			Lines.Push( iLevel < Levels.Num()-1 ? L"    }," : L"    }" );
+
+			NumFailed	+= NumModesFailed;
+		}
+
+		// Back to the game settings.
+		Level->EndPlay();
+		DestroyObject( Level, true );
+		Level	= nullptr;
+	}
+
+	// Write the report.
+	if( FileName )
+	{
+		FileName	= String::Pos( L":\\", FileName ) != -1 ? FileName : GDirectory+L"\\"+FileName;
+		CTextWriter Writer( FileName );
+
+		Writer.WriteString( L"{" );
+		Writer.WriteString( String::Format( L"  \"engine\": \"%s %s\",", FLU_NAME, FLU_VER ) );
+		Writer.WriteString( String::Format( L"  \"jit\": %s,", FLU_JIT ? L"true" : L"false" ) );
+		Writer.WriteString( String::Format( L"  \"match\": %s,", NumFailed == 0 ? L"true" : L"false" ) );
+		Writer.WriteString( L"  \"levels\":" );
+		Writer.WriteString( L"  [" );
+		for( Integer i=0; i<Lines.Num(); i++ )
+			Writer.WriteString( Lines[i] );
+		Writer.WriteString( L"  ]" );
+		Writer.WriteString( L"}" );
+
+		log( L"Game: Script diff saved to '%s'", *FileName );
+	}
+
+	// Restore spoiled level.
+	RunLevel( Original, true );
+	return NumFailed == 0;
+}
+
+
 /*-----------------------------------------------------------------------------
     Console commands execution.
 -----------------------------------------------------------------------------*/
@@ -905,6 +1458,101 @@ void CGame::ConsoleExecute( String Cmd )
 		if( Level )
 			Level->CollHash->DebugHash();
 	}
+	else if( MatchWord( Line, L"Phys" ) )
+	{
+		if( MatchWord( Line, L"Sat" ) )
+		{
+			// Polygon SAT benchmark.
+			Integer NumPairs = 100000;
+			ParseWord(Line).ToInteger( NumPairs, 100000 );
+			CPhysics::BenchmarkSAT( NumPairs );
+		}
+		else if( Level )
+		{
+			// Physics scene info.
+			Level->PhysScene->DebugScene();
+		}
+	}
+	else if( MatchWord( Line, L"Threads" ) )
+	{
+		// Script threads info.
+		if( Level )
+			Level->Scheduler->DebugScheduler();
+	}
+	else if( MatchWord( Line, L"Jit" ) )
+	{
+		// Script JIT info.
+		log
+		( 
+			L"Jit: %s, compiled %d, rejected %d, code %d bytes", 
+			FLU_JIT && CJit::bEnabled ? L"enabled" : L"disabled",
+			CJit::NumCompiled,
+			CJit::NumRejected,
+			CJit::CodeSize
+		);
+	}
+	else if( MatchWord( Line, L"Verifier" ) )
+	{
+		// Script verifier info.
+		log
+		( 
+			L"Verifier: lean code %s, watchdog %.2f ms, rejected %d", 
+			CFrame::bLeanCode ? L"enabled" : L"disabled",
+			CFrame::WatchdogBudget * 1000.0,
+			CLinkedCode::NumRejected
+		);
+	}
+	else if( MatchWord( Line, L"Bench" ) )
+	{
+		// Benchmarks.
+		if( MatchWord( Line, L"Phys" ) )
+		{
+			String	Scene		= ParseWord(Line);
+			Integer	NumObjects	= 400,
+					NumFrames	= 600;
+
+			ParseWord(Line).ToInteger( NumObjects, 400 );
+			ParseWord(Line).ToInteger( NumFrames, 600 );
+			BenchPhysics( Scene ? Scene : String(L"All"), NumObjects, NumFrames, ParseWord(Line) );
+		}
+		else if( MatchWord( Line, L"Script" ) )
+		{
+			Integer NumIterations = 1000;
+			ParseWord(Line).ToInteger( NumIterations, 1000 );
+			BenchScript( NumIterations, ParseWord(Line) );
+		}
+		else if( MatchWord( Line, L"Diff" ) )
+		{
+			Integer NumFrames = 600;
+			ParseWord(Line).ToInteger( NumFrames, 600 );
+			String FileName = ParseWord(Line);
+			DiffScripts( NumFrames, FileName, MatchWord( Line, L"All" ) );
+		}
+		else
+		{
+			log( L"Game: Bench Phys [Scene|All] [Objects|0] [Frames] [File]" );
+			log( L"Game: Bench Script [Iterations] [File]" );
+			log( L"Game: Bench Diff [Frames] [File] [All]" );
+		}
+	}
+	else if( MatchWord( Line, L"Replay" ) )
+	{
+		// Physics replay.
+		if( MatchWord( Line, L"Record" ) )
+		{
+			String FileName = ParseWord(Line);
+			RecordReplay( FileName, ParseWord(Line) );
+		}
+		else if( MatchWord( Line, L"Stop" ) )
+			StopReplay();
+		else if( MatchWord( Line, L"Verify" ) )
+			VerifyReplay( ParseWord(Line) );
+		else
+		{
+			log( L"Game: Replay Record <File> [Scene]" );
+			log( L"Game: Replay Stop|Verify <File>" );
+		}
+	}
 	else if( MatchWord( Line, L"RMode" ) )
 	{
 		// Change render mode.
@@ -1276,6 +1924,15 @@ public:
 		if( !QueryPerformanceFrequency(&LInt) )
 			error( L"'QueryPerformanceFrequency' failed." );
 		SecsPerCycle = 1.0 / (Double)LInt.QuadPart;
+
+		// Multithreading.
+		InitializeCriticalSection( &CriticalSection );
+	}
+
+	// Shutdown platform.
+	~CWinPlatform()
+	{
+		DeleteCriticalSection( &CriticalSection );
 	}
 
 	// Return current time.
@@ -1365,9 +2022,68 @@ public:
 		ShellExecute( nullptr, L"open", Target, Parms?Parms:L"", L"", SW_SHOWNORMAL );
 	}
 
+	// Return peak process memory usage in kilobytes.
+	DWord PeakMemory()
+	{
+		PROCESS_MEMORY_COUNTERS Counters;
+		if( !GetProcessMemoryInfo( GetCurrentProcess(), &Counters, sizeof(Counters) ) )
+			return 0;
+		return (DWord)(Counters.PeakWorkingSetSize / 1024);
+	}
+
+	// Return number of job workers, including
+	// the main thread.
+	Integer NumWorkers()
+	{
+		return Jobs.NumWorkers();
+	}
+
+	// Execute all jobs on the worker threads.
+	void ParallelFor( TJobFunction Func, void* Param, Integer NumJobs )
+	{
+		Jobs.ParallelFor( Func, Param, NumJobs );
+	}
+
+	// Enter the global critical section.
+	void EnterCritical()
+	{
+		EnterCriticalSection( &CriticalSection );
+	}
+
+	// Leave the global critical section.
+	void LeaveCritical()
+	{
+		LeaveCriticalSection( &CriticalSection );
+	}
+
+	// Allocate a writable memory for the generated code.
+	void* AllocExecutable( DWord Size )
+	{
+		return VirtualAlloc( nullptr, Size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+	}
+
+	// Make the written code executable, but read only.
+	Bool ProtectExecutable( void* Mem, DWord Size )
+	{
+		DWORD OldProtect;
+		return	VirtualProtect( Mem, Size, PAGE_EXECUTE_READ, &OldProtect ) &&
+				FlushInstructionCache( GetCurrentProcess(), Mem, Size );
+	}
+
+	// Release a generated code memory.
+	void FreeExecutable( void* Mem, DWord Size )
+	{
+		if( Mem )
+			VirtualFree( Mem, 0, MEM_RELEASE );
+	}
+
 private:
 	// Internal variables.
 	Double		SecsPerCycle;
+
+	// Multithreading.
+	CRITICAL_SECTION	CriticalSection;
+	CWinJobPool			Jobs;
 };
 
 
@@ -31,6 +31,12 @@ public:
 	CConsole*			Console;
 	Integer				WinWidth;
 	Integer				WinHeight;
+	Integer				ExitCode;
+
+	// Physics replay.
+	CPhysicsReplay*		Replay;
+	CPhysicsBench*		ReplayBench;
+	String				ReplayFile;
 
 	// CApplication interface.
 	void SetCaption( String NewCaption );
@@ -42,6 +48,16 @@ public:
 	void Tick( Float Delta );
 	void RunLevel( FLevel* Source, Bool bCopy );
 	FLevel* FindLevel( String LevName );
+
+	// Physics replay.
+	void RecordReplay( String FileName, String SceneName );
+	void StopReplay();
+	void VerifyReplay( String FileName );
+	void BenchPhysics( String SceneName, Integer NumObjects, Integer NumFrames, String FileName );
+
+	// Script benchmark.
+	void BenchScript( Integer NumIterations, String FileName );
+	Bool DiffScripts( Integer NumFrames, String FileName, Bool bAllLevels );
 };
 
 
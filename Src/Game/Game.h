@@ -14,6 +14,8 @@
 #include <tchar.h>
 #include <windows.h>
 #include <windowsx.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
    
 #pragma pack( push, 8 )
 #include <DbgHelp.h>
@@ -28,6 +30,7 @@
 #include "..\Engine\Engine.h"
 #include "..\Render\OpenGL\OpenGLRend.h"
 #include "..\Audio\OpenAL\OpenALAud.h"
+#include "..\Win32\FrWinJobs.h"
 
 // Game includes.
 #include "FrConsole.h"
@@ -17,7 +17,7 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLin
 	Game.MainLoop();
 	Game.Exit();
 
-	return 0;
+	return Game.ExitCode;
 }
       
 
@@ -0,0 +1,135 @@
+/*=============================================================================
+    FrWinJobs.cpp: Win32 jobs thread pool.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+
+#include "FrWinJobs.h"
+
+/*-----------------------------------------------------------------------------
+    CWinJobPool implementation.
+-----------------------------------------------------------------------------*/
+
+//
+// Pool constructor, one thread per each extra
+// processor.
+//
+CWinJobPool::CWinJobPool()
+	:	NumThreads( 0 ),
+		bThreadsReady( false ),
+		JobFunc( nullptr ),
+		JobParam( nullptr ),
+		JobsCount( 0 ),
+		iNextJob( 0 )
+{
+	SYSTEM_INFO SysInfo;
+	GetSystemInfo( &SysInfo );
+	NumThreads	= Clamp<Integer>( SysInfo.dwNumberOfProcessors-1, 0, MAX_THREADS );
+}
+
+
+//
+// Pool destructor, stop all threads.
+//
+CWinJobPool::~CWinJobPool()
+{
+	if( bThreadsReady )
+	{
+		JobFunc	= nullptr;
+		for( Integer i=0; i<NumThreads; i++ )
+			SetEvent( Workers[i].WakeEvent );
+		WaitForMultipleObjects( NumThreads, Threads, TRUE, 1000 );
+	}
+}
+
+
+//
+// Return number of job workers, including
+// the main thread.
+//
+Integer CWinJobPool::NumWorkers() const
+{
+	return NumThreads + 1;
+}
+
+
+//
+// Execute all jobs on the worker threads, the
+// calling thread works too. Returns when all
+// jobs are done.
+//
+void CWinJobPool::ParallelFor( TJobFunction Func, void* Param, Integer NumJobs )
+{
+	if( NumThreads == 0 || NumJobs <= 1 )
+	{
+		// Nothing to share.
+		for( Integer iJob=0; iJob<NumJobs; iJob++ )
+			Func( Param, iJob, 0 );
+		return;
+	}
+
+	// Lazy initialize threads.
+	if( !bThreadsReady )
+	{
+		for( Integer i=0; i<NumThreads; i++ )
+		{
+			TWorker& W	= Workers[i];
+			W.Pool		= this;
+			W.iWorker	= i+1;
+			W.WakeEvent	= CreateEvent( nullptr, FALSE, FALSE, nullptr );
+			W.DoneEvent	= CreateEvent( nullptr, FALSE, FALSE, nullptr );
+			W.Thread	= CreateThread( nullptr, 0, WorkerProc, &W, 0, nullptr );
+			DoneEvents[i]	= W.DoneEvent;
+			Threads[i]		= W.Thread;
+		}
+		bThreadsReady	= true;
+	}
+
+	// Start workers.
+	JobFunc		= Func;
+	JobParam	= Param;
+	JobsCount	= NumJobs;
+	iNextJob	= 0;
+	for( Integer i=0; i<NumThreads; i++ )
+		SetEvent( Workers[i].WakeEvent );
+
+	// Help them and wait for the end.
+	RunJobs( 0 );
+	WaitForMultipleObjects( NumThreads, DoneEvents, TRUE, INFINITE );
+}
+
+
+//
+// Grab jobs until they are end.
+//
+void CWinJobPool::RunJobs( Integer iWorker )
+{
+	Integer iJob;
+	while( (iJob = InterlockedIncrement(&iNextJob)-1) < JobsCount )
+		JobFunc( JobParam, iJob, iWorker );
+}
+
+
+//
+// Worker thread main function.
+//
+DWORD WINAPI CWinJobPool::WorkerProc( LPVOID Param )
+{
+	TWorker*		W		= (TWorker*)Param;
+	CWinJobPool*	Pool	= W->Pool;
+
+	for( ; ; )
+	{
+		WaitForSingleObject( W->WakeEvent, INFINITE );
+		if( !Pool->JobFunc )
+			break;
+
+		Pool->RunJobs( W->iWorker );
+		SetEvent( W->DoneEvent );
+	}
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/
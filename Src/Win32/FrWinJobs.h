@@ -0,0 +1,65 @@
+/*=============================================================================
+    FrWinJobs.h: Win32 jobs thread pool.
+    Copyright Jan.2017 Vlad Gordienko.
+=============================================================================*/
+#ifndef _FLU_WINJOBS_
+#define _FLU_WINJOBS_
+
+// C++ includes.
+#include <Windows.h>
+
+// Flu includes.
+#include "..\Engine\Engine.h"
+
+/*-----------------------------------------------------------------------------
+    CWinJobPool.
+-----------------------------------------------------------------------------*/
+
+//
+// A pool of worker threads to execute parallel jobs,
+// shared by the game and the editor platforms. Threads
+// are created on the first parallel job.
+//
+class CWinJobPool
+{
+public:
+	// CWinJobPool interface.
+	CWinJobPool();
+	~CWinJobPool();
+	Integer NumWorkers() const;
+	void ParallelFor( TJobFunction Func, void* Param, Integer NumJobs );
+
+private:
+	// A worker thread info.
+	struct TWorker
+	{
+	public:
+		CWinJobPool*	Pool;
+		Integer			iWorker;
+		HANDLE			Thread;
+		HANDLE			WakeEvent;
+		HANDLE			DoneEvent;
+	};
+
+	// Variables.
+	enum{ MAX_THREADS = 15 };
+	Integer				NumThreads;
+	Bool				bThreadsReady;
+	TWorker				Workers[MAX_THREADS];
+	HANDLE				DoneEvents[MAX_THREADS];
+	HANDLE				Threads[MAX_THREADS];
+	TJobFunction		JobFunc;
+	void*				JobParam;
+	Integer				JobsCount;
+	volatile LONG		iNextJob;
+
+	// Internal.
+	void RunJobs( Integer iWorker );
+	static DWORD WINAPI WorkerProc( LPVOID Param );
+};
+
+
+#endif
+/*-----------------------------------------------------------------------------
+    The End.
+-----------------------------------------------------------------------------*/